@@ -23,8 +23,8 @@ REPROSTIM_CAPTURE_PACKAGES_RUNTIME="mc"
 # dev packages are needed only during build time
 # runtime packages are needed during runtime and build time
 if [[ "$REPROSTIM_CAPTURE_ENABLED" == "1" ]]; then
-  REPROSTIM_CAPTURE_PACKAGES_DEV="libyaml-cpp-dev libspdlog-dev catch2 libv4l-dev libudev-dev libopencv-dev libcurl4-openssl-dev nlohmann-json3-dev cmake g++"
-  REPROSTIM_CAPTURE_PACKAGES_RUNTIME="mc libyaml-cpp0.7 libfmt9"
+  REPROSTIM_CAPTURE_PACKAGES_DEV="libyaml-cpp-dev libspdlog-dev catch2 libv4l-dev libudev-dev libopencv-dev libcurl4-openssl-dev liblz4-dev nlohmann-json3-dev cmake g++"
+  REPROSTIM_CAPTURE_PACKAGES_RUNTIME="mc libyaml-cpp0.7 libfmt9 liblz4-1"
 fi
 
 generate() {
@@ -4,8 +4,10 @@
 #include <unistd.h>
 #include <optional>
 #include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureDevices.h"
 #include "reprostim/CaptureThreading.h"
 #include "reprostim/CaptureRepromon.h"
+#include "reprostim/CaptureSignal.h"
 #include "yaml-cpp/yaml.h"
 
 namespace reprostim {
@@ -124,6 +126,8 @@ namespace reprostim {
 		std::string               targetMwDevPath;
 		std::string               targetVideoDevPath;
 		std::string               targetAudioInDevPath;
+		DeviceRegistry            deviceRegistry; // invalidated by USB hotplug
+		SignalMonitor             signalMonitor; // video signal of target device
 
 		static void usbHotplugCallback(MWUSBHOT_PLUG_EVETN event, const char *pszDevicePath, void* pParam);
 
@@ -135,10 +139,16 @@ namespace reprostim {
 		SessionLogger_ptr createSessionLogger(const std::string& name, const std::string& filePath);
 		void listDevices(const std::string& devices);
 		virtual bool loadConfig(AppConfig& cfg, const std::string& pathConfig);
+		// video signal changed while recording, by default
+		// recording is stopped and restarted on the next cycle
+		virtual void onCaptureChange(const std::string& message);
 		virtual void onCaptureIdle();
 		virtual void onCaptureStart();
 		virtual void onCaptureStop(const std::string& message);
 		virtual bool onLoadConfig(AppConfig& cfg, const std::string& pathConfig, YAML::Node doc);
+		// hook to run capture without Magewell device, e.g. from software
+		// frame source, returns true when handled and res is exit code
+		virtual bool onRunWithoutDevice(int& res);
 		virtual void onUsbDevArrived(const std::string& devPath);
 		virtual void onUsbDevLeft(const std::string& devPath);
 		virtual int  parseOpts(AppOpts& opts, int argc, char* argv[]);
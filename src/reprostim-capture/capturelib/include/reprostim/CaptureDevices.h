@@ -0,0 +1,80 @@
+#ifndef CAPTURE_CAPTUREDEVICES_H
+#define CAPTURE_CAPTUREDEVICES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureThreading.h"
+
+// Magewell device family name of USB capture devices
+#define _USB_CAPTURE_FAMILY "USB Capture"
+
+// devices are enumerated on every lookup during this time after
+// invalidate(), as SDK can list hotplugged device with delay
+#ifndef _DEVICE_SETTLE_MS
+#define _DEVICE_SETTLE_MS 5000
+#endif
+
+namespace reprostim {
+
+	// Magewell device channel cached by DeviceRegistry
+	struct DeviceInfo {
+		int                channelIndex = -1;
+		MWCAP_CHANNEL_INFO info{};
+		std::string        devPath;      // instance path for MWOpenChannelByPath
+		std::string        videoDevPath; // V4L2 device path, when resolved
+		std::string        busInfo;      // USB bus info of V4L2 device, when resolved
+	};
+
+	// Cache of Magewell device channels enumerated with MWRefreshDevice.
+	// Channels are kept until registry is invalidated by USB hotplug
+	// callback or by owner, e.g. when channel can't be opened, so
+	// lookups made on every capture loop cycle don't call SDK.
+	class DeviceRegistry {
+	private:
+		_DECLARE_CLASS_WITH_SYNC();
+
+		std::vector<DeviceInfo>                 m_devices;
+		std::unordered_map<std::string, size_t> m_bySerial; // USB Capture channels by S/N
+		int                                     m_firstUsb; // index in m_devices or -1
+		bool                                    m_fAccessError;
+		std::atomic<bool>                       m_fStale;
+		std::atomic<int64_t>                    m_invalidatedMs; // steady clock
+		const int                               m_settleMs;
+		MW_RESULT                               m_lastResult;
+		uint64_t                                m_enumerations;
+
+	public:
+		explicit DeviceRegistry(int settleMs = _DEVICE_SETTLE_MS);
+
+		// find USB Capture channel by S/N or the first one when serial
+		// is empty, devices are enumerated when registry is stale
+		bool find(const std::string& serial, DeviceInfo& di);
+		// copy of cached channels
+		std::vector<DeviceInfo> getDevices() const;
+		// successful enumerations made
+		uint64_t getEnumerations() const;
+		// result of the last MWRefreshDevice call
+		MW_RESULT getLastResult() const;
+		// channel without product and family IDs was found, usually
+		// means udev rules don't give access to device
+		bool hasAccessError() const;
+		// mark cached channels outdated, can be called from any thread
+		void invalidate();
+		bool isStale() const { return m_fStale; }
+		// enumerate devices when stale or fForce, returns false when
+		// MWRefreshDevice failed, then registry stays stale
+		bool refresh(bool fForce = false);
+		// remember V4L2 device resolved for USB Capture channel S/N
+		// until registry is refreshed
+		void setVideoDevice(const std::string& serial, const VDevPath& vdp);
+		size_t size() const;
+	};
+
+}
+
+#endif //CAPTURE_CAPTUREDEVICES_H
@@ -100,8 +100,13 @@ namespace reprostim {
 		std::string name;
 		std::string serial;
 		int channelIndex = -1;
+		std::string devPath;      // Magewell device instance path
+		std::string videoDevPath; // cached V4L2 device path if any
+		std::string busInfo;      // cached V4L2 device USB bus info if any
 	};
 
+	class DeviceRegistry;
+
 	//////////////////////////////////////////////////////////////////////////
 	// Functions
 
@@ -111,13 +116,17 @@ namespace reprostim {
 
 	std::string chiToString(const MWCAP_CHANNEL_INFO &info);
 
+	// run shell command and return its stdout, for commands from
+	// config only, see runProc for the rest
 	std::string exec(const std::string &cmd, bool showStdout = false,
-					 bool sessionLogOnly = false, int maxResLen = -1,
-					 std::function<bool()> isTerminated = [](){ return false; });
+					 bool sessionLogOnly = false, int maxResLen = -1);
 
 	std::string expandMacros(const std::string &text, const SDict &dict);
 
-	bool findTargetVideoDevice(const std::string &serialNumber, VideoDevice &vd);
+	// find USB Capture device in registry, devices are enumerated
+	// only when registry is stale, e.g. after USB hotplug event
+	bool findTargetVideoDevice(DeviceRegistry &registry, const std::string &serialNumber,
+							   VideoDevice &vd);
 
 	// returns audio device ALSA path and sound card ALSA name
 	AudioInDevice getAudioInDevice(const std::string &busInfo,
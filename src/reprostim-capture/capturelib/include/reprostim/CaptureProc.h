@@ -0,0 +1,127 @@
+#ifndef CAPTURE_CAPTUREPROC_H
+#define CAPTURE_CAPTUREPROC_H
+
+#include <csignal>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/types.h>
+
+// timeout of short system queries, e.g. v4l2-ctl or which
+#ifndef _PROC_QUERY_TIMEOUT_MS
+#define _PROC_QUERY_TIMEOUT_MS 5000
+#endif
+
+namespace reprostim {
+
+	// ChildProc::spawn flags
+	enum ProcSpawnFlags {
+		PROC_CAPTURE_OUT = 0x1, // stdout to pipe
+		PROC_CAPTURE_ERR = 0x2, // stderr to separate pipe
+		PROC_MERGE_ERR   = 0x4  // stderr to stdout pipe
+	};
+
+	// output stream of line passed to ProcLineFunc
+	enum ProcStream {
+		PROC_STDOUT = 1,
+		PROC_STDERR = 2
+	};
+
+	// Called per output line including trailing newline, line
+	// data is valid during the call only
+	using ProcLineFunc = std::function<void(std::string_view line, int stream)>;
+
+	// Single step of child process stop escalation, signal is sent
+	// and process exit is waited up to timeoutMs
+	struct ProcStopStep {
+		int sig;
+		int timeoutMs;
+	};
+
+	// Options of ChildProc::run
+	struct ProcRunOpts {
+		bool showOutput = false;     // log output lines as they come
+		bool sessionLogOnly = false; // log output to session log only
+		int  maxOutLen = -1;         // max collected stdout length, <=0 for unlimited
+		int  timeoutMs = -1;         // process is stopped after timeout, -1 for no timeout
+		int  cancelFd = -1;          // process is stopped when fd becomes readable
+		std::vector<ProcStopStep> stopSteps = {{SIGTERM, 1000}, {SIGKILL, 1000}};
+	};
+
+	// Child process spawned with posix_spawn in own process group
+	// and tracked with pidfd, so exit can be waited with poll() and
+	// signals are never delivered to reused pid. Falls back to
+	// waitpid() polling on kernels without pidfd_open (< 5.3).
+	class ChildProc {
+	private:
+		pid_t       m_pid;
+		int         m_pidFd;
+		int         m_outFd;  // read end of stdout pipe
+		int         m_errFd;  // read end of stderr pipe
+		std::string m_outBuf; // incomplete stdout line
+		std::string m_errBuf; // incomplete stderr line
+		int         m_status; // wait status, valid when exited
+		struct rusage m_usage; // resource usage, valid when exited
+		bool        m_exited;
+		mutable std::mutex m_mutex; // reaping can be done from several threads
+
+		void readStream(int stream, const ProcLineFunc& onLine);
+		bool reap();
+
+	public:
+		ChildProc();
+		ChildProc(const ChildProc&) = delete;
+		ChildProc& operator=(const ChildProc&) = delete;
+		~ChildProc();
+
+		// read end of stderr pipe, -1 when not captured separately
+		int getErrFd() const { return m_errFd; }
+		// exit code, or -1 when not exited or terminated by signal
+		int getExitCode() const;
+		// read end of stdout pipe, -1 when not captured
+		int getOutFd() const { return m_outFd; }
+		pid_t getPid() const { return m_pid; }
+		// -1 when pidfd is not supported
+		int getPidFd() const { return m_pidFd; }
+		// resource usage of exited process including its waited-for
+		// children, e.g. CPU time and max RSS
+		struct rusage getUsage() const;
+		bool isRunning();
+		// send signal to child process group
+		bool kill(int sig);
+		// wait up to timeoutMs for output on captured pipes, onLine is
+		// called per complete line, returns 1 on data, 0 on timeout and
+		// -1 on end of all output or error. When extraFd is specified
+		// and becomes readable, returns 0 promptly.
+		int readOutput(int timeoutMs, const ProcLineFunc& onLine, int extraFd = -1);
+		// spawn args, read stdout/stderr until process exits and return
+		// its exit code, -1 when failed to start, stopped or signaled.
+		// Stdout is collected to pOut when specified.
+		int run(const std::vector<std::string>& args, const ProcRunOpts& opts,
+				std::string* pOut = nullptr);
+		// spawn "/bin/sh -c cmd", stdout and stderr are captured to
+		// the same pipe when fCaptureOut is true
+		bool spawn(const std::string& cmd, bool fCaptureOut);
+		// spawn args[0] found in PATH without shell, with stdin from
+		// /dev/null and output pipes according to ProcSpawnFlags
+		bool spawn(const std::vector<std::string>& args, int flags);
+		// escalate signals until process exits, returns as soon as
+		// it exited, false when still running after the last step
+		bool stop(const std::vector<ProcStopStep>& steps);
+		// wait up to timeoutMs for exit, -1 for infinite wait
+		bool wait(int timeoutMs);
+	};
+
+	// args joined with spaces, for logging
+	std::string joinArgs(const std::vector<std::string>& args);
+
+	// run args with ChildProc::run
+	int runProc(const std::vector<std::string>& args, const ProcRunOpts& opts,
+				std::string* pOut = nullptr);
+
+} // reprostim
+
+#endif //CAPTURE_CAPTUREPROC_H
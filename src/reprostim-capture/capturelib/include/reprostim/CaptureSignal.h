@@ -0,0 +1,84 @@
+#ifndef CAPTURE_CAPTURESIGNAL_H
+#define CAPTURE_CAPTURESIGNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "LibMWCapture/MWCapture.h"
+
+// max wait of capture loop, video signal is polled with this
+// interval when device notifications are not available
+#ifndef _SIGNAL_POLL_MS
+#define _SIGNAL_POLL_MS 1000
+#endif
+
+// video signal status is re-read at least with this interval
+// even when notifications are enabled, in case one is lost
+#ifndef _SIGNAL_REFRESH_MS
+#define _SIGNAL_REFRESH_MS 10000
+#endif
+
+// device notifications which wake up signal monitor
+#define _SIGNAL_NOTIFY_BITS (MWCAP_NOTIFY_VIDEO_SIGNAL_CHANGE | \
+	MWCAP_NOTIFY_VIDEO_INPUT_SOURCE_CHANGE | MWCAP_NOTIFY_INPUT_SPECIFIC_CHANGE)
+
+namespace reprostim {
+
+	// Video signal monitor of Magewell device channel. Channel is
+	// kept open between capture loop cycles and signal change and
+	// input source change notifications are registered on it, so
+	// wait() returns as soon as signal changes and status is read
+	// from device only after notification. When notifications are
+	// not supported, status is read on every cycle like before.
+	class SignalMonitor {
+	private:
+		std::atomic<MWCAP_PTR>    m_hEvent;  // notification and wake event
+		HCHANNEL                  m_hChannel;
+		HNOTIFY                   m_hNotify;
+		std::string               m_devPath;
+		MWCAP_VIDEO_SIGNAL_STATUS m_vss;     // last read status
+		bool                      m_fValid;  // m_vss was read
+		bool                      m_fPending; // notified, status should be read
+		std::chrono::steady_clock::time_point m_tsRead;
+		uint64_t                  m_notifies;
+		uint64_t                  m_reads;
+
+	public:
+		SignalMonitor();
+		SignalMonitor(const SignalMonitor&) = delete;
+		SignalMonitor& operator=(const SignalMonitor&) = delete;
+		~SignalMonitor();
+
+		// unregister notifications and close channel
+		void close();
+		const std::string& getDevicePath() const { return m_devPath; }
+		// signal notifications received
+		uint64_t getNotifies() const { return m_notifies; }
+		// video signal status reads from device
+		uint64_t getReads() const { return m_reads; }
+		// current video signal status, read from device when notified,
+		// in polling mode or after refresh interval, returns false
+		// when channel is closed or device read failed
+		bool getStatus(MWCAP_VIDEO_SIGNAL_STATUS& vss);
+		bool hasNotify() const { return m_hNotify != 0; }
+		// create wake event, must be called after MWCaptureInitInstance
+		bool init();
+		bool isOpen() const { return m_hChannel != NULL; }
+		// open channel by Magewell device instance path and register
+		// notifications, returns false when channel can't be opened
+		bool open(const std::string& devPath);
+		// close channel and wake event, must be called before
+		// MWCaptureExitInstance
+		void release();
+		// wait for notification or wake() up to timeoutMs, returns
+		// true when woken up before timeout
+		bool wait(int timeoutMs);
+		// wake up wait(), can be called from any thread, e.g.
+		// from USB hotplug callback
+		void wake();
+	};
+
+}
+
+#endif //CAPTURE_CAPTURESIGNAL_H
@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <atomic>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -55,17 +57,23 @@ namespace reprostim {
 		const T m_params;
 		std::atomic<bool> m_running;
 		std::atomic<bool> m_terminated;
+		int               m_terminateFd; // eventfd signalled by stop()
 
 	public:
 		WorkerThread(const T &params);
 		virtual ~WorkerThread();
 
 		const T& getParams() const;
+		// eventfd which becomes readable on stop(), can be used in poll()
+		// to wake up blocked thread promptly, -1 when not available
+		int getTerminateFd() const;
 		bool isRunning() const;
 		bool isTerminated() const;
 		void run();
 		void start();
 		void stop();
+		// request thread to stop without waiting for it
+		void terminate();
 
 		// static helpers
 		static WorkerThread<T, U>* newInstance(const T &params);
@@ -79,10 +87,14 @@ namespace reprostim {
 	WorkerThread<T, U>::WorkerThread(const T &params) : m_params(params) {
 		m_running = false;
 		m_terminated = false;
+		m_terminateFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 	}
 
 	template<typename T, typename U>
 	WorkerThread<T, U>::~WorkerThread() {
+		if( m_terminateFd>=0 ) {
+			close(m_terminateFd);
+		}
 	}
 
 	template<typename T, typename U>
@@ -90,6 +102,11 @@ namespace reprostim {
 		return m_params;
 	}
 
+	template<typename T, typename U>
+	inline int WorkerThread<T, U>::getTerminateFd() const {
+		return m_terminateFd;
+	}
+
 	template<typename T, typename U>
 	inline bool WorkerThread<T, U>::isRunning() const {
 		return m_running;
@@ -123,6 +140,11 @@ namespace reprostim {
 	void WorkerThread<T, U>::start() {
 		m_running = false;
 		m_terminated = false;
+		if( m_terminateFd>=0 ) {
+			// drain pending stop signal
+			eventfd_t value;
+			eventfd_read(m_terminateFd, &value);
+		}
 		std::thread t(&WorkerThread::runInternal, this);
 		for (int i = 0; i < 10; i++) {
 			SLEEP_MS(100);
@@ -135,7 +157,7 @@ namespace reprostim {
 
 	template<typename T, typename U>
 	void WorkerThread<T, U>::stop() {
-		m_terminated = true;
+		terminate();
 		for (int i = 0; i < 10; i++) {
 			if (!m_running) {
 				break;
@@ -144,6 +166,14 @@ namespace reprostim {
 		}
 	}
 
+	template<typename T, typename U>
+	void WorkerThread<T, U>::terminate() {
+		m_terminated = true;
+		if( m_terminateFd>=0 ) {
+			eventfd_write(m_terminateFd, 1);
+		}
+	}
+
 	template<typename T, typename U>
 	inline WorkerThread<T, U>* WorkerThread<T, U>::newInstance(const T &params) {
 		return new WorkerThread<T, U>(params);
@@ -265,6 +295,9 @@ namespace reprostim {
 		~SingleThreadExecutor();
 
 		T* getCurrentThread() const;
+		// detach current thread from executor without stopping it,
+		// caller becomes owner of the thread
+		T* release();
 		void schedule(T* pThread);
 		void shutdown();
 	};
@@ -286,6 +319,13 @@ namespace reprostim {
 		return m_pCur;
 	}
 
+	template<typename T>
+	T* SingleThreadExecutor<T>::release() {
+		T* p = m_pCur;
+		m_pCur = nullptr;
+		return p;
+	}
+
 	template<typename T>
 	inline void SingleThreadExecutor<T>::safeDelete(T* &p) {
 		if( p ) {
@@ -0,0 +1,19 @@
+#ifndef CAPTURE_CAPTUREVER_H
+#define CAPTURE_CAPTUREVER_H
+
+/*
+    NOTE: This file is generated automatically by CaptureVer.h.in template
+    Generation date: 2026-10-17 02:57:12
+*/
+
+#define CAPTURE_VERSION_MAJOR 1
+#define CAPTURE_VERSION_MINOR 11
+#define CAPTURE_VERSION_PATCH 0
+#define CAPTURE_VERSION_BUILD 389
+//
+#define CAPTURE_VERSION_STRING "1.11.0.389"
+#define CAPTURE_VERSION_DATE "2026-10-17 02:57:12"
+#define CAPTURE_VERSION_TAG "d938934"
+#define CAPTURE_BUILD_TYPE "Release"
+
+#endif //CAPTURE_CAPTUREVER_H
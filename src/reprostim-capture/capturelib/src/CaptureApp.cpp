@@ -5,6 +5,7 @@
 #include <thread>
 #include <sysexits.h>
 #include "reprostim/CaptureApp.h"
+#include "reprostim/CaptureProc.h"
 
 namespace reprostim {
 
@@ -13,12 +14,15 @@ namespace reprostim {
 			_VERBOSE("Conduct monitoring is disabled");
 			return EX_OK;
 		}
-		std::string cmd = opts.duct_bin + " --version";
-		std::string res = exec(cmd);
+		const std::vector<std::string> args{opts.duct_bin, "--version"};
+		ProcRunOpts runOpts;
+		runOpts.timeoutMs = _PROC_QUERY_TIMEOUT_MS;
+		std::string res;
+		runProc(args, runOpts, &res);
 		if (res.empty() || !res.starts_with("duct ")) {
 			_ERROR("con/duct utility not found. Please make sure it's installed with 'pip install con-duct'");
 			_ERROR("  and configured correctly in config.yaml -> conduct_opts -> duct_bin .");
-			_ERROR("  COMMAND : " << cmd);
+			_ERROR("  COMMAND : " << joinArgs(args));
 			_ERROR("  RESULT  : " << res);
 			return EX_UNAVAILABLE;
 		}
@@ -282,6 +286,10 @@ namespace reprostim {
 		return this->onLoadConfig(cfg, pathConfig, doc);
 	}
 
+	void CaptureApp::onCaptureChange(const std::string& message) {
+		onCaptureStop(message);
+	}
+
 	void CaptureApp::onCaptureIdle() {
 	}
 
@@ -297,6 +305,11 @@ namespace reprostim {
 		return true;
 	}
 
+	bool CaptureApp::onRunWithoutDevice(int& res) {
+		// by default capture only from Magewell device
+		return false;
+	}
+
 	void CaptureApp::onUsbDevArrived(const std::string& devPath) {
 		_INFO("Connected USB device: " << devPath);
 		disconnDevRemove(devPath);
@@ -429,12 +442,21 @@ namespace reprostim {
 
 		_INFO("    <> Instance tag                ===> " << instanceTag);
 
+		int resNoDevice = EX_OK;
+		if( onRunWithoutDevice(resNoDevice) ) {
+			return resNoDevice;
+		}
+
 		BOOL fInit = MWCaptureInitInstance();
 		if( !fInit )
 			_ERROR("ERROR[005]: Failed MWCaptureInitInstance");
 
 		_VERBOSE("MWCapture SDK version: " << mwcSdkVersion());
 
+		if( !signalMonitor.init() ) {
+			_ERROR("Failed create video signal event, poll every " << _SIGNAL_POLL_MS << " ms");
+		}
+
 		// register USB hotplug callback if any
 		bool hasHotplug = true;
 		if (MWUSBRegisterHotPlug(CaptureApp::usbHotplugCallback, this) != MW_SUCCEEDED) {
@@ -445,43 +467,65 @@ namespace reprostim {
 		_NOTIFY_REPROMON(REPROMON_INFO, appName + " started, v" + CAPTURE_VERSION_STRING);
 
 		do {
-			SLEEP_SEC(1);
+			// woken up by signal change notification or USB hotplug,
+			// otherwise this is fallback poll interval
+			signalMonitor.wait(_SIGNAL_POLL_MS);
 
 			if( !targetMwDevPath.empty() && disconnDevContains(targetMwDevPath) ) {
+				signalMonitor.close();
 				onCaptureStop("Target USB device instance " + targetMwDevPath + " disconnected");
 				targetMwDevPath = "";
 				continue;
 			}
 
-			HCHANNEL hChannel = NULL;
-			if( !findTargetVideoDevice(cfg.has_device_serial_number?cfg.device_serial_number:"",
-									   targetVideoDev) ) {
-				onCaptureStop(":\tStopped recording. No channels!");
-				_VERBOSE("Wait, no channels found");
-				continue;
-			}
+			// device is searched only until its channel is open
+			if( !signalMonitor.isOpen() ) {
+				// without hotplug events devices are enumerated on every cycle
+				if( !hasHotplug ) {
+					deviceRegistry.invalidate();
+				}
+				if( !findTargetVideoDevice(deviceRegistry,
+										   cfg.has_device_serial_number?cfg.device_serial_number:"",
+										   targetVideoDev) ) {
+					onCaptureStop(":\tStopped recording. No channels!");
+					_VERBOSE("Wait, no channels found");
+					continue;
+				}
 
-			if(targetVideoDev.channelIndex < 0 ) {
-				_VERBOSE("Wait, no valid USB devices found");
-				continue;
-			}
+				if(targetVideoDev.channelIndex < 0 ) {
+					_VERBOSE("Wait, no valid USB devices found");
+					continue;
+				}
 
-			_VERBOSE("Found target device: " << targetVideoDev);
+				_VERBOSE("Found target device: " << targetVideoDev);
 
-			char wPath[256] = {0};
-			if(MWGetDevicePath(targetVideoDev.channelIndex, wPath) == MW_SUCCEEDED ) {
-				targetMwDevPath = wPath;
-				_VERBOSE("Magewell device instance path: " << wPath);
-			} else {
-				_ERROR("ERROR[006]: Failed MWGetDevicePath");
-				targetMwDevPath = "";
-			}
+				targetMwDevPath = targetVideoDev.devPath;
+				if( !targetMwDevPath.empty() ) {
+					_VERBOSE("Magewell device instance path: " << targetMwDevPath);
+				} else {
+					_ERROR("ERROR[006]: Failed MWGetDevicePath");
+					deviceRegistry.invalidate();
+					continue;
+				}
 
-			// TODO: check res
-			hChannel = MWOpenChannelByPath(wPath);
+				if( !signalMonitor.open(targetMwDevPath) ) {
+					_ERROR("Failed MWOpenChannelByPath: " << targetMwDevPath);
+					deviceRegistry.invalidate();
+					continue;
+				}
+				if( signalMonitor.hasNotify() ) {
+					_VERBOSE("Video signal notifications registered");
+				} else {
+					_VERBOSE("Video signal notifications not supported, poll every " << _SIGNAL_POLL_MS << " ms");
+				}
+			}
 
-			// TODO: check res
-			MWGetVideoSignalStatus(hChannel, &vssCur);
+			if( !signalMonitor.getStatus(vssCur) ) {
+				_ERROR("Failed MWGetVideoSignalStatus, reopen device: " << targetMwDevPath);
+				signalMonitor.close();
+				deviceRegistry.invalidate();
+				continue;
+			}
 
 			frameRate = vssFrameRate(vssCur);
 
@@ -495,8 +539,18 @@ namespace reprostim {
 						targetVideoDevPath = cfg.ffm_opts.v_dev;
 						targetBusInfo = "N/A";
 					} else {
-						VDevPath vdp = getVideoDevicePathBySerial(cfg.video_device_path_pattern,
-																  targetVideoDev.serial);
+						// V4L2 lookup runs v4l2-ctl per device, so it's cached
+						// in registry until the next hotplug event
+						VDevPath vdp = {targetVideoDev.videoDevPath, targetVideoDev.busInfo};
+						if( vdp.path.empty() ) {
+							vdp = getVideoDevicePathBySerial(cfg.video_device_path_pattern,
+															 targetVideoDev.serial);
+							if( !vdp.path.empty() ) {
+								deviceRegistry.setVideoDevice(targetVideoDev.serial, vdp);
+								targetVideoDev.videoDevPath = vdp.path;
+								targetVideoDev.busInfo = vdp.busInfo;
+							}
+						}
 						targetVideoDevPath = vdp.path;
 						targetBusInfo = vdp.busInfo;
 						if( targetVideoDevPath.empty() ) {
@@ -548,7 +602,7 @@ namespace reprostim {
 				}
 				else {
 					if( !vssEquals(vssCur, vssPrev) ) {
-						onCaptureStop(":\tStopped recording because something changed.");
+						onCaptureChange(":\tStopped recording because something changed.");
 					} else
 						onCaptureIdle(); // hook to check capture cycle
 				}
@@ -563,7 +617,6 @@ namespace reprostim {
 			}
 
 			vssPrev = vssCur;
-			safeMWCloseChannel(hChannel);
 
 			// check config changed
 			std::string configHash2 = getFileChangeHash(opts.configPath);
@@ -585,6 +638,8 @@ namespace reprostim {
 			hasHotplug = false;
 		}
 
+		signalMonitor.release();
+
 		if( fInit )
 			MWCaptureExitInstance();
 
@@ -600,6 +655,7 @@ namespace reprostim {
 	void CaptureApp::usbHotplugCallback(MWUSBHOT_PLUG_EVETN event, const char *pszDevicePath, void* pParam) {
 		if( pParam==NULL ) return;
 		CaptureApp* pApp = reinterpret_cast<CaptureApp*>(pParam);
+		pApp->deviceRegistry.invalidate();
 		switch(event) {
 			case USBHOT_PLUG_EVENT_DEVICE_ARRIVED:
 				pApp->onUsbDevArrived(pszDevicePath);
@@ -610,5 +666,7 @@ namespace reprostim {
 			default:
 				_VERBOSE("Unknown USB hotplug event: " << event << ", " << pszDevicePath);
 		}
+		// don't wait for poll interval to handle device change
+		pApp->signalMonitor.wake();
 	}
 }
@@ -0,0 +1,124 @@
+#include <cstring>
+#include "reprostim/CaptureDevices.h"
+
+namespace reprostim {
+
+	static int64_t getSteadyMs() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// DeviceRegistry
+
+	DeviceRegistry::DeviceRegistry(int settleMs):
+			m_firstUsb(-1), m_fAccessError(false), m_fStale(true), m_invalidatedMs(0),
+			m_settleMs(settleMs), m_lastResult(MW_SUCCEEDED), m_enumerations(0) {
+	}
+
+	bool DeviceRegistry::find(const std::string& serial, DeviceInfo& di) {
+		if( m_fStale && !refresh() ) {
+			return false;
+		}
+		_SYNC();
+		if( serial.empty() ) {
+			if( m_firstUsb < 0 ) {
+				return false;
+			}
+			di = m_devices[m_firstUsb];
+			return true;
+		}
+		auto it = m_bySerial.find(serial);
+		if( it == m_bySerial.end() ) {
+			return false;
+		}
+		di = m_devices[it->second];
+		return true;
+	}
+
+	std::vector<DeviceInfo> DeviceRegistry::getDevices() const {
+		_SYNC();
+		return m_devices;
+	}
+
+	uint64_t DeviceRegistry::getEnumerations() const {
+		_SYNC();
+		return m_enumerations;
+	}
+
+	MW_RESULT DeviceRegistry::getLastResult() const {
+		_SYNC();
+		return m_lastResult;
+	}
+
+	bool DeviceRegistry::hasAccessError() const {
+		_SYNC();
+		return m_fAccessError;
+	}
+
+	void DeviceRegistry::invalidate() {
+		m_invalidatedMs = getSteadyMs();
+		m_fStale = true;
+	}
+
+	bool DeviceRegistry::refresh(bool fForce) {
+		// cleared before enumeration, so hotplug event during
+		// enumeration keeps registry stale
+		if( !m_fStale.exchange(false) && !fForce ) {
+			return true;
+		}
+		_SYNC();
+		m_lastResult = MWRefreshDevice();
+		if( m_lastResult != MW_SUCCEEDED ) {
+			m_fStale = true;
+			return false;
+		}
+		m_devices.clear();
+		m_bySerial.clear();
+		m_firstUsb = -1;
+		m_fAccessError = false;
+		const int nCount = MWGetChannelCount();
+		for (int i = 0; i < nCount; i++) {
+			DeviceInfo di;
+			di.channelIndex = i;
+			if( MWGetChannelInfoByIndex(i, &di.info) != MW_SUCCEEDED ) {
+				continue;
+			}
+			char wPath[256] = {0};
+			if( MWGetDevicePath(i, wPath) == MW_SUCCEEDED ) {
+				di.devPath = wPath;
+			}
+			const size_t k = m_devices.size();
+			if( strcmp(di.info.szFamilyName, _USB_CAPTURE_FAMILY) == 0 ) {
+				if( m_firstUsb < 0 ) {
+					m_firstUsb = static_cast<int>(k);
+				}
+				// the first channel wins like in former linear search
+				m_bySerial.emplace(di.info.szBoardSerialNo, k);
+			} else if( di.info.wProductID == 0 && di.info.wFamilyID == 0 ) {
+				m_fAccessError = true;
+			}
+			m_devices.push_back(std::move(di));
+		}
+		m_enumerations++;
+		if( m_invalidatedMs != 0 && getSteadyMs() - m_invalidatedMs < m_settleMs ) {
+			m_fStale = true;
+		}
+		return true;
+	}
+
+	void DeviceRegistry::setVideoDevice(const std::string& serial, const VDevPath& vdp) {
+		_SYNC();
+		auto it = m_bySerial.find(serial);
+		if( it != m_bySerial.end() ) {
+			m_devices[it->second].videoDevPath = vdp.path;
+			m_devices[it->second].busInfo = vdp.busInfo;
+		}
+	}
+
+	size_t DeviceRegistry::size() const {
+		_SYNC();
+		return m_devices.size();
+	}
+
+}
@@ -16,6 +16,8 @@
 #include <sysexits.h>
 #include <alsa/asoundlib.h>
 #include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureDevices.h"
+#include "reprostim/CaptureProc.h"
 
 
 namespace fs = std::filesystem;
@@ -46,15 +48,20 @@ namespace reprostim {
 	}
 
 	int checkSystem() {
+		ProcRunOpts opts;
+		opts.timeoutMs = _PROC_QUERY_TIMEOUT_MS;
+
 		// check ffmpeg
-		std::string ffmpeg = exec("which ffmpeg");
+		std::string ffmpeg;
+		runProc({"which", "ffmpeg"}, opts, &ffmpeg);
 		if (ffmpeg.empty()) {
 			_ERROR("ffmpeg program not found. Please make sure ffmpeg package is installed.");
 			return EX_UNAVAILABLE;
 		}
 
 		// check v4l2-ctl
-		std::string v4l2ctl = exec("which v4l2-ctl");
+		std::string v4l2ctl;
+		runProc({"which", "v4l2-ctl"}, opts, &v4l2ctl);
 		if (v4l2ctl.empty()) {
 			_ERROR("v4l2-ctl program not found. Please make sure v4l-utils package is installed.");
 			return EX_UNAVAILABLE;
@@ -82,33 +89,14 @@ namespace reprostim {
 	std::string exec(const std::string &cmd,
 					 bool showStdout,
 					 bool sessionLogOnly,
-					 int maxResLen,
-					 std::function<bool()> isTerminated
+					 int maxResLen
 					 ) {
-		std::array<char, 128> buffer;
+		ProcRunOpts opts;
+		opts.showOutput = showStdout;
+		opts.sessionLogOnly = sessionLogOnly;
+		opts.maxOutLen = maxResLen;
 		std::string result;
-		std::unique_ptr<FILE, int (*)(FILE*)> pipe(popen(cmd.c_str(), "r"), pclose);
-		if (!pipe) {
-			_ERROR("popen() failed for cmd: " << cmd);
-			throw std::runtime_error("popen() failed!");
-		}
-		while (!isTerminated() && fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) {
-			if( !(maxResLen>0 && result.size()>=maxResLen) ) {
-				result += buffer.data();
-			}
-			if (showStdout) {
-				if( sessionLogOnly ) {
-					_SESSION_LOG_INFO(buffer.data());
-				} else {
-					_INFO_RAW(buffer.data());
-				}
-				fflush(stdout); // force output
-			}
-		}
-
-		if( maxResLen>0 && result.size()>=maxResLen ) {
-			result += " ...";
-		}
+		runProc({"/bin/sh", "-c", cmd}, opts, &result);
 
 		_VERBOSE("exec -> :  " << result);
 		return result;
@@ -141,58 +129,44 @@ namespace reprostim {
 		return s;
 	}
 
-	bool findTargetVideoDevice(const std::string &serialNumber,
+	bool findTargetVideoDevice(DeviceRegistry &registry, const std::string &serialNumber,
 							   VideoDevice &vd) {
 		vd.channelIndex = -1;
-		MW_RESULT mwRes = MWRefreshDevice();
-		if (mwRes != MW_SUCCEEDED) {
-			_ERROR("ERROR[004]: Failed MWRefreshDevice: " << mwRes);
+		const uint64_t nEnum = registry.getEnumerations();
+		DeviceInfo di;
+		const bool fFound = registry.find(serialNumber, di);
+		if (registry.getEnumerations() != nEnum) {
+			std::vector<DeviceInfo> devices = registry.getDevices();
+			_VERBOSE("Channel count: " << devices.size());
+			for (const auto &dev: devices) {
+				_VERBOSE("Found device on channel " << dev.channelIndex << ". " << dev.info);
+			}
+		} else if (registry.isStale() && registry.getLastResult() != MW_SUCCEEDED) {
+			_ERROR("ERROR[004]: Failed MWRefreshDevice: " << registry.getLastResult());
 			return false;
 		}
-		int nCount = MWGetChannelCount();
 
-		_VERBOSE("Channel count: " << nCount);
-
-		if (nCount <= 0) {
+		if (registry.size() == 0) {
 			_ERROR("ERROR[001]: Can't find channels!");
 			return false;
 		}
 
-		for (int i = 0; i < nCount; i++) {
-
-			MWCAP_CHANNEL_INFO info;
-			mwRes = MWGetChannelInfoByIndex(i, &info);
-
-			_VERBOSE("Found device on channel " << i << ". " << info);
-
-			if (strcmp(info.szFamilyName, "USB Capture") == 0) {
-				if (!serialNumber.empty()) {
-					if (serialNumber == info.szBoardSerialNo) {
-						_VERBOSE("Found USB Capture device with S/N=" << info.szBoardSerialNo << " , index=" << i);
-						vd.serial = info.szBoardSerialNo;
-						vd.name = info.szProductName;
-						vd.channelIndex = i;
-						return true;
-					} else {
-						_VERBOSE("Unknown USB device with S/N=" << info.szBoardSerialNo << ", skip it, index=" << i);
-					}
-				} else {
-					_VERBOSE("Found USB Capture device, index=" << i);
-					vd.serial = info.szBoardSerialNo;
-					vd.name = info.szProductName;
-					vd.channelIndex = i;
-					return true;
-				}
-			} else {
-				if (info.wProductID == 0 && info.wFamilyID == 0) {
-					_ERROR("ERROR[003]: Access or permissions issue. Please check /etc/udev/rules.d/ configuration and docs.");
-					return false;
-				} else {
-					_VERBOSE("Unknown USB device, skip it, index=" << i);
-				}
+		if (!fFound) {
+			if (registry.hasAccessError()) {
+				_ERROR("ERROR[003]: Access or permissions issue. Please check /etc/udev/rules.d/ configuration and docs.");
+			} else if (!serialNumber.empty()) {
+				_VERBOSE("USB Capture device with S/N=" << serialNumber << " not found");
 			}
+			return false;
 		}
-		return false;
+		_VERBOSE("Found USB Capture device with S/N=" << di.info.szBoardSerialNo << " , index=" << di.channelIndex);
+		vd.serial = di.info.szBoardSerialNo;
+		vd.name = di.info.szProductName;
+		vd.channelIndex = di.channelIndex;
+		vd.devPath = di.devPath;
+		vd.videoDevPath = di.videoDevPath;
+		vd.busInfo = di.busInfo;
+		return true;
 	}
 
 	// get audio-in control name by reprostim alias
@@ -380,10 +354,10 @@ namespace reprostim {
 // NOTE: uses by-value result
 	VDevSerial getVideoDeviceSerial(const std::string &devPath) {
 		VDevSerial vdi;
-		std::string cmd = "v4l2-ctl -d " + devPath + " --info";
-
-		//std::string res = exec_cmd(verbose, cmd);
-		std::string res = exec(cmd);
+		ProcRunOpts opts;
+		opts.timeoutMs = _PROC_QUERY_TIMEOUT_MS;
+		std::string res;
+		runProc({"v4l2-ctl", "-d", devPath, "--info"}, opts, &res);
 		//_INFO("Result: " << res);
 		std::regex reVideoCapture("Video Capture");
 
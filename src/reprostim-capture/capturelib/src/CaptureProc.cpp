@@ -0,0 +1,430 @@
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureProc.h"
+#include "reprostim/CaptureThreading.h"
+
+extern char **environ;
+
+// pidfd_open syscall number, the same on all architectures
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+// max length of output line without newline, e.g. progress
+// updated with '\r', longer data is passed as separate line
+#ifndef _PROC_MAX_LINE_LEN
+#define _PROC_MAX_LINE_LEN 4096
+#endif
+
+// waitpid() polling interval when pidfd is not supported
+#ifndef _PROC_WAIT_POLL_MS
+#define _PROC_WAIT_POLL_MS 10
+#endif
+
+// ChildProc::run output polling interval, timeout is checked with it
+#ifndef _PROC_RUN_POLL_MS
+#define _PROC_RUN_POLL_MS 100
+#endif
+
+namespace reprostim {
+
+	std::string joinArgs(const std::vector<std::string>& args) {
+		std::string res;
+		for (const auto& arg: args) {
+			res += (res.empty() ? "" : " ") + arg;
+		}
+		return res;
+	}
+
+	// pass complete lines from data to onLine, lines are passed in place
+	// and only line split between reads is copied to pending buffer
+	static void splitLines(std::string& pending, const char* data, size_t len,
+						   int stream, const ProcLineFunc& onLine) {
+		const char* p = data;
+		const char* end = data + len;
+		while( p<end ) {
+			const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+			if( nl==nullptr ) {
+				pending.append(p, end - p);
+				break;
+			}
+			if( pending.empty() ) {
+				onLine(std::string_view(p, nl - p + 1), stream);
+			} else {
+				pending.append(p, nl - p + 1);
+				onLine(pending, stream);
+				pending.clear();
+			}
+			p = nl + 1;
+		}
+		if( pending.size()>=_PROC_MAX_LINE_LEN ) {
+			onLine(pending, stream);
+			pending.clear();
+		}
+	}
+
+	ChildProc::ChildProc() {
+		m_pid = -1;
+		m_pidFd = -1;
+		m_outFd = -1;
+		m_errFd = -1;
+		m_status = 0;
+		m_usage = {};
+		m_exited = false;
+	}
+
+	ChildProc::~ChildProc() {
+		if( isRunning() ) {
+			_ERROR("ChildProc: process still running on cleanup, killing pid=" << m_pid);
+			kill(SIGKILL);
+			wait(1000);
+		}
+		if( m_pidFd>=0 ) {
+			close(m_pidFd);
+		}
+		if( m_outFd>=0 ) {
+			close(m_outFd);
+		}
+		if( m_errFd>=0 ) {
+			close(m_errFd);
+		}
+	}
+
+	int ChildProc::getExitCode() const {
+		_SYNC_LOCK(m_mutex);
+		if( m_exited && WIFEXITED(m_status) ) {
+			return WEXITSTATUS(m_status);
+		}
+		return -1;
+	}
+
+	struct rusage ChildProc::getUsage() const {
+		_SYNC_LOCK(m_mutex);
+		return m_usage;
+	}
+
+	bool ChildProc::isRunning() {
+		return m_pid>0 && !reap();
+	}
+
+	bool ChildProc::kill(int sig) {
+		// pid is not reused until reaped, so process
+		// group id is still valid here
+		_SYNC_LOCK(m_mutex);
+		if( m_pid<=0 || m_exited ) {
+			return false;
+		}
+		return ::kill(-m_pid, sig) == 0;
+	}
+
+	bool ChildProc::reap() {
+		_SYNC_LOCK(m_mutex);
+		if( m_exited ) {
+			return true;
+		}
+		int status = 0;
+		struct rusage usage = {};
+		pid_t res = wait4(m_pid, &status, WNOHANG, &usage);
+		if( res==m_pid ) {
+			m_status = status;
+			m_usage = usage;
+			m_exited = true;
+		} else if( res<0 && errno==ECHILD ) {
+			// reaped elsewhere, exit status is lost
+			m_status = -1;
+			m_exited = true;
+		}
+		return m_exited;
+	}
+
+	int ChildProc::readOutput(int timeoutMs, const ProcLineFunc& onLine, int extraFd) {
+		struct pollfd fds[3];
+		int streams[2];
+		nfds_t nPipes = 0;
+		if( m_outFd>=0 ) {
+			fds[nPipes] = {m_outFd, POLLIN, 0};
+			streams[nPipes++] = PROC_STDOUT;
+		}
+		if( m_errFd>=0 ) {
+			fds[nPipes] = {m_errFd, POLLIN, 0};
+			streams[nPipes++] = PROC_STDERR;
+		}
+		if( nPipes==0 ) {
+			return -1;
+		}
+		nfds_t n = nPipes;
+		if( extraFd>=0 ) {
+			fds[n++] = {extraFd, POLLIN, 0};
+		}
+		int rc = poll(fds, n, timeoutMs);
+		if( rc<0 ) {
+			return errno==EINTR ? 0 : -1;
+		}
+		if( rc==0 || (extraFd>=0 && (fds[nPipes].revents & POLLIN)) ) {
+			return 0;
+		}
+		for (nfds_t i = 0; i < nPipes; i++) {
+			if( fds[i].revents!=0 ) {
+				readStream(streams[i], onLine);
+			}
+		}
+		return m_outFd<0 && m_errFd<0 ? -1 : 1;
+	}
+
+	void ChildProc::readStream(int stream, const ProcLineFunc& onLine) {
+		int& fd = stream==PROC_STDERR ? m_errFd : m_outFd;
+		std::string& pending = stream==PROC_STDERR ? m_errBuf : m_outBuf;
+		char buf[4096];
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if( n<0 && (errno==EAGAIN || errno==EINTR) ) {
+			return;
+		}
+		if( n<=0 ) {
+			// end of output or error, pipe is closed
+			if( !pending.empty() ) {
+				onLine(pending, stream);
+				pending.clear();
+			}
+			close(fd);
+			fd = -1;
+			return;
+		}
+		splitLines(pending, buf, static_cast<size_t>(n), stream, onLine);
+	}
+
+	int ChildProc::run(const std::vector<std::string>& args, const ProcRunOpts& opts,
+					   std::string* pOut) {
+		if( !spawn(args, PROC_CAPTURE_OUT | PROC_CAPTURE_ERR) ) {
+			return -1;
+		}
+		const bool fSessionLogOnly = opts.sessionLogOnly;
+		const bool fShowOutput = opts.showOutput;
+		const int maxOutLen = opts.maxOutLen;
+		bool fTruncated = false;
+		auto onLine = [&](std::string_view line, int stream) {
+			if( stream==PROC_STDOUT && pOut!=nullptr ) {
+				if( maxOutLen<=0 || pOut->size() + line.size()<=static_cast<size_t>(maxOutLen) ) {
+					pOut->append(line);
+				} else if( !fTruncated ) {
+					pOut->append(line.substr(0, maxOutLen - pOut->size()));
+					pOut->append(" ...");
+					fTruncated = true;
+				}
+			}
+			if( fShowOutput ) {
+				if( fSessionLogOnly ) {
+					_SESSION_LOG_INFO(line);
+				} else {
+					_INFO_RAW(line);
+					fflush(stdout); // force output
+				}
+			} else if( stream==PROC_STDERR ) {
+				_VERBOSE("ChildProc: pid=" << m_pid << " stderr: "
+						 << line.substr(0, line.find_last_not_of("\r\n") + 1));
+			}
+		};
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(opts.timeoutMs);
+		bool fStop = false;
+		int res;
+		while( (res = readOutput(_PROC_RUN_POLL_MS, onLine, opts.cancelFd))>=0 ) {
+			if( res==0 && opts.cancelFd>=0 ) {
+				struct pollfd pfd = {opts.cancelFd, POLLIN, 0};
+				if( poll(&pfd, 1, 0)>0 ) {
+					_VERBOSE("ChildProc: cancelled, pid=" << m_pid);
+					fStop = true;
+					break;
+				}
+			}
+			if( opts.timeoutMs>=0 && std::chrono::steady_clock::now()>=deadline ) {
+				_ERROR("ChildProc: timeout " << opts.timeoutMs << " ms exceeded, pid=" << m_pid
+					   << ", cmd: " << joinArgs(args));
+				fStop = true;
+				break;
+			}
+		}
+		if( fStop && !stop(opts.stopSteps) ) {
+			_ERROR("ChildProc: process not stopped, pid=" << m_pid);
+			return -1;
+		}
+		// output is closed, but process can still be running, e.g.
+		// when it closed its stdout/stderr explicitly
+		if( opts.timeoutMs>=0 ) {
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - std::chrono::steady_clock::now()).count();
+			if( !wait(left>0 ? static_cast<int>(left) : 0) && !stop(opts.stopSteps) ) {
+				return -1;
+			}
+		} else {
+			wait(-1);
+		}
+		return fStop ? -1 : getExitCode();
+	}
+
+	bool ChildProc::spawn(const std::string& cmd, bool fCaptureOut) {
+		return spawn({"/bin/sh", "-c", cmd}, fCaptureOut ? PROC_CAPTURE_OUT | PROC_MERGE_ERR : 0);
+	}
+
+	bool ChildProc::spawn(const std::vector<std::string>& args, int flags) {
+		if( m_pid>0 ) {
+			_ERROR("ChildProc: already spawned, pid=" << m_pid);
+			return false;
+		}
+		if( args.empty() ) {
+			_ERROR("ChildProc: empty command");
+			return false;
+		}
+		const bool fCaptureOut = (flags & PROC_CAPTURE_OUT)!=0;
+		const bool fCaptureErr = (flags & PROC_CAPTURE_ERR)!=0 && (flags & PROC_MERGE_ERR)==0;
+		int outFds[2] = {-1, -1};
+		int errFds[2] = {-1, -1};
+		if( (fCaptureOut && pipe2(outFds, O_CLOEXEC)!=0) ||
+			(fCaptureErr && pipe2(errFds, O_CLOEXEC)!=0) ) {
+			_ERROR("ChildProc: pipe2() failed: " << strerror(errno));
+			for (int fd: {outFds[0], outFds[1], errFds[0], errFds[1]}) {
+				if( fd>=0 ) {
+					close(fd);
+				}
+			}
+			return false;
+		}
+
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+		if( fCaptureOut ) {
+			posix_spawn_file_actions_adddup2(&actions, outFds[1], STDOUT_FILENO);
+			if( flags & PROC_MERGE_ERR ) {
+				posix_spawn_file_actions_adddup2(&actions, outFds[1], STDERR_FILENO);
+			}
+		}
+		if( fCaptureErr ) {
+			posix_spawn_file_actions_adddup2(&actions, errFds[1], STDERR_FILENO);
+		}
+
+		// own process group, so signals reach shell children as
+		// well, and default dispositions/empty mask in child
+		posix_spawnattr_t attr;
+		posix_spawnattr_init(&attr);
+		sigset_t sigDefault;
+		sigemptyset(&sigDefault);
+		for (int sig: {SIGHUP, SIGINT, SIGQUIT, SIGPIPE, SIGTERM}) {
+			sigaddset(&sigDefault, sig);
+		}
+		sigset_t sigMask;
+		sigemptyset(&sigMask);
+		posix_spawnattr_setsigdefault(&attr, &sigDefault);
+		posix_spawnattr_setsigmask(&attr, &sigMask);
+		posix_spawnattr_setpgroup(&attr, 0);
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF |
+										POSIX_SPAWN_SETSIGMASK);
+
+		std::vector<char*> argv;
+		argv.reserve(args.size() + 1);
+		for (const auto& arg: args) {
+			argv.push_back(const_cast<char*>(arg.c_str()));
+		}
+		argv.push_back(nullptr);
+		pid_t pid = -1;
+		int res = posix_spawnp(&pid, argv[0], &actions, &attr, argv.data(), environ);
+		posix_spawnattr_destroy(&attr);
+		posix_spawn_file_actions_destroy(&actions);
+		for (int fd: {outFds[1], errFds[1]}) {
+			if( fd>=0 ) {
+				close(fd);
+			}
+		}
+		if( res!=0 ) {
+			_ERROR("ChildProc: posix_spawn() failed: " << strerror(res) << ", cmd: " << joinArgs(args));
+			for (int fd: {outFds[0], errFds[0]}) {
+				if( fd>=0 ) {
+					close(fd);
+				}
+			}
+			return false;
+		}
+
+		{
+			_SYNC_LOCK(m_mutex);
+			m_pid = pid;
+			m_exited = false;
+			m_status = 0;
+			m_usage = {};
+		}
+		m_outBuf.clear();
+		m_errBuf.clear();
+		m_outFd = outFds[0];
+		m_errFd = errFds[0];
+		for (int fd: {m_outFd, m_errFd}) {
+			if( fd>=0 ) {
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			}
+		}
+		m_pidFd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+		if( m_pidFd<0 ) {
+			_VERBOSE("ChildProc: pidfd_open() not supported, using waitpid() polling: " << strerror(errno));
+		}
+		_VERBOSE("ChildProc: spawned pid=" << m_pid << ", pidfd=" << m_pidFd << ", cmd: "
+				 << joinArgs(args));
+		return true;
+	}
+
+	bool ChildProc::stop(const std::vector<ProcStopStep>& steps) {
+		for (const ProcStopStep& step: steps) {
+			if( !isRunning() ) {
+				return true;
+			}
+			_INFO("ChildProc: sending signal " << step.sig << " to pid=" << m_pid
+				  << ", wait " << step.timeoutMs << " ms");
+			kill(step.sig);
+			if( wait(step.timeoutMs) ) {
+				return true;
+			}
+		}
+		return !isRunning();
+	}
+
+	bool ChildProc::wait(int timeoutMs) {
+		if( m_pid<=0 ) {
+			return true;
+		}
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		while( !reap() ) {
+			int waitMs = -1;
+			if( timeoutMs>=0 ) {
+				auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+						deadline - std::chrono::steady_clock::now()).count();
+				if( left<=0 ) {
+					return false;
+				}
+				// round up, so deadline is not missed by poll() granularity
+				waitMs = static_cast<int>((left + 999) / 1000);
+			}
+			if( m_pidFd>=0 ) {
+				// pidfd becomes readable when process exits
+				struct pollfd pfd = {m_pidFd, POLLIN, 0};
+				poll(&pfd, 1, waitMs);
+			} else {
+				SLEEP_MS(waitMs<0 || waitMs>_PROC_WAIT_POLL_MS ? _PROC_WAIT_POLL_MS : waitMs);
+			}
+		}
+		return true;
+	}
+
+	int runProc(const std::vector<std::string>& args, const ProcRunOpts& opts,
+				std::string* pOut) {
+		ChildProc proc;
+		return proc.run(args, opts, pOut);
+	}
+
+} // reprostim
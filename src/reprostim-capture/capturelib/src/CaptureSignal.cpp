@@ -0,0 +1,112 @@
+#include <thread>
+#include "reprostim/CaptureSignal.h"
+
+namespace reprostim {
+
+	//////////////////////////////////////////////////////////////////////////
+	// SignalMonitor
+
+	SignalMonitor::SignalMonitor():
+			m_hEvent(0), m_hChannel(NULL), m_hNotify(0), m_vss{}, m_fValid(false),
+			m_fPending(false), m_notifies(0), m_reads(0) {
+	}
+
+	SignalMonitor::~SignalMonitor() {
+		release();
+	}
+
+	void SignalMonitor::close() {
+		if( m_hChannel == NULL ) {
+			return;
+		}
+		if( m_hNotify != 0 ) {
+			MWUnregisterNotify(m_hChannel, m_hNotify);
+			m_hNotify = 0;
+		}
+		MWCloseChannel(m_hChannel);
+		m_hChannel = NULL;
+		m_devPath = "";
+		m_fValid = false;
+		m_fPending = false;
+	}
+
+	bool SignalMonitor::getStatus(MWCAP_VIDEO_SIGNAL_STATUS& vss) {
+		if( m_hChannel == NULL ) {
+			return false;
+		}
+		const auto now = std::chrono::steady_clock::now();
+		if( m_hNotify == 0 || m_fPending || !m_fValid ||
+			now - m_tsRead >= std::chrono::milliseconds(_SIGNAL_REFRESH_MS) ) {
+			if( MWGetVideoSignalStatus(m_hChannel, &m_vss) != MW_SUCCEEDED ) {
+				m_fValid = false;
+				return false;
+			}
+			m_reads++;
+			m_fValid = true;
+			m_fPending = false;
+			m_tsRead = now;
+		}
+		vss = m_vss;
+		return true;
+	}
+
+	bool SignalMonitor::init() {
+		if( m_hEvent == 0 ) {
+			m_hEvent = MWCreateEvent();
+		}
+		return m_hEvent != 0;
+	}
+
+	bool SignalMonitor::open(const std::string& devPath) {
+		close();
+		m_hChannel = MWOpenChannelByPath(devPath.c_str());
+		if( m_hChannel == NULL ) {
+			return false;
+		}
+		m_devPath = devPath;
+		// status is read on the first cycle anyway
+		m_fPending = true;
+		if( m_hEvent != 0 ) {
+			m_hNotify = MWRegisterNotify(m_hChannel, m_hEvent, _SIGNAL_NOTIFY_BITS);
+		}
+		return true;
+	}
+
+	void SignalMonitor::release() {
+		close();
+		const MWCAP_PTR hEvent = m_hEvent.exchange(0);
+		if( hEvent != 0 ) {
+			MWCloseEvent(hEvent);
+		}
+	}
+
+	bool SignalMonitor::wait(int timeoutMs) {
+		const MWCAP_PTR hEvent = m_hEvent;
+		if( hEvent == 0 ) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+			return false;
+		}
+		if( MWWaitEvent(hEvent, timeoutMs) != 1 ) {
+			return false;
+		}
+		// event is shared by notifications and wake()
+		if( m_hNotify != 0 ) {
+			ULONGLONG status = 0;
+			if( MWGetNotifyStatus(m_hChannel, m_hNotify, &status) != MW_SUCCEEDED ) {
+				m_fPending = true;
+			} else if( (status & _SIGNAL_NOTIFY_BITS) != 0 ) {
+				m_fPending = true;
+				m_notifies++;
+			}
+		}
+		return true;
+	}
+
+	void SignalMonitor::wake() {
+		const MWCAP_PTR hEvent = m_hEvent;
+		if( hEvent != 0 ) {
+			MWSetEvent(hEvent);
+		}
+	}
+
+}
@@ -0,0 +1,250 @@
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FakeMWCapture.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Fake device state
+
+struct FakeEvent {
+	std::mutex              mutex;
+	std::condition_variable cv;
+	bool                    fSet = false;
+};
+
+struct FakeNotify {
+	MWCAP_PTR hEvent;
+	DWORD     dwEnableBits;
+	ULONGLONG status;
+};
+
+struct FakeDevice {
+	std::mutex                mutex;
+	std::map<MWCAP_PTR, std::shared_ptr<FakeEvent>> events;
+	std::map<MWCAP_PTR, FakeNotify> notifies;
+	MWCAP_PTR                 nextHandle = 1;
+	bool                      fNotify = true;
+	bool                      fLost = false;
+	bool                      fRefreshFailed = false;
+	std::vector<FakeMWChannel> channels;   // plugged
+	std::vector<FakeMWChannel> refreshed;  // listed by MWRefreshDevice
+	MWCAP_VIDEO_SIGNAL_STATUS vss{};
+	FakeMWStats               stats;
+};
+
+static FakeDevice g_device;
+// channel handle is only compared with NULL
+static int g_channel = 0;
+
+static std::shared_ptr<FakeEvent> getEvent(MWCAP_PTR hEvent) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	auto it = g_device.events.find(hEvent);
+	return it == g_device.events.end() ? nullptr : it->second;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Fake control
+
+FakeMWStats fakeMWGetStats() {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	return g_device.stats;
+}
+
+void fakeMWReset(bool fNotify) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	g_device.notifies.clear();
+	g_device.fNotify = fNotify;
+	g_device.fLost = false;
+	g_device.fRefreshFailed = false;
+	g_device.channels.clear();
+	g_device.refreshed.clear();
+	g_device.vss = MWCAP_VIDEO_SIGNAL_STATUS{};
+	g_device.stats = FakeMWStats();
+}
+
+void fakeMWSetChannels(const std::vector<FakeMWChannel>& channels) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	g_device.channels = channels;
+}
+
+void fakeMWSetLost(bool fLost) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	g_device.fLost = fLost;
+}
+
+void fakeMWSetRefreshFailed(bool fFailed) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	g_device.fRefreshFailed = fFailed;
+}
+
+void fakeMWSetSignal(int cx, int cy, DWORD dwFrameDuration) {
+	std::vector<std::shared_ptr<FakeEvent>> events;
+	{
+		std::lock_guard<std::mutex> lock(g_device.mutex);
+		MWCAP_VIDEO_SIGNAL_STATUS& vss = g_device.vss;
+		vss.state = cx > 0 && cy > 0 ? MWCAP_VIDEO_SIGNAL_LOCKED : MWCAP_VIDEO_SIGNAL_NONE;
+		vss.cx = cx;
+		vss.cy = cy;
+		vss.cxTotal = cx;
+		vss.cyTotal = cy;
+		vss.dwFrameDuration = dwFrameDuration;
+		for (auto& entry: g_device.notifies) {
+			FakeNotify& notify = entry.second;
+			if( notify.dwEnableBits & MWCAP_NOTIFY_VIDEO_SIGNAL_CHANGE ) {
+				notify.status |= MWCAP_NOTIFY_VIDEO_SIGNAL_CHANGE;
+				auto it = g_device.events.find(notify.hEvent);
+				if( it != g_device.events.end() ) {
+					events.push_back(it->second);
+				}
+			}
+		}
+	}
+	for (auto& pEvent: events) {
+		std::lock_guard<std::mutex> lock(pEvent->mutex);
+		pEvent->fSet = true;
+		pEvent->cv.notify_all();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// MWCapture SDK functions
+
+void MWCloseChannel(HCHANNEL hChannel) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( hChannel != NULL ) {
+		g_device.stats.closed++;
+	}
+}
+
+MW_RESULT MWCloseEvent(MWCAP_PTR hEvent) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	return g_device.events.erase(hEvent) > 0 ? MW_SUCCEEDED : MW_INVALID_PARAMS;
+}
+
+MWCAP_PTR MWCreateEvent() {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	const MWCAP_PTR hEvent = g_device.nextHandle++;
+	g_device.events[hEvent] = std::make_shared<FakeEvent>();
+	return hEvent;
+}
+
+int MWGetChannelCount() {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	return static_cast<int>(g_device.refreshed.size());
+}
+
+MW_RESULT MWGetChannelInfoByIndex(int nIndex, MWCAP_CHANNEL_INFO* pChannelInfo) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( nIndex < 0 || nIndex >= static_cast<int>(g_device.refreshed.size()) ) {
+		return MW_INVALID_PARAMS;
+	}
+	const FakeMWChannel& ch = g_device.refreshed[nIndex];
+	*pChannelInfo = MWCAP_CHANNEL_INFO{};
+	pChannelInfo->wFamilyID = ch.wFamilyID;
+	pChannelInfo->wProductID = ch.wProductID;
+	strncpy(pChannelInfo->szFamilyName, ch.family.c_str(), sizeof(pChannelInfo->szFamilyName) - 1);
+	strncpy(pChannelInfo->szProductName, ch.product.c_str(), sizeof(pChannelInfo->szProductName) - 1);
+	strncpy(pChannelInfo->szBoardSerialNo, ch.serial.c_str(), sizeof(pChannelInfo->szBoardSerialNo) - 1);
+	g_device.stats.channelInfoReads++;
+	return MW_SUCCEEDED;
+}
+
+MW_RESULT MWGetDevicePath(int nIndex, char* pDevicePath) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( nIndex < 0 || nIndex >= static_cast<int>(g_device.refreshed.size()) ) {
+		return MW_INVALID_PARAMS;
+	}
+	// SDK path buffer is 256 bytes
+	strncpy(pDevicePath, g_device.refreshed[nIndex].devPath.c_str(), 255);
+	return MW_SUCCEEDED;
+}
+
+MW_RESULT MWGetNotifyStatus(HCHANNEL hChannel, HNOTIFY hNotify, ULONGLONG* pullStatus) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	auto it = g_device.notifies.find(hNotify);
+	if( hChannel == NULL || it == g_device.notifies.end() ) {
+		return MW_INVALID_PARAMS;
+	}
+	*pullStatus = it->second.status;
+	it->second.status = 0;
+	return MW_SUCCEEDED;
+}
+
+MW_RESULT MWGetVideoSignalStatus(HCHANNEL hChannel, MWCAP_VIDEO_SIGNAL_STATUS* pSignalStatus) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( hChannel == NULL || g_device.fLost ) {
+		return MW_FAILED;
+	}
+	*pSignalStatus = g_device.vss;
+	g_device.stats.statusReads++;
+	return MW_SUCCEEDED;
+}
+
+HCHANNEL MWOpenChannelByPath(const char* pszDevicePath) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( pszDevicePath == NULL || g_device.fLost ) {
+		return NULL;
+	}
+	g_device.stats.opened++;
+	return &g_channel;
+}
+
+MW_RESULT MWRefreshDevice() {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	g_device.stats.refreshes++;
+	if( g_device.fRefreshFailed ) {
+		return MW_FAILED;
+	}
+	g_device.refreshed = g_device.channels;
+	return MW_SUCCEEDED;
+}
+
+HNOTIFY MWRegisterNotify(HCHANNEL hChannel, MWHANDLE hEvent, DWORD dwEnableBits) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( hChannel == NULL || !g_device.fNotify || g_device.events.count(hEvent) == 0 ) {
+		return 0;
+	}
+	const HNOTIFY hNotify = g_device.nextHandle++;
+	g_device.notifies[hNotify] = FakeNotify{hEvent, dwEnableBits, 0};
+	g_device.stats.registered++;
+	return hNotify;
+}
+
+MW_RESULT MWSetEvent(MWCAP_PTR hEvent) {
+	std::shared_ptr<FakeEvent> pEvent = getEvent(hEvent);
+	if( !pEvent ) {
+		return MW_INVALID_PARAMS;
+	}
+	std::lock_guard<std::mutex> lock(pEvent->mutex);
+	pEvent->fSet = true;
+	pEvent->cv.notify_all();
+	return MW_SUCCEEDED;
+}
+
+MW_RESULT MWUnregisterNotify(HCHANNEL hChannel, HNOTIFY hNotify) {
+	std::lock_guard<std::mutex> lock(g_device.mutex);
+	if( g_device.notifies.erase(hNotify) == 0 ) {
+		return MW_INVALID_PARAMS;
+	}
+	g_device.stats.unregistered++;
+	return MW_SUCCEEDED;
+}
+
+// auto-reset event like in SDK
+int MWWaitEvent(MWCAP_PTR hEvent, int nTimeout) {
+	std::shared_ptr<FakeEvent> pEvent = getEvent(hEvent);
+	if( !pEvent ) {
+		return 0;
+	}
+	std::unique_lock<std::mutex> lock(pEvent->mutex);
+	if( !pEvent->cv.wait_for(lock, std::chrono::milliseconds(nTimeout),
+							 [&pEvent] { return pEvent->fSet; }) ) {
+		return 0;
+	}
+	pEvent->fSet = false;
+	return 1;
+}
@@ -0,0 +1,49 @@
+#ifndef CAPTURE_FAKEMWCAPTURE_H
+#define CAPTURE_FAKEMWCAPTURE_H
+
+#include <string>
+#include <vector>
+#include "LibMWCapture/MWCapture.h"
+
+// Fake of MWCapture SDK device enumeration, channel, event and
+// notification functions used by reprostim::DeviceRegistry and
+// reprostim::SignalMonitor, emulates devices with programmable
+// video signal, so they can be tested without Magewell hardware.
+// Linked instead of libMWCapture.
+
+// channel listed by MWRefreshDevice
+struct FakeMWChannel {
+	std::string family = "USB Capture";
+	std::string product;
+	std::string serial;
+	std::string devPath;
+	WORD        wFamilyID = 1;
+	WORD        wProductID = 1;
+};
+
+// SDK calls made since fakeMWReset
+struct FakeMWStats {
+	int opened = 0;
+	int closed = 0;
+	int statusReads = 0;
+	int registered = 0;
+	int unregistered = 0;
+	int refreshes = 0;
+	int channelInfoReads = 0;
+};
+
+FakeMWStats fakeMWGetStats();
+// reset device state and stats, device without notifications
+// support returns NULL from MWRegisterNotify
+void fakeMWReset(bool fNotify = true);
+// channels listed after the next MWRefreshDevice call
+void fakeMWSetChannels(const std::vector<FakeMWChannel>& channels);
+// MWOpenChannelByPath and MWGetVideoSignalStatus fail, e.g.
+// device is unplugged
+void fakeMWSetLost(bool fLost);
+// MWRefreshDevice fails
+void fakeMWSetRefreshFailed(bool fFailed);
+// change video signal and raise signal change notification
+void fakeMWSetSignal(int cx, int cy, DWORD dwFrameDuration = 166667);
+
+#endif //CAPTURE_FAKEMWCAPTURE_H
@@ -19,3 +19,22 @@ TEST_CASE("TestCaptureApp_constructor_destructor",
 	REQUIRE(pApp != nullptr);
 	pApp = nullptr;
 }
+
+// app recording stop messages
+class TestStopCaptureApp: public CaptureApp {
+public:
+	std::vector<std::string> stopMessages;
+
+	void onCaptureStop(const std::string& message) override {
+		stopMessages.push_back(message);
+	}
+};
+
+// by default signal change stops recording
+TEST_CASE("TestCaptureApp_onCaptureChange",
+		  "[capturelib][CaptureApp][onCaptureChange]") {
+	TestStopCaptureApp app;
+	app.onCaptureChange("changed");
+	REQUIRE(app.stopMessages.size() == 1);
+	REQUIRE(app.stopMessages[0] == "changed");
+}
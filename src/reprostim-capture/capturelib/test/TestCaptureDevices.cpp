@@ -0,0 +1,142 @@
+#include <chrono>
+#include <thread>
+#include "reprostim/CaptureDevices.h"
+#include "FakeMWCapture.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+using namespace reprostim;
+
+static FakeMWChannel getChannel(const std::string& family, const std::string& serial) {
+	FakeMWChannel ch;
+	ch.family = family;
+	ch.product = family + " HDMI";
+	ch.serial = serial;
+	ch.devPath = "/dev/fake_" + serial;
+	return ch;
+}
+
+TEST_CASE("TestCaptureDevices_find",
+		  "[capturelib][CaptureDevices][DeviceRegistry]") {
+	fakeMWReset();
+	fakeMWSetChannels({getChannel(_USB_CAPTURE_FAMILY, "A1"),
+					   getChannel("Pro Capture", "P1"),
+					   getChannel(_USB_CAPTURE_FAMILY, "B2")});
+	DeviceRegistry registry(0);
+	REQUIRE(registry.isStale());
+
+	DeviceInfo di;
+	REQUIRE(registry.find("B2", di));
+	REQUIRE(di.channelIndex == 2);
+	REQUIRE(di.devPath == "/dev/fake_B2");
+	REQUIRE(std::string(di.info.szProductName) == "USB Capture HDMI");
+	REQUIRE_FALSE(registry.isStale());
+	REQUIRE(registry.size() == 3);
+	REQUIRE_FALSE(registry.hasAccessError());
+
+	// the first USB Capture channel, other families are skipped
+	REQUIRE(registry.find("", di));
+	REQUIRE(di.channelIndex == 0);
+	REQUIRE_FALSE(registry.find("P1", di));
+	REQUIRE_FALSE(registry.find("X9", di));
+
+	// lookups don't call SDK
+	FakeMWStats stats = fakeMWGetStats();
+	REQUIRE(stats.refreshes == 1);
+	REQUIRE(stats.channelInfoReads == 3);
+	REQUIRE(registry.getEnumerations() == 1);
+
+	// V4L2 device is kept until refresh
+	registry.setVideoDevice("A1", VDevPath{"/dev/video0", "usb-0000:00:14.0-1"});
+	REQUIRE(registry.find("A1", di));
+	REQUIRE(di.videoDevPath == "/dev/video0");
+	REQUIRE(di.busInfo == "usb-0000:00:14.0-1");
+	REQUIRE(registry.refresh(true));
+	REQUIRE(registry.getEnumerations() == 2);
+	REQUIRE(registry.find("A1", di));
+	REQUIRE(di.videoDevPath.empty());
+}
+
+TEST_CASE("TestCaptureDevices_invalidate",
+		  "[capturelib][CaptureDevices][DeviceRegistry]") {
+	fakeMWReset();
+	fakeMWSetChannels({getChannel(_USB_CAPTURE_FAMILY, "A1")});
+	DeviceRegistry registry(0);
+	DeviceInfo di;
+	REQUIRE(registry.find("A1", di));
+
+	// plugged device is not seen until hotplug event
+	fakeMWSetChannels({getChannel(_USB_CAPTURE_FAMILY, "A1"),
+					   getChannel(_USB_CAPTURE_FAMILY, "C3")});
+	REQUIRE_FALSE(registry.find("C3", di));
+	REQUIRE(fakeMWGetStats().refreshes == 1);
+	std::thread th([&registry] { registry.invalidate(); });
+	th.join();
+	REQUIRE(registry.isStale());
+	REQUIRE(registry.find("C3", di));
+	REQUIRE(di.channelIndex == 1);
+	REQUIRE(fakeMWGetStats().refreshes == 2);
+
+	// unplugged
+	fakeMWSetChannels({});
+	registry.invalidate();
+	REQUIRE_FALSE(registry.find("", di));
+	REQUIRE(registry.size() == 0);
+	REQUIRE(registry.refresh());
+	REQUIRE(fakeMWGetStats().refreshes == 3);
+
+	// failed enumeration is retried
+	fakeMWSetChannels({getChannel(_USB_CAPTURE_FAMILY, "A1")});
+	fakeMWSetRefreshFailed(true);
+	registry.invalidate();
+	REQUIRE_FALSE(registry.find("A1", di));
+	REQUIRE(registry.getLastResult() == MW_FAILED);
+	REQUIRE(registry.isStale());
+	fakeMWSetRefreshFailed(false);
+	REQUIRE(registry.find("A1", di));
+	REQUIRE(registry.getLastResult() == MW_SUCCEEDED);
+	REQUIRE(fakeMWGetStats().refreshes == 5);
+}
+
+TEST_CASE("TestCaptureDevices_settle",
+		  "[capturelib][CaptureDevices][DeviceRegistry]") {
+	fakeMWReset();
+	DeviceRegistry registry(100);
+	DeviceInfo di;
+	REQUIRE_FALSE(registry.find("", di));
+	REQUIRE_FALSE(registry.isStale());
+
+	// device is listed by SDK with delay after hotplug event
+	registry.invalidate();
+	REQUIRE_FALSE(registry.find("", di));
+	REQUIRE(registry.isStale());
+	fakeMWSetChannels({getChannel(_USB_CAPTURE_FAMILY, "A1")});
+	REQUIRE(registry.find("", di));
+	REQUIRE(fakeMWGetStats().refreshes == 3);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(150));
+	REQUIRE(registry.find("A1", di));
+	REQUIRE_FALSE(registry.isStale());
+	REQUIRE(registry.find("A1", di));
+	REQUIRE(fakeMWGetStats().refreshes == 4);
+}
+
+TEST_CASE("TestCaptureDevices_accessError",
+		  "[capturelib][CaptureDevices][DeviceRegistry]") {
+	fakeMWReset();
+	FakeMWChannel ch = getChannel("", "");
+	ch.wFamilyID = 0;
+	ch.wProductID = 0;
+	fakeMWSetChannels({ch});
+	DeviceRegistry registry(0);
+	DeviceInfo di;
+	REQUIRE_FALSE(registry.find("", di));
+	REQUIRE(registry.hasAccessError());
+}
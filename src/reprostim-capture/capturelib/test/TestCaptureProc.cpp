@@ -0,0 +1,132 @@
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureProc.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+using namespace reprostim;
+
+static long long elapsedMs(const std::chrono::steady_clock::time_point& ts) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - ts).count();
+}
+
+TEST_CASE("TestCaptureProc_run",
+		  "[capturelib][ChildProc][run]") {
+	// argv is passed as is, without shell expansion
+	ProcRunOpts opts;
+	std::string out;
+	REQUIRE(runProc({"printf", "%s|%s\\n", "$HOME", "a b"}, opts, &out) == 0);
+	REQUIRE(out == "$HOME|a b\n");
+
+	// stderr is not collected, exit code is returned
+	out.clear();
+	REQUIRE(runProc({"sh", "-c", "echo out; echo err 1>&2; exit 5"}, opts, &out) == 5);
+	REQUIRE(out == "out\n");
+
+	out.clear();
+	opts.maxOutLen = 4;
+	REQUIRE(runProc({"echo", "0123456789"}, opts, &out) == 0);
+	REQUIRE(out == "0123 ...");
+
+	REQUIRE(runProc({"reprostim-no-such-program"}, ProcRunOpts(), &out) == -1);
+
+	// process is stopped on timeout
+	opts = ProcRunOpts();
+	opts.timeoutMs = 300;
+	auto ts = std::chrono::steady_clock::now();
+	REQUIRE(runProc({"sleep", "30"}, opts) == -1);
+	REQUIRE(elapsedMs(ts) >= 300);
+	REQUIRE(elapsedMs(ts) < 3000);
+
+	// and when cancel fd becomes readable
+	int fds[2];
+	REQUIRE(pipe(fds) == 0);
+	opts = ProcRunOpts();
+	opts.cancelFd = fds[0];
+	REQUIRE(write(fds[1], "x", 1) == 1);
+	ts = std::chrono::steady_clock::now();
+	REQUIRE(runProc({"sleep", "30"}, opts) == -1);
+	REQUIRE(elapsedMs(ts) < 3000);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST_CASE("TestCaptureProc_spawn",
+		  "[capturelib][ChildProc][spawn]") {
+	ChildProc proc;
+	REQUIRE_FALSE(proc.isRunning());
+	REQUIRE(proc.spawn("echo line1; echo line2 1>&2; printf tail; exit 3", true));
+
+	std::vector<std::string> lines;
+	while( proc.readOutput(1000, [&](std::string_view line, int stream) {
+		REQUIRE(stream == PROC_STDOUT);
+		lines.emplace_back(line);
+	}) >= 0 ) {
+	}
+	REQUIRE(lines.size() == 3);
+	REQUIRE(lines[0] == "line1\n");
+	REQUIRE(lines[1] == "line2\n");
+	REQUIRE(lines[2] == "tail");
+
+	REQUIRE(proc.wait(5000));
+	REQUIRE_FALSE(proc.isRunning());
+	REQUIRE(proc.getExitCode() == 3);
+	REQUIRE(proc.getUsage().ru_maxrss > 0);
+	REQUIRE_FALSE(proc.kill(SIGTERM));
+}
+
+TEST_CASE("TestCaptureProc_stop",
+		  "[capturelib][ChildProc][stop]") {
+	// exits on the first signal, stop returns without waiting full timeout
+	ChildProc proc;
+	REQUIRE(proc.spawn("sleep 30", false));
+	REQUIRE(proc.isRunning());
+	REQUIRE_FALSE(proc.wait(100));
+	auto ts = std::chrono::steady_clock::now();
+	REQUIRE(proc.stop({{SIGINT, 5000}, {SIGKILL, 1000}}));
+	REQUIRE(elapsedMs(ts) < 2000);
+	REQUIRE_FALSE(proc.isRunning());
+	REQUIRE(proc.getExitCode() == -1);
+
+	// SIGINT is ignored by shell and its children, escalated to SIGTERM
+	ChildProc proc2;
+	REQUIRE(proc2.spawn("trap '' INT; sleep 30", false));
+	SLEEP_MS(200);
+	ts = std::chrono::steady_clock::now();
+	REQUIRE(proc2.stop({{SIGINT, 300}, {SIGTERM, 5000}}));
+	REQUIRE(elapsedMs(ts) >= 300);
+	REQUIRE(elapsedMs(ts) < 3000);
+	REQUIRE_FALSE(proc2.isRunning());
+}
+
+TEST_CASE("TestCaptureProc_spawnArgs",
+		  "[capturelib][ChildProc][spawn]") {
+	ChildProc proc;
+	REQUIRE(proc.spawn({"sh", "-c", "echo out1; echo err1 1>&2; echo out2"},
+					   PROC_CAPTURE_OUT | PROC_CAPTURE_ERR));
+	REQUIRE(proc.getOutFd() >= 0);
+	REQUIRE(proc.getErrFd() >= 0);
+
+	std::string out, err;
+	while( proc.readOutput(1000, [&](std::string_view line, int stream) {
+		(stream == PROC_STDERR ? err : out).append(line);
+	}) >= 0 ) {
+	}
+	REQUIRE(out == "out1\nout2\n");
+	REQUIRE(err == "err1\n");
+	REQUIRE(proc.wait(5000));
+	REQUIRE(proc.getExitCode() == 0);
+	REQUIRE_FALSE(proc.spawn({"true"}, 0));
+}
@@ -0,0 +1,156 @@
+#define CATCH_CONFIG_MAIN
+#include <chrono>
+#include <thread>
+#include "reprostim/CaptureSignal.h"
+#include "FakeMWCapture.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+using namespace reprostim;
+
+static int64_t getElapsedMs(const std::chrono::steady_clock::time_point& ts) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - ts).count();
+}
+
+// change signal from another thread after delayMs and measure
+// how fast wait() returns
+static int64_t waitSignal(SignalMonitor& monitor, int cx, int cy, int delayMs) {
+	std::thread th([cx, cy, delayMs] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+		fakeMWSetSignal(cx, cy);
+	});
+	const auto ts = std::chrono::steady_clock::now();
+	const bool fWoken = monitor.wait(5000);
+	const int64_t ms = getElapsedMs(ts) - delayMs;
+	th.join();
+	REQUIRE(fWoken);
+	return ms;
+}
+
+TEST_CASE("TestCaptureSignal_notify",
+		  "[capturelib][CaptureSignal][SignalMonitor]") {
+	fakeMWReset();
+	SignalMonitor monitor;
+	REQUIRE(monitor.init());
+	REQUIRE(monitor.open("fake"));
+	REQUIRE(monitor.isOpen());
+	REQUIRE(monitor.hasNotify());
+	REQUIRE(monitor.getDevicePath() == "fake");
+
+	MWCAP_VIDEO_SIGNAL_STATUS vss;
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.state == MWCAP_VIDEO_SIGNAL_NONE);
+	REQUIRE(monitor.getReads() == 1);
+
+	// idle, no device reads without notification
+	REQUIRE_FALSE(monitor.wait(50));
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(monitor.getReads() == 1);
+
+	// no signal -> signal -> changed -> lost
+	REQUIRE(waitSignal(monitor, 1920, 1080, 100) < 500);
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.state == MWCAP_VIDEO_SIGNAL_LOCKED);
+	REQUIRE(vss.cx == 1920);
+	REQUIRE(vss.cy == 1080);
+	REQUIRE(monitor.getReads() == 2);
+	REQUIRE(monitor.getNotifies() == 1);
+
+	REQUIRE(waitSignal(monitor, 1280, 720, 100) < 500);
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.cx == 1280);
+
+	REQUIRE(waitSignal(monitor, 0, 0, 100) < 500);
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.state == MWCAP_VIDEO_SIGNAL_NONE);
+	REQUIRE(monitor.getReads() == 4);
+	REQUIRE(monitor.getNotifies() == 3);
+
+	// wake up without signal change
+	std::thread th([&monitor] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		monitor.wake();
+	});
+	REQUIRE(monitor.wait(5000));
+	th.join();
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(monitor.getReads() == 4);
+
+	monitor.close();
+	REQUIRE_FALSE(monitor.isOpen());
+	REQUIRE_FALSE(monitor.getStatus(vss));
+	monitor.release();
+	const FakeMWStats stats = fakeMWGetStats();
+	REQUIRE(stats.opened == 1);
+	REQUIRE(stats.closed == 1);
+	REQUIRE(stats.registered == 1);
+	REQUIRE(stats.unregistered == 1);
+	REQUIRE(stats.statusReads == 4);
+}
+
+TEST_CASE("TestCaptureSignal_poll",
+		  "[capturelib][CaptureSignal][SignalMonitor]") {
+	// device without notifications, status is read on every cycle
+	fakeMWReset(false);
+	SignalMonitor monitor;
+	REQUIRE(monitor.init());
+	REQUIRE(monitor.open("fake"));
+	REQUIRE_FALSE(monitor.hasNotify());
+
+	MWCAP_VIDEO_SIGNAL_STATUS vss;
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.cx == 0);
+	fakeMWSetSignal(1920, 1080);
+	const auto ts = std::chrono::steady_clock::now();
+	REQUIRE_FALSE(monitor.wait(100));
+	REQUIRE(getElapsedMs(ts) >= 90);
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.cx == 1920);
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(monitor.getReads() == 3);
+	REQUIRE(monitor.getNotifies() == 0);
+
+	// no wake event, wait is plain sleep
+	SignalMonitor monitor2;
+	REQUIRE(monitor2.open("fake"));
+	REQUIRE_FALSE(monitor2.hasNotify());
+	monitor2.wake();
+	REQUIRE_FALSE(monitor2.wait(10));
+	REQUIRE(monitor2.getStatus(vss));
+}
+
+TEST_CASE("TestCaptureSignal_lost",
+		  "[capturelib][CaptureSignal][SignalMonitor]") {
+	fakeMWReset();
+	SignalMonitor monitor;
+	REQUIRE(monitor.init());
+	REQUIRE(monitor.open("fake"));
+
+	MWCAP_VIDEO_SIGNAL_STATUS vss;
+	fakeMWSetLost(true);
+	REQUIRE_FALSE(monitor.getStatus(vss));
+	// reopened when device is back
+	REQUIRE_FALSE(monitor.open("fake"));
+	REQUIRE_FALSE(monitor.isOpen());
+	fakeMWSetLost(false);
+	fakeMWSetSignal(1920, 1080);
+	REQUIRE(monitor.open("fake"));
+	REQUIRE(monitor.getStatus(vss));
+	REQUIRE(vss.cx == 1920);
+
+	monitor.release();
+	monitor.release();
+	const FakeMWStats stats = fakeMWGetStats();
+	REQUIRE(stats.opened == 2);
+	REQUIRE(stats.closed == 2);
+	REQUIRE(stats.registered == 2);
+	REQUIRE(stats.unregistered == 2);
+}
@@ -1,3 +1,4 @@
+#include <poll.h>
 #include "reprostim/CaptureLib.h"
 #include "reprostim/CaptureThreading.h"
 
@@ -54,9 +55,15 @@ TEST_CASE("TestCaptureThreading_WorkerThread",
 	p->start();
 	REQUIRE(p->isRunning() == true);
 	REQUIRE(p->isTerminated() == false);
+	REQUIRE(p->getTerminateFd() >= 0);
+	pollfd pfd = {p->getTerminateFd(), POLLIN, 0};
+	REQUIRE(poll(&pfd, 1, 0) == 0);
 	p->stop();
 	REQUIRE(p->isRunning() == false);
 	REQUIRE(p->isTerminated() == true);
+	// stop wakes up poll on terminate fd
+	REQUIRE(poll(&pfd, 1, 0) == 1);
+	REQUIRE((pfd.revents & POLLIN) != 0);
 	TestWorkerThread::deleteInstance(p);
 }
 
@@ -107,4 +114,33 @@ TEST_CASE("TestCaptureThreading_SingleThreadExecutor",
 	REQUIRE(pA->isTerminated() == true);
 	REQUIRE(pB->isRunning() == false);
 	REQUIRE(pB->isTerminated() == true);
-}
\ No newline at end of file
+}
+
+// test handover of running thread out of TestSingleThreadExecutor
+TEST_CASE("TestCaptureThreading_SingleThreadExecutor_release",
+		  "[capturelib][CaptureThreading][SingleThreadExecutor]") {
+	TestSingleThreadExecutor executor;
+	TestWorkerThread* pA = TestWorkerThread::newInstance("workerA_"+getTimeStr());
+	TestWorkerThread* pB = TestWorkerThread::newInstance("workerB_"+getTimeStr());
+
+	executor.schedule(pA);
+	REQUIRE(executor.release() == pA);
+	REQUIRE(executor.getCurrentThread() == nullptr);
+
+	// released thread keeps running when next one is scheduled
+	executor.schedule(pB);
+	REQUIRE(pA->isRunning() == true);
+	REQUIRE(pB->isRunning() == true);
+
+	// terminate doesn't wait for thread
+	pA->terminate();
+	REQUIRE(pA->isTerminated() == true);
+	for (int i = 0; i < 50 && pA->isRunning(); i++) {
+		SLEEP_MS(20);
+	}
+	REQUIRE(pA->isRunning() == false);
+	TestWorkerThread::deleteInstance(pA);
+
+	executor.schedule(nullptr);
+	REQUIRE(executor.getCurrentThread() == nullptr);
+}
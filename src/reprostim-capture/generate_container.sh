@@ -16,7 +16,7 @@ generate() {
 		--install vim wget strace time ncdu gnupg curl procps datalad pigz less tree \
 				  git-annex \
                   ffmpeg mediainfo \
-                  libudev-dev libasound-dev libv4l-dev libyaml-cpp-dev libspdlog-dev catch2 v4l-utils libopencv-dev libcurl4-openssl-dev nlohmann-json3-dev \
+                  libudev-dev libasound-dev libv4l-dev libyaml-cpp-dev libspdlog-dev catch2 v4l-utils libopencv-dev libcurl4-openssl-dev liblz4-dev nlohmann-json3-dev \
                   cmake g++ \
                   python3-pydantic python3-opencv python3-numpy python3-click python3-pytest python3-pytest-cov \
 		--user=reproin
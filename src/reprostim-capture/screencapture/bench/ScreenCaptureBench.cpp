@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sysexits.h>
+#include <unistd.h>
+#include <vector>
+#include "ChangeDetector.h"
+#include "DeltaSnapshot.h"
+#include "FrameSource.h"
+#include "RecordingThread.h"
+#include "SnapshotCodec.h"
+
+// Benchmark of screencapture snapshot write path: YUYV frame
+// conversion, encoding with all supported codecs and optional
+// file IO. Reports frames per second and bytes per frame.
+//
+// With -p whole recordScreens pipeline is run on synthetic or
+// replay frame source, without capture device, and frames per
+// second, CPU per frame and change detection latency are reported.
+
+struct BenchFrame {
+	std::string                name;
+	std::vector<unsigned char> data; // YUYV
+};
+
+struct BenchOpts {
+	int                      cx = 1920;
+	int                      cy = 1080;
+	int                      nIters = 20;
+	std::string              outDir; // write encoded frames when set
+	std::vector<std::string> files;  // raw YUYV frames, e.g. from dump_raw
+	bool                     pipeline = false;
+	int                      nFrames = 600;  // synthetic frames in pipeline
+	int                      fps = 0;        // source fps in pipeline, 0 - unthrottled
+};
+
+static void setYuyv(std::vector<unsigned char>& d, int cx, int x, int y,
+					unsigned char Y, unsigned char U, unsigned char V) {
+	const size_t i = (static_cast<size_t>(y) * cx + x) * 2;
+	d[i] = Y;
+	d[i + 1] = (x & 1) ? V : U;
+}
+
+// flat UI-like screen: background, panels and text-like strokes
+static BenchFrame makeUiFrame(int cx, int cy) {
+	BenchFrame f{"ui", std::vector<unsigned char>(static_cast<size_t>(cx) * cy * 2)};
+	for (int y = 0; y < cy; y++) {
+		for (int x = 0; x < cx; x++) {
+			unsigned char Y = 235, U = 128, V = 128;
+			if( y < cy / 20 ) {
+				Y = 60; U = 160; V = 110; // title bar
+			} else if( x > cx / 10 && x < cx * 9 / 10 && y > cy / 5 && y < cy * 4 / 5 ) {
+				Y = 200; // dialog panel
+				// text lines with glyph-like strokes
+				if( (y / 4) % 6 == 0 && ((x * 7 + y * 3) % 11) < 5 ) {
+					Y = 16;
+				}
+			}
+			setYuyv(f.data, cx, x, y, Y, U, V);
+		}
+	}
+	return f;
+}
+
+// camera-like frame: smooth gradient plus sensor noise
+static BenchFrame makeNoiseFrame(int cx, int cy) {
+	BenchFrame f{"noise", std::vector<unsigned char>(static_cast<size_t>(cx) * cy * 2)};
+	std::mt19937 rng(2024);
+	std::uniform_int_distribution<int> noise(-12, 12);
+	for (int y = 0; y < cy; y++) {
+		for (int x = 0; x < cx; x++) {
+			const int Y = 40 + (x * 150 / cx) + (y * 50 / cy) + noise(rng);
+			setYuyv(f.data, cx, x, y, static_cast<unsigned char>(std::clamp(Y, 16, 235)),
+					static_cast<unsigned char>(100 + y * 50 / cy),
+					static_cast<unsigned char>(150 - x * 40 / cx));
+		}
+	}
+	return f;
+}
+
+static bool loadFrame(const std::string& path, int cx, int cy, BenchFrame& f) {
+	std::ifstream in(path, std::ios::binary);
+	f.name = std::filesystem::path(path).filename().string();
+	f.data.assign(static_cast<size_t>(cx) * cy * 2, 0);
+	in.read(reinterpret_cast<char*>(f.data.data()), static_cast<std::streamsize>(f.data.size()));
+	if( static_cast<size_t>(in.gcount()) != f.data.size() ) {
+		std::cerr << "Failed to read " << f.data.size() << " bytes from: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static void runBench(const BenchOpts& opts, const BenchFrame& frame,
+					 const SnapshotCodecOpts& codec, const std::string& label) {
+	std::vector<unsigned char> out;
+	size_t totalBytes = 0;
+	const auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < opts.nIters; i++) {
+		if( !encodeSnapshot(codec, frame.data.data(), opts.cx, opts.cy, out) ) {
+			std::cerr << "Failed to encode frame with codec: " << label << std::endl;
+			return;
+		}
+		totalBytes += out.size();
+		if( !opts.outDir.empty() ) {
+			const std::filesystem::path p = std::filesystem::path(opts.outDir) /
+				(frame.name + "_" + label + getSnapshotCodecExt(codec.codec));
+			std::ofstream f(p, std::ios::binary);
+			f.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+		}
+	}
+	const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	const double bytesPerFrame = static_cast<double>(totalBytes) / opts.nIters;
+	std::cout << std::left << std::setw(16) << frame.name
+			  << std::setw(8) << label
+			  << std::right << std::fixed
+			  << std::setw(10) << std::setprecision(1) << opts.nIters / sec
+			  << std::setw(14) << std::setprecision(0) << bytesPerFrame
+			  << std::setw(9) << std::setprecision(2) << frame.data.size() / bytesPerFrame
+			  << std::endl;
+}
+
+static int64_t processCpuUs() {
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static bool runPipelineBench(const BenchOpts& opts, const std::string& detector,
+							 const FrameSourceOpts& source, const std::string& outDir) {
+	const std::string start_ts = "bench_" + detector;
+	const RecordingParams rp{
+			1,
+			opts.cx, opts.cy,
+			0,
+			detector,
+			SC_DEFAULT_TILE_SIZE,
+			SC_DEFAULT_TILE_THRESHOLD,
+			outDir,
+			"",
+			false,
+			0,
+			4,
+			false,
+			SC_DEFAULT_WRITER_THREADS,
+			SC_DEFAULT_QUEUE_SIZE,
+			OVERFLOW_BLOCK,
+			SC_STORAGE_ARCHIVE,
+			SC_DEFAULT_ARCHIVE_INDEX_INTERVAL,
+			SnapshotCodecOpts{CODEC_LZ4, 0},
+			false,
+			SC_DEFAULT_KEYFRAME_INTERVAL,
+			SC_DEFAULT_KEYFRAME_INTERVAL_MS,
+			0,
+			source,
+			start_ts,
+			nullptr,
+			nullptr
+	};
+	RecordingStats stats;
+	const int64_t cpu0 = processCpuUs();
+	if( recordScreens(rp, []() { return false; }, -1, &stats) != 0 ) {
+		std::cerr << "Failed to run pipeline with detector: " << detector << std::endl;
+		return false;
+	}
+	const int64_t cpuUs = processCpuUs() - cpu0;
+	std::cout << std::left << std::setw(16) << source.type
+			  << std::setw(10) << detector
+			  << std::right << std::fixed
+			  << std::setw(8) << stats.nFrames
+			  << std::setw(10) << std::setprecision(1) << stats.getFps()
+			  << std::setw(12) << std::setprecision(1) << stats.getCpuPerFrameUs()
+			  << std::setw(12) << std::setprecision(1)
+			  << (stats.nFrames > 0 ? static_cast<double>(cpuUs) / stats.nFrames : 0)
+			  << std::setw(12) << std::setprecision(1) << stats.getLatencyAvgUs()
+			  << std::setw(12) << stats.latencyMaxUs
+			  << std::setw(10) << stats.nLatency;
+	if( source.type == SC_SOURCE_SYNTHETIC ) {
+		std::cout << std::setw(6) << stats.nDetectedChanges << "/" << stats.nScriptedChanges;
+	}
+	std::cout << std::endl;
+	return true;
+}
+
+static int runPipeline(const BenchOpts& opts) {
+	FrameSourceOpts source;
+	source.fps = opts.fps;
+	if( opts.files.empty() ) {
+		source.type = SC_SOURCE_SYNTHETIC;
+		source.nFrames = static_cast<uint64_t>(opts.nFrames);
+	} else {
+		source.type = SC_SOURCE_REPLAY;
+		source.path = opts.files[0];
+	}
+
+	// sessions are stored as archives in output or temporary directory
+	const bool fTemp = opts.outDir.empty();
+	const std::filesystem::path outDir = fTemp ?
+		std::filesystem::temp_directory_path() / ("reprostim-bench-" + std::to_string(getpid())) :
+		std::filesystem::path(opts.outDir);
+	std::filesystem::create_directories(outDir);
+
+	std::cout << "Frame size: " << opts.cx << "x" << opts.cy
+			  << ", source: " << source.type << (source.path.empty() ? "" : ":" + source.path)
+			  << ", fps: " << source.fps << std::endl;
+	std::cout << std::left << std::setw(16) << "source" << std::setw(10) << "detector"
+			  << std::right << std::setw(8) << "frames" << std::setw(10) << "fps"
+			  << std::setw(12) << "cpu/frame" << std::setw(12) << "proc/frame"
+			  << std::setw(12) << "lat.avg,us" << std::setw(12) << "lat.max,us"
+			  << std::setw(10) << "changes"
+			  << (source.type == SC_SOURCE_SYNTHETIC ? "  scripted" : "") << std::endl;
+	bool fOk = true;
+	for (const char* detector: {"sad", "luma_grid"}) {
+		fOk = runPipelineBench(opts, detector, source, outDir.string()) && fOk;
+	}
+	if( fTemp ) {
+		std::error_code ec;
+		std::filesystem::remove_all(outDir, ec);
+	}
+	return fOk ? EX_OK : EX_SOFTWARE;
+}
+
+int main(int argc, char* argv[]) {
+	const std::string HELP_STR = "Usage: reprostim-screencapture-bench [-p [-f <frames>] [-r <fps>]] [-s <cx>x<cy>] [-n <iters>] [-o <dir>] [<file.bin> ...]\n\n"
+								 "\t-p\t\tBenchmark whole capture pipeline with synthetic frame\n"
+								 "\t         \tsource, or replay source when <file.bin> or directory\n"
+								 "\t         \tis specified, instead of snapshot codecs\n"
+								 "\t-f <frames>\tNumber of synthetic frames in pipeline, defaults to 600\n"
+								 "\t-r <fps>\tSource frame rate in pipeline, defaults to 0 (unthrottled)\n"
+								 "\t-s <cx>x<cy>\tFrame size, defaults to 1920x1080\n"
+								 "\t-n <iters>\tNumber of encode iterations per codec, defaults to 20\n"
+								 "\t-o <dir>\tWrite encoded frames to directory to include file IO\n"
+								 "\t<file.bin>\tRaw YUYV frames saved with sc_opts.dump_raw, when\n"
+								 "\t         \tnot specified synthetic \"ui\" and \"noise\" frames are used\n";
+	BenchOpts opts;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if( arg == "-h" || arg == "--help" ) {
+			std::cout << HELP_STR;
+			return EX_OK;
+		} else if( arg == "-s" && i + 1 < argc ) {
+			if( sscanf(argv[++i], "%dx%d", &opts.cx, &opts.cy) != 2 || opts.cx < 2 || opts.cy < 1 ) {
+				std::cerr << "Invalid frame size: " << argv[i] << std::endl;
+				return EX_USAGE;
+			}
+		} else if( arg == "-n" && i + 1 < argc ) {
+			opts.nIters = std::max(1, atoi(argv[++i]));
+		} else if( arg == "-p" ) {
+			opts.pipeline = true;
+		} else if( arg == "-f" && i + 1 < argc ) {
+			opts.nFrames = std::max(1, atoi(argv[++i]));
+		} else if( arg == "-r" && i + 1 < argc ) {
+			opts.fps = std::max(0, atoi(argv[++i]));
+		} else if( arg == "-o" && i + 1 < argc ) {
+			opts.outDir = argv[++i];
+			std::filesystem::create_directories(opts.outDir);
+		} else if( !arg.empty() && arg[0] == '-' ) {
+			std::cerr << "Unknown option: " << arg << std::endl << HELP_STR;
+			return EX_USAGE;
+		} else {
+			opts.files.push_back(arg);
+		}
+	}
+
+	if( opts.pipeline ) {
+		return runPipeline(opts);
+	}
+
+	std::vector<BenchFrame> frames;
+	if( opts.files.empty() ) {
+		frames.push_back(makeUiFrame(opts.cx, opts.cy));
+		frames.push_back(makeNoiseFrame(opts.cx, opts.cy));
+	} else {
+		for (const auto& path: opts.files) {
+			BenchFrame f;
+			if( !loadFrame(path, opts.cx, opts.cy, f) ) {
+				return EX_NOINPUT;
+			}
+			frames.push_back(std::move(f));
+		}
+	}
+
+	std::cout << "Frame size: " << opts.cx << "x" << opts.cy
+			  << ", iterations: " << opts.nIters << std::endl;
+	std::cout << std::left << std::setw(16) << "frame" << std::setw(8) << "codec"
+			  << std::right << std::setw(10) << "fps" << std::setw(14) << "bytes/frame"
+			  << std::setw(9) << "ratio" << std::endl;
+	for (const auto& frame: frames) {
+		for (int level: {0, 1, 3, 6, 9}) {
+			runBench(opts, frame, SnapshotCodecOpts{CODEC_PNG, level}, "png" + std::to_string(level));
+		}
+		runBench(opts, frame, SnapshotCodecOpts{CODEC_QOI, 0}, "qoi");
+		runBench(opts, frame, SnapshotCodecOpts{CODEC_LZ4, 0}, "lz4");
+	}
+	return EX_OK;
+}
@@ -0,0 +1,76 @@
+#ifndef CAPTURE_BYTESTREAM_H
+#define CAPTURE_BYTESTREAM_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Little-endian serialization helper
+class ByteWriter {
+public:
+	std::vector<unsigned char> buf;
+
+	void putBytes(const void* p, size_t len) {
+		const unsigned char* b = static_cast<const unsigned char*>(p);
+		buf.insert(buf.end(), b, b + len);
+	}
+
+	template<typename T>
+	void put(T value) {
+		uint64_t v = static_cast<uint64_t>(value);
+		for (size_t i = 0; i < sizeof(T); i++) {
+			buf.push_back(static_cast<unsigned char>(v >> (8*i)));
+		}
+	}
+
+	void putString(const std::string& s) {
+		put<uint16_t>(static_cast<uint16_t>(s.size()));
+		putBytes(s.data(), s.size());
+	}
+};
+
+// Little-endian deserialization helper, sets fail flag on
+// out of bounds access instead of throwing
+class ByteReader {
+private:
+	const unsigned char* m_p;
+	size_t               m_len;
+	size_t               m_pos = 0;
+public:
+	bool fail = false;
+
+	ByteReader(const unsigned char* p, size_t len): m_p(p), m_len(len) {}
+
+	bool getBytes(void* dst, size_t len) {
+		if( fail || m_pos + len > m_len ) {
+			fail = true;
+			return false;
+		}
+		if( len > 0 ) {
+			memcpy(dst, m_p + m_pos, len);
+		}
+		m_pos += len;
+		return true;
+	}
+
+	template<typename T>
+	T get() {
+		unsigned char b[sizeof(T)] = {0};
+		if( !getBytes(b, sizeof(T)) ) return 0;
+		uint64_t v = 0;
+		for (size_t i = 0; i < sizeof(T); i++) {
+			v |= static_cast<uint64_t>(b[i]) << (8*i);
+		}
+		return static_cast<T>(v);
+	}
+
+	std::string getString() {
+		const uint16_t len = get<uint16_t>();
+		std::string s(len, '\0');
+		getBytes(s.data(), len);
+		return s;
+	}
+};
+
+#endif //CAPTURE_BYTESTREAM_H
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include "FrameDiff.h"
+#include "ChangeDetector.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static int64_t calcLumaRowTileDiffScalar(const unsigned char* r1, const unsigned char* r2,
+										 int cx, int tileSize, int64_t* tileAcc) {
+	int64_t total = 0;
+	for (int x = 0; x < cx; x += tileSize) {
+		const int x2 = std::min(x + tileSize, cx);
+		int64_t sum = 0;
+		for (int i = x; i < x2; i++) {
+			// Y sample is the first byte of each 2-byte YUYV pixel
+			const int y1 = r1[i * 2];
+			const int y2 = r2[i * 2];
+			sum += y1 > y2 ? y1 - y2 : y2 - y1;
+		}
+		*tileAcc++ += sum;
+		total += sum;
+	}
+	return total;
+}
+
+int64_t calcLumaRowTileDiff(const unsigned char* r1, const unsigned char* r2,
+						 int cx, int tileSize, int64_t* tileAcc) {
+#if defined(__SSE2__)
+	// 16 bytes hold 8 YUYV pixels, chroma bytes are masked out
+	// in both rows, so psadbw sums only luma differences
+	if( tileSize % 8 == 0 ) {
+		const __m128i mask = _mm_set1_epi16(0x00FF);
+		const int chunksPerTile = tileSize / 8;
+		const int nFullChunks = cx / 8;
+		int64_t total = 0;
+		int chunk = 0;
+		for (; chunk < nFullChunks; chunk++) {
+			__m128i a = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + chunk * 16)), mask);
+			__m128i b = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r2 + chunk * 16)), mask);
+			__m128i sad = _mm_sad_epu8(a, b);
+			const int64_t sum = _mm_cvtsi128_si32(sad) +
+				_mm_cvtsi128_si32(_mm_unpackhi_epi64(sad, sad));
+			tileAcc[chunk / chunksPerTile] += sum;
+			total += sum;
+		}
+		// remaining pixels of the last tile
+		const int x = chunk * 8;
+		if( x < cx ) {
+			int64_t tail = 0;
+			calcLumaRowTileDiffScalar(r1 + x * 2, r2 + x * 2, cx - x, tileSize, &tail);
+			tileAcc[x / tileSize] += tail;
+			total += tail;
+		}
+		return total;
+	}
+#endif
+	return calcLumaRowTileDiffScalar(r1, r2, cx, tileSize, tileAcc);
+}
+
+////////////////////////////////////////////////////////////////////////
+// SadChangeDetector
+
+SadChangeDetector::SadChangeDetector(int64_t threshold): m_threshold(threshold) {
+}
+
+bool SadChangeDetector::detect(const unsigned char* cur, const unsigned char* prev,
+							   size_t len, ChangeResult& res) {
+	res.difference = calcFrameDiff(cur, prev, len);
+	res.changed = res.difference > m_threshold;
+	res.complete = true;
+	res.tilesX = 0;
+	res.tilesY = 0;
+	res.nChangedTiles = 0;
+	res.tiles.clear();
+	return res.changed;
+}
+
+const char* SadChangeDetector::getName() const {
+	return "sad";
+}
+
+////////////////////////////////////////////////////////////////////////
+// LumaGridChangeDetector
+
+LumaGridChangeDetector::LumaGridChangeDetector(const ChangeDetectorOpts& opts):
+	m_opts(opts),
+	m_tilesX((opts.cx + opts.tileSize - 1) / opts.tileSize),
+	m_tilesY((opts.cy + opts.tileSize - 1) / opts.tileSize),
+	m_bandAcc(m_tilesX, 0) {
+}
+
+bool LumaGridChangeDetector::detect(const unsigned char* cur, const unsigned char* prev,
+									size_t len, ChangeResult& res) {
+	const size_t stride = static_cast<size_t>(m_opts.cx) * 2;
+	const int cy = static_cast<int>(std::min(static_cast<size_t>(m_opts.cy), len / stride));
+
+	res.difference = 0;
+	res.changed = false;
+	res.complete = true;
+	res.tilesX = m_tilesX;
+	res.tilesY = m_tilesY;
+	res.nChangedTiles = 0;
+	res.tiles.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+
+	for (int ty = 0; ty < m_tilesY; ty++) {
+		const int y1 = ty * m_opts.tileSize;
+		const int y2 = std::min(y1 + m_opts.tileSize, cy);
+		std::fill(m_bandAcc.begin(), m_bandAcc.end(), 0);
+
+		bool fStop = false;
+		int y = y1;
+		for (; y < y2; y++) {
+			res.difference += calcLumaRowTileDiff(cur + y * stride, prev + y * stride,
+												  m_opts.cx, m_opts.tileSize, m_bandAcc.data());
+
+			// early exit, the answer is already "changed"
+			if( !m_opts.fullScan && res.difference > m_opts.threshold ) {
+				fStop = true;
+				break;
+			}
+		}
+
+		uint8_t* tiles = res.tiles.data() + static_cast<size_t>(ty) * m_tilesX;
+		for (int tx = 0; tx < m_tilesX; tx++) {
+			if( m_bandAcc[tx] > m_opts.tileThreshold ) {
+				tiles[tx] = 1;
+				res.nChangedTiles++;
+			}
+		}
+
+		if( fStop ) {
+			res.complete = (ty == m_tilesY - 1) && (y + 1 >= y2);
+			break;
+		}
+	}
+	res.changed = res.difference > m_opts.threshold;
+	return res.changed;
+}
+
+const char* LumaGridChangeDetector::getName() const {
+	return "luma_grid";
+}
+
+////////////////////////////////////////////////////////////////////////
+// Factory
+
+std::unique_ptr<ChangeDetector> createChangeDetector(const ChangeDetectorOpts& opts) {
+	if( opts.name == "sad" ) {
+		return std::make_unique<SadChangeDetector>(opts.threshold);
+	}
+	if( opts.name == "luma_grid" ) {
+		if( opts.cx <= 0 || opts.cy <= 0 || opts.tileSize <= 0 ) {
+			return nullptr;
+		}
+		return std::make_unique<LumaGridChangeDetector>(opts);
+	}
+	return nullptr;
+}
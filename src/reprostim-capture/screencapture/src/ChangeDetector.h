@@ -0,0 +1,88 @@
+#ifndef CAPTURE_CHANGEDETECTOR_H
+#define CAPTURE_CHANGEDETECTOR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// default tile size in pixels for block-grid change detector
+#ifndef SC_DEFAULT_TILE_SIZE
+#define SC_DEFAULT_TILE_SIZE 16
+#endif
+
+// default per-tile luma difference to mark tile as changed
+#ifndef SC_DEFAULT_TILE_THRESHOLD
+#define SC_DEFAULT_TILE_THRESHOLD 64
+#endif
+
+// Change detector options, from config.yaml sc_opts
+struct ChangeDetectorOpts {
+	std::string name = "sad";  // "sad" or "luma_grid"
+	int         cx = 0;
+	int         cy = 0;
+	int64_t     threshold = 0;
+	int         tileSize = SC_DEFAULT_TILE_SIZE;
+	int         tileThreshold = SC_DEFAULT_TILE_THRESHOLD;
+	bool        fullScan = false; // don't stop on threshold, always build full tile map
+};
+
+// Result of change detection between two YUYV frames
+struct ChangeResult {
+	bool                 changed = false;
+	int64_t              difference = 0;   // accumulated difference, partial when !complete
+	bool                 complete = true;  // false when detection stopped early
+	int                  tilesX = 0;
+	int                  tilesY = 0;
+	int                  nChangedTiles = 0;
+	std::vector<uint8_t> tiles;            // row-major changed tile flags, empty when not supported
+};
+
+// Pluggable frame change detector interface
+class ChangeDetector {
+public:
+	virtual ~ChangeDetector() = default;
+
+	virtual bool        detect(const unsigned char* cur, const unsigned char* prev,
+							   size_t len, ChangeResult& res) = 0;
+	virtual const char* getName() const = 0;
+};
+
+// Legacy detector, full SAD of all luma and chroma bytes
+class SadChangeDetector: public ChangeDetector {
+private:
+	const int64_t m_threshold;
+public:
+	explicit SadChangeDetector(int64_t threshold);
+
+	bool        detect(const unsigned char* cur, const unsigned char* prev,
+					   size_t len, ChangeResult& res) override;
+	const char* getName() const override;
+};
+
+// Block-grid detector working only on Y samples of YUYV frame,
+// stops as soon as threshold exceeded unless full scan requested,
+// and reports changed tiles
+class LumaGridChangeDetector: public ChangeDetector {
+private:
+	const ChangeDetectorOpts m_opts;
+	const int                m_tilesX;
+	const int                m_tilesY;
+	std::vector<int64_t>     m_bandAcc; // per-tile accumulators for current band of rows
+public:
+	explicit LumaGridChangeDetector(const ChangeDetectorOpts& opts);
+
+	bool        detect(const unsigned char* cur, const unsigned char* prev,
+					   size_t len, ChangeResult& res) override;
+	const char* getName() const override;
+};
+
+// Create change detector by name, returns nullptr for unknown name
+std::unique_ptr<ChangeDetector> createChangeDetector(const ChangeDetectorOpts& opts);
+
+// Accumulate luma SAD of one YUYV row into per-tile accumulators,
+// returns luma SAD of the whole row
+int64_t calcLumaRowTileDiff(const unsigned char* r1, const unsigned char* r2,
+						 int cx, int tileSize, int64_t* tileAcc);
+
+#endif //CAPTURE_CHANGEDETECTOR_H
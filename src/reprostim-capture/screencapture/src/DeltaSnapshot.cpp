@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cstring>
+#include <lz4frame.h>
+#include "ByteStream.h"
+#include "DeltaSnapshot.h"
+#include "reprostim/CaptureLog.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static inline int tileExtent(int tile, int tileSize, int size) {
+	return std::min(tileSize, size - tile * tileSize);
+}
+
+static bool lz4Compress(const unsigned char* src, size_t len, std::vector<unsigned char>& out) {
+	LZ4F_preferences_t prefs;
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.frameInfo.contentSize = len;
+	const size_t offset = out.size();
+	out.resize(offset + LZ4F_compressFrameBound(len, &prefs));
+	const size_t n = LZ4F_compressFrame(out.data() + offset, out.size() - offset, src, len, &prefs);
+	if( LZ4F_isError(n) ) {
+		return false;
+	}
+	out.resize(offset + n);
+	return true;
+}
+
+static bool lz4Decompress(const unsigned char* src, size_t len, std::vector<unsigned char>& out) {
+	LZ4F_dctx* dctx = nullptr;
+	if( LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)) ) {
+		return false;
+	}
+	LZ4F_frameInfo_t info;
+	memset(&info, 0, sizeof(info));
+	size_t srcSize = len;
+	size_t res = LZ4F_getFrameInfo(dctx, &info, src, &srcSize);
+	if( LZ4F_isError(res) || info.contentSize == 0 ) {
+		LZ4F_freeDecompressionContext(dctx);
+		return false;
+	}
+	out.resize(info.contentSize);
+	size_t dstSize = out.size();
+	size_t restSize = len - srcSize;
+	res = LZ4F_decompress(dctx, out.data(), &dstSize, src + srcSize, &restSize, nullptr);
+	LZ4F_freeDecompressionContext(dctx);
+	return res == 0 && dstSize == out.size();
+}
+
+////////////////////////////////////////////////////////////////////////
+// DeltaEncoder
+
+DeltaEncoder::DeltaEncoder(const DeltaEncoderOpts& opts):
+		m_opts(opts),
+		m_tilesX((opts.cx + opts.tileSize - 1) / opts.tileSize),
+		m_tilesY((opts.cy + opts.tileSize - 1) / opts.tileSize) {
+	m_hasKeyframe = false;
+	m_keyNFrame = 0;
+	m_keyTsMs = 0;
+	m_nDeltas = 0;
+	m_nKeyframesTotal = 0;
+	m_nDeltasTotal = 0;
+}
+
+void DeltaEncoder::update(const unsigned char* frame, uint32_t nFrame, int64_t tsMs,
+						  DeltaFrame& delta, std::vector<unsigned char>& data) {
+	const size_t frameLen = static_cast<size_t>(m_opts.cx) * m_opts.cy * 2;
+	const size_t stride = static_cast<size_t>(m_opts.cx) * 2;
+	delta.tileSize = m_opts.tileSize;
+	delta.tilesX = m_tilesX;
+	delta.tilesY = m_tilesY;
+	delta.dirty.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 0);
+	delta.nDirty = 0;
+
+	bool fKeyframe = !m_hasKeyframe ||
+		(m_opts.keyframeInterval > 0 && m_nDeltas >= m_opts.keyframeInterval) ||
+		(m_opts.keyframeIntervalMs > 0 && tsMs - m_keyTsMs >= m_opts.keyframeIntervalMs);
+
+	if( !fKeyframe ) {
+		// find tiles changed against keyframe, tile is dirty as soon
+		// as any of its rows differs
+		for (int ty = 0; ty < m_tilesY; ty++) {
+			uint8_t* dirtyRow = delta.dirty.data() + static_cast<size_t>(ty) * m_tilesX;
+			const int y0 = ty * m_opts.tileSize;
+			const int th = tileExtent(ty, m_opts.tileSize, m_opts.cy);
+			for (int y = y0; y < y0 + th; y++) {
+				const unsigned char* cur = frame + y * stride;
+				const unsigned char* key = m_keyframe.data() + y * stride;
+				for (int tx = 0; tx < m_tilesX; tx++) {
+					if( dirtyRow[tx] ) continue;
+					const size_t off = static_cast<size_t>(tx) * m_opts.tileSize * 2;
+					const size_t len = static_cast<size_t>(tileExtent(tx, m_opts.tileSize, m_opts.cx)) * 2;
+					if( memcmp(cur + off, key + off, len) != 0 ) {
+						dirtyRow[tx] = 1;
+						delta.nDirty++;
+					}
+				}
+			}
+		}
+		fKeyframe = delta.nDirty * 100 > static_cast<int>(delta.dirty.size()) * SC_DELTA_MAX_DIRTY_PERCENT;
+	}
+
+	if( fKeyframe ) {
+		m_keyframe.assign(frame, frame + frameLen);
+		m_hasKeyframe = true;
+		m_keyNFrame = nFrame;
+		m_keyTsMs = tsMs;
+		m_nDeltas = 0;
+		m_nKeyframesTotal++;
+		delta.isDelta = false;
+		delta.keyFrame = nFrame;
+		delta.nDirty = 0;
+		std::fill(delta.dirty.begin(), delta.dirty.end(), 0);
+		data.resize(frameLen);
+		memcpy(data.data(), frame, frameLen);
+		return;
+	}
+
+	// pack dirty tiles rows one tile after another
+	m_nDeltas++;
+	m_nDeltasTotal++;
+	delta.isDelta = true;
+	delta.keyFrame = m_keyNFrame;
+	data.resize(frameLen);
+	unsigned char* p = data.data();
+	for (int ty = 0; ty < m_tilesY; ty++) {
+		const int y0 = ty * m_opts.tileSize;
+		const int th = tileExtent(ty, m_opts.tileSize, m_opts.cy);
+		for (int tx = 0; tx < m_tilesX; tx++) {
+			if( !delta.dirty[static_cast<size_t>(ty) * m_tilesX + tx] ) continue;
+			const size_t off = static_cast<size_t>(tx) * m_opts.tileSize * 2;
+			const size_t len = static_cast<size_t>(tileExtent(tx, m_opts.tileSize, m_opts.cx)) * 2;
+			for (int y = y0; y < y0 + th; y++) {
+				memcpy(p, frame + y * stride + off, len);
+				p += len;
+			}
+		}
+	}
+	data.resize(p - data.data());
+}
+
+////////////////////////////////////////////////////////////////////////
+// FrameReconstructor
+
+FrameReconstructor::FrameReconstructor(SnapshotArchiveReader& reader): m_reader(reader) {
+	m_hasKey = false;
+	m_keyNFrame = 0;
+}
+
+bool FrameReconstructor::loadKeyframe(uint32_t nFrame) {
+	if( m_hasKey && m_keyNFrame == nFrame ) {
+		return true;
+	}
+	const auto& entries = m_reader.getEntries();
+	for (const auto& e: entries) {
+		if( e.nFrame == nFrame && e.format != ARCHIVE_FORMAT_DELTA && e.format != ARCHIVE_FORMAT_YUYV ) {
+			ArchiveFrame frame;
+			if( !m_reader.readFrame(e, frame) || !decodeArchiveFrame(frame, m_keyBgr) ) {
+				return false;
+			}
+			m_hasKey = true;
+			m_keyNFrame = nFrame;
+			return true;
+		}
+	}
+	_ERROR("Keyframe [" << nFrame << "] not found in archive");
+	return false;
+}
+
+bool FrameReconstructor::reconstruct(const ArchiveEntry& entry, cv::Mat& bgr) {
+	ArchiveFrame frame;
+	if( !m_reader.readFrame(entry, frame) ) {
+		return false;
+	}
+	if( frame.entry.format != ARCHIVE_FORMAT_DELTA ) {
+		return decodeArchiveFrame(frame, bgr);
+	}
+
+	ByteReader r(frame.data.data(), frame.data.size());
+	const uint32_t keyFrame = r.get<uint32_t>();
+	if( r.fail || !loadKeyframe(keyFrame) ) {
+		return false;
+	}
+	bgr = m_keyBgr.clone();
+	return applyDeltaPayload(frame.data.data(), frame.data.size(), bgr);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+bool encodeDeltaPayload(const DeltaFrame& delta, const unsigned char* tiles, size_t len,
+						std::vector<unsigned char>& out) {
+	ByteWriter w;
+	w.put<uint32_t>(delta.keyFrame);
+	w.put<uint16_t>(static_cast<uint16_t>(delta.tileSize));
+	w.put<uint16_t>(static_cast<uint16_t>(delta.tilesX));
+	w.put<uint16_t>(static_cast<uint16_t>(delta.tilesY));
+	w.put<uint16_t>(0);
+	std::vector<unsigned char> bits((delta.dirty.size() + 7) / 8, 0);
+	for (size_t i = 0; i < delta.dirty.size(); i++) {
+		if( delta.dirty[i] ) bits[i >> 3] |= static_cast<unsigned char>(1 << (i & 7));
+	}
+	w.putBytes(bits.data(), bits.size());
+	out = std::move(w.buf);
+	if( len == 0 ) {
+		return true; // nothing changed against keyframe
+	}
+	return lz4Compress(tiles, len, out);
+}
+
+bool applyDeltaPayload(const unsigned char* data, size_t len, cv::Mat& bgr) {
+	ByteReader r(data, len);
+	r.get<uint32_t>(); // keyframe
+	const int tileSize = r.get<uint16_t>();
+	const int tilesX = r.get<uint16_t>();
+	const int tilesY = r.get<uint16_t>();
+	r.get<uint16_t>();
+	const size_t nTiles = static_cast<size_t>(tilesX) * tilesY;
+	std::vector<unsigned char> bits((nTiles + 7) / 8);
+	r.getBytes(bits.data(), bits.size());
+	if( r.fail || tileSize < 2 || (tileSize & 1) ||
+		(tilesX - 1) * tileSize >= bgr.cols || (tilesY - 1) * tileSize >= bgr.rows ) {
+		_ERROR("Invalid delta payload");
+		return false;
+	}
+
+	const size_t headerLen = 12 + bits.size();
+	std::vector<unsigned char> tiles;
+	if( len > headerLen && !lz4Decompress(data + headerLen, len - headerLen, tiles) ) {
+		_ERROR("Invalid delta payload, failed to decompress tiles");
+		return false;
+	}
+
+	size_t pos = 0;
+	for (int ty = 0; ty < tilesY; ty++) {
+		for (int tx = 0; tx < tilesX; tx++) {
+			const size_t i = static_cast<size_t>(ty) * tilesX + tx;
+			if( !((bits[i >> 3] >> (i & 7)) & 1) ) continue;
+			const int tw = tileExtent(tx, tileSize, bgr.cols);
+			const int th = tileExtent(ty, tileSize, bgr.rows);
+			const size_t tileLen = static_cast<size_t>(tw) * th * 2;
+			if( pos + tileLen > tiles.size() ) {
+				_ERROR("Invalid delta payload, truncated tiles data");
+				return false;
+			}
+			// YUYV->BGR conversion is done per macropixel, so converting
+			// tile separately gives exactly the same pixels as full frame
+			cv::Mat yuyvTile(th, tw, CV_8UC2, tiles.data() + pos);
+			cv::Mat bgrTile;
+			cv::cvtColor(yuyvTile, bgrTile, cv::COLOR_YUV2BGR_YUYV);
+			bgrTile.copyTo(bgr(cv::Rect(tx * tileSize, ty * tileSize, tw, th)));
+			pos += tileLen;
+		}
+	}
+	return true;
+}
+
+bool decodeArchiveFrame(const ArchiveFrame& frame, cv::Mat& bgr) {
+	switch( frame.entry.format ) {
+		case ARCHIVE_FORMAT_PNG:
+			bgr = cv::imdecode(frame.data, cv::IMREAD_COLOR);
+			return !bgr.empty();
+		case ARCHIVE_FORMAT_QOI: {
+			std::vector<unsigned char> pixels;
+			int cx = 0, cy = 0;
+			if( !decodeQoi(frame.data.data(), frame.data.size(), pixels, cx, cy) ) {
+				return false;
+			}
+			bgr = cv::Mat(cy, cx, CV_8UC3, pixels.data()).clone();
+			return true;
+		}
+		case ARCHIVE_FORMAT_YUYV:
+		case ARCHIVE_FORMAT_YUYV_LZ4: {
+			std::vector<unsigned char> yuyv;
+			if( frame.entry.format == ARCHIVE_FORMAT_YUYV ) {
+				yuyv = frame.data;
+			} else if( !lz4Decompress(frame.data.data(), frame.data.size(), yuyv) ) {
+				return false;
+			}
+			if( yuyv.size() < static_cast<size_t>(frame.cx) * frame.cy * 2 ) {
+				return false;
+			}
+			cv::Mat yuyvImage(frame.cy, frame.cx, CV_8UC2, yuyv.data());
+			cv::cvtColor(yuyvImage, bgr, cv::COLOR_YUV2BGR_YUYV);
+			return true;
+		}
+	}
+	_ERROR("Unsupported archive frame format: " << frame.entry.format);
+	return false;
+}
+
+const ArchiveEntry* findArchiveEntryAt(const std::vector<ArchiveEntry>& entries,
+									   const std::string& at) {
+	const bool fMs = !at.empty() && std::all_of(at.begin(), at.end(), ::isdigit);
+	const int64_t atMs = fMs ? std::stoll(at) : 0;
+	const ArchiveEntry* pFound = nullptr;
+	for (const auto& e: entries) {
+		// raw dumps share frame number with encoded snapshot
+		if( e.format == ARCHIVE_FORMAT_YUYV ) continue;
+		const bool fBefore = fMs ? e.tsMs <= atMs : e.name <= at;
+		if( fBefore && (!pFound || (fMs ? e.tsMs >= pFound->tsMs : e.name >= pFound->name)) ) {
+			pFound = &e;
+		}
+	}
+	return pFound;
+}
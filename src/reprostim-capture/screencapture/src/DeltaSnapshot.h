@@ -0,0 +1,114 @@
+#ifndef CAPTURE_DELTASNAPSHOT_H
+#define CAPTURE_DELTASNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "SnapshotArchive.h"
+
+// Delta snapshots store only tiles changed against the last keyframe,
+// tiles are kept as raw YUYV compressed with LZ4. Delta payload layout
+// (little-endian):
+//
+//   u32 keyframe nFrame, u16 tileSize, u16 tilesX, u16 tilesY,
+//   u16 reserved, dirty tiles bitmap, LZ4 frame with dirty tiles
+//   YUYV rows packed tile by tile in row-major tile order
+
+// default max number of deltas between keyframes
+#ifndef SC_DEFAULT_KEYFRAME_INTERVAL
+#define SC_DEFAULT_KEYFRAME_INTERVAL 50
+#endif
+
+// default max time between keyframes in ms
+#ifndef SC_DEFAULT_KEYFRAME_INTERVAL_MS
+#define SC_DEFAULT_KEYFRAME_INTERVAL_MS 10000
+#endif
+
+// write keyframe instead of delta when more than this
+// percentage of tiles changed
+#ifndef SC_DELTA_MAX_DIRTY_PERCENT
+#define SC_DELTA_MAX_DIRTY_PERCENT 50
+#endif
+
+// Delta encoder options
+struct DeltaEncoderOpts {
+	int cx = 0;
+	int cy = 0;
+	int tileSize = 16;  // must be even to keep YUYV macropixels whole
+	int keyframeInterval = SC_DEFAULT_KEYFRAME_INTERVAL;
+	int keyframeIntervalMs = SC_DEFAULT_KEYFRAME_INTERVAL_MS;
+};
+
+// Delta information attached to snapshot
+struct DeltaFrame {
+	bool                 isDelta = false;
+	uint32_t             keyFrame = 0;  // nFrame of reference keyframe
+	int                  tileSize = 0;
+	int                  tilesX = 0;
+	int                  tilesY = 0;
+	int                  nDirty = 0;
+	std::vector<uint8_t> dirty;         // one byte per tile
+};
+
+// Decides keyframe vs delta and collects tiles changed against
+// the last keyframe, used from capture thread only
+class DeltaEncoder {
+private:
+	const DeltaEncoderOpts     m_opts;
+	const int                  m_tilesX;
+	const int                  m_tilesY;
+	std::vector<unsigned char> m_keyframe;
+	bool                       m_hasKeyframe;
+	uint32_t                   m_keyNFrame;
+	int64_t                    m_keyTsMs;
+	int                        m_nDeltas;     // deltas since last keyframe
+	uint64_t                   m_nKeyframesTotal;
+	uint64_t                   m_nDeltasTotal;
+
+public:
+	explicit DeltaEncoder(const DeltaEncoderOpts& opts);
+
+	uint64_t getDeltaCount() const { return m_nDeltasTotal; }
+	uint64_t getKeyframeCount() const { return m_nKeyframesTotal; }
+
+	// fills delta info and data with full YUYV frame for keyframe,
+	// or with packed YUYV of dirty tiles for delta
+	void update(const unsigned char* frame, uint32_t nFrame, int64_t tsMs,
+				DeltaFrame& delta, std::vector<unsigned char>& data);
+};
+
+// Rebuilds full frames from archive keyframes and deltas, caches
+// the last decoded keyframe
+class FrameReconstructor {
+private:
+	SnapshotArchiveReader& m_reader;
+	bool                   m_hasKey;
+	uint32_t               m_keyNFrame;
+	cv::Mat                m_keyBgr;
+
+	bool loadKeyframe(uint32_t nFrame);
+
+public:
+	explicit FrameReconstructor(SnapshotArchiveReader& reader);
+
+	// rebuild BGR image of the specified archive entry
+	bool reconstruct(const ArchiveEntry& entry, cv::Mat& bgr);
+};
+
+// encode delta archive payload from snapshot delta info and packed tiles
+bool encodeDeltaPayload(const DeltaFrame& delta, const unsigned char* tiles, size_t len,
+						std::vector<unsigned char>& out);
+
+// apply delta archive payload to keyframe BGR image in place
+bool applyDeltaPayload(const unsigned char* data, size_t len, cv::Mat& bgr);
+
+// decode non-delta archive frame to BGR image
+bool decodeArchiveFrame(const ArchiveFrame& frame, cv::Mat& bgr);
+
+// find the last entry captured at or before specified time, time is
+// either ms since epoch or snapshot name like "2024.01.31-13.45.10.123"
+const ArchiveEntry* findArchiveEntryAt(const std::vector<ArchiveEntry>& entries,
+									   const std::string& at);
+
+#endif //CAPTURE_DELTASNAPSHOT_H
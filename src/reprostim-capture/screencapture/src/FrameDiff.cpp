@@ -0,0 +1,112 @@
+#include "FrameDiff.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRAME_DIFF_X86 1
+#include <immintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Implementations
+
+int64_t calcFrameDiffScalar(const unsigned char *f1, const unsigned char *f2, size_t len) {
+	uint64_t difference = 0;
+	for (size_t j = 0; j < len; j++) {
+		difference += f1[j] > f2[j] ? f1[j] - f2[j] : f2[j] - f1[j];
+	}
+	return static_cast<int64_t>(difference);
+}
+
+#ifdef FRAME_DIFF_X86
+
+__attribute__((target("sse2")))
+static int64_t calcFrameDiffSse2(const unsigned char *f1, const unsigned char *f2, size_t len) {
+	__m128i acc = _mm_setzero_si128();
+	size_t j = 0;
+	for (; j + 16 <= len; j += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f1 + j));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(f2 + j));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(a, b));
+	}
+	alignas(16) uint64_t sum[2];
+	_mm_store_si128(reinterpret_cast<__m128i*>(sum), acc);
+	return static_cast<int64_t>(sum[0] + sum[1]) + calcFrameDiffScalar(f1 + j, f2 + j, len - j);
+}
+
+__attribute__((target("avx2")))
+static int64_t calcFrameDiffAvx2(const unsigned char *f1, const unsigned char *f2, size_t len) {
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	size_t j = 0;
+	for (; j + 64 <= len; j += 64) {
+		__m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f1 + j));
+		__m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f2 + j));
+		__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f1 + j + 32));
+		__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f2 + j + 32));
+		acc0 = _mm256_add_epi64(acc0, _mm256_sad_epu8(a0, b0));
+		acc1 = _mm256_add_epi64(acc1, _mm256_sad_epu8(a1, b1));
+	}
+	for (; j + 32 <= len; j += 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f1 + j));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f2 + j));
+		acc0 = _mm256_add_epi64(acc0, _mm256_sad_epu8(a, b));
+	}
+	alignas(32) uint64_t sum[4];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(sum), _mm256_add_epi64(acc0, acc1));
+	return static_cast<int64_t>(sum[0] + sum[1] + sum[2] + sum[3]) +
+		calcFrameDiffScalar(f1 + j, f2 + j, len - j);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int64_t calcFrameDiffAvx512(const unsigned char *f1, const unsigned char *f2, size_t len) {
+	__m512i acc = _mm512_setzero_si512();
+	size_t j = 0;
+	for (; j + 64 <= len; j += 64) {
+		__m512i a = _mm512_loadu_si512(reinterpret_cast<const void*>(f1 + j));
+		__m512i b = _mm512_loadu_si512(reinterpret_cast<const void*>(f2 + j));
+		acc = _mm512_add_epi64(acc, _mm512_sad_epu8(a, b));
+	}
+	alignas(64) uint64_t sum[8];
+	_mm512_store_si512(reinterpret_cast<void*>(sum), acc);
+	uint64_t total = 0;
+	for (int k = 0; k < 8; k++) {
+		total += sum[k];
+	}
+	return static_cast<int64_t>(total) + calcFrameDiffScalar(f1 + j, f2 + j, len - j);
+}
+
+#endif // FRAME_DIFF_X86
+
+////////////////////////////////////////////////////////////////////////
+// Runtime dispatch
+
+std::vector<FrameDiffImpl> getFrameDiffImpls() {
+	std::vector<FrameDiffImpl> impls;
+	impls.push_back({"scalar", calcFrameDiffScalar});
+#ifdef FRAME_DIFF_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("sse2") ) {
+		impls.push_back({"sse2", calcFrameDiffSse2});
+	}
+	if( __builtin_cpu_supports("avx2") ) {
+		impls.push_back({"avx2", calcFrameDiffAvx2});
+	}
+	if( __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ) {
+		impls.push_back({"avx512", calcFrameDiffAvx512});
+	}
+#endif
+	return impls;
+}
+
+// select the last, i.e. the most advanced, supported implementation once
+static const FrameDiffImpl& getBestFrameDiffImpl() {
+	static const FrameDiffImpl s_impl = getFrameDiffImpls().back();
+	return s_impl;
+}
+
+int64_t calcFrameDiff(const unsigned char *f1, const unsigned char *f2, size_t len) {
+	return getBestFrameDiffImpl().func(f1, f2, len);
+}
+
+const char* getFrameDiffImplName() {
+	return getBestFrameDiffImpl().name;
+}
@@ -0,0 +1,34 @@
+#ifndef CAPTURE_FRAMEDIFF_H
+#define CAPTURE_FRAMEDIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Frame difference as sum of absolute differences (SAD) of all
+// bytes in two raw frame buffers. SIMD implementations are selected
+// at runtime based on CPU features, all of them return bit-identical
+// result to scalar one.
+
+// frame difference function type
+using FrameDiffFunc = int64_t (*)(const unsigned char *f1, const unsigned char *f2, size_t len);
+
+// frame difference implementation info
+struct FrameDiffImpl {
+	const char*   name;
+	FrameDiffFunc func;
+};
+
+// calculate frame difference with best implementation for current CPU
+int64_t calcFrameDiff(const unsigned char *f1, const unsigned char *f2, size_t len);
+
+// plain C++ implementation, reference one
+int64_t calcFrameDiffScalar(const unsigned char *f1, const unsigned char *f2, size_t len);
+
+// name of implementation used by calcFrameDiff
+const char* getFrameDiffImplName();
+
+// list of all implementations supported by current CPU, scalar first
+std::vector<FrameDiffImpl> getFrameDiffImpls();
+
+#endif //CAPTURE_FRAMEDIFF_H
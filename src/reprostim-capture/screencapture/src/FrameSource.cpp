@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+#include "FrameSource.h"
+#include "FrameTiming.h"
+#include "reprostim/CaptureLog.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static bool queueBuffer(int fd, unsigned int index) {
+	v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = index;
+	return ioctl(fd, VIDIOC_QBUF, &buf) != -1;
+}
+
+static void setYuyv(unsigned char* d, int cx, int x, int y,
+					unsigned char Y, unsigned char U, unsigned char V) {
+	const size_t i = (static_cast<size_t>(y) * cx + x) * 2;
+	d[i] = Y;
+	d[i + 1] = (x & 1) ? V : U;
+}
+
+////////////////////////////////////////////////////////////////////////
+// V4l2FrameSource
+
+V4l2FrameSource::V4l2FrameSource(const FrameSourceOpts& opts): m_opts(opts) {
+	m_fd = -1;
+	m_streaming = false;
+}
+
+V4l2FrameSource::~V4l2FrameSource() {
+	stop();
+}
+
+FrameResult V4l2FrameSource::dequeue(SourceFrame& frame) {
+	v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	if (ioctl(m_fd, VIDIOC_DQBUF, &buf) == -1) {
+		if( errno == EAGAIN ) {
+			return FRAME_AGAIN;
+		}
+		_ERROR("Failed to capture frame (dequeue buffer)");
+		return FRAME_ERROR;
+	}
+	const MmapBuffer& b = m_buffers[buf.index];
+	frame.index = static_cast<int>(buf.index);
+	frame.data = static_cast<const unsigned char*>(b.start);
+	frame.len = std::min(static_cast<size_t>(buf.bytesused > 0 ? buf.bytesused : b.length), b.length);
+	frame.sequence = buf.sequence;
+	frame.flags = buf.flags;
+	frame.tvSec = buf.timestamp.tv_sec;
+	frame.tvUsec = buf.timestamp.tv_usec;
+	frame.changed = false;
+	return FRAME_OK;
+}
+
+size_t V4l2FrameSource::getFrameLen() const {
+	return m_buffers.empty() ? 0 : m_buffers[0].length;
+}
+
+bool V4l2FrameSource::release(int index) {
+	return queueBuffer(m_fd, static_cast<unsigned int>(index));
+}
+
+bool V4l2FrameSource::start() {
+	// non-blocking device, frames are waited with poll() together
+	// with cancel eventfd, so stop is not stuck when signal is lost
+	m_fd = open(m_opts.path.c_str(), O_RDWR | O_NONBLOCK);
+	if (m_fd == -1) {
+		_ERROR("Failed to open " << m_opts.path);
+		return false;
+	}
+
+	// Query the device capabilities
+	v4l2_capability cap;
+	if (ioctl(m_fd, VIDIOC_QUERYCAP, &cap) == -1) {
+		_ERROR("Failed to query device capabilities");
+		stop();
+		return false;
+	}
+
+	// Set the format (e.g., YUYV)
+	v4l2_format fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+	fmt.fmt.pix.width  = m_opts.cx; // 640;
+	fmt.fmt.pix.height = m_opts.cy; // 480;
+	if (ioctl(m_fd, VIDIOC_S_FMT, &fmt) == -1) {
+		_ERROR("Failed to set v4l2 format: cx=" << m_opts.cx << ", cy=" << m_opts.cy);
+		stop();
+		return false;
+	}
+
+	// Request buffers for memory mapping, use streaming ring of
+	// several buffers so device can fill next frames while current
+	// one is processed
+	const int nBuffers = m_opts.nBuffers > 0 ? m_opts.nBuffers : 1;
+	v4l2_requestbuffers reqbuf;
+	memset(&reqbuf, 0, sizeof(reqbuf));
+	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.memory = V4L2_MEMORY_MMAP;
+	reqbuf.count = nBuffers; // number of buffers
+	if (ioctl(m_fd, VIDIOC_REQBUFS, &reqbuf) == -1) {
+		_ERROR("Failed to request buffers: " << nBuffers);
+		stop();
+		return false;
+	}
+	if (reqbuf.count < 1) {
+		_ERROR("Failed to request buffers, no buffers allocated");
+		stop();
+		return false;
+	}
+	if (reqbuf.count != static_cast<unsigned int>(nBuffers)) {
+		_INFO("Requested " << nBuffers << " buffers, driver allocated " << reqbuf.count);
+	}
+
+	// Map the buffers to user space
+	v4l2_buffer buf;
+	for (unsigned int i = 0; i < reqbuf.count; i++) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (ioctl(m_fd, VIDIOC_QUERYBUF, &buf) == -1) {
+			_ERROR("Failed to query buffer: " << i);
+			stop();
+			return false;
+		}
+
+		void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, buf.m.offset);
+		if (start == MAP_FAILED) {
+			_ERROR("Failed to map buffer: " << i);
+			stop();
+			return false;
+		}
+		m_buffers.push_back(MmapBuffer{start, buf.length});
+	}
+
+	// Enqueue all buffers, device owns them until dequeued
+	for (unsigned int i = 0; i < m_buffers.size(); i++) {
+		if (!queueBuffer(m_fd, i)) {
+			_ERROR("Failed to enqueue buffer: " << i);
+			stop();
+			return false;
+		}
+	}
+
+	// Start capturing
+	v4l2_buf_type bufType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (ioctl(m_fd, VIDIOC_STREAMON, &bufType) == -1) {
+		_ERROR("Failed to start capture");
+		stop();
+		return false;
+	}
+	m_streaming = true;
+	return true;
+}
+
+void V4l2FrameSource::stop() {
+	if( m_streaming ) {
+		v4l2_buf_type bufType = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		ioctl(m_fd, VIDIOC_STREAMOFF, &bufType);
+		m_streaming = false;
+	}
+	unmapBuffers();
+	if( m_fd >= 0 ) {
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+void V4l2FrameSource::unmapBuffers() {
+	for (auto& b: m_buffers) {
+		munmap(b.start, b.length);
+	}
+	m_buffers.clear();
+}
+
+FrameResult V4l2FrameSource::wait(int cancelFd, int timeoutMs) {
+	pollfd fds[2];
+	fds[0] = {m_fd, POLLIN, 0};
+	fds[1] = {cancelFd, POLLIN, 0};
+	const nfds_t n = cancelFd>=0 ? 2 : 1;
+	const int res = poll(fds, n, timeoutMs);
+	if( res<0 ) {
+		return errno==EINTR ? FRAME_TIMEOUT : FRAME_ERROR;
+	}
+	if( res==0 ) {
+		return FRAME_TIMEOUT;
+	}
+	if( n>1 && (fds[1].revents & POLLIN) ) {
+		return FRAME_CANCEL;
+	}
+	if( fds[0].revents & (POLLERR | POLLHUP | POLLNVAL) ) {
+		_ERROR("Failed to capture frame (poll device)");
+		return FRAME_ERROR;
+	}
+	return FRAME_OK;
+}
+
+////////////////////////////////////////////////////////////////////////
+// SoftFrameSource
+
+SoftFrameSource::SoftFrameSource(const FrameSourceOpts& opts):
+		m_opts(opts),
+		m_frameLen(static_cast<size_t>(opts.cx) * opts.cy * 2) {
+	m_sequence = 0;
+	m_nextUs = 0;
+}
+
+FrameResult SoftFrameSource::dequeue(SourceFrame& frame) {
+	const int64_t now = FrameClock::monotonicUs();
+	if( m_opts.fps > 0 && now < m_nextUs ) {
+		return FRAME_AGAIN;
+	}
+	auto it = std::find(m_busy.begin(), m_busy.end(), false);
+	if( it == m_busy.end() ) {
+		_ERROR("No free frame buffer in " << getName() << " source");
+		return FRAME_ERROR;
+	}
+	const size_t index = it - m_busy.begin();
+	bool changed = false;
+	const FrameResult res = fill(m_buffers[index].data(), m_sequence, changed);
+	if( res != FRAME_OK ) {
+		return res;
+	}
+	m_busy[index] = true;
+	frame.index = static_cast<int>(index);
+	frame.data = m_buffers[index].data();
+	frame.len = m_frameLen;
+	frame.sequence = m_sequence++;
+	frame.flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	frame.tvSec = now / 1000000;
+	frame.tvUsec = now % 1000000;
+	frame.changed = changed;
+
+	// keep constant pace, but don't burst to catch up after stall
+	if( m_opts.fps > 0 ) {
+		const int64_t periodUs = 1000000 / m_opts.fps;
+		m_nextUs = now - m_nextUs > periodUs ? now + periodUs : m_nextUs + periodUs;
+	}
+	return FRAME_OK;
+}
+
+bool SoftFrameSource::release(int index) {
+	if( index < 0 || index >= static_cast<int>(m_busy.size()) ) {
+		return false;
+	}
+	m_busy[index] = false;
+	if( m_opts.scrubReleased ) {
+		memset(m_buffers[index].data(), 0xA5, m_buffers[index].size());
+	}
+	return true;
+}
+
+bool SoftFrameSource::start() {
+	if( m_frameLen == 0 ) {
+		_ERROR("Invalid " << getName() << " source frame size: " << m_opts.cx << "x" << m_opts.cy);
+		return false;
+	}
+	const int nBuffers = m_opts.nBuffers > 0 ? m_opts.nBuffers : 1;
+	m_buffers.assign(nBuffers, std::vector<unsigned char>(m_frameLen, 0));
+	m_busy.assign(nBuffers, false);
+	m_sequence = 0;
+	m_nextUs = FrameClock::monotonicUs();
+	return true;
+}
+
+FrameResult SoftFrameSource::wait(int cancelFd, int timeoutMs) {
+	int64_t delayUs = 0;
+	if( m_opts.fps > 0 ) {
+		delayUs = std::max<int64_t>(0, m_nextUs - FrameClock::monotonicUs());
+	}
+	const int delayMs = static_cast<int>((delayUs + 999) / 1000);
+	if( cancelFd >= 0 || delayMs > 0 ) {
+		pollfd pfd = {cancelFd, POLLIN, 0};
+		const int res = poll(&pfd, cancelFd >= 0 ? 1 : 0, std::min(delayMs, timeoutMs));
+		if( res > 0 && (pfd.revents & POLLIN) ) {
+			return FRAME_CANCEL;
+		}
+	}
+	return delayMs > timeoutMs ? FRAME_TIMEOUT : FRAME_OK;
+}
+
+////////////////////////////////////////////////////////////////////////
+// ReplayFrameSource
+
+ReplayFrameSource::ReplayFrameSource(const FrameSourceOpts& opts): SoftFrameSource(opts) {
+	m_fileIndex = 0;
+}
+
+FrameResult ReplayFrameSource::fill(unsigned char* data, uint32_t sequence, bool& changed) {
+	changed = false;
+	for (size_t nOpened = 0; nOpened <= m_files.size(); nOpened++) {
+		if( m_file.is_open() ) {
+			m_file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(m_frameLen));
+			if( static_cast<size_t>(m_file.gcount()) == m_frameLen ) {
+				return FRAME_OK;
+			}
+			if( m_file.gcount() > 0 ) {
+				_VERBOSE("Skip incomplete frame at the end of replay file: " << m_files[m_fileIndex]);
+			}
+			m_file.close();
+			m_fileIndex++;
+		}
+		if( !openNextFile() ) {
+			return FRAME_EOF;
+		}
+	}
+	return FRAME_EOF;
+}
+
+bool ReplayFrameSource::openNextFile() {
+	if( m_fileIndex >= m_files.size() ) {
+		if( !m_opts.loop || m_files.empty() ) {
+			return false;
+		}
+		m_fileIndex = 0;
+	}
+	m_file.clear();
+	m_file.open(m_files[m_fileIndex], std::ios::binary);
+	if( !m_file.is_open() ) {
+		_ERROR("Failed to open replay file: " << m_files[m_fileIndex]);
+		return false;
+	}
+	_VERBOSE("Replay frames from: " << m_files[m_fileIndex]);
+	return true;
+}
+
+bool ReplayFrameSource::start() {
+	m_files.clear();
+	m_fileIndex = 0;
+	std::error_code ec;
+	if( std::filesystem::is_directory(m_opts.path, ec) ) {
+		for (const auto& entry: std::filesystem::directory_iterator(m_opts.path, ec)) {
+			const std::string ext = entry.path().extension().string();
+			if( entry.is_regular_file() && (ext == ".bin" || ext == ".yuyv") ) {
+				m_files.push_back(entry.path().string());
+			}
+		}
+		std::sort(m_files.begin(), m_files.end());
+	} else if( std::filesystem::is_regular_file(m_opts.path, ec) ) {
+		m_files.push_back(m_opts.path);
+	}
+	if( m_files.empty() ) {
+		_ERROR("No replay frames found: " << m_opts.path);
+		return false;
+	}
+	_INFO("Replay " << m_files.size() << " file(s) from: " << m_opts.path);
+	return SoftFrameSource::start() && openNextFile();
+}
+
+////////////////////////////////////////////////////////////////////////
+// SyntheticFrameSource
+
+SyntheticFrameSource::SyntheticFrameSource(const FrameSourceOpts& opts): SoftFrameSource(opts) {
+}
+
+FrameResult SyntheticFrameSource::fill(unsigned char* data, uint32_t sequence, bool& changed) {
+	if( m_opts.nFrames > 0 && sequence >= m_opts.nFrames ) {
+		return FRAME_EOF;
+	}
+	const int cx = m_opts.cx;
+	const int cy = m_opts.cy;
+	const uint32_t interval = m_opts.changeInterval > 0 ? m_opts.changeInterval : 1;
+	const uint32_t scene = sequence / interval;
+	changed = sequence > 0 && sequence % interval == 0;
+
+	// every 4th scene changes whole screen background, others
+	// move stimulus-like box over static UI
+	std::vector<unsigned char>& bg = m_backgrounds[(scene / 4) % 2];
+	if( bg.empty() ) {
+		bg.resize(m_frameLen);
+		const unsigned char bgY = (scene / 4) % 2 ? 200 : 235;
+		for (int y = 0; y < cy; y++) {
+			for (int x = 0; x < cx; x++) {
+				unsigned char Y = bgY;
+				if( y < cy / 20 ) {
+					Y = 60; // title bar
+				} else if( (y / 4) % 6 == 0 && ((x * 7 + y * 3) % 11) < 5 ) {
+					Y = 16; // text-like strokes
+				}
+				setYuyv(bg.data(), cx, x, y, Y, 128, 128);
+			}
+		}
+	}
+	memcpy(data, bg.data(), m_frameLen);
+
+	const int box = std::max(2, std::min(cx, cy) / 16) & ~1;
+	const uint32_t h = scene * 2654435761u;
+	const int bx = static_cast<int>(h % static_cast<uint32_t>(std::max(1, cx - box))) & ~1;
+	const int by = static_cast<int>((h >> 16) % static_cast<uint32_t>(std::max(1, cy - box)));
+	for (int y = by; y < std::min(cy, by + box); y++) {
+		for (int x = bx; x < std::min(cx, bx + box); x++) {
+			setYuyv(data, cx, x, y, 30 + (scene * 37) % 200, 90, 200);
+		}
+	}
+	return FRAME_OK;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+std::unique_ptr<FrameSource> createFrameSource(const FrameSourceOpts& opts) {
+	if( opts.type == SC_SOURCE_V4L2 ) {
+		return std::make_unique<V4l2FrameSource>(opts);
+	} else if( opts.type == SC_SOURCE_REPLAY ) {
+		return std::make_unique<ReplayFrameSource>(opts);
+	} else if( opts.type == SC_SOURCE_SYNTHETIC ) {
+		return std::make_unique<SyntheticFrameSource>(opts);
+	}
+	return nullptr;
+}
+
+bool parseFrameSourceSpec(const std::string& spec, std::string& type, std::string& path) {
+	const std::string replayPrefix = std::string(SC_SOURCE_REPLAY) + ":";
+	if( spec == SC_SOURCE_V4L2 || spec == SC_SOURCE_SYNTHETIC ) {
+		type = spec;
+		path.clear();
+		return true;
+	}
+	if( spec.rfind(replayPrefix, 0) == 0 && spec.size() > replayPrefix.size() ) {
+		type = SC_SOURCE_REPLAY;
+		path = spec.substr(replayPrefix.size());
+		return true;
+	}
+	return false;
+}
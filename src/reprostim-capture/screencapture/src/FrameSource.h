@@ -0,0 +1,194 @@
+#ifndef CAPTURE_FRAMESOURCE_H
+#define CAPTURE_FRAMESOURCE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// frame source types
+#ifndef SC_SOURCE_V4L2
+#define SC_SOURCE_V4L2 "v4l2"
+#endif
+
+#ifndef SC_SOURCE_REPLAY
+#define SC_SOURCE_REPLAY "replay"
+#endif
+
+#ifndef SC_SOURCE_SYNTHETIC
+#define SC_SOURCE_SYNTHETIC "synthetic"
+#endif
+
+// default frame rate of replay and synthetic sources
+#ifndef SC_DEFAULT_SOURCE_FPS
+#define SC_DEFAULT_SOURCE_FPS 60
+#endif
+
+// default number of synthetic frames between scripted screen changes
+#ifndef SC_DEFAULT_SOURCE_CHANGE_INTERVAL
+#define SC_DEFAULT_SOURCE_CHANGE_INTERVAL 30
+#endif
+
+// Frame source options
+struct FrameSourceOpts {
+	std::string type = SC_SOURCE_V4L2;
+	std::string path;              // video device or replay file/directory
+	int         cx = 0;
+	int         cy = 0;
+	int         nBuffers = 1;
+	int         fps = SC_DEFAULT_SOURCE_FPS; // replay/synthetic, 0 means unthrottled
+	bool        loop = false;      // replay from the beginning at end
+	int         changeInterval = SC_DEFAULT_SOURCE_CHANGE_INTERVAL; // synthetic
+	uint64_t    nFrames = 0;       // synthetic frames limit, 0 means unlimited
+	bool        scrubReleased = false; // replay/synthetic, overwrite released buffer like device
+};
+
+// Result of frame source operation
+enum FrameResult {
+	FRAME_OK,      // frame is ready or dequeued
+	FRAME_AGAIN,   // no frame yet, wait again
+	FRAME_TIMEOUT,
+	FRAME_CANCEL,  // terminate requested with cancel eventfd
+	FRAME_EOF,     // no more frames, e.g. end of replay
+	FRAME_ERROR
+};
+
+// Frame buffer dequeued from source, owned by caller until released
+struct SourceFrame {
+	int                  index = -1;  // buffer index in source ring
+	const unsigned char* data = nullptr;
+	size_t               len = 0;
+	uint32_t             sequence = 0;
+	uint32_t             flags = 0;   // V4L2 buffer flags
+	int64_t              tvSec = 0;   // capture timestamp
+	int64_t              tvUsec = 0;
+	bool                 changed = false; // scripted screen change, synthetic only
+};
+
+// Source of raw YUYV frames for recordScreens, all methods are
+// called from capture thread only
+class FrameSource {
+public:
+	virtual ~FrameSource() = default;
+
+	virtual int         getBufferCount() const = 0;
+	// max frame length in bytes
+	virtual size_t      getFrameLen() const = 0;
+	virtual const char* getName() const = 0;
+
+	// take filled frame buffer
+	virtual FrameResult dequeue(SourceFrame& frame) = 0;
+	// return frame buffer to source
+	virtual bool        release(int index) = 0;
+	// open source and start streaming
+	virtual bool        start() = 0;
+	virtual void        stop() = 0;
+	// wait for the next frame, cancelFd is optional eventfd
+	virtual FrameResult wait(int cancelFd, int timeoutMs) = 0;
+};
+
+// V4L2 capture device with ring of memory mapped buffers
+class V4l2FrameSource: public FrameSource {
+private:
+	struct MmapBuffer {
+		void*  start;
+		size_t length;
+	};
+
+	const FrameSourceOpts   m_opts;
+	int                     m_fd;
+	bool                    m_streaming;
+	std::vector<MmapBuffer> m_buffers;
+
+	void unmapBuffers();
+
+public:
+	explicit V4l2FrameSource(const FrameSourceOpts& opts);
+	~V4l2FrameSource() override;
+
+	int         getBufferCount() const override { return static_cast<int>(m_buffers.size()); }
+	size_t      getFrameLen() const override;
+	const char* getName() const override { return SC_SOURCE_V4L2; }
+
+	FrameResult dequeue(SourceFrame& frame) override;
+	bool        release(int index) override;
+	bool        start() override;
+	void        stop() override;
+	FrameResult wait(int cancelFd, int timeoutMs) override;
+};
+
+// Base of software frame sources, ring of heap buffers paced
+// at target frame rate
+class SoftFrameSource: public FrameSource {
+private:
+	std::vector<std::vector<unsigned char>> m_buffers;
+	std::vector<bool>                       m_busy;
+	uint32_t                                m_sequence;
+	int64_t                                 m_nextUs; // monotonic time of next frame
+
+protected:
+	const FrameSourceOpts m_opts;
+	const size_t          m_frameLen;
+
+	// fill next frame, returns FRAME_OK or FRAME_EOF
+	virtual FrameResult fill(unsigned char* data, uint32_t sequence, bool& changed) = 0;
+
+public:
+	explicit SoftFrameSource(const FrameSourceOpts& opts);
+
+	int         getBufferCount() const override { return static_cast<int>(m_buffers.size()); }
+	size_t      getFrameLen() const override { return m_frameLen; }
+
+	FrameResult dequeue(SourceFrame& frame) override;
+	bool        release(int index) override;
+	bool        start() override;
+	void        stop() override {}
+	FrameResult wait(int cancelFd, int timeoutMs) override;
+};
+
+// Replays raw YUYV frames from .bin dumps (dump_raw) or raw YUYV
+// files, path is single file or directory, files are played in
+// name order, file can contain several frames
+class ReplayFrameSource: public SoftFrameSource {
+private:
+	std::vector<std::string> m_files;
+	size_t                   m_fileIndex;
+	std::ifstream            m_file;
+
+	bool openNextFile();
+
+protected:
+	FrameResult fill(unsigned char* data, uint32_t sequence, bool& changed) override;
+
+public:
+	explicit ReplayFrameSource(const FrameSourceOpts& opts);
+
+	const char* getName() const override { return SC_SOURCE_REPLAY; }
+	bool        start() override;
+};
+
+// Generates UI-like screen with scripted changes every
+// changeInterval frames, alternating small stimulus box
+// moves and full screen background changes
+class SyntheticFrameSource: public SoftFrameSource {
+private:
+	std::vector<unsigned char> m_backgrounds[2]; // pre-rendered screens
+
+protected:
+	FrameResult fill(unsigned char* data, uint32_t sequence, bool& changed) override;
+
+public:
+	explicit SyntheticFrameSource(const FrameSourceOpts& opts);
+
+	const char* getName() const override { return SC_SOURCE_SYNTHETIC; }
+};
+
+// create frame source by type, returns nullptr for unknown type
+std::unique_ptr<FrameSource> createFrameSource(const FrameSourceOpts& opts);
+
+// parse CLI source spec: "v4l2", "synthetic" or "replay:<path>",
+// returns false on invalid spec
+bool parseFrameSourceSpec(const std::string& spec, std::string& type, std::string& path);
+
+#endif //CAPTURE_FRAMESOURCE_H
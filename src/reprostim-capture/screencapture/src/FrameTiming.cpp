@@ -0,0 +1,145 @@
+#include <ctime>
+#include <linux/videodev2.h>
+#include <nlohmann/json.hpp>
+#include "FrameTiming.h"
+#include "reprostim/CaptureLog.h"
+
+using json = nlohmann::json;
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static inline int64_t clockUs(clockid_t clk) {
+	timespec ts;
+	clock_gettime(clk, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+////////////////////////////////////////////////////////////////////////
+// FrameClock
+
+FrameClock::FrameClock(int64_t syncIntervalUs) {
+	m_hasOffset = false;
+	m_offsetUs = 0;
+	m_lastSyncUs = 0;
+	m_syncIntervalUs = syncIntervalUs;
+}
+
+int64_t FrameClock::monotonicUs() {
+	return clockUs(CLOCK_MONOTONIC);
+}
+
+int64_t FrameClock::sync() {
+	const int64_t now = monotonicUs();
+	if( m_hasOffset && now - m_lastSyncUs < m_syncIntervalUs ) {
+		return 0;
+	}
+
+	// bracket realtime read with monotonic reads, and take sample
+	// with the narrowest bracket to minimize preemption error
+	int64_t bestSpan = INT64_MAX;
+	int64_t bestMono = 0;
+	int64_t bestReal = 0;
+	for (int i = 0; i < SC_FRAME_CLOCK_SAMPLES; i++) {
+		const int64_t mono1 = clockUs(CLOCK_MONOTONIC);
+		const int64_t real = clockUs(CLOCK_REALTIME);
+		const int64_t mono2 = clockUs(CLOCK_MONOTONIC);
+		if( mono2 - mono1 < bestSpan ) {
+			bestSpan = mono2 - mono1;
+			bestMono = mono1 + (mono2 - mono1) / 2;
+			bestReal = real;
+		}
+	}
+	return sync(bestMono, bestReal);
+}
+
+int64_t FrameClock::sync(int64_t monoUs, int64_t realUs) {
+	const int64_t offsetUs = realUs - monoUs;
+	const int64_t change = m_hasOffset ? offsetUs - m_offsetUs : 0;
+	m_offsetUs = offsetUs;
+	m_lastSyncUs = monoUs;
+	m_hasOffset = true;
+	return change;
+}
+
+Timestamp FrameClock::toTimestamp(int64_t monoUs) const {
+	return Timestamp(std::chrono::duration_cast<Timestamp::duration>(
+			std::chrono::microseconds(toWallUs(monoUs))));
+}
+
+////////////////////////////////////////////////////////////////////////
+// FrameTimingIndex
+
+FrameTimingIndex::~FrameTimingIndex() {
+	close();
+}
+
+bool FrameTimingIndex::append(const FrameTiming& t, const std::string& name) {
+	_SYNC();
+	if( !m_file.is_open() ) {
+		return false;
+	}
+	m_file << frameTimingToJson(t, name) << '\n';
+	if( !m_file.good() ) {
+		_ERROR("Error writing frame timing index: " << m_path);
+		return false;
+	}
+	return true;
+}
+
+void FrameTimingIndex::close() {
+	_SYNC();
+	if( m_file.is_open() ) {
+		m_file.close();
+	}
+}
+
+bool FrameTimingIndex::isOpen() const {
+	_SYNC();
+	return m_file.is_open();
+}
+
+bool FrameTimingIndex::open(const std::string& path) {
+	_SYNC();
+	m_path = path;
+	m_file.open(path, std::ios::out | std::ios::app);
+	if( !m_file.is_open() ) {
+		_ERROR("Error opening frame timing index: " << path);
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+FrameTiming getFrameTiming(const FrameClock& clock, uint32_t nFrame, uint32_t sequence,
+						   uint32_t flags, int64_t tvSec, int64_t tvUsec) {
+	FrameTiming t;
+	t.nFrame = nFrame;
+	t.sequence = sequence;
+	const bool fMonotonic = (flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	if( fMonotonic && (tvSec != 0 || tvUsec != 0) ) {
+		t.monoUs = tvSec * 1000000 + tvUsec;
+		t.kernelTs = true;
+	} else {
+		t.monoUs = FrameClock::monotonicUs();
+		t.kernelTs = false;
+	}
+	t.wallUs = clock.toWallUs(t.monoUs);
+	return t;
+}
+
+std::string frameTimingToJson(const FrameTiming& t, const std::string& name) {
+	const Timestamp ts(std::chrono::duration_cast<Timestamp::duration>(
+			std::chrono::microseconds(t.wallUs)));
+	json jm = {
+			{"frame", t.nFrame},
+			{"sequence", t.sequence},
+			{"mono_us", t.monoUs},
+			{"wall_us", t.wallUs},
+			{"isotime", getTimeIsoStr(ts)},
+			{"name", name}
+	};
+	return jm.dump();
+}
@@ -0,0 +1,98 @@
+#ifndef CAPTURE_FRAMETIMING_H
+#define CAPTURE_FRAMETIMING_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include "reprostim/CaptureLib.h"
+#include "reprostim/CaptureThreading.h"
+
+using namespace reprostim;
+
+// interval in us between re-measurements of realtime/monotonic clocks
+// offset, wall clock can be stepped or slewed by NTP at any time
+#ifndef SC_FRAME_CLOCK_SYNC_US
+#define SC_FRAME_CLOCK_SYNC_US 1000000
+#endif
+
+// offset change in us logged as wall clock step
+#ifndef SC_FRAME_CLOCK_STEP_US
+#define SC_FRAME_CLOCK_STEP_US 1000
+#endif
+
+// number of clock reads per offset measurement, the one with the
+// narrowest monotonic bracket is used
+#ifndef SC_FRAME_CLOCK_SAMPLES
+#define SC_FRAME_CLOCK_SAMPLES 3
+#endif
+
+// name of per-session frame timing index file in files storage
+#ifndef SC_FRAME_INDEX_FILE
+#define SC_FRAME_INDEX_FILE "frames.jsonl"
+#endif
+
+// Converts kernel capture timestamps (CLOCK_MONOTONIC) to wall clock
+// using tracked offset between CLOCK_REALTIME and CLOCK_MONOTONIC,
+// used from capture thread only
+class FrameClock {
+private:
+	bool    m_hasOffset;
+	int64_t m_offsetUs;     // realtime - monotonic
+	int64_t m_lastSyncUs;   // monotonic time of last measurement
+	int64_t m_syncIntervalUs;
+
+public:
+	explicit FrameClock(int64_t syncIntervalUs = SC_FRAME_CLOCK_SYNC_US);
+
+	int64_t getOffsetUs() const { return m_offsetUs; }
+	bool    hasOffset() const { return m_hasOffset; }
+
+	// measure offset when sync interval elapsed, returns offset change in us
+	int64_t sync();
+	// set measured offset explicitly, returns offset change in us
+	int64_t sync(int64_t monoUs, int64_t realUs);
+	// wall clock time in us since epoch for monotonic time in us
+	int64_t toWallUs(int64_t monoUs) const { return monoUs + m_offsetUs; }
+	Timestamp toTimestamp(int64_t monoUs) const;
+
+	// current CLOCK_MONOTONIC time in us
+	static int64_t monotonicUs();
+};
+
+// Capture timing of single frame
+struct FrameTiming {
+	uint32_t nFrame = 0;
+	uint32_t sequence = 0;  // V4L2 buffer sequence number
+	int64_t  monoUs = 0;    // kernel capture timestamp, CLOCK_MONOTONIC
+	int64_t  wallUs = 0;    // capture time converted to wall clock
+	bool     kernelTs = false; // false when dequeue time was used instead
+};
+
+// Thread-safe per-session frame timing index, one JSON object per
+// line, used for files storage (archive stores timing in records)
+class FrameTimingIndex {
+private:
+	_DECLARE_CLASS_WITH_SYNC();
+
+	std::ofstream m_file;
+	std::string   m_path;
+
+public:
+	~FrameTimingIndex();
+
+	bool append(const FrameTiming& t, const std::string& name);
+	void close();
+	const std::string& getPath() const { return m_path; }
+	bool isOpen() const;
+	bool open(const std::string& path);
+};
+
+// capture timing of dequeued V4L2 buffer fields, falls back to current
+// monotonic time when buffer timestamp is not monotonic or missing
+FrameTiming getFrameTiming(const FrameClock& clock, uint32_t nFrame, uint32_t sequence,
+						   uint32_t flags, int64_t tvSec, int64_t tvUsec);
+
+// format frame timing as single JSON line
+std::string frameTimingToJson(const FrameTiming& t, const std::string& name);
+
+#endif //CAPTURE_FRAMETIMING_H
@@ -1,129 +1,195 @@
 #include <iostream>
-#include <fstream>
 #include <unistd.h>
 #include <fcntl.h>
 #include <filesystem>
+#include <cerrno>
 #include <cstring>
 #include <atomic>
 #include <thread>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
-#include <linux/videodev2.h>
-#include <opencv2/opencv.hpp>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <sstream>
 #include "reprostim/CaptureLib.h"
+#include "ChangeDetector.h"
+#include "FrameDiff.h"
+#include "FrameSource.h"
+#include "FrameTiming.h"
 #include "RecordingThread.h"
+#include "SnapshotWriter.h"
 
 using namespace reprostim;
 
 ////////////////////////////////////////////////////////////////////////
 
-// TODO: work on algorithm to detect changes better
-inline int calcFrameDiff(unsigned char *f1, unsigned char *f2, size_t len) {
-	/*
-	int diffSum = 0;
-	for (size_t j = 0; j < len; j++) {
-		int i1 = static_cast<int>(f1[j]);
-		int i2 = static_cast<int>(f2[j]);
-		//diffSum += abs(i1 - i2);
-		if( i1 != i2 ) {
-			diffSum++;
-		}
+// CPU time in us consumed by calling thread
+static int64_t threadCpuUs() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void reportEvent(const RecordingParams& rp, RecordingEventType type,
+						int64_t durationMs, const std::string& message) {
+	_INFO(message);
+	if( rp.onEvent ) {
+		rp.onEvent(RecordingEvent{type, rp.sessionId, durationMs, message});
 	}
-	_INFO("calcDiff: diffSum=" << diffSum);
-	return diffSum;*/
+}
 
-	int difference = 0;
-	for (size_t j = 0; j < len; j++) {
-		difference += abs(static_cast<int>(f1[j]) - static_cast<int>(f2[j]));
+std::string recordingStatsToString(const RecordingStats& stats) {
+	std::ostringstream ss;
+	ss << "frames=" << stats.nFrames
+	   << ", fps=" << stats.getFps()
+	   << ", cpuPerFrameUs=" << stats.getCpuPerFrameUs()
+	   << ", saved=" << stats.nSaved
+	   << ", changes=" << stats.nLatency
+	   << ", latencyAvgUs=" << stats.getLatencyAvgUs()
+	   << ", latencyMaxUs=" << stats.latencyMaxUs;
+	if( stats.nScriptedChanges > 0 ) {
+		ss << ", scriptedChanges=" << stats.nScriptedChanges
+		   << ", detectedScriptedChanges=" << stats.nDetectedChanges;
 	}
-	//_INFO("calcDiff: difference=" << difference);
-	return difference;
+	return ss.str();
 }
 
-int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated) {
+int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated, int cancelFd,
+				  RecordingStats* pStats) {
 	_VERBOSE("recordScreens enter, sessionId=" << rp.sessionId);
-	int fd = open(rp.videoDevPath.c_str(), O_RDWR);
-	if (fd == -1) {
-		_ERROR("Failed to open " << rp.videoDevPath);
+	ChangeDetectorOpts cdo;
+	cdo.name = rp.detector;
+	cdo.cx = rp.cx;
+	cdo.cy = rp.cy;
+	cdo.threshold = rp.threshold;
+	cdo.tileSize = rp.tileSize;
+	cdo.tileThreshold = rp.tileThreshold;
+	std::unique_ptr<ChangeDetector> pDetector = createChangeDetector(cdo);
+	if (!pDetector) {
+		_ERROR("Failed to create change detector: " << rp.detector);
 		return -1;
 	}
 
-	// Query the device capabilities
-	v4l2_capability cap;
-	if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == -1) {
-		_ERROR("Failed to query device capabilities");
-		close(fd);
-		return -1;
+	// Frame source, V4L2 device or software replay/synthetic one
+	FrameSourceOpts fso = rp.source;
+	fso.cx = rp.cx;
+	fso.cy = rp.cy;
+	if( fso.type == SC_SOURCE_V4L2 ) {
+		fso.path = rp.videoDevPath;
 	}
-
-	// Set the format (e.g., YUYV)
-	v4l2_format fmt;
-	memset(&fmt, 0, sizeof(fmt));
-	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-	fmt.fmt.pix.width  = rp.cx; // 640;
-	fmt.fmt.pix.height = rp.cy; // 480;
-	if (ioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
-		_ERROR("Failed to set v4l2 format: cx=" << rp.cx << ", cy=" << rp.cy);
-		close(fd);
-		return -1;
+	// Use streaming ring of several buffers so device can fill
+	// next frames while current one is processed
+	fso.nBuffers = rp.nBuffers > 0 ? rp.nBuffers : 1;
+	// in zero-copy mode previous frame buffer is held by us, so
+	// keep at least two more buffers queued to the device
+	if( rp.zeroCopy && fso.nBuffers < SC_MIN_ZERO_COPY_BUFFERS ) {
+		_INFO("Zero-copy mode requires at least " << SC_MIN_ZERO_COPY_BUFFERS
+			<< " buffers, requested " << fso.nBuffers);
+		fso.nBuffers = SC_MIN_ZERO_COPY_BUFFERS;
 	}
-
-	// Request buffers for memory mapping
-	v4l2_requestbuffers reqbuf;
-	memset(&reqbuf, 0, sizeof(reqbuf));
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	reqbuf.memory = V4L2_MEMORY_MMAP;
-	reqbuf.count = 1; // number of buffers
-	if (ioctl(fd, VIDIOC_REQBUFS, &reqbuf) == -1) {
-		_ERROR("Failed to request buffers");
-		close(fd);
-		return -1;
-	}
-
-	// Map the buffer to user space
-	v4l2_buffer buf;
-	memset(&buf, 0, sizeof(buf));
-	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	buf.memory = V4L2_MEMORY_MMAP;
-	buf.index = 0;
-	if (ioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
-		_ERROR("Failed to query buffer");
-		close(fd);
+	std::unique_ptr<FrameSource> pSource = createFrameSource(fso);
+	if( !pSource ) {
+		_ERROR("Unknown frame source: " << fso.type);
 		return -1;
 	}
-
-	void* buffer = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
-	if (buffer == MAP_FAILED) {
-		_ERROR("Failed to map buffer");
-		close(fd);
+	if( !pSource->start() ) {
+		_ERROR("Failed to start " << fso.type << " frame source: " << fso.path);
 		return -1;
 	}
-
-	// Start capturing
-	if (ioctl(fd, VIDIOC_STREAMON, &buf.type) == -1) {
-		_ERROR("Failed to start capture");
-		munmap(buffer, buf.length);
-		close(fd);
-		return -1;
+	if( fso.type != SC_SOURCE_V4L2 ) {
+		_INFO("Frame source: " << pSource->getName() << ", path=" << fso.path
+			<< ", fps=" << fso.fps << ", buffers=" << pSource->getBufferCount());
 	}
 
-	// Variables to store two consecutive frames
-	unsigned char* previousFrame = new unsigned char[buf.length];
-	unsigned char* currentFrame = new unsigned char[buf.length];
+	// Variables to store two consecutive frames, in zero-copy
+	// mode frames are compared directly in mmap buffers and
+	// previous one is kept dequeued until next frame arrives
+	const size_t frameLen = pSource->getFrameLen();
+	unsigned char* previousFrame = rp.zeroCopy ? nullptr : new unsigned char[frameLen];
+	unsigned char* currentFrame = rp.zeroCopy ? nullptr : new unsigned char[frameLen];
+	SourceFrame frame;
+	SourceFrame prevFrame; // held buffer in zero-copy mode
 	int nFrame = 0;
+	ChangeResult change;
+	FrameDropCounter dropCounter;
 	bool fSave = false;
 	long long nextSaveTime = currentTimeMs() + rp.intervalMs;
 
 	//std::string start_ts = getTimeStr();
-	std::filesystem::path sessionPath = std::filesystem::path(rp.outPath) / (rp.start_ts + "_");
-	if( !std::filesystem::exists(sessionPath) ) {
+	// session is stored either in directory with snapshot files, or
+	// in single append-only archive file
+	const bool fArchive = rp.storage == SC_STORAGE_ARCHIVE;
+	const std::string sessionExt = fArchive ? SC_ARCHIVE_EXT : "";
+	std::filesystem::path sessionPath = std::filesystem::path(rp.outPath) / (rp.start_ts + "_" + sessionExt);
+	SnapshotArchive archive;
+	if( fArchive ) {
+		_INFO("Create session " << rp.sessionId << " archive: " << sessionPath.string());
+		if( !archive.open(sessionPath.string(), rp.cx, rp.cy, rp.archiveIndexInterval) ) {
+			pSource->stop();
+			delete[] previousFrame;
+			delete[] currentFrame;
+			return -1;
+		}
+	} else if( !std::filesystem::exists(sessionPath) ) {
 		_INFO("Create session " << rp.sessionId << " directory: " << sessionPath.string());
 		std::filesystem::create_directory(sessionPath);
 	}
 
+	// per-session index of frame capture timing, archive keeps
+	// the same values in its own records
+	FrameTimingIndex timingIndex;
+	if( !fArchive ) {
+		timingIndex.open((sessionPath / SC_FRAME_INDEX_FILE).string());
+	}
+
 	_SESSION_LOG_BEGIN(rp.pLogger);
 
+	// Snapshot writer pool, converts and saves frames off the capture thread
+	SnapshotWriterOpts swo;
+	swo.nThreads = rp.writerThreads;
+	swo.queueSize = rp.queueSize;
+	// deltas reference the keyframe set by encoder before the snapshot
+	// is queued, so no snapshot can be dropped in delta mode
+	swo.overflow = rp.delta ? OVERFLOW_BLOCK : rp.overflow;
+	swo.codec = rp.codec;
+	swo.pArchive = fArchive ? &archive : nullptr;
+	swo.pTimingIndex = timingIndex.isOpen() ? &timingIndex : nullptr;
+	swo.pLogger = rp.pLogger;
+	SnapshotWriter writer(swo);
+	writer.start();
+
+	// Delta encoder to store only tiles changed against keyframe
+	std::unique_ptr<DeltaEncoder> pDelta;
+	if( rp.delta ) {
+		DeltaEncoderOpts deo;
+		deo.cx = rp.cx;
+		deo.cy = rp.cy;
+		deo.tileSize = rp.tileSize;
+		deo.keyframeInterval = rp.keyframeInterval;
+		deo.keyframeIntervalMs = rp.keyframeIntervalMs;
+		pDelta = std::make_unique<DeltaEncoder>(deo);
+	}
+
+	_VERBOSE("Change detector: " << pDetector->getName()
+		<< ", frame diff implementation: " << getFrameDiffImplName()
+		<< ", codec: " << getSnapshotCodecName(rp.codec.codec));
+
+	// Kernel timestamps are CLOCK_MONOTONIC, converted to wall clock
+	// with tracked offset
+	FrameClock frameClock;
+	frameClock.sync();
+	bool fKernelTsWarned = false;
+
+	// Starvation tracking, no frames from device for too long
+	const int pollTimeoutMs = rp.starvationMs > 0 ?
+			std::min(rp.starvationMs, SC_POLL_TIMEOUT_MS) : SC_POLL_TIMEOUT_MS;
+	int64_t lastFrameUs = FrameClock::monotonicUs();
+	bool fStarved = false;
+
+	// Throughput and detection latency statistics
+	RecordingStats stats;
+	const int64_t startUs = FrameClock::monotonicUs();
+	const int64_t startCpuUs = threadCpuUs();
+
 	// Capturing and comparing loop
 	while (true) {
 		if( isTerminated() ) {
@@ -131,24 +197,87 @@ int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated)
 			break;
 		}
 
-		// Capture a frame, enqueue buffer
-		if (ioctl(fd, VIDIOC_QBUF, &buf) == -1) {
-			_ERROR("Failed to capture frame (enqueue buffer)");
+		// Wait for filled buffer, terminate request or timeout
+		const FrameResult wait = pSource->wait(cancelFd, pollTimeoutMs);
+		if( wait == FRAME_ERROR ) {
 			break;
 		}
-		// Capture a frame, dequeue buffer
-		if (ioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
-			_ERROR("Failed to capture frame (dequeue buffer)");
+		if( wait == FRAME_CANCEL ) {
+			continue;
+		}
+		if( wait == FRAME_TIMEOUT ) {
+			const int64_t idleMs = (FrameClock::monotonicUs() - lastFrameUs) / 1000;
+			if( rp.starvationMs > 0 && !fStarved && idleMs >= rp.starvationMs ) {
+				fStarved = true;
+				reportEvent(rp, EVENT_STARVATION_BEGIN, idleMs, "No frames from device "
+					+ fso.path + " for " + std::to_string(idleMs) + " ms, session "
+					+ std::to_string(rp.sessionId));
+			}
+			continue;
+		}
+
+		// Capture a frame, dequeue filled buffer
+		const FrameResult res = pSource->dequeue(frame);
+		if( res == FRAME_AGAIN ) {
+			continue;
+		}
+		if( res == FRAME_EOF ) {
+			_INFO("No more frames from " << pSource->getName() << " source, session " << rp.sessionId);
+			break;
+		}
+		if( res != FRAME_OK ) {
 			break;
 		}
+		if( fStarved ) {
+			const int64_t idleMs = (FrameClock::monotonicUs() - lastFrameUs) / 1000;
+			fStarved = false;
+			reportEvent(rp, EVENT_STARVATION_END, idleMs, "Frames from device "
+				+ fso.path + " resumed after " + std::to_string(idleMs) + " ms, session "
+				+ std::to_string(rp.sessionId));
+		}
+		lastFrameUs = FrameClock::monotonicUs();
 
-		memcpy(currentFrame, buffer, buf.length);
-		// Save the first frame
-		if( nFrame==0 ) {
-			memcpy(previousFrame, buffer, buf.length);
+		const unsigned char* curData = frame.data;
+		const unsigned char* prevData = frame.data;
+		if( rp.zeroCopy ) {
+			if( prevFrame.index>=0 ) {
+				prevData = prevFrame.data;
+			}
+		} else {
+			const size_t len = std::min(frame.len, frameLen);
+			memcpy(currentFrame, frame.data, len);
+			// Save the first frame
+			if( nFrame==0 ) {
+				memcpy(previousFrame, frame.data, len);
+			}
+			curData = currentFrame;
+			prevData = previousFrame;
+
+			// Return buffer to the device right after copy
+			if( !pSource->release(frame.index) ) {
+				_ERROR("Failed to capture frame (enqueue buffer)");
+				break;
+			}
 		}
 		nFrame++;
 
+		const int64_t offsetChangeUs = frameClock.sync();
+		if( offsetChangeUs > SC_FRAME_CLOCK_STEP_US || offsetChangeUs < -SC_FRAME_CLOCK_STEP_US ) {
+			_INFO("Wall clock offset changed by " << offsetChangeUs << " us");
+		}
+		const FrameTiming timing = getFrameTiming(frameClock, nFrame, frame.sequence, frame.flags,
+				frame.tvSec, frame.tvUsec);
+		if( !timing.kernelTs && !fKernelTsWarned ) {
+			_INFO("Device provides no monotonic buffer timestamps, dequeue time is used");
+			fKernelTsWarned = true;
+		}
+
+		const uint32_t nDropped = dropCounter.update(frame.sequence);
+		if( nDropped>0 ) {
+			_VERBOSE("Dropped " << nDropped << " frame(s) before sequence " << frame.sequence
+				<< ", total dropped=" << dropCounter.dropped);
+		}
+
 		fSave = false;
 
 		// always save first frame
@@ -158,10 +287,23 @@ int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated)
 		}
 
 		// save frame when difference is above threshold
-		int difference = calcFrameDiff(currentFrame, previousFrame, buf.length);
-		if (difference > rp.threshold  ) {
+		const bool fChanged = pDetector->detect(curData, prevData, frameLen, change);
+		if (fChanged) {
 			fSave = true;
-			_VERBOSE("Save frame: difference=" << difference);
+			_VERBOSE("Save frame: difference=" << change.difference
+				<< (change.complete ? "" : " (early exit)")
+				<< ", changed tiles=" << change.nChangedTiles);
+		}
+		if( frame.changed ) {
+			stats.nScriptedChanges++;
+		}
+		if( fChanged ) {
+			stats.nDetectedChanges += frame.changed ? 1 : 0;
+			// latency from frame capture to change detected
+			const int64_t latencyUs = FrameClock::monotonicUs() - timing.monoUs;
+			stats.latencySumUs += latencyUs;
+			stats.latencyMaxUs = std::max(stats.latencyMaxUs, latencyUs);
+			stats.nLatency++;
 		}
 
 		// check obligatory save interval
@@ -173,59 +315,101 @@ int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated)
 		if (fSave) {
 			nextSaveTime = currentTimeMs() + rp.intervalMs;
 
-			std::string baseName = getTimeStr();
+			// name snapshot after capture time rather than save time
+			const Timestamp ts = frameClock.toTimestamp(timing.monoUs);
+			std::string baseName = getTimeStr(ts);
 			std::filesystem::path basePath = sessionPath / baseName;
 
-			if (rp.dumpRawFrame) {
-				std::string rawPath = basePath.string() + ".bin";
-				_INFO("Save frame [" << nFrame << "] to: " << rawPath);
-				std::ofstream outputFile(rawPath, std::ios::binary);
-				if (!outputFile.is_open()) {
-					_ERROR("Error opening file for writing: " << rawPath);
-					break;
-				}
-
-				outputFile.write(reinterpret_cast<char *>(currentFrame), buf.length);
-				if (!outputFile.good()) {
-					_ERROR("Error writing to file: " << rawPath);
-					outputFile.close();
-					break;
-				}
-				outputFile.close();
+			// copy frame to pooled buffer and hand it over to the
+			// writer, conversion/encoding/IO is done on worker threads
+			Snapshot snapshot;
+			snapshot.nFrame = nFrame;
+			snapshot.cx = rp.cx;
+			snapshot.cy = rp.cy;
+			snapshot.dumpRaw = rp.dumpRawFrame;
+			snapshot.tsMs = timing.wallUs / 1000;
+			snapshot.timing = timing;
+			snapshot.difference = change.difference;
+			snapshot.nChangedTiles = change.nChangedTiles;
+			snapshot.tilesX = change.tilesX;
+			snapshot.tilesY = change.tilesY;
+			snapshot.tiles = change.tiles;
+			snapshot.baseName = baseName;
+			snapshot.basePath = basePath.string();
+			snapshot.data = writer.acquireBuffer(frameLen);
+			if( pDelta ) {
+				pDelta->update(curData, nFrame, snapshot.tsMs, snapshot.delta, snapshot.data);
+				// raw dump is stored only for keyframes
+				snapshot.dumpRaw = rp.dumpRawFrame && !snapshot.delta.isDelta;
+			} else {
+				memcpy(snapshot.data.data(), curData, frameLen);
 			}
-
-			std::string pngPath = basePath.string() + ".png";
-			//cv::Mat frame(cy, cx, CV_8UC3, currentFrame);
-			cv::Mat yuyvImage(rp.cy, rp.cx, CV_8UC2, currentFrame);
-			cv::Mat frame;
-			cv::cvtColor(yuyvImage, frame, cv::COLOR_YUV2BGR_YUYV);
-			_INFO("Save frame [" << nFrame << "] to: " << pngPath);
-			cv::imwrite(pngPath, frame);
-		}
-		// Swap buffers for the next iteration
-		unsigned char* temp = previousFrame;
-		previousFrame = currentFrame;
-		currentFrame = temp;
+			if( writer.push(std::move(snapshot)) ) {
+				stats.nSaved++;
+			} else {
+				_VERBOSE("Snapshot queue is full, frame [" << nFrame << "] dropped");
+			}
+		}
+		if( rp.zeroCopy ) {
+			// Return previous buffer to the device and hold current
+			// one as reference for the next iteration
+			if( prevFrame.index>=0 && !pSource->release(prevFrame.index) ) {
+				_ERROR("Failed to capture frame (enqueue buffer)");
+				break;
+			}
+			prevFrame = frame;
+		} else {
+			// Swap buffers for the next iteration
+			unsigned char* temp = previousFrame;
+			previousFrame = currentFrame;
+			currentFrame = temp;
+		}
 	}
 
 	delete[] previousFrame;
 	delete[] currentFrame;
-
+	stats.nFrames = nFrame;
+	stats.nDropped = dropCounter.dropped;
+	stats.wallUs = FrameClock::monotonicUs() - startUs;
+	stats.cpuUs = threadCpuUs() - startCpuUs;
+
+	// Wait till all queued snapshots are saved, drain is bounded on
+	// termination as it can take up to queue size PNG encodes
+	const bool fTerminated = isTerminated();
+	writer.stop(fTerminated ? SC_CANCEL_DRAIN_MS : -1);
+	_INFO("Session " << rp.sessionId << " snapshots: "
+		<< snapshotWriterStatsToString(writer.getStats()));
+	if( pDelta ) {
+		_INFO("Session " << rp.sessionId << " keyframes=" << pDelta->getKeyframeCount()
+			<< ", deltas=" << pDelta->getDeltaCount());
+	}
+	if( fArchive ) {
+		archive.close();
+	}
+	timingIndex.close();
+
+	_INFO("Session " << rp.sessionId << " frames: captured=" << nFrame
+		<< ", dropped=" << dropCounter.dropped
+		<< ", buffers=" << pSource->getBufferCount()
+		<< ", zeroCopy=" << rp.zeroCopy);
+	_INFO("Session " << rp.sessionId << " stats: " << recordingStatsToString(stats));
+	if( pStats ) {
+		*pStats = stats;
+	}
 
 	// Cleanup
-	ioctl(fd, VIDIOC_STREAMOFF, &buf.type);
-	munmap(buffer, buf.length);
-	close(fd);
+	pSource->stop();
 
 	std::string end_ts = getTimeStr();
+	const std::string sessionName2 = rp.start_ts+"_"+end_ts;
 	std::filesystem::path sessionPath2 = sessionPath;
-	sessionPath2.replace_filename(rp.start_ts+"_"+end_ts);
-	_INFO("Rename session " << rp.sessionId << " directory: "
+	sessionPath2.replace_filename(sessionName2+sessionExt);
+	_INFO("Rename session " << rp.sessionId << (fArchive ? " archive: " : " directory: ")
 		<< sessionPath.string() << " -> " << sessionPath2.string());
 	std::filesystem::rename(sessionPath, sessionPath2);
 
 	_VERBOSE("recordScreens leave, sessionId=" << rp.sessionId);
-	_SESSION_LOG_END_CLOSE_RENAME(sessionPath2.string() + ".log");
+	_SESSION_LOG_END_CLOSE_RENAME((sessionPath2.parent_path() / sessionName2).string() + ".log");
 	return 0;
 }
 
@@ -238,7 +422,8 @@ template<>
 void RecordingThread::run() {
 	try {
 		recordScreens(m_params,
-					  [this]() { return isTerminated(); }
+					  [this]() { return isTerminated(); },
+					  getTerminateFd()
 		);
 	} catch(std::exception e) {
 		_ERROR("Unhandled exception: " << e.what());
@@ -3,10 +3,30 @@
 
 #include <iostream>
 #include <atomic>
+#include <cstdint>
+#include <functional>
 #include "reprostim/CaptureThreading.h"
+#include "FrameSource.h"
+#include "SnapshotWriter.h"
 
 using namespace reprostim;
 
+// Recording event types
+enum RecordingEventType: int {
+	EVENT_STARVATION_BEGIN = 0, // no frames from device for starvation timeout
+	EVENT_STARVATION_END   = 1  // frames are coming again after starvation
+};
+
+// Recording event reported from capture thread
+struct RecordingEvent {
+	RecordingEventType type;
+	int                sessionId;
+	int64_t            durationMs; // time without frames
+	std::string        message;
+};
+
+using RecordingEventHandler = std::function<void(const RecordingEvent&)>;
+
 // Screen capture params shared between threads
 // make sure it's thread-safe in usage
 struct RecordingParams {
@@ -14,14 +34,118 @@ struct RecordingParams {
 	const int cx;
 	const int cy;
 	const int threshold;
+	const std::string detector;
+	const int tileSize;
+	const int tileThreshold;
 	const std::string outPath;
 	const std::string videoDevPath;
 	const bool dumpRawFrame;
 	const int intervalMs;
+	const int nBuffers;
+	const bool zeroCopy;
+	const int writerThreads;
+	const int queueSize;
+	const SnapshotOverflow overflow;
+	const std::string storage;
+	const int archiveIndexInterval;
+	const SnapshotCodecOpts codec;
+	const bool delta;
+	const int keyframeInterval;
+	const int keyframeIntervalMs;
+	const int starvationMs;
+	const FrameSourceOpts source; // frame source, size/buffers/device taken from params above
 	const std::string& start_ts;
 	const SessionLogger_ptr pLogger;
+	const RecordingEventHandler onEvent;
+};
+
+// session storage types
+#ifndef SC_STORAGE_FILES
+#define SC_STORAGE_FILES "files"
+#endif
+
+#ifndef SC_STORAGE_ARCHIVE
+#define SC_STORAGE_ARCHIVE "archive"
+#endif
+
+// default time in ms without frames reported as starvation
+#ifndef SC_DEFAULT_STARVATION_MS
+#define SC_DEFAULT_STARVATION_MS 2000
+#endif
+
+// max poll timeout in ms, used to check termination flag and
+// starvation when terminate eventfd is not available
+#ifndef SC_POLL_TIMEOUT_MS
+#define SC_POLL_TIMEOUT_MS 100
+#endif
+
+// max time in ms to save queued snapshots after session is terminated,
+// the rest is dropped, so owner's WorkerThread::stop() (1 s) isn't exceeded
+#ifndef SC_CANCEL_DRAIN_MS
+#define SC_CANCEL_DRAIN_MS 500
+#endif
+
+// minimal number of V4L2 buffers in zero-copy mode
+#ifndef SC_MIN_ZERO_COPY_BUFFERS
+#define SC_MIN_ZERO_COPY_BUFFERS 3
+#endif
+
+// Tracks frames lost by driver/device using gaps
+// in V4L2 buffer sequence numbers
+struct FrameDropCounter {
+	bool     hasLast = false;
+	uint32_t lastSequence = 0;
+	uint64_t dropped = 0;
+
+	// returns number of frames dropped right before specified sequence
+	inline uint32_t update(uint32_t sequence) {
+		uint32_t gap = 0;
+		// NOTE: unsigned arithmetic handles sequence wrap-around,
+		// sequence reset is not counted as drop
+		if( hasLast && static_cast<int32_t>(sequence - lastSequence) > 1 ) {
+			gap = sequence - lastSequence - 1;
+			dropped += gap;
+		}
+		lastSequence = sequence;
+		hasLast = true;
+		return gap;
+	}
+};
+
+// Capture session throughput and detection latency statistics
+struct RecordingStats {
+	uint64_t nFrames = 0;
+	uint64_t nDropped = 0;
+	uint64_t nSaved = 0;           // snapshots queued to writer
+	uint64_t nLatency = 0;         // changes detected
+	uint64_t nScriptedChanges = 0; // changes produced by synthetic source
+	uint64_t nDetectedChanges = 0; // scripted changes caught by detector
+	int64_t  wallUs = 0;
+	int64_t  cpuUs = 0;            // capture thread CPU time
+	int64_t  latencySumUs = 0;     // frame capture to change detected
+	int64_t  latencyMaxUs = 0;
+
+	inline double getFps() const {
+		return wallUs > 0 ? nFrames * 1000000.0 / wallUs : 0;
+	}
+
+	inline double getCpuPerFrameUs() const {
+		return nFrames > 0 ? static_cast<double>(cpuUs) / nFrames : 0;
+	}
+
+	inline double getLatencyAvgUs() const {
+		return nLatency > 0 ? static_cast<double>(latencySumUs) / nLatency : 0;
+	}
 };
 
 using RecordingThread = WorkerThread<RecordingParams>;
 
+// capture session loop, returns when terminated, on device error or
+// at the end of replay/synthetic frames, cancelFd is optional eventfd
+// to wake up poll on termination, pStats receives session statistics
+int recordScreens(const RecordingParams& rp, std::function<bool()> isTerminated, int cancelFd = -1,
+				  RecordingStats* pStats = nullptr);
+
+std::string recordingStatsToString(const RecordingStats& stats);
+
 #endif //CAPTURE_RECORDINGTHREAD_H
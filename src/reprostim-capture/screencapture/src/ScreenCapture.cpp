@@ -4,6 +4,7 @@
 #include <thread>
 #include <sysexits.h>
 #include <getopt.h>
+#include <filesystem>
 #include "ScreenCapture.h"
 
 
@@ -40,12 +41,37 @@ void ScreenCaptureApp::onCaptureStart() {
 			sessionId,
 			vssCur.cx, vssCur.cy,
 			m_scOpts.threshold,
+			m_scOpts.detector,
+			m_scOpts.tile_size,
+			m_scOpts.tile_threshold,
 			outPath,
 			targetVideoDevPath,
 			m_scOpts.dump_raw,
 			m_scOpts.interval_ms,
+			m_scOpts.n_buffers,
+			m_scOpts.zero_copy,
+			m_scOpts.writer_threads,
+			m_scOpts.queue_size,
+			m_scOpts.overflow_policy,
+			m_scOpts.storage,
+			m_scOpts.archive_index_interval,
+			SnapshotCodecOpts{m_scOpts.codec, m_scOpts.png_level},
+			m_scOpts.delta,
+			m_scOpts.keyframe_interval,
+			m_scOpts.keyframe_interval_ms,
+			m_scOpts.starvation_ms,
+			FrameSourceOpts{
+				m_scOpts.source,
+				m_scOpts.source_path,
+				0, 0, 0, // size and buffers from params above
+				m_scOpts.source_fps,
+				m_scOpts.source_loop,
+				m_scOpts.source_change_interval,
+				static_cast<uint64_t>(m_scOpts.source_frames)
+			},
 			start_ts,
-			pLogger
+			pLogger,
+			[this](const RecordingEvent& event) { onRecordingEvent(event); }
 	});
 
 	m_recExec.schedule(pt);
@@ -61,17 +87,221 @@ void ScreenCaptureApp::onCaptureStop(const std::string& message) {
 	}
 }
 
+void ScreenCaptureApp::onRecordingEvent(const RecordingEvent& event) {
+	// called from recording thread
+	_NOTIFY_REPROMON(
+		event.type == EVENT_STARVATION_BEGIN ? REPROMON_WARNING : REPROMON_INFO,
+		appName + " " + event.message,
+		{
+			{"start_ts", start_ts},
+			{"session_id", event.sessionId},
+			{"duration_ms", event.durationMs}
+		}
+	);
+}
+
 bool ScreenCaptureApp::onLoadConfig(AppConfig &cfg, const std::string &pathConfig, YAML::Node doc) {
+	bool fOverflowPolicy = false;
 	if( doc["sc_opts"] ) {
 		YAML::Node node = doc["sc_opts"];
 		m_scOpts.dump_raw = getYamlProp<bool>(node, "dump_raw");
 		m_scOpts.interval_ms = getYamlProp<int>(node,"interval_ms");
+		m_scOpts.n_buffers = node["n_buffers"] ? getYamlProp<int>(node, "n_buffers") : SC_DEFAULT_N_BUFFERS;
 		m_scOpts.threshold = getYamlProp<int>(node, "threshold");
+		m_scOpts.zero_copy = node["zero_copy"] ? getYamlProp<bool>(node, "zero_copy") : false;
+		m_scOpts.detector = node["detector"] ? getYamlProp<std::string>(node, "detector") : "sad";
+		m_scOpts.tile_size = node["tile_size"] ? getYamlProp<int>(node, "tile_size") : SC_DEFAULT_TILE_SIZE;
+		m_scOpts.tile_threshold = node["tile_threshold"] ?
+				getYamlProp<int>(node, "tile_threshold") : SC_DEFAULT_TILE_THRESHOLD;
+		m_scOpts.writer_threads = node["writer_threads"] ?
+				getYamlProp<int>(node, "writer_threads") : SC_DEFAULT_WRITER_THREADS;
+		m_scOpts.queue_size = node["queue_size"] ? getYamlProp<int>(node, "queue_size") : SC_DEFAULT_QUEUE_SIZE;
+		if( node["overflow_policy"] ) {
+			try {
+				m_scOpts.overflow_policy = parseSnapshotOverflow(getYamlProp<std::string>(node, "overflow_policy"));
+			} catch(const std::exception& e) {
+				_ERROR("Invalid sc_opts.overflow_policy value: " << e.what());
+				return false;
+			}
+		} else {
+			m_scOpts.overflow_policy = OVERFLOW_DROP_OLDEST;
+		}
+		fOverflowPolicy = static_cast<bool>(node["overflow_policy"]);
+		m_scOpts.storage = node["storage"] ? getYamlProp<std::string>(node, "storage") : SC_STORAGE_FILES;
+		m_scOpts.archive_index_interval = node["archive_index_interval"] ?
+				getYamlProp<int>(node, "archive_index_interval") : SC_DEFAULT_ARCHIVE_INDEX_INTERVAL;
+		if( node["codec"] ) {
+			try {
+				m_scOpts.codec = parseSnapshotCodec(getYamlProp<std::string>(node, "codec"));
+			} catch(const std::exception& e) {
+				_ERROR("Invalid sc_opts.codec value: " << e.what());
+				return false;
+			}
+		} else {
+			m_scOpts.codec = CODEC_PNG;
+		}
+		m_scOpts.png_level = node["png_level"] ? getYamlProp<int>(node, "png_level") : SC_DEFAULT_PNG_LEVEL;
+		m_scOpts.delta = node["delta"] ? getYamlProp<bool>(node, "delta") : false;
+		m_scOpts.keyframe_interval = node["keyframe_interval"] ?
+				getYamlProp<int>(node, "keyframe_interval") : SC_DEFAULT_KEYFRAME_INTERVAL;
+		m_scOpts.keyframe_interval_ms = node["keyframe_interval_ms"] ?
+				getYamlProp<int>(node, "keyframe_interval_ms") : SC_DEFAULT_KEYFRAME_INTERVAL_MS;
+		m_scOpts.starvation_ms = node["starvation_ms"] ?
+				getYamlProp<int>(node, "starvation_ms") : SC_DEFAULT_STARVATION_MS;
+		m_scOpts.source = node["source"] ? getYamlProp<std::string>(node, "source") : SC_SOURCE_V4L2;
+		m_scOpts.source_path = node["source_path"] ? getYamlProp<std::string>(node, "source_path") : "";
+		m_scOpts.source_cx = node["source_cx"] ? getYamlProp<int>(node, "source_cx") : SC_DEFAULT_SOURCE_CX;
+		m_scOpts.source_cy = node["source_cy"] ? getYamlProp<int>(node, "source_cy") : SC_DEFAULT_SOURCE_CY;
+		m_scOpts.source_fps = node["source_fps"] ? getYamlProp<int>(node, "source_fps") : SC_DEFAULT_SOURCE_FPS;
+		m_scOpts.source_loop = node["source_loop"] ? getYamlProp<bool>(node, "source_loop") : false;
+		m_scOpts.source_change_interval = node["source_change_interval"] ?
+				getYamlProp<int>(node, "source_change_interval") : SC_DEFAULT_SOURCE_CHANGE_INTERVAL;
+		m_scOpts.source_frames = node["source_frames"] ? getYamlProp<int>(node, "source_frames") : 0;
 	} else {
 		m_scOpts.dump_raw = false;
 		m_scOpts.interval_ms = 0;
+		m_scOpts.n_buffers = SC_DEFAULT_N_BUFFERS;
 		m_scOpts.threshold = 0;
+		m_scOpts.zero_copy = false;
+		m_scOpts.detector = "sad";
+		m_scOpts.tile_size = SC_DEFAULT_TILE_SIZE;
+		m_scOpts.tile_threshold = SC_DEFAULT_TILE_THRESHOLD;
+		m_scOpts.writer_threads = SC_DEFAULT_WRITER_THREADS;
+		m_scOpts.queue_size = SC_DEFAULT_QUEUE_SIZE;
+		m_scOpts.overflow_policy = OVERFLOW_DROP_OLDEST;
+		m_scOpts.storage = SC_STORAGE_FILES;
+		m_scOpts.archive_index_interval = SC_DEFAULT_ARCHIVE_INDEX_INTERVAL;
+		m_scOpts.codec = CODEC_PNG;
+		m_scOpts.png_level = SC_DEFAULT_PNG_LEVEL;
+		m_scOpts.delta = false;
+		m_scOpts.keyframe_interval = SC_DEFAULT_KEYFRAME_INTERVAL;
+		m_scOpts.keyframe_interval_ms = SC_DEFAULT_KEYFRAME_INTERVAL_MS;
+		m_scOpts.starvation_ms = SC_DEFAULT_STARVATION_MS;
+		m_scOpts.source = SC_SOURCE_V4L2;
+		m_scOpts.source_path = "";
+		m_scOpts.source_cx = SC_DEFAULT_SOURCE_CX;
+		m_scOpts.source_cy = SC_DEFAULT_SOURCE_CY;
+		m_scOpts.source_fps = SC_DEFAULT_SOURCE_FPS;
+		m_scOpts.source_loop = false;
+		m_scOpts.source_change_interval = SC_DEFAULT_SOURCE_CHANGE_INTERVAL;
+		m_scOpts.source_frames = 0;
+	}
+	// --source option overrides config
+	if( !m_sourceSpec.empty() ) {
+		std::string sourcePath;
+		parseFrameSourceSpec(m_sourceSpec, m_scOpts.source, sourcePath);
+		if( !sourcePath.empty() ) {
+			m_scOpts.source_path = sourcePath;
+		}
+	}
+	if( m_scOpts.detector != "sad" && m_scOpts.detector != "luma_grid" ) {
+		_ERROR("Invalid sc_opts.detector value: " << m_scOpts.detector << ", must be 'sad' or 'luma_grid'");
+		return false;
+	}
+	if( m_scOpts.tile_size < 1 ) {
+		_ERROR("Invalid sc_opts.tile_size value: " << m_scOpts.tile_size << ", must be >= 1");
+		return false;
+	}
+	if( m_scOpts.n_buffers < 1 ) {
+		_ERROR("Invalid sc_opts.n_buffers value: " << m_scOpts.n_buffers << ", must be >= 1");
+		return false;
+	}
+	if( m_scOpts.writer_threads < 0 ) {
+		_ERROR("Invalid sc_opts.writer_threads value: " << m_scOpts.writer_threads << ", must be >= 0");
+		return false;
+	}
+	if( m_scOpts.storage != SC_STORAGE_FILES && m_scOpts.storage != SC_STORAGE_ARCHIVE ) {
+		_ERROR("Invalid sc_opts.storage value: " << m_scOpts.storage << ", must be 'files' or 'archive'");
+		return false;
+	}
+	if( m_scOpts.archive_index_interval < 0 ) {
+		_ERROR("Invalid sc_opts.archive_index_interval value: " << m_scOpts.archive_index_interval
+			<< ", must be >= 0");
+		return false;
+	}
+	if( m_scOpts.delta && m_scOpts.storage != SC_STORAGE_ARCHIVE ) {
+		_ERROR("Invalid sc_opts.delta value, delta snapshots require sc_opts.storage 'archive'");
+		return false;
+	}
+	if( m_scOpts.delta ) {
+		// dropped keyframe breaks all deltas referencing it
+		if( !fOverflowPolicy ) {
+			m_scOpts.overflow_policy = OVERFLOW_BLOCK;
+		} else if( m_scOpts.overflow_policy != OVERFLOW_BLOCK ) {
+			_ERROR("Invalid sc_opts.overflow_policy value, delta snapshots require 'block'");
+			return false;
+		}
+	}
+	if( m_scOpts.delta && (m_scOpts.tile_size % 2) != 0 ) {
+		_ERROR("Invalid sc_opts.tile_size value: " << m_scOpts.tile_size << ", must be even for delta snapshots");
+		return false;
+	}
+	if( m_scOpts.keyframe_interval < 0 || m_scOpts.keyframe_interval_ms < 0 ) {
+		_ERROR("Invalid sc_opts.keyframe_interval or sc_opts.keyframe_interval_ms value, must be >= 0");
+		return false;
+	}
+	if( m_scOpts.starvation_ms < 0 ) {
+		_ERROR("Invalid sc_opts.starvation_ms value: " << m_scOpts.starvation_ms << ", must be >= 0");
+		return false;
+	}
+	if( m_scOpts.png_level < 0 || m_scOpts.png_level > 9 ) {
+		_ERROR("Invalid sc_opts.png_level value: " << m_scOpts.png_level << ", must be in 0..9 range");
+		return false;
+	}
+	if( m_scOpts.queue_size < 1 ) {
+		_ERROR("Invalid sc_opts.queue_size value: " << m_scOpts.queue_size << ", must be >= 1");
+		return false;
 	}
+	if( m_scOpts.source != SC_SOURCE_V4L2 && m_scOpts.source != SC_SOURCE_REPLAY
+		&& m_scOpts.source != SC_SOURCE_SYNTHETIC ) {
+		_ERROR("Invalid sc_opts.source value: " << m_scOpts.source
+			<< ", must be 'v4l2', 'replay' or 'synthetic'");
+		return false;
+	}
+	if( m_scOpts.source == SC_SOURCE_REPLAY && m_scOpts.source_path.empty() ) {
+		_ERROR("Invalid sc_opts.source_path value, replay source requires file or directory path");
+		return false;
+	}
+	if( m_scOpts.source_cx < 2 || (m_scOpts.source_cx % 2) != 0 || m_scOpts.source_cy < 1 ) {
+		_ERROR("Invalid sc_opts.source_cx or sc_opts.source_cy value: " << m_scOpts.source_cx
+			<< "x" << m_scOpts.source_cy << ", width must be even");
+		return false;
+	}
+	if( m_scOpts.source_fps < 0 || m_scOpts.source_change_interval < 1 || m_scOpts.source_frames < 0 ) {
+		_ERROR("Invalid sc_opts.source_fps, sc_opts.source_change_interval or sc_opts.source_frames value");
+		return false;
+	}
+	return true;
+}
+
+bool ScreenCaptureApp::onRunWithoutDevice(int& res) {
+	if( m_scOpts.source == SC_SOURCE_V4L2 ) {
+		return false;
+	}
+
+	// software frame source, no Magewell device and signal status,
+	// single session runs till terminated or end of frames
+	_INFO("    <> Frame source                ===> " << m_scOpts.source
+		<< (m_scOpts.source_path.empty() ? "" : ":" + m_scOpts.source_path)
+		<< ", " << m_scOpts.source_cx << "x" << m_scOpts.source_cy
+		<< ", fps=" << m_scOpts.source_fps);
+	_NOTIFY_REPROMON(REPROMON_INFO, appName + " started, v" + CAPTURE_VERSION_STRING
+		+ ", source " + m_scOpts.source);
+	vssCur = {};
+	vssCur.cx = m_scOpts.source_cx;
+	vssCur.cy = m_scOpts.source_cy;
+	targetVideoDevPath = m_scOpts.source_path;
+	onCaptureStart();
+	while( !isSysBreakExec() ) {
+		RecordingThread* pt = m_recExec.getCurrentThread();
+		if( pt == nullptr || !pt->isRunning() ) {
+			break;
+		}
+		SLEEP_MS(100);
+	}
+	onCaptureStop(isSysBreakExec() ? "Program terminated" : "End of frame source");
+	_NOTIFY_REPROMON(REPROMON_INFO, appName + " terminated");
+	res = isSysBreakExec() ? EX_SYS_BREAK_EXEC : EX_OK;
 	return true;
 }
 
@@ -93,6 +323,21 @@ int ScreenCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 								 "\t         \t  audio : list only audio devices information\n"
 								 "\t         \t  video : list only video devices information\n"
 								 "\t         \tDefault value is \"all\"\n"
+								 "\t-x, --extract <path>\n"
+								 "\t         \tExtract snapshots from session archive file (.scarch)\n"
+								 "\t         \tto directory specified with -o, or to directory\n"
+								 "\t         \tnamed after archive file by default\n"
+								 "\t--at <time>\n"
+								 "\t         \tUsed with -x, rebuild only frame captured at or before\n"
+								 "\t         \tthe time, specified as ms since epoch or as snapshot\n"
+								 "\t         \tname, e.g. \"2024.05.01-13.45.10.123\"\n"
+								 "\t--source <source>\n"
+								 "\t         \tFrame source, overrides sc_opts.source config value.\n"
+								 "\t         \tSupported <source> values:\n"
+								 "\t         \t  v4l2          : Magewell video device (default)\n"
+								 "\t         \t  synthetic     : generated frames with scripted changes\n"
+								 "\t         \t  replay:<path> : raw YUYV frames from .bin/.yuyv file\n"
+								 "\t         \t                  or directory\n"
 								 "\t-V\n"
 								 "\t         \tPrint version number only\n"
 								 "\t--version\n"
@@ -101,6 +346,8 @@ int ScreenCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 								 "\t         \tPrint this help string\n";
 
 	int c = 0;
+	std::string extractPath;
+	std::string extractAt;
 	if (argc == 1) {
 		_ERROR("ERROR[006]: Please provide valid options");
 		_INFO(HELP_STR);
@@ -113,10 +360,13 @@ int ScreenCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 			{"version", no_argument, nullptr, 1000},
 			{"list-devices", optional_argument, nullptr, 'l'},
 			{"file-log", required_argument, nullptr, 'f'},
+			{"extract", required_argument, nullptr, 'x'},
+			{"at", required_argument, nullptr, 1001},
+			{"source", required_argument, nullptr, 1002},
 			{nullptr, 0, nullptr, 0}
 	};
 
-	while ((c = getopt_long(argc, argv, "o:c:d:f:hvVl", longOpts, nullptr)) != -1) {
+	while ((c = getopt_long(argc, argv, "o:c:d:f:x:hvVl", longOpts, nullptr)) != -1) {
 		switch (c) {
 			case 'o':
 				if (optarg) opts.outPathTempl = optarg;
@@ -154,7 +404,39 @@ int ScreenCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 				registerFileLogger(_FILE_LOGGER_NAME, optarg);
 				setLogPattern(LogPattern::FULL);
 				break;
+			case 'x':
+				if (optarg) extractPath = optarg;
+				break;
+			case 1001:
+				if (optarg) extractAt = optarg;
+				break;
+			case 1002: {
+					std::string type, path;
+					if (!optarg || !parseFrameSourceSpec(optarg, type, path)) {
+						_ERROR("ERROR[011]: Invalid frame source: " << (optarg ? optarg : ""));
+						_INFO(HELP_STR);
+						return EX_USAGE;
+					}
+					m_sourceSpec = optarg;
+				}
+				break;
+		}
+	}
+
+	// Extract session archive and exit
+	if( !extractPath.empty() ) {
+		std::string outDir = opts.outPathTempl;
+		if( outDir.empty() ) {
+			std::filesystem::path p(extractPath);
+			outDir = (p.parent_path() / p.stem()).string();
+		}
+		const int n = extractSnapshotArchive(extractPath, outDir, extractAt);
+		if( n<0 ) {
+			_ERROR("ERROR[010]: Failed extract snapshots from archive: " << extractPath);
+			return EX_DATAERR;
 		}
+		_INFO("Extracted " << n << " snapshot(s) to: " << outDir);
+		return 1;
 	}
 
 
@@ -2,29 +2,73 @@
 #define CAPTURE_SCREENCAPTURE_H
 
 #include "reprostim/CaptureApp.h"
+#include "ChangeDetector.h"
 #include "RecordingThread.h"
+#include "SnapshotArchive.h"
 
 ///////////////////////////////////////////////////////////////////////////
 //
 using namespace reprostim;
 
+// default number of V4L2 buffers in capture streaming ring
+#ifndef SC_DEFAULT_N_BUFFERS
+#define SC_DEFAULT_N_BUFFERS 4
+#endif
+
+// default frame size of replay and synthetic sources
+#ifndef SC_DEFAULT_SOURCE_CX
+#define SC_DEFAULT_SOURCE_CX 1920
+#endif
+
+#ifndef SC_DEFAULT_SOURCE_CY
+#define SC_DEFAULT_SOURCE_CY 1080
+#endif
+
 // Specific options for ScreenCaptureApp
 struct ScreenCaptureOpts {
 	bool dump_raw;
 	int  interval_ms;
+	int  n_buffers;
 	int  threshold;
+	bool zero_copy;
+	std::string detector;
+	int  tile_size;
+	int  tile_threshold;
+	int  writer_threads;
+	int  queue_size;
+	SnapshotOverflow overflow_policy;
+	std::string storage;
+	int  archive_index_interval;
+	SnapshotCodec codec;
+	int  png_level;
+	bool delta;
+	int  keyframe_interval;
+	int  keyframe_interval_ms;
+	int  starvation_ms;
+	std::string source;
+	std::string source_path;
+	int  source_cx;
+	int  source_cy;
+	int  source_fps;
+	bool source_loop;
+	int  source_change_interval;
+	int  source_frames;
 };
 
 class ScreenCaptureApp: public CaptureApp {
 private:
 	SingleThreadExecutor<RecordingThread> m_recExec;
 	ScreenCaptureOpts                     m_scOpts;
+	std::string                           m_sourceSpec; // --source override
+
+	void onRecordingEvent(const RecordingEvent& event);
 public:
 	ScreenCaptureApp();
 	~ScreenCaptureApp();
 	void onCaptureStart() override;
 	void onCaptureStop(const std::string& message) override;
 	bool onLoadConfig(AppConfig &cfg, const std::string &pathConfig, YAML::Node doc) override;
+	bool onRunWithoutDevice(int& res) override;
 	int  parseOpts(AppOpts& opts, int argc, char* argv[]) override;
 };
 
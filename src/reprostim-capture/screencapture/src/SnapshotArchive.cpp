@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include "reprostim/CaptureLog.h"
+#include "ByteStream.h"
+#include "DeltaSnapshot.h"
+#include "FrameTiming.h"
+#include "SnapshotArchive.h"
+
+////////////////////////////////////////////////////////////////////////
+// Archive layout constants
+
+static const char     ARCHIVE_MAGIC[8] = {'R','S','S','C','A','R','C','\0'};
+static const char     ARCHIVE_END_MAGIC[8] = {'R','S','S','C','A','E','N','D'};
+static const uint32_t ARCHIVE_VERSION = 1;
+static const size_t   ARCHIVE_HEADER_SIZE = 24;
+static const size_t   ARCHIVE_TRAILER_SIZE = 32;
+static const size_t   ARCHIVE_INDEX_HEAD_SIZE = 24;
+static const char     TAG_FRAME[4] = {'F','R','M','E'};
+static const char     TAG_INDEX[4] = {'I','N','D','X'};
+static const char     TAG_TAIL[4] = {'T','A','I','L'};
+
+static void putEntry(ByteWriter& w, const ArchiveEntry& e) {
+	w.put<uint64_t>(e.offset);
+	w.put<uint32_t>(e.nFrame);
+	w.put<uint32_t>(e.format);
+	w.put<int64_t>(e.tsMs);
+	w.put<int64_t>(e.difference);
+	w.put<uint32_t>(e.nChangedTiles);
+	w.put<uint32_t>(e.sequence);
+	w.put<int64_t>(e.monoUs);
+	w.put<int64_t>(e.wallUs);
+	w.putString(e.name);
+}
+
+static void getEntry(ByteReader& r, ArchiveEntry& e) {
+	e.offset = r.get<uint64_t>();
+	e.nFrame = r.get<uint32_t>();
+	e.format = r.get<uint32_t>();
+	e.tsMs = r.get<int64_t>();
+	e.difference = r.get<int64_t>();
+	e.nChangedTiles = r.get<uint32_t>();
+	e.sequence = r.get<uint32_t>();
+	e.monoUs = r.get<int64_t>();
+	e.wallUs = r.get<int64_t>();
+	e.name = r.getString();
+}
+
+static bool readAt(std::ifstream& f, uint64_t offset, void* dst, size_t len) {
+	f.clear();
+	f.seekg(static_cast<std::streamoff>(offset));
+	f.read(static_cast<char*>(dst), static_cast<std::streamsize>(len));
+	return f.good() && static_cast<size_t>(f.gcount()) == len;
+}
+
+////////////////////////////////////////////////////////////////////////
+// SnapshotArchive
+
+SnapshotArchive::SnapshotArchive() {
+	m_indexInterval = SC_DEFAULT_ARCHIVE_INDEX_INTERVAL;
+	m_offset = 0;
+	m_lastIndexOffset = 0;
+	m_nFrames = 0;
+}
+
+SnapshotArchive::~SnapshotArchive() {
+	close();
+}
+
+bool SnapshotArchive::append(ArchiveFrame& frame) {
+	// prepare FRME metadata outside of lock
+	ByteWriter meta;
+	const ArchiveEntry& e = frame.entry;
+	meta.put<uint32_t>(e.nFrame);
+	meta.put<uint32_t>(e.format);
+	meta.put<uint32_t>(frame.cx);
+	meta.put<uint32_t>(frame.cy);
+	meta.put<int64_t>(e.tsMs);
+	meta.put<int64_t>(e.difference);
+	meta.put<uint32_t>(e.nChangedTiles);
+	meta.put<uint32_t>(e.sequence);
+	meta.put<int64_t>(e.monoUs);
+	meta.put<int64_t>(e.wallUs);
+	const size_t nTiles = std::min(frame.tiles.size(), static_cast<size_t>(frame.tilesX) * frame.tilesY);
+	meta.put<uint16_t>(nTiles > 0 ? frame.tilesX : 0);
+	meta.put<uint16_t>(nTiles > 0 ? frame.tilesY : 0);
+	if( nTiles > 0 ) {
+		std::vector<unsigned char> bits((nTiles + 7) / 8, 0);
+		for (size_t i = 0; i < nTiles; i++) {
+			if( frame.tiles[i] ) bits[i >> 3] |= static_cast<unsigned char>(1 << (i & 7));
+		}
+		meta.putBytes(bits.data(), bits.size());
+	}
+	meta.putString(e.name);
+
+	ByteWriter head;
+	head.putBytes(TAG_FRAME, sizeof(TAG_FRAME));
+	head.put<uint32_t>(static_cast<uint32_t>(meta.buf.size()));
+	head.putBytes(meta.buf.data(), meta.buf.size());
+	head.put<uint64_t>(frame.data.size());
+
+	_SYNC();
+	if( !m_file.is_open() ) {
+		return false;
+	}
+	frame.entry.offset = m_offset;
+	m_file.write(reinterpret_cast<const char*>(head.buf.data()), head.buf.size());
+	m_file.write(reinterpret_cast<const char*>(frame.data.data()), frame.data.size());
+	m_file.flush();
+	if( !m_file.good() ) {
+		_ERROR("Error writing to archive: " << m_path);
+		return false;
+	}
+	m_offset += head.buf.size() + frame.data.size();
+	m_nFrames++;
+	m_pending.push_back(frame.entry);
+	if( m_indexInterval > 0 && m_pending.size() >= static_cast<size_t>(m_indexInterval) ) {
+		return writeIndex();
+	}
+	return true;
+}
+
+bool SnapshotArchive::close() {
+	_SYNC();
+	if( !m_file.is_open() ) {
+		return true;
+	}
+	bool fOk = writeIndex();
+
+	ByteWriter tail;
+	tail.putBytes(TAG_TAIL, sizeof(TAG_TAIL));
+	tail.put<uint32_t>(0);
+	tail.put<uint64_t>(m_lastIndexOffset);
+	tail.put<uint64_t>(m_nFrames);
+	tail.putBytes(ARCHIVE_END_MAGIC, sizeof(ARCHIVE_END_MAGIC));
+	m_file.write(reinterpret_cast<const char*>(tail.buf.data()), tail.buf.size());
+	m_file.close();
+	if( m_file.fail() ) {
+		_ERROR("Error closing archive: " << m_path);
+		fOk = false;
+	}
+	return fOk;
+}
+
+uint64_t SnapshotArchive::getFrameCount() const {
+	_SYNC();
+	return m_nFrames;
+}
+
+const std::string& SnapshotArchive::getPath() const {
+	return m_path;
+}
+
+bool SnapshotArchive::isOpen() const {
+	_SYNC();
+	return m_file.is_open();
+}
+
+bool SnapshotArchive::open(const std::string& path, int cx, int cy, int indexInterval) {
+	_SYNC();
+	m_file.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+	if( !m_file.is_open() ) {
+		_ERROR("Error opening archive for writing: " << path);
+		return false;
+	}
+	m_path = path;
+	m_indexInterval = indexInterval;
+	m_lastIndexOffset = 0;
+	m_nFrames = 0;
+	m_pending.clear();
+
+	ByteWriter header;
+	header.putBytes(ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	header.put<uint32_t>(ARCHIVE_VERSION);
+	header.put<uint32_t>(static_cast<uint32_t>(cx));
+	header.put<uint32_t>(static_cast<uint32_t>(cy));
+	header.put<uint32_t>(0);
+	m_file.write(reinterpret_cast<const char*>(header.buf.data()), header.buf.size());
+	m_file.flush();
+	m_offset = header.buf.size();
+	return m_file.good();
+}
+
+// must be called under lock
+bool SnapshotArchive::writeIndex() {
+	if( m_pending.empty() ) {
+		return true;
+	}
+	ByteWriter body;
+	for (const auto& e: m_pending) {
+		putEntry(body, e);
+	}
+	ByteWriter w;
+	w.putBytes(TAG_INDEX, sizeof(TAG_INDEX));
+	w.put<uint32_t>(static_cast<uint32_t>(m_pending.size()));
+	w.put<uint64_t>(m_lastIndexOffset);
+	w.put<uint64_t>(body.buf.size());
+	w.putBytes(body.buf.data(), body.buf.size());
+	m_file.write(reinterpret_cast<const char*>(w.buf.data()), w.buf.size());
+	m_file.flush();
+	if( !m_file.good() ) {
+		_ERROR("Error writing index to archive: " << m_path);
+		return false;
+	}
+	m_lastIndexOffset = m_offset;
+	m_offset += w.buf.size();
+	m_pending.clear();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// SnapshotArchiveReader
+
+SnapshotArchiveReader::SnapshotArchiveReader() {
+	m_fileSize = 0;
+	m_cx = 0;
+	m_cy = 0;
+	m_complete = false;
+}
+
+bool SnapshotArchiveReader::open(const std::string& path) {
+	m_entries.clear();
+	m_complete = false;
+	m_file.open(path, std::ios::binary | std::ios::in);
+	if( !m_file.is_open() ) {
+		_ERROR("Error opening archive: " << path);
+		return false;
+	}
+	m_file.seekg(0, std::ios::end);
+	m_fileSize = static_cast<uint64_t>(m_file.tellg());
+
+	unsigned char header[ARCHIVE_HEADER_SIZE];
+	if( m_fileSize < ARCHIVE_HEADER_SIZE || !readAt(m_file, 0, header, sizeof(header)) ||
+		memcmp(header, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 ) {
+		_ERROR("Invalid archive header: " << path);
+		return false;
+	}
+	ByteReader r(header + sizeof(ARCHIVE_MAGIC), sizeof(header) - sizeof(ARCHIVE_MAGIC));
+	const uint32_t version = r.get<uint32_t>();
+	if( version != ARCHIVE_VERSION ) {
+		_ERROR("Unsupported archive version " << version << ": " << path);
+		return false;
+	}
+	m_cx = r.get<uint32_t>();
+	m_cy = r.get<uint32_t>();
+
+	// use index when archive was properly closed
+	unsigned char tail[ARCHIVE_TRAILER_SIZE];
+	if( m_fileSize >= ARCHIVE_HEADER_SIZE + ARCHIVE_TRAILER_SIZE &&
+		readAt(m_file, m_fileSize - ARCHIVE_TRAILER_SIZE, tail, sizeof(tail)) &&
+		memcmp(tail, TAG_TAIL, sizeof(TAG_TAIL)) == 0 &&
+		memcmp(tail + ARCHIVE_TRAILER_SIZE - sizeof(ARCHIVE_END_MAGIC),
+			   ARCHIVE_END_MAGIC, sizeof(ARCHIVE_END_MAGIC)) == 0 ) {
+		ByteReader tr(tail + 8, 16);
+		const uint64_t lastIndexOffset = tr.get<uint64_t>();
+		const uint64_t nFrames = tr.get<uint64_t>();
+		if( readIndexChain(lastIndexOffset) && m_entries.size() == nFrames ) {
+			m_complete = true;
+		} else {
+			_INFO("Archive index is inconsistent, scan records: " << path);
+			m_entries.clear();
+		}
+	}
+
+	if( !m_complete ) {
+		_VERBOSE("Archive has no valid trailer, scan records: " << path);
+		if( !scanRecords() ) {
+			return false;
+		}
+	}
+
+	std::stable_sort(m_entries.begin(), m_entries.end(),
+		[](const ArchiveEntry& a, const ArchiveEntry& b) { return a.nFrame < b.nFrame; });
+	return true;
+}
+
+bool SnapshotArchiveReader::readFrame(const ArchiveEntry& entry, ArchiveFrame& frame) {
+	unsigned char head[8];
+	if( !readAt(m_file, entry.offset, head, sizeof(head)) ||
+		memcmp(head, TAG_FRAME, sizeof(TAG_FRAME)) != 0 ) {
+		_ERROR("Invalid frame record at offset " << entry.offset);
+		return false;
+	}
+	ByteReader hr(head + 4, 4);
+	const uint32_t metaLen = hr.get<uint32_t>();
+	// metadata length is untrusted, check it before allocation
+	const uint64_t metaSize = static_cast<uint64_t>(metaLen) + 8;
+	if( entry.offset > m_fileSize || sizeof(head) > m_fileSize - entry.offset ||
+		metaSize > m_fileSize - entry.offset - sizeof(head) ) {
+		_ERROR("Truncated frame record at offset " << entry.offset);
+		return false;
+	}
+	std::vector<unsigned char> meta(metaSize);
+	if( !readAt(m_file, entry.offset + sizeof(head), meta.data(), meta.size()) ) {
+		_ERROR("Truncated frame record at offset " << entry.offset);
+		return false;
+	}
+	ByteReader r(meta.data(), meta.size());
+	frame.entry.offset = entry.offset;
+	frame.entry.nFrame = r.get<uint32_t>();
+	frame.entry.format = r.get<uint32_t>();
+	frame.cx = r.get<uint32_t>();
+	frame.cy = r.get<uint32_t>();
+	frame.entry.tsMs = r.get<int64_t>();
+	frame.entry.difference = r.get<int64_t>();
+	frame.entry.nChangedTiles = r.get<uint32_t>();
+	frame.entry.sequence = r.get<uint32_t>();
+	frame.entry.monoUs = r.get<int64_t>();
+	frame.entry.wallUs = r.get<int64_t>();
+	frame.tilesX = r.get<uint16_t>();
+	frame.tilesY = r.get<uint16_t>();
+	const size_t nTiles = static_cast<size_t>(frame.tilesX) * frame.tilesY;
+	std::vector<unsigned char> bits((nTiles + 7) / 8);
+	r.getBytes(bits.data(), bits.size());
+	frame.tiles.assign(nTiles, 0);
+	for (size_t i = 0; i < nTiles; i++) {
+		frame.tiles[i] = (bits[i >> 3] >> (i & 7)) & 1;
+	}
+	frame.entry.name = r.getString();
+	const uint64_t payloadSize = r.get<uint64_t>();
+	// payload offset is within file after metadata check above
+	const uint64_t payloadOffset = entry.offset + sizeof(head) + metaSize;
+	if( r.fail || payloadSize > m_fileSize - payloadOffset ) {
+		_ERROR("Truncated frame record at offset " << entry.offset);
+		return false;
+	}
+	frame.data.resize(payloadSize);
+	return readAt(m_file, payloadOffset, frame.data.data(), payloadSize);
+}
+
+// read INDX record at offset, returns false if there is no valid index
+static bool readIndex(std::ifstream& f, uint64_t fileSize, uint64_t offset,
+					  std::vector<ArchiveEntry>& entries, uint64_t& prevOffset, uint64_t& recordSize) {
+	unsigned char head[ARCHIVE_INDEX_HEAD_SIZE];
+	if( offset > fileSize || sizeof(head) > fileSize - offset || !readAt(f, offset, head, sizeof(head)) ||
+		memcmp(head, TAG_INDEX, sizeof(TAG_INDEX)) != 0 ) {
+		return false;
+	}
+	ByteReader hr(head + 4, sizeof(head) - 4);
+	const uint32_t count = hr.get<uint32_t>();
+	prevOffset = hr.get<uint64_t>();
+	const uint64_t bodyLen = hr.get<uint64_t>();
+	// body length is untrusted, check it against bytes left before allocation
+	if( bodyLen > fileSize - offset - sizeof(head) ) {
+		return false;
+	}
+	std::vector<unsigned char> body(bodyLen);
+	if( !readAt(f, offset + sizeof(head), body.data(), body.size()) ) {
+		return false;
+	}
+	ByteReader r(body.data(), body.size());
+	for (uint32_t i = 0; i < count; i++) {
+		ArchiveEntry e;
+		getEntry(r, e);
+		if( r.fail ) return false;
+		entries.push_back(e);
+	}
+	recordSize = sizeof(head) + bodyLen;
+	return true;
+}
+
+bool SnapshotArchiveReader::readIndexChain(uint64_t lastIndexOffset) {
+	uint64_t offset = lastIndexOffset;
+	while( offset != 0 ) {
+		uint64_t prevOffset = 0;
+		uint64_t recordSize = 0;
+		if( !readIndex(m_file, m_fileSize, offset, m_entries, prevOffset, recordSize) ) {
+			return false;
+		}
+		if( prevOffset >= offset ) {
+			return false; // index chain must go backward
+		}
+		offset = prevOffset;
+	}
+	return true;
+}
+
+bool SnapshotArchiveReader::scanRecords() {
+	uint64_t offset = ARCHIVE_HEADER_SIZE;
+	while( offset + 8 <= m_fileSize ) {
+		unsigned char head[8];
+		if( !readAt(m_file, offset, head, sizeof(head)) ) {
+			break;
+		}
+		if( memcmp(head, TAG_FRAME, sizeof(TAG_FRAME)) == 0 ) {
+			ArchiveEntry e;
+			e.offset = offset;
+			ArchiveFrame frame;
+			if( !readFrame(e, frame) ) {
+				break; // truncated tail, e.g. after crash
+			}
+			ByteReader hr(head + 4, 4);
+			const uint32_t metaLen = hr.get<uint32_t>();
+			m_entries.push_back(frame.entry);
+			offset += sizeof(head) + metaLen + 8 + frame.data.size();
+		} else if( memcmp(head, TAG_INDEX, sizeof(TAG_INDEX)) == 0 ) {
+			// entries are already collected from FRME records
+			std::vector<ArchiveEntry> entries;
+			uint64_t prevOffset = 0;
+			uint64_t recordSize = 0;
+			if( !readIndex(m_file, m_fileSize, offset, entries, prevOffset, recordSize) ) {
+				break;
+			}
+			offset += recordSize;
+		} else {
+			break; // trailer or garbage
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+ArchiveFormat getArchiveFormat(SnapshotCodec codec) {
+	switch( codec ) {
+		case CODEC_PNG: return ARCHIVE_FORMAT_PNG;
+		case CODEC_QOI: return ARCHIVE_FORMAT_QOI;
+		case CODEC_LZ4: return ARCHIVE_FORMAT_YUYV_LZ4;
+	}
+	return ARCHIVE_FORMAT_PNG;
+}
+
+const char* getArchiveFormatExt(uint32_t format) {
+	switch( format ) {
+		case ARCHIVE_FORMAT_PNG:      return getSnapshotCodecExt(CODEC_PNG);
+		case ARCHIVE_FORMAT_YUYV:     return ".bin";
+		case ARCHIVE_FORMAT_QOI:      return getSnapshotCodecExt(CODEC_QOI);
+		case ARCHIVE_FORMAT_YUYV_LZ4: return getSnapshotCodecExt(CODEC_LZ4);
+		case ARCHIVE_FORMAT_DELTA:    return ".delta";
+	}
+	return ".dat";
+}
+
+static bool writeExtractFile(const std::filesystem::path& outPath,
+							 const unsigned char* data, size_t len) {
+	std::ofstream outputFile(outPath, std::ios::binary);
+	outputFile.write(reinterpret_cast<const char*>(data), len);
+	if( !outputFile.good() ) {
+		_ERROR("Error writing to file: " << outPath.string());
+		return false;
+	}
+	return true;
+}
+
+int extractSnapshotArchive(const std::string& archivePath, const std::string& outDir,
+						   const std::string& at) {
+	SnapshotArchiveReader reader;
+	if( !reader.open(archivePath) ) {
+		return -1;
+	}
+	if( !reader.isComplete() ) {
+		_INFO("Archive was not properly closed, recovered " << reader.getEntries().size()
+			<< " frame(s): " << archivePath);
+	}
+	if( !std::filesystem::exists(outDir) ) {
+		std::filesystem::create_directories(outDir);
+	}
+
+	FrameReconstructor reconstructor(reader);
+	std::vector<const ArchiveEntry*> entries;
+	if( at.empty() ) {
+		for (const auto& e: reader.getEntries()) {
+			entries.push_back(&e);
+		}
+	} else {
+		const ArchiveEntry* pEntry = findArchiveEntryAt(reader.getEntries(), at);
+		if( !pEntry ) {
+			_ERROR("No frame captured at or before: " << at);
+			return -1;
+		}
+		entries.push_back(pEntry);
+	}
+
+	// frame timing index, the same as in files storage
+	FrameTimingIndex timingIndex;
+	if( at.empty() ) {
+		const std::filesystem::path indexPath = std::filesystem::path(outDir) / SC_FRAME_INDEX_FILE;
+		std::filesystem::remove(indexPath);
+		if( !timingIndex.open(indexPath.string()) ) {
+			return -1;
+		}
+	}
+
+	int nExtracted = 0;
+	ArchiveFrame frame;
+	std::vector<unsigned char> png;
+	for (const ArchiveEntry* e: entries) {
+		const std::string name = e->name.empty() ? std::to_string(e->nFrame) : e->name;
+		if( timingIndex.isOpen() && e->format != ARCHIVE_FORMAT_YUYV ) {
+			FrameTiming t;
+			t.nFrame = e->nFrame;
+			t.sequence = e->sequence;
+			t.monoUs = e->monoUs;
+			t.wallUs = e->wallUs != 0 ? e->wallUs : e->tsMs * 1000;
+			timingIndex.append(t, name);
+		}
+		// rebuild delta frames, and the requested frame, into PNG image
+		if( e->format == ARCHIVE_FORMAT_DELTA || !at.empty() ) {
+			cv::Mat bgr;
+			if( !reconstructor.reconstruct(*e, bgr) || !cv::imencode(".png", bgr, png) ) {
+				_ERROR("Failed rebuild frame [" << e->nFrame << "]");
+				return -1;
+			}
+			const std::filesystem::path outPath = std::filesystem::path(outDir) /
+					(name + getSnapshotCodecExt(CODEC_PNG));
+			_VERBOSE("Rebuild frame [" << e->nFrame << "] to: " << outPath.string());
+			if( !writeExtractFile(outPath, png.data(), png.size()) ) {
+				return -1;
+			}
+			nExtracted++;
+			continue;
+		}
+
+		if( !reader.readFrame(*e, frame) ) {
+			return -1;
+		}
+		const std::filesystem::path outPath = std::filesystem::path(outDir) /
+				(name + getArchiveFormatExt(frame.entry.format));
+		_VERBOSE("Extract frame [" << e->nFrame << "] to: " << outPath.string());
+		if( !writeExtractFile(outPath, frame.data.data(), frame.data.size()) ) {
+			return -1;
+		}
+		nExtracted++;
+	}
+	return nExtracted;
+}
@@ -0,0 +1,138 @@
+#ifndef CAPTURE_SNAPSHOTARCHIVE_H
+#define CAPTURE_SNAPSHOTARCHIVE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "reprostim/CaptureThreading.h"
+#include "SnapshotCodec.h"
+
+using namespace reprostim;
+
+// Session archive is single append-only file with all snapshots
+// of screencapture session, layout (all numbers little-endian):
+//
+//   header  : magic "RSSCARC\0", u32 version, u32 cx, u32 cy, u32 reserved
+//   FRME    : snapshot record, metadata followed by payload
+//   INDX    : periodic index of FRME records written since previous
+//             INDX, linked to previous one with its offset
+//   TAIL    : trailer with offset of the last INDX, written on close
+//
+// When trailer is missing (e.g. crash), reader falls back to
+// sequential scan of FRME records.
+
+// default extension of session archive files
+#ifndef SC_ARCHIVE_EXT
+#define SC_ARCHIVE_EXT ".scarch"
+#endif
+
+// default number of frames between periodic index records
+#ifndef SC_DEFAULT_ARCHIVE_INDEX_INTERVAL
+#define SC_DEFAULT_ARCHIVE_INDEX_INTERVAL 100
+#endif
+
+// Snapshot payload format
+enum ArchiveFormat: uint32_t {
+	ARCHIVE_FORMAT_PNG      = 0, // PNG encoded image
+	ARCHIVE_FORMAT_YUYV     = 1, // raw YUYV frame
+	ARCHIVE_FORMAT_QOI      = 2, // QOI encoded image
+	ARCHIVE_FORMAT_YUYV_LZ4 = 3, // raw YUYV frame in LZ4 frame format
+	ARCHIVE_FORMAT_DELTA    = 4  // tiles changed against keyframe, see DeltaSnapshot.h
+};
+
+// Archive index entry
+struct ArchiveEntry {
+	uint64_t    offset = 0;        // offset of FRME record in archive file
+	uint32_t    nFrame = 0;
+	uint32_t    format = ARCHIVE_FORMAT_PNG;
+	int64_t     tsMs = 0;          // capture time, ms since epoch
+	int64_t     difference = 0;    // change detector difference
+	uint32_t    nChangedTiles = 0;
+	uint32_t    sequence = 0;          // V4L2 buffer sequence number
+	int64_t     monoUs = 0;            // kernel capture time, CLOCK_MONOTONIC us
+	int64_t     wallUs = 0;            // kernel capture time converted to wall clock us
+	std::string name;              // snapshot base name, e.g. timestamp
+};
+
+// Archive snapshot record with tile diffs and payload
+struct ArchiveFrame {
+	ArchiveEntry               entry;
+	uint32_t                   cx = 0;
+	uint32_t                   cy = 0;
+	uint16_t                   tilesX = 0;
+	uint16_t                   tilesY = 0;
+	std::vector<uint8_t>       tiles; // changed tiles, one byte per tile
+	std::vector<unsigned char> data;  // payload
+};
+
+// Thread-safe append-only writer of session archive
+class SnapshotArchive {
+private:
+	_DECLARE_CLASS_WITH_SYNC();
+
+	std::ofstream             m_file;
+	std::string               m_path;
+	int                       m_indexInterval;
+	uint64_t                  m_offset;
+	uint64_t                  m_lastIndexOffset;
+	uint64_t                  m_nFrames;
+	std::vector<ArchiveEntry> m_pending; // entries not yet indexed
+
+	bool writeIndex();
+
+public:
+	SnapshotArchive();
+	~SnapshotArchive();
+
+	// append snapshot record, offset in frame entry is assigned here
+	bool append(ArchiveFrame& frame);
+	// write pending index and trailer, then close file
+	bool close();
+	uint64_t getFrameCount() const;
+	const std::string& getPath() const;
+	bool isOpen() const;
+	bool open(const std::string& path, int cx, int cy,
+			  int indexInterval = SC_DEFAULT_ARCHIVE_INDEX_INTERVAL);
+};
+
+// Reader of session archive
+class SnapshotArchiveReader {
+private:
+	std::ifstream             m_file;
+	uint64_t                  m_fileSize;
+	uint32_t                  m_cx;
+	uint32_t                  m_cy;
+	bool                      m_complete;
+	std::vector<ArchiveEntry> m_entries;
+
+	bool readIndexChain(uint64_t lastIndexOffset);
+	bool scanRecords();
+
+public:
+	SnapshotArchiveReader();
+
+	int  getCx() const { return m_cx; }
+	int  getCy() const { return m_cy; }
+	// entries sorted by frame number
+	const std::vector<ArchiveEntry>& getEntries() const { return m_entries; }
+	// true when archive was properly closed and index is used
+	bool isComplete() const { return m_complete; }
+	bool open(const std::string& path);
+	bool readFrame(const ArchiveEntry& entry, ArchiveFrame& frame);
+};
+
+// archive payload format for snapshot codec
+ArchiveFormat getArchiveFormat(SnapshotCodec codec);
+
+// file extension for archive payload format
+const char* getArchiveFormatExt(uint32_t format);
+
+// extract all snapshots from archive to the directory, delta frames are
+// rebuilt to PNG images and frame timing is written to frames.jsonl.
+// When "at" time is specified, only frame captured at or before this
+// time is rebuilt. Returns number of extracted frames or -1 on error
+int extractSnapshotArchive(const std::string& archivePath, const std::string& outDir,
+						   const std::string& at = "");
+
+#endif //CAPTURE_SNAPSHOTARCHIVE_H
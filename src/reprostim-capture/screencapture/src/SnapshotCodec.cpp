@@ -0,0 +1,230 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <lz4frame.h>
+#include <opencv2/opencv.hpp>
+#include "SnapshotCodec.h"
+
+////////////////////////////////////////////////////////////////////////
+// QOI codec, see https://qoiformat.org/qoi-specification.pdf
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_OP_RGBA  0xff
+#define QOI_MASK_2   0xc0
+#define QOI_HEADER_SIZE 14
+
+static const unsigned char QOI_PADDING[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct QoiPixel {
+	unsigned char r, g, b, a;
+};
+
+static inline int qoiHash(const QoiPixel& p) {
+	return (p.r*3 + p.g*5 + p.b*7 + p.a*11) % 64;
+}
+
+static inline void putU32BE(unsigned char* p, uint32_t v) {
+	p[0] = static_cast<unsigned char>(v >> 24);
+	p[1] = static_cast<unsigned char>(v >> 16);
+	p[2] = static_cast<unsigned char>(v >> 8);
+	p[3] = static_cast<unsigned char>(v);
+}
+
+static inline uint32_t getU32BE(const unsigned char* p) {
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+		   (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void encodeQoi(const unsigned char* bgr, int cx, int cy, size_t stride,
+			   std::vector<unsigned char>& out) {
+	// worst case is QOI_OP_RGB for every pixel
+	out.resize(QOI_HEADER_SIZE + static_cast<size_t>(cx) * cy * 4 + sizeof(QOI_PADDING));
+	unsigned char* p = out.data();
+	memcpy(p, "qoif", 4);
+	putU32BE(p + 4, cx);
+	putU32BE(p + 8, cy);
+	p[12] = 3; // channels
+	p[13] = 0; // sRGB with linear alpha
+	p += QOI_HEADER_SIZE;
+
+	QoiPixel index[64];
+	memset(index, 0, sizeof(index));
+	QoiPixel prev = {0, 0, 0, 255};
+	int run = 0;
+
+	for (int y = 0; y < cy; y++) {
+		const unsigned char* row = bgr + y * stride;
+		for (int x = 0; x < cx; x++) {
+			const QoiPixel px = {row[x*3 + 2], row[x*3 + 1], row[x*3], 255};
+			if( px.r == prev.r && px.g == prev.g && px.b == prev.b ) {
+				run++;
+				if( run == 62 ) {
+					*p++ = QOI_OP_RUN | (run - 1);
+					run = 0;
+				}
+				continue;
+			}
+			if( run > 0 ) {
+				*p++ = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+
+			const int h = qoiHash(px);
+			if( index[h].r == px.r && index[h].g == px.g && index[h].b == px.b && index[h].a == px.a ) {
+				*p++ = QOI_OP_INDEX | h;
+			} else {
+				index[h] = px;
+				const signed char vr = static_cast<signed char>(px.r - prev.r);
+				const signed char vg = static_cast<signed char>(px.g - prev.g);
+				const signed char vb = static_cast<signed char>(px.b - prev.b);
+				const signed char vgr = static_cast<signed char>(vr - vg);
+				const signed char vgb = static_cast<signed char>(vb - vg);
+				if( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 ) {
+					*p++ = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+				} else if( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 ) {
+					*p++ = QOI_OP_LUMA | (vg + 32);
+					*p++ = (vgr + 8) << 4 | (vgb + 8);
+				} else {
+					*p++ = QOI_OP_RGB;
+					*p++ = px.r;
+					*p++ = px.g;
+					*p++ = px.b;
+				}
+			}
+			prev = px;
+		}
+	}
+	if( run > 0 ) {
+		*p++ = QOI_OP_RUN | (run - 1);
+	}
+	memcpy(p, QOI_PADDING, sizeof(QOI_PADDING));
+	p += sizeof(QOI_PADDING);
+	out.resize(p - out.data());
+}
+
+bool decodeQoi(const unsigned char* data, size_t len, std::vector<unsigned char>& bgr,
+			   int& cx, int& cy) {
+	if( len < QOI_HEADER_SIZE + sizeof(QOI_PADDING) || memcmp(data, "qoif", 4) != 0 ) {
+		return false;
+	}
+	cx = static_cast<int>(getU32BE(data + 4));
+	cy = static_cast<int>(getU32BE(data + 8));
+	const int channels = data[12];
+	if( cx <= 0 || cy <= 0 || (channels != 3 && channels != 4) ||
+		static_cast<uint64_t>(cx) * cy > 400000000ULL ) {
+		return false;
+	}
+
+	const size_t nPixels = static_cast<size_t>(cx) * cy;
+	bgr.resize(nPixels * 3);
+	QoiPixel index[64];
+	memset(index, 0, sizeof(index));
+	QoiPixel px = {0, 0, 0, 255};
+	int run = 0;
+	size_t pos = QOI_HEADER_SIZE;
+	const size_t end = len - sizeof(QOI_PADDING);
+
+	for (size_t i = 0; i < nPixels; i++) {
+		if( run > 0 ) {
+			run--;
+		} else if( pos < end ) {
+			const int b1 = data[pos++];
+			if( b1 == QOI_OP_RGB ) {
+				if( pos + 3 > end ) return false;
+				px.r = data[pos++];
+				px.g = data[pos++];
+				px.b = data[pos++];
+			} else if( b1 == QOI_OP_RGBA ) {
+				if( pos + 4 > end ) return false;
+				px.r = data[pos++];
+				px.g = data[pos++];
+				px.b = data[pos++];
+				px.a = data[pos++];
+			} else if( (b1 & QOI_MASK_2) == QOI_OP_INDEX ) {
+				px = index[b1];
+			} else if( (b1 & QOI_MASK_2) == QOI_OP_DIFF ) {
+				px.r += ((b1 >> 4) & 0x03) - 2;
+				px.g += ((b1 >> 2) & 0x03) - 2;
+				px.b += ( b1       & 0x03) - 2;
+			} else if( (b1 & QOI_MASK_2) == QOI_OP_LUMA ) {
+				if( pos + 1 > end ) return false;
+				const int b2 = data[pos++];
+				const int vg = (b1 & 0x3f) - 32;
+				px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+				px.g += vg;
+				px.b += vg - 8 + (b2 & 0x0f);
+			} else if( (b1 & QOI_MASK_2) == QOI_OP_RUN ) {
+				run = (b1 & 0x3f);
+			}
+			index[qoiHash(px)] = px;
+		} else {
+			return false;
+		}
+		bgr[i*3]     = px.b;
+		bgr[i*3 + 1] = px.g;
+		bgr[i*3 + 2] = px.r;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+bool encodeSnapshot(const SnapshotCodecOpts& opts, const unsigned char* yuyv,
+					int cx, int cy, std::vector<unsigned char>& out) {
+	const size_t len = static_cast<size_t>(cx) * cy * 2;
+	if( opts.codec == CODEC_LZ4 ) {
+		LZ4F_preferences_t prefs;
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.frameInfo.contentSize = len;
+		out.resize(LZ4F_compressFrameBound(len, &prefs));
+		const size_t n = LZ4F_compressFrame(out.data(), out.size(), yuyv, len, &prefs);
+		if( LZ4F_isError(n) ) {
+			return false;
+		}
+		out.resize(n);
+		return true;
+	}
+
+	cv::Mat yuyvImage(cy, cx, CV_8UC2, const_cast<unsigned char*>(yuyv));
+	cv::Mat frame;
+	cv::cvtColor(yuyvImage, frame, cv::COLOR_YUV2BGR_YUYV);
+	if( opts.codec == CODEC_QOI ) {
+		encodeQoi(frame.data, cx, cy, frame.step, out);
+		return true;
+	}
+	return cv::imencode(".png", frame, out, {cv::IMWRITE_PNG_COMPRESSION, opts.pngLevel});
+}
+
+const char* getSnapshotCodecExt(SnapshotCodec codec) {
+	switch( codec ) {
+		case CODEC_PNG: return ".png";
+		case CODEC_QOI: return ".qoi";
+		case CODEC_LZ4: return ".yuyv.lz4";
+	}
+	return "";
+}
+
+const char* getSnapshotCodecName(SnapshotCodec codec) {
+	switch( codec ) {
+		case CODEC_PNG: return "png";
+		case CODEC_QOI: return "qoi";
+		case CODEC_LZ4: return "lz4";
+	}
+	return "";
+}
+
+SnapshotCodec parseSnapshotCodec(const std::string& text) {
+	if( text == "png" ) {
+		return CODEC_PNG;
+	} else if( text == "qoi" ) {
+		return CODEC_QOI;
+	} else if( text == "lz4" ) {
+		return CODEC_LZ4;
+	}
+	throw std::runtime_error("Unsupported codec "+text);
+}
@@ -0,0 +1,47 @@
+#ifndef CAPTURE_SNAPSHOTCODEC_H
+#define CAPTURE_SNAPSHOTCODEC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// default PNG compression level, 0..9
+#ifndef SC_DEFAULT_PNG_LEVEL
+#define SC_DEFAULT_PNG_LEVEL 1
+#endif
+
+// Snapshot codec types
+enum SnapshotCodec: int {
+	CODEC_PNG = 0, // zlib PNG via OpenCV, lossless
+	CODEC_QOI = 1, // QOI "Quite OK Image" format, fast lossless
+	CODEC_LZ4 = 2  // raw YUYV frame in LZ4 frame format
+};
+
+// Snapshot codec options
+struct SnapshotCodecOpts {
+	SnapshotCodec codec = CODEC_PNG;
+	int           pngLevel = SC_DEFAULT_PNG_LEVEL;
+};
+
+// Encode YUYV frame with specified codec into output buffer
+bool encodeSnapshot(const SnapshotCodecOpts& opts, const unsigned char* yuyv,
+					int cx, int cy, std::vector<unsigned char>& out);
+
+// Encode BGR image with QOI codec
+void encodeQoi(const unsigned char* bgr, int cx, int cy, size_t stride,
+			   std::vector<unsigned char>& out);
+
+// Decode QOI image to BGR pixels, returns false on invalid data
+bool decodeQoi(const unsigned char* data, size_t len, std::vector<unsigned char>& bgr,
+			   int& cx, int& cy);
+
+// File extension for snapshots encoded with codec
+const char* getSnapshotCodecExt(SnapshotCodec codec);
+
+// Codec name as used in config.yaml
+const char* getSnapshotCodecName(SnapshotCodec codec);
+
+// parse codec from config.yaml value
+SnapshotCodec parseSnapshotCodec(const std::string& text);
+
+#endif //CAPTURE_SNAPSHOTCODEC_H
@@ -0,0 +1,293 @@
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "SnapshotWriter.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static bool writeFile(const std::string& path, const unsigned char* data, size_t len) {
+	std::ofstream outputFile(path, std::ios::binary);
+	if (!outputFile.is_open()) {
+		_ERROR("Error opening file for writing: " << path);
+		return false;
+	}
+
+	outputFile.write(reinterpret_cast<const char *>(data), len);
+	if (!outputFile.good()) {
+		_ERROR("Error writing to file: " << path);
+		outputFile.close();
+		return false;
+	}
+	outputFile.close();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// SnapshotWriter
+
+SnapshotWriter::SnapshotWriter(const SnapshotWriterOpts& opts): m_opts(opts) {
+	m_stopping = false;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	stop();
+}
+
+std::vector<unsigned char> SnapshotWriter::acquireBuffer(size_t len) {
+	std::vector<unsigned char> data;
+	{
+		_SYNC();
+		if( !m_pool.empty() ) {
+			data = std::move(m_pool.back());
+			m_pool.pop_back();
+		}
+	}
+	data.resize(len);
+	return data;
+}
+
+SnapshotWriterStats SnapshotWriter::getStats() const {
+	_SYNC();
+	SnapshotWriterStats stats = m_stats;
+	stats.depth = m_queue.size();
+	return stats;
+}
+
+bool SnapshotWriter::push(Snapshot&& s) {
+	if( m_threads.empty() ) {
+		// synchronous mode, write on the caller thread
+		{
+			_SYNC();
+			m_stats.pushed++;
+		}
+		writeAndCount(s);
+		recycle(std::move(s.data));
+		return true;
+	}
+
+	bool fAccepted = true;
+	std::vector<unsigned char> dropped;
+	{
+		_SYNC_U();
+		m_stats.pushed++;
+		if( m_queue.size() >= static_cast<size_t>(m_opts.queueSize) ) {
+			switch( m_opts.overflow ) {
+				case OVERFLOW_DROP_OLDEST:
+					dropped = std::move(m_queue.front().data);
+					m_queue.pop_front();
+					m_stats.dropped++;
+					break;
+				case OVERFLOW_DROP_NEWEST:
+					m_stats.dropped++;
+					fAccepted = false;
+					break;
+				case OVERFLOW_BLOCK:
+					m_condNotFull.wait(_sync_ulock, [this]() {
+						return m_queue.size() < static_cast<size_t>(m_opts.queueSize) || m_stopping;
+					});
+					break;
+			}
+		}
+		if( fAccepted ) {
+			m_queue.push_back(std::move(s));
+			if( m_queue.size() > m_stats.maxDepth ) {
+				m_stats.maxDepth = m_queue.size();
+			}
+		} else {
+			dropped = std::move(s.data);
+		}
+	}
+	if( fAccepted ) {
+		m_condNotEmpty.notify_one();
+	}
+	if( !dropped.empty() ) {
+		recycle(std::move(dropped));
+	}
+	return fAccepted;
+}
+
+void SnapshotWriter::recycle(std::vector<unsigned char>&& data) {
+	_SYNC();
+	// keep at most queue size + workers buffers around
+	if( m_pool.size() < static_cast<size_t>(m_opts.queueSize + m_opts.nThreads) ) {
+		m_pool.push_back(std::move(data));
+	}
+}
+
+void SnapshotWriter::runWorker() {
+	_SESSION_LOG_BEGIN(m_opts.pLogger);
+	while( true ) {
+		Snapshot s;
+		{
+			_SYNC_U();
+			m_condNotEmpty.wait(_sync_ulock, [this]() {
+				return !m_queue.empty() || m_stopping;
+			});
+			if( m_queue.empty() ) {
+				break; // stopping and nothing left to write
+			}
+			s = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+		m_condNotFull.notify_one();
+		writeAndCount(s);
+		recycle(std::move(s.data));
+	}
+	_SESSION_LOG_END();
+}
+
+void SnapshotWriter::start() {
+	_SYNC();
+	m_stopping = false;
+	for (int i = 0; i < m_opts.nThreads; i++) {
+		m_threads.emplace_back(&SnapshotWriter::runWorker, this);
+	}
+}
+
+void SnapshotWriter::stop(int timeoutMs) {
+	std::vector<std::vector<unsigned char>> dropped;
+	{
+		_SYNC_U();
+		m_stopping = true;
+		m_condNotEmpty.notify_all();
+		m_condNotFull.notify_all();
+		if( timeoutMs >= 0 && !m_threads.empty() ) {
+			// workers notify m_condNotFull on every snapshot taken
+			m_condNotFull.wait_for(_sync_ulock, std::chrono::milliseconds(timeoutMs), [this]() {
+				return m_queue.empty();
+			});
+			for (auto& s: m_queue) {
+				dropped.push_back(std::move(s.data));
+			}
+			m_stats.dropped += m_queue.size();
+			m_queue.clear();
+		}
+	}
+	for (auto& data: dropped) {
+		recycle(std::move(data));
+	}
+	for (auto& t: m_threads) {
+		if( t.joinable() ) {
+			t.join();
+		}
+	}
+	m_threads.clear();
+}
+
+bool SnapshotWriter::write(const Snapshot& s) {
+	if( m_opts.pArchive ) {
+		return writeArchive(s);
+	}
+
+	if (s.dumpRaw) {
+		std::string rawPath = s.basePath + ".bin";
+		_INFO("Save frame [" << s.nFrame << "] to: " << rawPath);
+		if( !writeFile(rawPath, s.data.data(), s.data.size()) ) {
+			return false;
+		}
+	}
+
+	std::vector<unsigned char> encoded;
+	if( !encodeSnapshot(m_opts.codec, s.data.data(), s.cx, s.cy, encoded) ) {
+		_ERROR("Error encoding frame [" << s.nFrame << "] with codec: "
+			<< getSnapshotCodecName(m_opts.codec.codec));
+		return false;
+	}
+	std::string outPath = s.basePath + getSnapshotCodecExt(m_opts.codec.codec);
+	_INFO("Save frame [" << s.nFrame << "] to: " << outPath);
+	if( !writeFile(outPath, encoded.data(), encoded.size()) ) {
+		return false;
+	}
+	if( m_opts.pTimingIndex ) {
+		m_opts.pTimingIndex->append(s.timing, s.baseName);
+	}
+	return true;
+}
+
+bool SnapshotWriter::writeArchive(const Snapshot& s) {
+	ArchiveFrame frame;
+	frame.entry.nFrame = s.nFrame;
+	frame.entry.tsMs = s.tsMs;
+	frame.entry.difference = s.difference;
+	frame.entry.nChangedTiles = s.nChangedTiles;
+	frame.entry.sequence = s.timing.sequence;
+	frame.entry.monoUs = s.timing.monoUs;
+	frame.entry.wallUs = s.timing.wallUs;
+	frame.entry.name = s.baseName;
+	frame.cx = s.cx;
+	frame.cy = s.cy;
+	frame.tilesX = static_cast<uint16_t>(s.tilesX);
+	frame.tilesY = static_cast<uint16_t>(s.tilesY);
+	frame.tiles = s.tiles;
+
+	if( s.delta.isDelta ) {
+		frame.entry.format = ARCHIVE_FORMAT_DELTA;
+		if( !encodeDeltaPayload(s.delta, s.data.data(), s.data.size(), frame.data) ) {
+			_ERROR("Error encoding delta frame [" << s.nFrame << "]");
+			return false;
+		}
+		_INFO("Save frame [" << s.nFrame << "] delta to archive: " << m_opts.pArchive->getPath()
+			<< ", keyframe=" << s.delta.keyFrame << ", tiles=" << s.delta.nDirty);
+		return m_opts.pArchive->append(frame);
+	}
+
+	if (s.dumpRaw) {
+		frame.entry.format = ARCHIVE_FORMAT_YUYV;
+		frame.data = s.data;
+		_INFO("Save frame [" << s.nFrame << "] raw to archive: " << m_opts.pArchive->getPath());
+		if( !m_opts.pArchive->append(frame) ) {
+			return false;
+		}
+	}
+
+	frame.entry.format = getArchiveFormat(m_opts.codec.codec);
+	if( !encodeSnapshot(m_opts.codec, s.data.data(), s.cx, s.cy, frame.data) ) {
+		_ERROR("Error encoding frame [" << s.nFrame << "] with codec: "
+			<< getSnapshotCodecName(m_opts.codec.codec));
+		return false;
+	}
+	_INFO("Save frame [" << s.nFrame << "] to archive: " << m_opts.pArchive->getPath());
+	return m_opts.pArchive->append(frame);
+}
+
+void SnapshotWriter::writeAndCount(Snapshot& s) {
+	bool fOk = false;
+	try {
+		fOk = write(s);
+	} catch(const std::exception& e) {
+		_ERROR("Failed save frame [" << s.nFrame << "]: " << e.what());
+	}
+	_SYNC();
+	if( fOk ) {
+		m_stats.written++;
+	} else {
+		m_stats.failed++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+SnapshotOverflow parseSnapshotOverflow(const std::string& text) {
+	if( text == "drop_oldest" ) {
+		return OVERFLOW_DROP_OLDEST;
+	} else if( text == "drop_newest" ) {
+		return OVERFLOW_DROP_NEWEST;
+	} else if( text == "block" ) {
+		return OVERFLOW_BLOCK;
+	}
+	throw std::runtime_error("Unsupported overflow policy "+text);
+}
+
+std::string snapshotWriterStatsToString(const SnapshotWriterStats& stats) {
+	std::ostringstream s;
+	s << "pushed=" << stats.pushed;
+	s << ", written=" << stats.written;
+	s << ", dropped=" << stats.dropped;
+	s << ", failed=" << stats.failed;
+	s << ", depth=" << stats.depth;
+	s << ", maxDepth=" << stats.maxDepth;
+	return s.str();
+}
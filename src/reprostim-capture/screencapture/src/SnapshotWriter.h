@@ -0,0 +1,120 @@
+#ifndef CAPTURE_SNAPSHOTWRITER_H
+#define CAPTURE_SNAPSHOTWRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "reprostim/CaptureThreading.h"
+#include "DeltaSnapshot.h"
+#include "FrameTiming.h"
+#include "SnapshotArchive.h"
+#include "SnapshotCodec.h"
+
+using namespace reprostim;
+
+// default number of snapshot writer worker threads
+#ifndef SC_DEFAULT_WRITER_THREADS
+#define SC_DEFAULT_WRITER_THREADS 2
+#endif
+
+// default max number of snapshots waiting in writer queue
+#ifndef SC_DEFAULT_QUEUE_SIZE
+#define SC_DEFAULT_QUEUE_SIZE 16
+#endif
+
+// Policy used when snapshot writer queue is full
+enum SnapshotOverflow: int {
+	OVERFLOW_DROP_OLDEST = 0, // drop the oldest queued snapshot
+	OVERFLOW_DROP_NEWEST = 1, // drop the snapshot being pushed
+	OVERFLOW_BLOCK       = 2  // block capture thread until queue has room
+};
+
+// Snapshot writer options
+struct SnapshotWriterOpts {
+	int               nThreads = SC_DEFAULT_WRITER_THREADS; // 0 means write synchronously in push
+	int               queueSize = SC_DEFAULT_QUEUE_SIZE;
+	SnapshotOverflow  overflow = OVERFLOW_DROP_OLDEST;
+	SnapshotCodecOpts codec;
+	SnapshotArchive*  pArchive = nullptr; // when set, snapshots are appended to archive
+	FrameTimingIndex* pTimingIndex = nullptr; // when set, timing of saved files is indexed
+	SessionLogger_ptr pLogger;
+};
+
+// Snapshot of raw YUYV frame to be converted, encoded and saved
+struct Snapshot {
+	int                        nFrame = 0;
+	int                        cx = 0;
+	int                        cy = 0;
+	bool                       dumpRaw = false;
+	int64_t                    tsMs = 0; // capture time, ms since epoch
+	FrameTiming                timing;   // kernel capture timestamp and sequence
+	int64_t                    difference = 0;
+	int                        nChangedTiles = 0;
+	int                        tilesX = 0;
+	int                        tilesY = 0;
+	std::vector<uint8_t>       tiles;    // changed tiles from change detector
+	DeltaFrame                 delta;    // when delta, data holds packed dirty tiles
+	std::string                baseName; // snapshot name, e.g. timestamp
+	std::string                basePath; // output path without extension
+	std::vector<unsigned char> data;     // YUYV frame copy
+};
+
+// Snapshot writer statistics/counters
+struct SnapshotWriterStats {
+	uint64_t pushed = 0;
+	uint64_t written = 0;
+	uint64_t dropped = 0;
+	uint64_t failed = 0;
+	size_t   depth = 0;    // current queue depth
+	size_t   maxDepth = 0; // max observed queue depth
+};
+
+// Bounded queue plus worker pool to convert, encode and save
+// snapshots off the capture thread
+class SnapshotWriter {
+private:
+	_DECLARE_CLASS_WITH_SYNC();
+
+	const SnapshotWriterOpts                m_opts;
+	std::condition_variable                 m_condNotEmpty;
+	std::condition_variable                 m_condNotFull;
+	std::deque<Snapshot>                    m_queue;
+	std::vector<std::vector<unsigned char>> m_pool; // reusable frame buffers
+	std::vector<std::thread>                m_threads;
+	SnapshotWriterStats                     m_stats;
+	bool                                    m_stopping;
+
+	void recycle(std::vector<unsigned char>&& data);
+	void runWorker();
+	bool writeArchive(const Snapshot& s);
+	void writeAndCount(Snapshot& s);
+
+protected:
+	// convert/encode and save snapshot, returns false on failure
+	virtual bool write(const Snapshot& s);
+
+public:
+	explicit SnapshotWriter(const SnapshotWriterOpts& opts);
+	virtual ~SnapshotWriter();
+
+	// get frame buffer from pool with specified size
+	std::vector<unsigned char> acquireBuffer(size_t len);
+	SnapshotWriterStats getStats() const;
+	// queue snapshot, returns false when snapshot was dropped
+	bool push(Snapshot&& s);
+	void start();
+	// stop workers, all queued snapshots are saved before return, when
+	// timeoutMs >= 0 snapshots not taken by workers in this time are dropped
+	void stop(int timeoutMs = -1);
+};
+
+// parse overflow policy from config.yaml value
+SnapshotOverflow parseSnapshotOverflow(const std::string& text);
+
+// statistics to string
+std::string snapshotWriterStatsToString(const SnapshotWriterStats& stats);
+
+#endif //CAPTURE_SNAPSHOTWRITER_H
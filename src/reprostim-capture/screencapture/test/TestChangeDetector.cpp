@@ -0,0 +1,141 @@
+#include <vector>
+#include "ChangeDetector.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// fill YUYV frame with constant luma and chroma values
+static std::vector<unsigned char> makeYuyvFrame(int cx, int cy, unsigned char y, unsigned char uv) {
+	std::vector<unsigned char> frame(static_cast<size_t>(cx) * cy * 2);
+	for (size_t j = 0; j < frame.size(); j += 2) {
+		frame[j] = y;
+		frame[j + 1] = uv;
+	}
+	return frame;
+}
+
+// set luma of rectangle in YUYV frame
+static void fillLuma(std::vector<unsigned char>& frame, int cx,
+					 int x, int y, int w, int h, unsigned char value) {
+	for (int j = y; j < y + h; j++) {
+		for (int i = x; i < x + w; i++) {
+			frame[(static_cast<size_t>(j) * cx + i) * 2] = value;
+		}
+	}
+}
+
+TEST_CASE("TestChangeDetector_createChangeDetector",
+		  "[screencapture][ChangeDetector][createChangeDetector]") {
+	ChangeDetectorOpts opts;
+	opts.cx = 64;
+	opts.cy = 32;
+	opts.name = "sad";
+	REQUIRE(std::string(createChangeDetector(opts)->getName()) == "sad");
+	opts.name = "luma_grid";
+	REQUIRE(std::string(createChangeDetector(opts)->getName()) == "luma_grid");
+	opts.name = "unknown";
+	REQUIRE(createChangeDetector(opts) == nullptr);
+}
+
+TEST_CASE("TestChangeDetector_calcLumaRowTileDiff",
+		  "[screencapture][ChangeDetector][calcLumaRowTileDiff]") {
+	// odd width to cover partial last tile
+	const int cx = 45;
+	std::vector<unsigned char> r1 = makeYuyvFrame(cx, 1, 10, 128);
+	std::vector<unsigned char> r2 = makeYuyvFrame(cx, 1, 10, 0);
+	fillLuma(r2, cx, 0, 0, 1, 1, 20);   // tile 0
+	fillLuma(r2, cx, 44, 0, 1, 1, 13);  // tile 2
+
+	std::vector<int64_t> acc(3, 0);
+	REQUIRE(calcLumaRowTileDiff(r1.data(), r2.data(), cx, 16, acc.data()) == 13);
+	REQUIRE(acc[0] == 10);
+	REQUIRE(acc[1] == 0);
+	REQUIRE(acc[2] == 3);
+
+	// tile size not multiple of 8
+	std::vector<int64_t> acc2(9, 0);
+	REQUIRE(calcLumaRowTileDiff(r1.data(), r2.data(), cx, 5, acc2.data()) == 13);
+	REQUIRE(acc2[0] == 10);
+	REQUIRE(acc2[8] == 3);
+}
+
+TEST_CASE("TestChangeDetector_LumaGrid",
+		  "[screencapture][ChangeDetector][LumaGridChangeDetector]") {
+	const int cx = 128, cy = 64;
+	std::vector<unsigned char> prev = makeYuyvFrame(cx, cy, 16, 128);
+
+	ChangeDetectorOpts opts;
+	opts.name = "luma_grid";
+	opts.cx = cx;
+	opts.cy = cy;
+	opts.tileSize = 16;
+	opts.tileThreshold = 0;
+	opts.threshold = 1000;
+	opts.fullScan = true;
+	LumaGridChangeDetector detector(opts);
+	ChangeResult res;
+
+	// chroma only changes are ignored
+	std::vector<unsigned char> cur = makeYuyvFrame(cx, cy, 16, 0);
+	REQUIRE(detector.detect(cur.data(), prev.data(), cur.size(), res) == false);
+	REQUIRE(res.difference == 0);
+	REQUIRE(res.tilesX == 8);
+	REQUIRE(res.tilesY == 4);
+	REQUIRE(res.nChangedTiles == 0);
+
+	// small change in a single tile, below threshold
+	fillLuma(cur, cx, 20, 40, 2, 2, 26);
+	REQUIRE(detector.detect(cur.data(), prev.data(), cur.size(), res) == false);
+	REQUIRE(res.difference == 40);
+	REQUIRE(res.complete);
+	REQUIRE(res.nChangedTiles == 1);
+	REQUIRE(res.tiles[2 * 8 + 1] == 1);
+
+	// large change over two tiles
+	fillLuma(cur, cx, 96, 0, 32, 16, 116);
+	REQUIRE(detector.detect(cur.data(), prev.data(), cur.size(), res) == true);
+	REQUIRE(res.difference == 40 + 32 * 16 * 100);
+	REQUIRE(res.nChangedTiles == 3);
+	REQUIRE(res.tiles[6] == 1);
+	REQUIRE(res.tiles[7] == 1);
+}
+
+TEST_CASE("TestChangeDetector_LumaGrid_early_exit",
+		  "[screencapture][ChangeDetector][LumaGridChangeDetector]") {
+	const int cx = 64, cy = 64;
+	std::vector<unsigned char> prev = makeYuyvFrame(cx, cy, 0, 128);
+	std::vector<unsigned char> cur = makeYuyvFrame(cx, cy, 200, 128);
+
+	ChangeDetectorOpts opts;
+	opts.name = "luma_grid";
+	opts.cx = cx;
+	opts.cy = cy;
+	opts.threshold = 1000;
+	LumaGridChangeDetector detector(opts);
+	ChangeResult res;
+
+	REQUIRE(detector.detect(cur.data(), prev.data(), cur.size(), res) == true);
+	REQUIRE(res.complete == false);
+	// stopped after the first row
+	REQUIRE(res.difference == 64 * 200);
+	REQUIRE(res.nChangedTiles == 4);
+}
+
+TEST_CASE("TestChangeDetector_Sad",
+		  "[screencapture][ChangeDetector][SadChangeDetector]") {
+	const int cx = 32, cy = 8;
+	std::vector<unsigned char> prev = makeYuyvFrame(cx, cy, 16, 128);
+	std::vector<unsigned char> cur = makeYuyvFrame(cx, cy, 16, 129);
+	SadChangeDetector detector(100);
+	ChangeResult res;
+	REQUIRE(detector.detect(cur.data(), prev.data(), cur.size(), res) == true);
+	REQUIRE(res.difference == cx * cy);
+	REQUIRE(res.complete);
+	REQUIRE(res.tiles.empty());
+}
@@ -0,0 +1,181 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "DeltaSnapshot.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static std::vector<unsigned char> makeYuyvFrame(int cx, int cy, unsigned int seed) {
+	std::vector<unsigned char> frame(static_cast<size_t>(cx) * cy * 2);
+	std::mt19937 rng(seed);
+	for (auto& b: frame) {
+		b = static_cast<unsigned char>(rng());
+	}
+	return frame;
+}
+
+// change one YUYV macropixel at pixel position
+static void touchPixel(std::vector<unsigned char>& frame, int cx, int x, int y) {
+	const size_t off = (static_cast<size_t>(y) * cx + (x & ~1)) * 2;
+	frame[off] ^= 0xff;
+	frame[off + 1] ^= 0x55;
+}
+
+static DeltaEncoderOpts makeOpts(int cx, int cy, int tileSize) {
+	DeltaEncoderOpts opts;
+	opts.cx = cx;
+	opts.cy = cy;
+	opts.tileSize = tileSize;
+	opts.keyframeInterval = 3;
+	opts.keyframeIntervalMs = 1000;
+	return opts;
+}
+
+TEST_CASE("TestDeltaSnapshot_keyframes",
+		  "[screencapture][DeltaSnapshot][DeltaEncoder]") {
+	const int cx = 64;
+	const int cy = 32;
+	DeltaEncoder enc(makeOpts(cx, cy, 16));
+	std::vector<unsigned char> frame = makeYuyvFrame(cx, cy, 1);
+	DeltaFrame delta;
+	std::vector<unsigned char> data;
+
+	// first frame is always keyframe
+	enc.update(frame.data(), 1, 0, delta, data);
+	REQUIRE_FALSE(delta.isDelta);
+	REQUIRE(delta.keyFrame == 1);
+	REQUIRE(data.size() == frame.size());
+	REQUIRE(memcmp(data.data(), frame.data(), frame.size()) == 0);
+
+	// deltas until keyframe interval is reached
+	for (uint32_t n = 2; n <= 4; n++) {
+		touchPixel(frame, cx, 0, 0);
+		enc.update(frame.data(), n, n * 10, delta, data);
+		REQUIRE(delta.isDelta);
+		REQUIRE(delta.keyFrame == 1);
+	}
+	enc.update(frame.data(), 5, 50, delta, data);
+	REQUIRE_FALSE(delta.isDelta);
+	REQUIRE(delta.keyFrame == 5);
+
+	// keyframe forced by time interval
+	enc.update(frame.data(), 6, 60, delta, data);
+	REQUIRE(delta.isDelta);
+	enc.update(frame.data(), 7, 1050, delta, data);
+	REQUIRE_FALSE(delta.isDelta);
+
+	// keyframe when too many tiles changed
+	std::vector<unsigned char> other = makeYuyvFrame(cx, cy, 2);
+	enc.update(other.data(), 8, 1060, delta, data);
+	REQUIRE_FALSE(delta.isDelta);
+	REQUIRE(delta.keyFrame == 8);
+
+	REQUIRE(enc.getKeyframeCount() == 4);
+	REQUIRE(enc.getDeltaCount() == 4);
+}
+
+TEST_CASE("TestDeltaSnapshot_dirty_tiles",
+		  "[screencapture][DeltaSnapshot][DeltaEncoder]") {
+	// partial tiles at right and bottom edges
+	const int cx = 100;
+	const int cy = 40;
+	const int tileSize = 16;
+	DeltaEncoder enc(makeOpts(cx, cy, tileSize));
+	std::vector<unsigned char> frame = makeYuyvFrame(cx, cy, 3);
+	DeltaFrame delta;
+	std::vector<unsigned char> data;
+	enc.update(frame.data(), 1, 0, delta, data);
+	REQUIRE(delta.tilesX == 7);
+	REQUIRE(delta.tilesY == 3);
+
+	// unchanged frame produces empty delta
+	enc.update(frame.data(), 2, 10, delta, data);
+	REQUIRE(delta.isDelta);
+	REQUIRE(delta.nDirty == 0);
+	REQUIRE(data.empty());
+
+	// full tile (0,0) and edge tile (6,2) of 4x8 pixels
+	touchPixel(frame, cx, 5, 7);
+	touchPixel(frame, cx, 99, 39);
+	enc.update(frame.data(), 3, 20, delta, data);
+	REQUIRE(delta.isDelta);
+	REQUIRE(delta.nDirty == 2);
+	REQUIRE(delta.dirty[0] == 1);
+	REQUIRE(delta.dirty[2 * 7 + 6] == 1);
+	REQUIRE(data.size() == (16 * 16 + 4 * 8) * 2);
+
+	// first row of edge tile packed after full tile
+	REQUIRE(memcmp(data.data() + 16 * 16 * 2, frame.data() + (32 * cx + 96) * 2, 4 * 2) == 0);
+}
+
+TEST_CASE("TestDeltaSnapshot_apply_roundtrip",
+		  "[screencapture][DeltaSnapshot][applyDeltaPayload]") {
+	const int cx = 70;
+	const int cy = 36;
+	DeltaEncoder enc(makeOpts(cx, cy, 16));
+	std::vector<unsigned char> key = makeYuyvFrame(cx, cy, 4);
+	DeltaFrame delta;
+	std::vector<unsigned char> data;
+	enc.update(key.data(), 1, 0, delta, data);
+
+	std::vector<unsigned char> frame = key;
+	touchPixel(frame, cx, 17, 3);
+	touchPixel(frame, cx, 69, 35);
+	touchPixel(frame, cx, 40, 20);
+	enc.update(frame.data(), 2, 10, delta, data);
+	REQUIRE(delta.isDelta);
+	REQUIRE(delta.nDirty == 3);
+
+	std::vector<unsigned char> payload;
+	REQUIRE(encodeDeltaPayload(delta, data.data(), data.size(), payload));
+
+	// rebuilt frame matches full frame conversion exactly
+	cv::Mat bgr;
+	cv::cvtColor(cv::Mat(cy, cx, CV_8UC2, key.data()), bgr, cv::COLOR_YUV2BGR_YUYV);
+	REQUIRE(applyDeltaPayload(payload.data(), payload.size(), bgr));
+	cv::Mat expected;
+	cv::cvtColor(cv::Mat(cy, cx, CV_8UC2, frame.data()), expected, cv::COLOR_YUV2BGR_YUYV);
+	for (int y = 0; y < cy; y++) {
+		REQUIRE(memcmp(bgr.data + y * bgr.step, expected.data + y * expected.step,
+					   static_cast<size_t>(cx) * 3) == 0);
+	}
+
+	// truncated payload is rejected
+	REQUIRE_FALSE(applyDeltaPayload(payload.data(), 8, bgr));
+	REQUIRE_FALSE(applyDeltaPayload(payload.data(), payload.size() - 4, bgr));
+}
+
+TEST_CASE("TestDeltaSnapshot_findArchiveEntryAt",
+		  "[screencapture][DeltaSnapshot][findArchiveEntryAt]") {
+	std::vector<ArchiveEntry> entries(4);
+	entries[0].nFrame = 1;
+	entries[0].tsMs = 1000;
+	entries[0].name = "2024.05.01-13.45.10.000";
+	entries[1].nFrame = 1;
+	entries[1].tsMs = 1000;
+	entries[1].format = ARCHIVE_FORMAT_YUYV;
+	entries[1].name = "2024.05.01-13.45.10.000";
+	entries[2].nFrame = 2;
+	entries[2].tsMs = 2000;
+	entries[2].format = ARCHIVE_FORMAT_DELTA;
+	entries[2].name = "2024.05.01-13.45.11.000";
+	entries[3].nFrame = 3;
+	entries[3].tsMs = 3000;
+	entries[3].format = ARCHIVE_FORMAT_DELTA;
+	entries[3].name = "2024.05.01-13.45.12.000";
+
+	REQUIRE(findArchiveEntryAt(entries, "999") == nullptr);
+	REQUIRE(findArchiveEntryAt(entries, "1500") == &entries[0]);
+	REQUIRE(findArchiveEntryAt(entries, "2000") == &entries[2]);
+	REQUIRE(findArchiveEntryAt(entries, "99999") == &entries[3]);
+	REQUIRE(findArchiveEntryAt(entries, "2024.05.01-13.45.11.500") == &entries[2]);
+	REQUIRE(findArchiveEntryAt(entries, "2024.05.01-13.45.09") == nullptr);
+}
@@ -0,0 +1,57 @@
+#include <random>
+#include <vector>
+#include "FrameDiff.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+TEST_CASE("TestFrameDiff_calcFrameDiffScalar",
+		  "[screencapture][FrameDiff][calcFrameDiffScalar]") {
+	unsigned char f1[] = {0, 10, 255, 7};
+	unsigned char f2[] = {5, 10, 0, 9};
+	REQUIRE(calcFrameDiffScalar(f1, f2, 4) == 5 + 0 + 255 + 2);
+	REQUIRE(calcFrameDiffScalar(f1, f1, 4) == 0);
+	REQUIRE(calcFrameDiffScalar(f1, f2, 0) == 0);
+}
+
+TEST_CASE("TestFrameDiff_impls_bit_identical",
+		  "[screencapture][FrameDiff][calcFrameDiff]") {
+	std::vector<FrameDiffImpl> impls = getFrameDiffImpls();
+	REQUIRE(impls.size() >= 1);
+	REQUIRE(std::string(impls[0].name) == "scalar");
+	INFO("calcFrameDiff implementation: " << getFrameDiffImplName());
+
+	std::mt19937 rng(2024);
+	std::uniform_int_distribution<int> dist(0, 255);
+	// odd lengths to cover SIMD tails and unaligned data
+	for (size_t len : {size_t(0), size_t(1), size_t(15), size_t(33), size_t(127), size_t(1000), size_t(4097)}) {
+		std::vector<unsigned char> f1(len + 1), f2(len + 1);
+		for (size_t j = 0; j < len + 1; j++) {
+			f1[j] = static_cast<unsigned char>(dist(rng));
+			f2[j] = static_cast<unsigned char>(dist(rng));
+		}
+		int64_t expected = calcFrameDiffScalar(f1.data() + 1, f2.data() + 1, len);
+		for (const auto& impl : impls) {
+			INFO("impl=" << impl.name << ", len=" << len);
+			REQUIRE(impl.func(f1.data() + 1, f2.data() + 1, len) == expected);
+		}
+		REQUIRE(calcFrameDiff(f1.data() + 1, f2.data() + 1, len) == expected);
+	}
+}
+
+TEST_CASE("TestFrameDiff_no_overflow",
+		  "[screencapture][FrameDiff][calcFrameDiff]") {
+	// 4K YUYV frame with max difference exceeds 32-bit int range
+	const size_t len = 3840 * 2160 * 2;
+	std::vector<unsigned char> f1(len, 0), f2(len, 255);
+	int64_t expected = static_cast<int64_t>(len) * 255;
+	REQUIRE(expected > INT32_MAX);
+	REQUIRE(calcFrameDiff(f1.data(), f2.data(), len) == expected);
+	REQUIRE(calcFrameDiffScalar(f1.data(), f2.data(), len) == expected);
+}
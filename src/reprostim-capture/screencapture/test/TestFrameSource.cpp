@@ -0,0 +1,331 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include <lz4frame.h>
+#include "DeltaSnapshot.h"
+#include "FrameSource.h"
+#include "RecordingThread.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static FrameSourceOpts makeOpts(const std::string& type, int cx, int cy) {
+	FrameSourceOpts opts;
+	opts.type = type;
+	opts.cx = cx;
+	opts.cy = cy;
+	opts.nBuffers = 2;
+	opts.fps = 0;
+	return opts;
+}
+
+TEST_CASE("TestFrameSource_parseFrameSourceSpec",
+		  "[screencapture][FrameSource][parseFrameSourceSpec]") {
+	std::string type, path;
+	REQUIRE(parseFrameSourceSpec("v4l2", type, path));
+	REQUIRE(type == SC_SOURCE_V4L2);
+	REQUIRE(path.empty());
+	REQUIRE(parseFrameSourceSpec("synthetic", type, path));
+	REQUIRE(type == SC_SOURCE_SYNTHETIC);
+	REQUIRE(parseFrameSourceSpec("replay:/tmp/frames", type, path));
+	REQUIRE(type == SC_SOURCE_REPLAY);
+	REQUIRE(path == "/tmp/frames");
+	REQUIRE_FALSE(parseFrameSourceSpec("replay", type, path));
+	REQUIRE_FALSE(parseFrameSourceSpec("replay:", type, path));
+	REQUIRE_FALSE(parseFrameSourceSpec("camera", type, path));
+
+	REQUIRE(createFrameSource(makeOpts("camera", 4, 2)) == nullptr);
+}
+
+TEST_CASE("TestFrameSource_synthetic",
+		  "[screencapture][FrameSource][SyntheticFrameSource]") {
+	const int cx = 64;
+	const int cy = 32;
+	FrameSourceOpts opts = makeOpts(SC_SOURCE_SYNTHETIC, cx, cy);
+	opts.changeInterval = 3;
+	opts.nFrames = 7;
+	std::unique_ptr<FrameSource> pSource = createFrameSource(opts);
+	REQUIRE(pSource);
+	REQUIRE(pSource->start());
+	REQUIRE(pSource->getBufferCount() == 2);
+	REQUIRE(pSource->getFrameLen() == static_cast<size_t>(cx) * cy * 2);
+	REQUIRE(pSource->wait(-1, 10) == FRAME_OK);
+
+	std::vector<unsigned char> prev;
+	for (uint32_t n = 0; n < 7; n++) {
+		SourceFrame frame;
+		REQUIRE(pSource->dequeue(frame) == FRAME_OK);
+		REQUIRE(frame.sequence == n);
+		REQUIRE(frame.len == pSource->getFrameLen());
+		REQUIRE((frame.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC);
+		// scripted change every 3 frames, frames are the same in between
+		REQUIRE(frame.changed == (n == 3 || n == 6));
+		if( n > 0 ) {
+			REQUIRE((memcmp(prev.data(), frame.data, frame.len) != 0) == frame.changed);
+		}
+		prev.assign(frame.data, frame.data + frame.len);
+		REQUIRE(pSource->release(frame.index));
+	}
+	SourceFrame frame;
+	REQUIRE(pSource->dequeue(frame) == FRAME_EOF);
+	pSource->stop();
+}
+
+TEST_CASE("TestFrameSource_buffers",
+		  "[screencapture][FrameSource][SoftFrameSource]") {
+	std::unique_ptr<FrameSource> pSource = createFrameSource(makeOpts(SC_SOURCE_SYNTHETIC, 16, 8));
+	REQUIRE(pSource->start());
+
+	// all buffers are held by caller
+	SourceFrame f1, f2, f3;
+	REQUIRE(pSource->dequeue(f1) == FRAME_OK);
+	REQUIRE(pSource->dequeue(f2) == FRAME_OK);
+	REQUIRE(f1.index != f2.index);
+	REQUIRE(pSource->dequeue(f3) == FRAME_ERROR);
+
+	REQUIRE(pSource->release(f1.index));
+	REQUIRE(pSource->dequeue(f3) == FRAME_OK);
+	REQUIRE(f3.index == f1.index);
+	REQUIRE_FALSE(pSource->release(5));
+}
+
+TEST_CASE("TestFrameSource_paced",
+		  "[screencapture][FrameSource][SoftFrameSource]") {
+	FrameSourceOpts opts = makeOpts(SC_SOURCE_SYNTHETIC, 16, 8);
+	opts.fps = 10;
+	std::unique_ptr<FrameSource> pSource = createFrameSource(opts);
+	REQUIRE(pSource->start());
+	SourceFrame frame;
+	REQUIRE(pSource->dequeue(frame) == FRAME_OK);
+	REQUIRE(pSource->release(frame.index));
+
+	// next frame is due in 100 ms
+	REQUIRE(pSource->dequeue(frame) == FRAME_AGAIN);
+	REQUIRE(pSource->wait(-1, 10) == FRAME_TIMEOUT);
+	REQUIRE(pSource->wait(-1, 200) == FRAME_OK);
+	REQUIRE(pSource->dequeue(frame) == FRAME_OK);
+	REQUIRE(frame.sequence == 1);
+}
+
+TEST_CASE("TestFrameSource_replay",
+		  "[screencapture][FrameSource][ReplayFrameSource]") {
+	const int cx = 8;
+	const int cy = 4;
+	const size_t frameLen = static_cast<size_t>(cx) * cy * 2;
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() /
+			("reprostim-test-replay-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	// two frames in first file, incomplete frame skipped in second one
+	{
+		std::ofstream f(dir / "a.yuyv", std::ios::binary);
+		f << std::string(frameLen, 'a') << std::string(frameLen, 'b');
+	}
+	{
+		std::ofstream f(dir / "b.bin", std::ios::binary);
+		f << std::string(frameLen, 'c') << std::string(frameLen / 2, 'd');
+	}
+	{
+		std::ofstream f(dir / "c.txt", std::ios::binary);
+		f << std::string(frameLen, 'x');
+	}
+
+	FrameSourceOpts opts = makeOpts(SC_SOURCE_REPLAY, cx, cy);
+	opts.path = dir.string();
+	std::unique_ptr<FrameSource> pSource = createFrameSource(opts);
+	REQUIRE(pSource->start());
+	SourceFrame frame;
+	for (char c: std::string("abc")) {
+		REQUIRE(pSource->dequeue(frame) == FRAME_OK);
+		REQUIRE(frame.data[0] == c);
+		REQUIRE(frame.data[frameLen - 1] == c);
+		REQUIRE(pSource->release(frame.index));
+	}
+	REQUIRE(pSource->dequeue(frame) == FRAME_EOF);
+
+	// loop from the first file at the end
+	opts.loop = true;
+	pSource = createFrameSource(opts);
+	REQUIRE(pSource->start());
+	for (char c: std::string("abcab")) {
+		REQUIRE(pSource->dequeue(frame) == FRAME_OK);
+		REQUIRE(frame.data[0] == c);
+		REQUIRE(pSource->release(frame.index));
+	}
+
+	// missing path
+	opts.path = (dir / "missing").string();
+	pSource = createFrameSource(opts);
+	REQUIRE_FALSE(pSource->start());
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("TestFrameSource_recordScreens",
+		  "[screencapture][FrameSource][recordScreens]") {
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() /
+			("reprostim-test-record-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	FrameSourceOpts source = makeOpts(SC_SOURCE_SYNTHETIC, 0, 0);
+	source.changeInterval = 5;
+	source.nFrames = 20;
+	const std::string start_ts = "test";
+	const RecordingParams rp{
+			1, 64, 32, 0, "sad", 16, 0,
+			dir.string(), "", false, 0, 2, false,
+			1, 4, OVERFLOW_BLOCK,
+			SC_STORAGE_ARCHIVE, 0,
+			SnapshotCodecOpts{CODEC_LZ4, 0},
+			false, 0, 0, 0,
+			source, start_ts, nullptr, nullptr
+	};
+	RecordingStats stats;
+	REQUIRE(recordScreens(rp, []() { return false; }, -1, &stats) == 0);
+	REQUIRE(stats.nFrames == 20);
+	REQUIRE(stats.nDropped == 0);
+	REQUIRE(stats.nScriptedChanges == 3);
+	REQUIRE(stats.nDetectedChanges == 3);
+	REQUIRE(stats.nLatency == 3);
+	// first frame and changes
+	REQUIRE(stats.nSaved == 4);
+	REQUIRE(stats.latencyMaxUs >= 0);
+
+	std::filesystem::remove_all(dir);
+}
+
+static std::vector<unsigned char> lz4Decode(const std::vector<unsigned char>& data, size_t len) {
+	std::vector<unsigned char> out(len);
+	LZ4F_dctx* dctx = nullptr;
+	REQUIRE_FALSE(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)));
+	size_t dstSize = out.size();
+	size_t srcSize = data.size();
+	const size_t res = LZ4F_decompress(dctx, out.data(), &dstSize, data.data(), &srcSize, nullptr);
+	LZ4F_freeDecompressionContext(dctx);
+	REQUIRE(res == 0);
+	REQUIRE(dstSize == len);
+	return out;
+}
+
+TEST_CASE("TestFrameSource_recordScreens_zero_copy",
+		  "[screencapture][FrameSource][recordScreens]") {
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() /
+			("reprostim-test-record-zc-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	// buffers are overwritten once released, so comparing against or
+	// saving from requeued buffer shows up as wrong changes/snapshots
+	FrameSourceOpts source = makeOpts(SC_SOURCE_SYNTHETIC, 0, 0);
+	source.changeInterval = 5;
+	source.nFrames = 20;
+	source.scrubReleased = true;
+	const std::string start_ts = "test";
+	const RecordingParams rp{
+			1, 64, 32, 0, "sad", 16, 0,
+			dir.string(), "", false, 0, 2, true,
+			1, 4, OVERFLOW_BLOCK,
+			SC_STORAGE_ARCHIVE, 0,
+			SnapshotCodecOpts{CODEC_LZ4, 0},
+			false, 0, 0, 0,
+			source, start_ts, nullptr, nullptr
+	};
+	RecordingStats stats;
+	REQUIRE(recordScreens(rp, []() { return false; }, -1, &stats) == 0);
+	REQUIRE(stats.nFrames == 20);
+	REQUIRE(stats.nScriptedChanges == 3);
+	REQUIRE(stats.nDetectedChanges == 3);
+	// first frame and changes
+	REQUIRE(stats.nSaved == 4);
+
+	// the same frames from fresh source, by sequence
+	FrameSourceOpts opts = makeOpts(SC_SOURCE_SYNTHETIC, 64, 32);
+	opts.changeInterval = 5;
+	opts.nFrames = 20;
+	SyntheticFrameSource expected(opts);
+	REQUIRE(expected.start());
+	std::vector<std::vector<unsigned char>> frames;
+	SourceFrame frame;
+	while( expected.dequeue(frame) == FRAME_OK ) {
+		frames.emplace_back(frame.data, frame.data + frame.len);
+		REQUIRE(expected.release(frame.index));
+	}
+	REQUIRE(frames.size() == 20);
+
+	std::string archivePath;
+	for (const auto& entry: std::filesystem::directory_iterator(dir)) {
+		if( entry.path().extension() == SC_ARCHIVE_EXT ) {
+			archivePath = entry.path().string();
+		}
+	}
+	REQUIRE_FALSE(archivePath.empty());
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(archivePath));
+	REQUIRE(reader.getEntries().size() == 4);
+	for (const ArchiveEntry& entry: reader.getEntries()) {
+		REQUIRE(entry.sequence < frames.size());
+		ArchiveFrame f;
+		REQUIRE(reader.readFrame(entry, f));
+		REQUIRE(f.entry.format == ARCHIVE_FORMAT_YUYV_LZ4);
+		REQUIRE(lz4Decode(f.data, frames[entry.sequence].size()) == frames[entry.sequence]);
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("TestFrameSource_recordScreens_delta_overflow",
+		  "[screencapture][FrameSource][recordScreens][DeltaSnapshot]") {
+	const std::filesystem::path dir = std::filesystem::temp_directory_path() /
+			("reprostim-test-record-delta-" + std::to_string(getpid()));
+	std::filesystem::create_directories(dir);
+
+	// every frame is changed and encoding is slower than capture,
+	// so single slot queue overflows, drop policy must be ignored
+	FrameSourceOpts source = makeOpts(SC_SOURCE_SYNTHETIC, 0, 0);
+	source.changeInterval = 1;
+	source.nFrames = 40;
+	const std::string start_ts = "test";
+	const RecordingParams rp{
+			1, 320, 240, 0, "sad", 16, 0,
+			dir.string(), "", false, 0, 2, false,
+			1, 1, OVERFLOW_DROP_OLDEST,
+			SC_STORAGE_ARCHIVE, 0,
+			SnapshotCodecOpts{CODEC_QOI, 0},
+			true, 5, 0, 0,
+			source, start_ts, nullptr, nullptr
+	};
+	RecordingStats stats;
+	REQUIRE(recordScreens(rp, []() { return false; }, -1, &stats) == 0);
+	REQUIRE(stats.nFrames == 40);
+	REQUIRE(stats.nSaved > 10);
+
+	std::string archivePath;
+	for (const auto& entry: std::filesystem::directory_iterator(dir)) {
+		if( entry.path().extension() == SC_ARCHIVE_EXT ) {
+			archivePath = entry.path().string();
+		}
+	}
+	REQUIRE_FALSE(archivePath.empty());
+
+	// all queued snapshots are stored and every frame is rebuilt
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(archivePath));
+	REQUIRE(reader.getEntries().size() == stats.nSaved);
+	FrameReconstructor reconstructor(reader);
+	for (const ArchiveEntry& entry: reader.getEntries()) {
+		cv::Mat bgr;
+		REQUIRE(reconstructor.reconstruct(entry, bgr));
+		REQUIRE(bgr.cols == 320);
+		REQUIRE(bgr.rows == 240);
+	}
+
+	std::filesystem::remove_all(dir);
+}
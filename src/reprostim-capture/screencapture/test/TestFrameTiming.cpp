@@ -0,0 +1,95 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <linux/videodev2.h>
+#include "FrameTiming.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+TEST_CASE("TestFrameTiming_FrameClock",
+		  "[screencapture][FrameTiming][FrameClock]") {
+	FrameClock clock;
+	REQUIRE_FALSE(clock.hasOffset());
+	REQUIRE(clock.sync(1000000, 1700000000000000LL) == 0);
+	REQUIRE(clock.hasOffset());
+	REQUIRE(clock.toWallUs(1500000) == 1700000000500000LL);
+	REQUIRE(std::chrono::duration_cast<std::chrono::microseconds>(
+			clock.toTimestamp(1500000).time_since_epoch()).count() == 1700000000500000LL);
+
+	// wall clock stepped forward by 2.5 ms
+	REQUIRE(clock.sync(2000000, 1700000001002500LL) == 2500);
+	REQUIRE(clock.toWallUs(2000000) == 1700000001002500LL);
+
+	// measured offset matches current clocks
+	FrameClock sysClock;
+	sysClock.sync();
+	const int64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	const int64_t diff = sysClock.toWallUs(FrameClock::monotonicUs()) - wallUs;
+	REQUIRE(diff < 100000);
+	REQUIRE(diff > -100000);
+	// not re-measured before sync interval elapsed
+	REQUIRE(sysClock.sync() == 0);
+}
+
+TEST_CASE("TestFrameTiming_getFrameTiming",
+		  "[screencapture][FrameTiming][getFrameTiming]") {
+	FrameClock clock;
+	clock.sync(0, 1700000000000000LL);
+
+	FrameTiming t = getFrameTiming(clock, 7, 42, V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC, 12, 345678);
+	REQUIRE(t.nFrame == 7);
+	REQUIRE(t.sequence == 42);
+	REQUIRE(t.kernelTs);
+	REQUIRE(t.monoUs == 12345678);
+	REQUIRE(t.wallUs == 1700000012345678LL);
+
+	// unknown timestamp source, dequeue time is used
+	const int64_t before = FrameClock::monotonicUs();
+	t = getFrameTiming(clock, 8, 43, V4L2_BUF_FLAG_TIMESTAMP_UNKNOWN, 12, 345678);
+	REQUIRE_FALSE(t.kernelTs);
+	REQUIRE(t.monoUs >= before);
+	REQUIRE(t.wallUs == t.monoUs + 1700000000000000LL);
+}
+
+TEST_CASE("TestFrameTiming_FrameTimingIndex",
+		  "[screencapture][FrameTiming][FrameTimingIndex]") {
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "reprostim_test_frames.jsonl";
+	std::filesystem::remove(path);
+
+	FrameTiming t;
+	t.nFrame = 3;
+	t.sequence = 5;
+	t.monoUs = 1000;
+	t.wallUs = 1700000000000001LL;
+	const std::string json = frameTimingToJson(t, "2023.11.14-22.13.20.000");
+	REQUIRE(json.find("\"sequence\":5") != std::string::npos);
+	REQUIRE(json.find("\"mono_us\":1000") != std::string::npos);
+	REQUIRE(json.find("\"wall_us\":1700000000000001") != std::string::npos);
+	REQUIRE(json.find("\"name\":\"2023.11.14-22.13.20.000\"") != std::string::npos);
+
+	{
+		FrameTimingIndex index;
+		REQUIRE_FALSE(index.append(t, "a"));
+		REQUIRE(index.open(path.string()));
+		REQUIRE(index.append(t, "a"));
+		t.nFrame = 4;
+		REQUIRE(index.append(t, "b"));
+	}
+	std::ifstream f(path);
+	std::string line;
+	int nLines = 0;
+	while( std::getline(f, line) ) {
+		REQUIRE(line.front() == '{');
+		nLines++;
+	}
+	REQUIRE(nLines == 2);
+	std::filesystem::remove(path);
+}
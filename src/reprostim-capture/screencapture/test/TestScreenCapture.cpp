@@ -36,4 +36,24 @@ TEST_CASE("TestScreenCapture_constructor_destructor",
 
 	pApp = nullptr;
 	REQUIRE(pApp == nullptr);
-}
\ No newline at end of file
+}
+TEST_CASE("TestScreenCapture_FrameDropCounter",
+		  "[screencapture][FrameDropCounter]") {
+	FrameDropCounter fdc;
+	REQUIRE(fdc.update(10) == 0);
+	REQUIRE(fdc.update(11) == 0);
+	REQUIRE(fdc.dropped == 0);
+
+	// gap of 2 frames
+	REQUIRE(fdc.update(14) == 2);
+	REQUIRE(fdc.dropped == 2);
+
+	// sequence reset is not counted as drop
+	REQUIRE(fdc.update(0) == 0);
+	REQUIRE(fdc.dropped == 2);
+
+	// sequence wrap-around
+	fdc.update(0xFFFFFFFE);
+	REQUIRE(fdc.update(1) == 2);
+	REQUIRE(fdc.dropped == 4);
+}
@@ -0,0 +1,243 @@
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "FrameTiming.h"
+#include "SnapshotArchive.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static ArchiveFrame makeFrame(uint32_t nFrame, size_t len) {
+	ArchiveFrame f;
+	f.entry.nFrame = nFrame;
+	f.entry.format = nFrame % 2 ? ARCHIVE_FORMAT_YUYV : ARCHIVE_FORMAT_PNG;
+	f.entry.tsMs = 1700000000000LL + nFrame * 40;
+	f.entry.difference = nFrame * 1000;
+	f.entry.nChangedTiles = 2;
+	f.entry.sequence = nFrame + 100;
+	f.entry.monoUs = 5000000LL + nFrame * 40000;
+	f.entry.wallUs = f.entry.tsMs * 1000 + 123;
+	f.entry.name = "frame" + std::to_string(nFrame);
+	f.cx = 64;
+	f.cy = 32;
+	f.tilesX = 4;
+	f.tilesY = 3;
+	f.tiles.assign(12, 0);
+	f.tiles[1] = 1;
+	f.tiles[nFrame % 12] = 1;
+	f.data.resize(len);
+	for (size_t i = 0; i < len; i++) {
+		f.data[i] = static_cast<unsigned char>(i * 7 + nFrame);
+	}
+	return f;
+}
+
+static std::string tempArchivePath(const std::string& name) {
+	return (std::filesystem::temp_directory_path() / ("reprostim_test_" + name + SC_ARCHIVE_EXT)).string();
+}
+
+// overwrite bytes in archive file, e.g. to corrupt record length
+static void patchArchive(const std::string& path, uint64_t offset, const unsigned char* p, size_t len) {
+	std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+	f.seekp(static_cast<std::streamoff>(offset));
+	f.write(reinterpret_cast<const char*>(p), static_cast<std::streamsize>(len));
+}
+
+static uint64_t readArchiveU64(const std::string& path, uint64_t offset) {
+	std::ifstream f(path, std::ios::binary);
+	unsigned char b[8] = {0};
+	f.seekg(static_cast<std::streamoff>(offset));
+	f.read(reinterpret_cast<char*>(b), sizeof(b));
+	uint64_t v = 0;
+	for (int i = 7; i >= 0; i--) {
+		v = (v << 8) | b[i];
+	}
+	return v;
+}
+
+static void writeTestArchive(const std::string& path, uint32_t nFrames) {
+	SnapshotArchive archive;
+	REQUIRE(archive.open(path, 64, 32));
+	for (uint32_t i = 0; i < nFrames; i++) {
+		ArchiveFrame f = makeFrame(i, 100 + i);
+		REQUIRE(archive.append(f));
+	}
+	REQUIRE(archive.close());
+}
+
+static void checkFrames(SnapshotArchiveReader& reader, uint32_t nFrames) {
+	REQUIRE(reader.getCx() == 64);
+	REQUIRE(reader.getCy() == 32);
+	REQUIRE(reader.getEntries().size() == nFrames);
+	ArchiveFrame f;
+	for (uint32_t i = 0; i < nFrames; i++) {
+		const ArchiveEntry& e = reader.getEntries()[i];
+		ArchiveFrame expected = makeFrame(i, 100 + i);
+		REQUIRE(e.nFrame == i);
+		REQUIRE(e.name == expected.entry.name);
+		REQUIRE(e.tsMs == expected.entry.tsMs);
+		REQUIRE(e.difference == expected.entry.difference);
+		REQUIRE(e.sequence == expected.entry.sequence);
+		REQUIRE(e.monoUs == expected.entry.monoUs);
+		REQUIRE(e.wallUs == expected.entry.wallUs);
+		REQUIRE(reader.readFrame(e, f));
+		REQUIRE(f.entry.format == expected.entry.format);
+		REQUIRE(f.tilesX == 4);
+		REQUIRE(f.tilesY == 3);
+		REQUIRE(f.tiles == expected.tiles);
+		REQUIRE(f.data == expected.data);
+	}
+}
+
+TEST_CASE("TestSnapshotArchive_roundtrip",
+		  "[screencapture][SnapshotArchive]") {
+	const std::string path = tempArchivePath("roundtrip");
+	const uint32_t nFrames = 25;
+	{
+		SnapshotArchive archive;
+		REQUIRE(archive.open(path, 64, 32, 10));
+		for (uint32_t i = 0; i < nFrames; i++) {
+			ArchiveFrame f = makeFrame(i, 100 + i);
+			REQUIRE(archive.append(f));
+			REQUIRE(f.entry.offset > 0);
+		}
+		REQUIRE(archive.close());
+		REQUIRE(archive.getFrameCount() == nFrames);
+	}
+
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.isComplete());
+	checkFrames(reader, nFrames);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TestSnapshotArchive_recover_truncated",
+		  "[screencapture][SnapshotArchive]") {
+	const std::string path = tempArchivePath("truncated");
+	uint64_t validSize = 0;
+	{
+		SnapshotArchive archive;
+		REQUIRE(archive.open(path, 64, 32, 4));
+		for (uint32_t i = 0; i < 10; i++) {
+			ArchiveFrame f = makeFrame(i, 100 + i);
+			REQUIRE(archive.append(f));
+		}
+		validSize = std::filesystem::file_size(path);
+		ArchiveFrame f = makeFrame(10, 110);
+		REQUIRE(archive.append(f));
+		REQUIRE(archive.close());
+	}
+	// simulate crash in the middle of the last frame, no trailer
+	std::filesystem::resize_file(path, validSize + 50);
+
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE_FALSE(reader.isComplete());
+	checkFrames(reader, 10);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TestSnapshotArchive_corrupted_meta_length",
+		  "[screencapture][SnapshotArchive]") {
+	const std::string path = tempArchivePath("corrupted");
+	writeTestArchive(path, 3);
+
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.getEntries().size() == 3);
+	const ArchiveEntry e = reader.getEntries()[1];
+	// metadata length of the second FRME record far beyond file size
+	const unsigned char metaLen[4] = {0xF0, 0xFF, 0xFF, 0xFF};
+	patchArchive(path, e.offset + 4, metaLen, sizeof(metaLen));
+
+	SnapshotArchiveReader reader2;
+	REQUIRE(reader2.open(path));
+	ArchiveFrame frame;
+	REQUIRE_FALSE(reader2.readFrame(e, frame));
+	REQUIRE(reader2.readFrame(reader2.getEntries()[2], frame));
+	REQUIRE(frame.entry.nFrame == 2);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TestSnapshotArchive_corrupted_payload_length",
+		  "[screencapture][SnapshotArchive]") {
+	const std::string path = tempArchivePath("corrupted_payload");
+	writeTestArchive(path, 3);
+
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE(reader.getEntries().size() == 3);
+	const ArchiveEntry e = reader.getEntries()[1];
+	// payload size ends FRME metadata, offset + size wraps around 2^64
+	const uint64_t metaLen = readArchiveU64(path, e.offset + 4) & 0xFFFFFFFF;
+	const unsigned char payloadSize[8] = {0xF0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	patchArchive(path, e.offset + 8 + metaLen, payloadSize, sizeof(payloadSize));
+
+	SnapshotArchiveReader reader2;
+	REQUIRE(reader2.open(path));
+	ArchiveFrame frame;
+	REQUIRE_FALSE(reader2.readFrame(e, frame));
+	REQUIRE(reader2.readFrame(reader2.getEntries()[0], frame));
+	REQUIRE(frame.entry.nFrame == 0);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TestSnapshotArchive_corrupted_index_length",
+		  "[screencapture][SnapshotArchive]") {
+	const std::string path = tempArchivePath("corrupted_index");
+	writeTestArchive(path, 3);
+
+	// last INDX offset is stored in trailer after its tag
+	const uint64_t fileSize = std::filesystem::file_size(path);
+	const uint64_t indexOffset = readArchiveU64(path, fileSize - 32 + 8);
+	REQUIRE(indexOffset > 0);
+	REQUIRE(indexOffset < fileSize);
+	// body length of INDX record, offset + length wraps around 2^64
+	const unsigned char bodyLen[8] = {0xF0, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	patchArchive(path, indexOffset + 16, bodyLen, sizeof(bodyLen));
+
+	// index is rejected and frames are recovered by scan
+	SnapshotArchiveReader reader;
+	REQUIRE(reader.open(path));
+	REQUIRE_FALSE(reader.isComplete());
+	checkFrames(reader, 3);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("TestSnapshotArchive_extract",
+		  "[screencapture][SnapshotArchive][extractSnapshotArchive]") {
+	const std::string path = tempArchivePath("extract");
+	const std::filesystem::path outDir = std::filesystem::temp_directory_path() / "reprostim_test_extract";
+	std::filesystem::remove_all(outDir);
+	{
+		SnapshotArchive archive;
+		REQUIRE(archive.open(path, 64, 32));
+		for (uint32_t i = 0; i < 3; i++) {
+			ArchiveFrame f = makeFrame(i, 100 + i);
+			REQUIRE(archive.append(f));
+		}
+	}
+	REQUIRE(extractSnapshotArchive(path, outDir.string()) == 3);
+	REQUIRE(std::filesystem::file_size(outDir / "frame0.png") == 100);
+	REQUIRE(std::filesystem::file_size(outDir / "frame1.bin") == 101);
+	REQUIRE(std::filesystem::file_size(outDir / "frame2.png") == 102);
+	// timing index has no entry for raw dump
+	std::ifstream index(outDir / SC_FRAME_INDEX_FILE);
+	std::string line;
+	int nLines = 0;
+	while( std::getline(index, line) ) {
+		REQUIRE(line.find("\"sequence\":" + std::to_string(100 + nLines * 2)) != std::string::npos);
+		nLines++;
+	}
+	REQUIRE(nLines == 2);
+	REQUIRE(extractSnapshotArchive(path + ".missing", outDir.string()) == -1);
+	std::filesystem::remove_all(outDir);
+	std::filesystem::remove(path);
+}
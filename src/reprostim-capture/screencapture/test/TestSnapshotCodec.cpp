@@ -0,0 +1,95 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include <lz4frame.h>
+#include "SnapshotCodec.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+TEST_CASE("TestSnapshotCodec_parseSnapshotCodec",
+		  "[screencapture][SnapshotCodec][parseSnapshotCodec]") {
+	REQUIRE(parseSnapshotCodec("png") == CODEC_PNG);
+	REQUIRE(parseSnapshotCodec("qoi") == CODEC_QOI);
+	REQUIRE(parseSnapshotCodec("lz4") == CODEC_LZ4);
+	REQUIRE_THROWS(parseSnapshotCodec("jpeg"));
+	REQUIRE(std::string(getSnapshotCodecName(CODEC_QOI)) == "qoi");
+	REQUIRE(std::string(getSnapshotCodecExt(CODEC_LZ4)) == ".yuyv.lz4");
+}
+
+TEST_CASE("TestSnapshotCodec_qoi_roundtrip",
+		  "[screencapture][SnapshotCodec][encodeQoi]") {
+	const int cx = 97;
+	const int cy = 31;
+	std::vector<unsigned char> bgr(cx * cy * 3);
+	std::mt19937 rng(7);
+	for (int y = 0; y < cy; y++) {
+		for (int x = 0; x < cx; x++) {
+			unsigned char* p = &bgr[(y * cx + x) * 3];
+			if( y < 10 ) {
+				// flat area, runs and index hits
+				p[0] = 200; p[1] = x < 50 ? 200 : 10; p[2] = 30;
+			} else if( y < 20 ) {
+				// small and medium deltas
+				p[0] = static_cast<unsigned char>(x + y);
+				p[1] = static_cast<unsigned char>(x * 3);
+				p[2] = static_cast<unsigned char>(x * 3 + (x & 3));
+			} else {
+				// random pixels
+				p[0] = rng(); p[1] = rng(); p[2] = rng();
+			}
+		}
+	}
+
+	std::vector<unsigned char> encoded;
+	encodeQoi(bgr.data(), cx, cy, cx * 3, encoded);
+	REQUIRE(encoded.size() > 22);
+	REQUIRE(memcmp(encoded.data(), "qoif", 4) == 0);
+	REQUIRE(encoded.back() == 1);
+
+	std::vector<unsigned char> decoded;
+	int cx2 = 0, cy2 = 0;
+	REQUIRE(decodeQoi(encoded.data(), encoded.size(), decoded, cx2, cy2));
+	REQUIRE(cx2 == cx);
+	REQUIRE(cy2 == cy);
+	REQUIRE(decoded == bgr);
+
+	// flat image compresses to runs
+	std::vector<unsigned char> flat(640 * 480 * 3, 128);
+	encodeQoi(flat.data(), 640, 480, 640 * 3, encoded);
+	REQUIRE(encoded.size() < flat.size() / 50);
+
+	// truncated data is rejected
+	encodeQoi(bgr.data(), cx, cy, cx * 3, encoded);
+	REQUIRE_FALSE(decodeQoi(encoded.data(), encoded.size() / 2, decoded, cx2, cy2));
+}
+
+TEST_CASE("TestSnapshotCodec_lz4_roundtrip",
+		  "[screencapture][SnapshotCodec][encodeSnapshot]") {
+	const int cx = 320;
+	const int cy = 240;
+	std::vector<unsigned char> yuyv(cx * cy * 2);
+	for (size_t i = 0; i < yuyv.size(); i++) {
+		yuyv[i] = static_cast<unsigned char>((i / 64) & 0xFF);
+	}
+	std::vector<unsigned char> encoded;
+	REQUIRE(encodeSnapshot(SnapshotCodecOpts{CODEC_LZ4, 0}, yuyv.data(), cx, cy, encoded));
+	REQUIRE(encoded.size() < yuyv.size());
+
+	LZ4F_dctx* dctx = nullptr;
+	REQUIRE_FALSE(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)));
+	std::vector<unsigned char> decoded(yuyv.size());
+	size_t dstSize = decoded.size();
+	size_t srcSize = encoded.size();
+	const size_t res = LZ4F_decompress(dctx, decoded.data(), &dstSize, encoded.data(), &srcSize, nullptr);
+	LZ4F_freeDecompressionContext(dctx);
+	REQUIRE(res == 0);
+	REQUIRE(dstSize == yuyv.size());
+	REQUIRE(decoded == yuyv);
+}
@@ -0,0 +1,177 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SnapshotWriter.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// Writer which records frame numbers instead of saving files,
+// optionally waits for gate to be opened
+class TestWriter: public SnapshotWriter {
+public:
+	std::atomic<bool> gateOpen{true};
+	std::mutex        mutex;
+	std::vector<int>  frames;
+
+	explicit TestWriter(const SnapshotWriterOpts& opts): SnapshotWriter(opts) {}
+	~TestWriter() override { gateOpen = true; stop(); }
+
+protected:
+	bool write(const Snapshot& s) override {
+		while( !gateOpen ) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		frames.push_back(s.nFrame);
+		return s.nFrame >= 0;
+	}
+};
+
+static Snapshot makeSnapshot(SnapshotWriter& w, int nFrame) {
+	Snapshot s;
+	s.nFrame = nFrame;
+	s.data = w.acquireBuffer(16);
+	return s;
+}
+
+TEST_CASE("TestSnapshotWriter_parseSnapshotOverflow",
+		  "[screencapture][SnapshotWriter][parseSnapshotOverflow]") {
+	REQUIRE(parseSnapshotOverflow("drop_oldest") == OVERFLOW_DROP_OLDEST);
+	REQUIRE(parseSnapshotOverflow("drop_newest") == OVERFLOW_DROP_NEWEST);
+	REQUIRE(parseSnapshotOverflow("block") == OVERFLOW_BLOCK);
+	REQUIRE_THROWS(parseSnapshotOverflow("unknown"));
+}
+
+TEST_CASE("TestSnapshotWriter_sync",
+		  "[screencapture][SnapshotWriter]") {
+	SnapshotWriterOpts opts;
+	opts.nThreads = 0;
+	TestWriter w(opts);
+	w.start();
+	REQUIRE(w.push(makeSnapshot(w, 1)));
+	REQUIRE(w.push(makeSnapshot(w, -1)));
+	w.stop();
+	SnapshotWriterStats stats = w.getStats();
+	REQUIRE(stats.pushed == 2);
+	REQUIRE(stats.written == 1);
+	REQUIRE(stats.failed == 1);
+	REQUIRE(w.frames == std::vector<int>{1, -1});
+}
+
+TEST_CASE("TestSnapshotWriter_drain_on_stop",
+		  "[screencapture][SnapshotWriter]") {
+	SnapshotWriterOpts opts;
+	opts.nThreads = 3;
+	opts.queueSize = 100;
+	TestWriter w(opts);
+	w.start();
+	for (int i = 0; i < 50; i++) {
+		REQUIRE(w.push(makeSnapshot(w, i)));
+	}
+	w.stop();
+	SnapshotWriterStats stats = w.getStats();
+	REQUIRE(stats.written == 50);
+	REQUIRE(stats.dropped == 0);
+	REQUIRE(stats.depth == 0);
+	REQUIRE(w.frames.size() == 50);
+}
+
+TEST_CASE("TestSnapshotWriter_stop_timeout",
+		  "[screencapture][SnapshotWriter]") {
+	SnapshotWriterOpts opts;
+	opts.nThreads = 1;
+	opts.queueSize = 100;
+	TestWriter w(opts);
+	w.gateOpen = false;
+	w.start();
+	for (int i = 0; i < 10; i++) {
+		REQUIRE(w.push(makeSnapshot(w, i)));
+	}
+	// the first snapshot is being written till gate is opened
+	std::thread th([&w]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		w.gateOpen = true;
+	});
+	const auto ts = std::chrono::steady_clock::now();
+	w.stop(50);
+	const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - ts).count();
+	th.join();
+	// waits for snapshot in progress only
+	REQUIRE(ms < 1000);
+	SnapshotWriterStats stats = w.getStats();
+	REQUIRE(stats.pushed == 10);
+	REQUIRE(stats.written == 1);
+	REQUIRE(stats.dropped == 9);
+	REQUIRE(stats.depth == 0);
+	REQUIRE(w.frames == std::vector<int>{0});
+}
+
+TEST_CASE("TestSnapshotWriter_overflow",
+		  "[screencapture][SnapshotWriter]") {
+	SnapshotWriterOpts opts;
+	opts.nThreads = 1;
+	opts.queueSize = 2;
+
+	SECTION("drop_oldest") {
+		opts.overflow = OVERFLOW_DROP_OLDEST;
+		TestWriter w(opts);
+		w.gateOpen = false;
+		w.start();
+		REQUIRE(w.push(makeSnapshot(w, 0)));
+		// wait till worker takes first snapshot and blocks on gate
+		while( w.getStats().depth > 0 ) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		for (int i = 1; i <= 4; i++) {
+			REQUIRE(w.push(makeSnapshot(w, i)));
+		}
+		w.gateOpen = true;
+		w.stop();
+		SnapshotWriterStats stats = w.getStats();
+		REQUIRE(stats.dropped == 2);
+		REQUIRE(stats.maxDepth == 2);
+		REQUIRE(w.frames == std::vector<int>{0, 3, 4});
+	}
+
+	SECTION("drop_newest") {
+		opts.overflow = OVERFLOW_DROP_NEWEST;
+		TestWriter w(opts);
+		w.gateOpen = false;
+		w.start();
+		REQUIRE(w.push(makeSnapshot(w, 0)));
+		while( w.getStats().depth > 0 ) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		REQUIRE(w.push(makeSnapshot(w, 1)));
+		REQUIRE(w.push(makeSnapshot(w, 2)));
+		REQUIRE_FALSE(w.push(makeSnapshot(w, 3)));
+		w.gateOpen = true;
+		w.stop();
+		REQUIRE(w.getStats().dropped == 1);
+		REQUIRE(w.frames == std::vector<int>{0, 1, 2});
+	}
+
+	SECTION("block") {
+		opts.overflow = OVERFLOW_BLOCK;
+		TestWriter w(opts);
+		w.start();
+		for (int i = 0; i < 20; i++) {
+			REQUIRE(w.push(makeSnapshot(w, i)));
+		}
+		w.stop();
+		SnapshotWriterStats stats = w.getStats();
+		REQUIRE(stats.dropped == 0);
+		REQUIRE(stats.written == 20);
+		REQUIRE(stats.maxDepth <= 2);
+	}
+}
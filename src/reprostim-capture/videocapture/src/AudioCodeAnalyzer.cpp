@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include "AudioCodeAnalyzer.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// level blocks, 5 ms
+static const int BLOCKS_PER_SEC = 200;
+
+// burst ends after this many quiet blocks
+static const int BURST_END_BLOCKS = 4;
+
+// first and last sample of tone in burst, above half of its amplitude
+static bool findTone(const float* x, size_t n, double amplitude, size_t& begin, size_t& end) {
+	const float threshold = static_cast<float>(amplitude / 2);
+	size_t i = 0;
+	while( i < n && std::fabs(x[i]) < threshold ) {
+		i++;
+	}
+	size_t j = n;
+	while( j > i && std::fabs(x[j - 1]) < threshold ) {
+		j--;
+	}
+	if( i >= j ) {
+		return false;
+	}
+	begin = i;
+	end = j;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+nlohmann::json audioCodeToJson(const AudioCode& code, const Timestamp& ts) {
+	nlohmann::json jm = {
+			{"codec", code.codec},
+			{"isotime", getTimeIsoStr(ts)},
+			{"duration", code.durationSec},
+			{"amplitude", code.amplitude}
+	};
+	if( code.codec == VC_AUDIOCODE_FSK ) {
+		std::ostringstream ss;
+		for (uint8_t b: code.data) {
+			ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(b);
+		}
+		jm["data"] = ss.str();
+	} else {
+		jm["freq"] = code.freq;
+	}
+	jm["value"] = code.fValue ? nlohmann::json(code.value) : nlohmann::json(nullptr);
+	return jm;
+}
+
+uint8_t getCrc8(const uint8_t* data, size_t n) {
+	uint8_t crc = 0;
+	for (size_t i = 0; i < n; i++) {
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++) {
+			crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+		}
+	}
+	return crc;
+}
+
+double getToneAmplitude(const float* x, size_t n, double freq, int sampleRate) {
+	if( n == 0 || sampleRate <= 0 ) {
+		return 0;
+	}
+	const double coeff = 2 * std::cos(2 * M_PI * freq / sampleRate);
+	double s1 = 0, s2 = 0;
+	for (size_t i = 0; i < n; i++) {
+		const double s0 = x[i] + coeff * s1 - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+	const double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+	return 2 * std::sqrt(std::max(power, 0.0)) / static_cast<double>(n);
+}
+
+////////////////////////////////////////////////////////////////////////
+// AudioCodeDecoder
+
+AudioCodeDecoder::AudioCodeDecoder(const AudioCodeOpts& opts, int sampleRate):
+		m_opts(opts), m_sampleRate(sampleRate),
+		m_blockSize(std::max(sampleRate / BLOCKS_PER_SEC, 1)),
+		m_maxBurst(static_cast<size_t>(sampleRate) * VC_AUDIOCODE_MAX_BURST_MS / 1000) {
+	m_sample = 0;
+	m_burstStart = 0;
+	m_burstRms = 0;
+	m_quietBlocks = 0;
+	m_fBurst = false;
+	m_fOverflow = false;
+	m_bursts = 0;
+	m_block.reserve(m_blockSize);
+}
+
+bool AudioCodeDecoder::decodeFsk(const float* x, size_t n, AudioCode& code) const {
+	const double amplitude = m_burstRms * M_SQRT2;
+	const double bitLen = m_sampleRate * m_opts.bitMs / 1000.0;
+	size_t begin, end;
+	if( bitLen < 8 || !findTone(x, n, amplitude, begin, end) ) {
+		return false;
+	}
+	const long nBits = std::lround(static_cast<double>(end - begin) / bitLen);
+	if( nBits < 16 ) {
+		return false;
+	}
+	// bits are classified in the middle, so burst edges and bit
+	// length rounding in generator don't matter
+	std::vector<uint8_t> bytes(nBits / 8, 0);
+	const size_t len = static_cast<size_t>(bitLen * 0.6);
+	for (size_t i = 0; i < bytes.size() * 8; i++) {
+		const size_t from = begin + static_cast<size_t>((static_cast<double>(i) + 0.2) * bitLen);
+		if( from + len > n ) {
+			return false;
+		}
+		const double a0 = getToneAmplitude(x + from, len, m_opts.f0, m_sampleRate);
+		const double a1 = getToneAmplitude(x + from, len, m_opts.f1, m_sampleRate);
+		if( a1 > a0 ) {
+			bytes[i / 8] |= static_cast<uint8_t>(0x80 >> (i % 8));
+		}
+	}
+	// [crc8, length, value..., parity...]
+	const size_t size = bytes[1];
+	const long expected = static_cast<long>(2 + size + VC_AUDIOCODE_ECC_BYTES) * 8;
+	if( std::labs(nBits - expected) > 2 || bytes.size() < 2 + size ||
+		getCrc8(bytes.data() + 2, size) != bytes[0] ) {
+		return false;
+	}
+	code.data.assign(bytes.begin() + 2, bytes.begin() + 2 + static_cast<ptrdiff_t>(size));
+	if( size == 2 || size == 4 || size == 8 ) {
+		code.fValue = true;
+		code.value = 0;
+		for (uint8_t b: code.data) {
+			code.value = (code.value << 8) | b;
+		}
+	}
+	code.sampleStart = begin;
+	code.durationSec = static_cast<double>(end - begin) / m_sampleRate;
+	code.amplitude = amplitude;
+	return true;
+}
+
+bool AudioCodeDecoder::decodeNfe(const float* x, size_t n, AudioCode& code) const {
+	const double amplitude = m_burstRms * M_SQRT2;
+	size_t begin, end;
+	if( m_opts.nfeDf <= 0 || !findTone(x, n, amplitude, begin, end) ) {
+		return false;
+	}
+	const double toneLen = static_cast<double>(end - begin);
+	const double expectedLen = static_cast<double>(m_sampleRate) * m_opts.nfeMs / 1000.0;
+	if( toneLen < expectedLen / 2 || toneLen > expectedLen * 3 / 2 ) {
+		return false;
+	}
+	// the strongest frequency step in the middle of tone
+	const float* p = x + begin + static_cast<size_t>(toneLen / 10);
+	const size_t len = static_cast<size_t>(toneLen * 8 / 10);
+	const int count = (m_opts.f1 - m_opts.f0) / m_opts.nfeDf + 1;
+	int best = -1;
+	double bestAmplitude = 0;
+	for (int k = 0; k < count; k++) {
+		const int freq = m_opts.f0 + k * m_opts.nfeDf;
+		if( freq * 2 >= m_sampleRate ) {
+			break;
+		}
+		const double a = getToneAmplitude(p, len, freq, m_sampleRate);
+		if( a > bestAmplitude ) {
+			best = k;
+			bestAmplitude = a;
+		}
+	}
+	// not a single tone
+	if( best < 0 || bestAmplitude < amplitude / 2 ) {
+		return false;
+	}
+	code.fValue = true;
+	code.value = static_cast<uint64_t>(best);
+	code.freq = m_opts.f0 + best * m_opts.nfeDf;
+	code.sampleStart = begin;
+	code.durationSec = toneLen / m_sampleRate;
+	code.amplitude = amplitude;
+	return true;
+}
+
+void AudioCodeDecoder::endBurst(std::vector<AudioCode>& codes) {
+	m_fBurst = false;
+	m_bursts++;
+	AudioCode code;
+	code.codec = m_opts.codec;
+	const bool fDecoded = !m_fOverflow && (m_opts.codec == VC_AUDIOCODE_NFE ?
+										   decodeNfe(m_burst.data(), m_burst.size(), code) :
+										   decodeFsk(m_burst.data(), m_burst.size(), code));
+	if( fDecoded ) {
+		code.sampleStart += m_burstStart;
+		codes.push_back(std::move(code));
+	}
+	m_burst.clear();
+}
+
+void AudioCodeDecoder::flush(std::vector<AudioCode>& codes) {
+	if( m_fBurst ) {
+		m_burst.insert(m_burst.end(), m_block.begin(), m_block.end());
+		endBurst(codes);
+	}
+	m_sample += m_block.size();
+	m_block.clear();
+	m_prevBlock.clear();
+}
+
+void AudioCodeDecoder::push(const float* x, size_t n, std::vector<AudioCode>& codes) {
+	while( n > 0 ) {
+		const size_t k = std::min(n, m_blockSize - m_block.size());
+		m_block.insert(m_block.end(), x, x + k);
+		x += k;
+		n -= k;
+		if( m_block.size() == m_blockSize ) {
+			pushBlock(codes);
+		}
+	}
+}
+
+void AudioCodeDecoder::pushBlock(std::vector<AudioCode>& codes) {
+	double sum = 0;
+	for (float v: m_block) {
+		sum += static_cast<double>(v) * v;
+	}
+	const double rms = std::sqrt(sum / static_cast<double>(m_block.size()));
+	const bool fLoud = rms >= m_opts.level;
+	if( !m_fBurst && fLoud ) {
+		// previous block holds tone onset
+		m_fBurst = true;
+		m_fOverflow = false;
+		m_burst = m_prevBlock;
+		m_burstStart = m_sample - m_prevBlock.size();
+		m_burstRms = 0;
+		m_quietBlocks = 0;
+	}
+	if( m_fBurst ) {
+		if( !m_fOverflow ) {
+			m_burst.insert(m_burst.end(), m_block.begin(), m_block.end());
+			if( m_burst.size() > m_maxBurst ) {
+				m_fOverflow = true;
+				m_burst.clear();
+			}
+		}
+		if( fLoud ) {
+			m_quietBlocks = 0;
+			m_burstRms = std::max(m_burstRms, rms);
+		} else if( ++m_quietBlocks >= BURST_END_BLOCKS ) {
+			endBurst(codes);
+		}
+	}
+	if( !m_fBurst ) {
+		m_prevBlock.swap(m_block);
+	}
+	m_sample += m_blockSize;
+	m_block.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+// AudioTapClock
+
+AudioTapClock::AudioTapClock(int sampleRate): m_sampleRate(sampleRate) {
+}
+
+void AudioTapClock::add(const AudioTapAnchor& anchor) {
+	m_anchors.push_back(anchor);
+	if( m_anchors.size() > VC_AUDIOCODE_MAX_ANCHORS ) {
+		m_anchors.pop_front();
+	}
+}
+
+int64_t AudioTapClock::getUs(uint64_t sample) {
+	while( m_anchors.size() > 1 && m_anchors[1].sample <= sample ) {
+		m_anchors.pop_front();
+	}
+	if( m_anchors.empty() || m_sampleRate <= 0 ) {
+		return 0;
+	}
+	const AudioTapAnchor& anchor = m_anchors.front();
+	const int64_t offset = static_cast<int64_t>(sample) - static_cast<int64_t>(anchor.sample);
+	return anchor.captureUs + offset * 1000000 / m_sampleRate;
+}
+
+////////////////////////////////////////////////////////////////////////
+// AudioCodeAnalyzer
+
+AudioCodeAnalyzer::AudioCodeAnalyzer(const AudioCodeOpts& opts, const SessionLogger_ptr& pLogger,
+									 const AudioCodeCallback& callback):
+		m_opts(opts), m_pLogger(pLogger), m_callback(callback) {
+	m_pRecorder = nullptr;
+	m_fStop = false;
+	m_analyzed = 0;
+	m_bursts = 0;
+	m_decoded = 0;
+}
+
+AudioCodeAnalyzer::~AudioCodeAnalyzer() {
+	stop();
+}
+
+uint64_t AudioCodeAnalyzer::getDropped() const {
+	return m_pTap ? m_pTap->dropped.load() : 0;
+}
+
+void AudioCodeAnalyzer::run() {
+	_SESSION_LOG_BEGIN(m_pLogger);
+	_VERBOSE("AudioCodeAnalyzer start: " << m_opts.codec);
+	std::shared_ptr<AudioTap> pTap = m_pTap;
+	std::vector<float> samples(pTap->samples.getCapacity() / 8);
+	std::vector<AudioTapAnchor> anchors(64);
+	std::unique_ptr<AudioCodeDecoder> pDecoder;
+	std::unique_ptr<AudioTapClock> pClock;
+	std::vector<AudioCode> codes;
+	auto report = [&]() {
+		m_bursts = pDecoder->getBursts();
+		for (const AudioCode& code: codes) {
+			m_decoded++;
+			m_callback(code, toCaptureTimestamp(pClock->getUs(code.sampleStart)));
+		}
+		codes.clear();
+	};
+	while( true ) {
+		// samples pushed before stop are decoded as well
+		const bool fStop = m_fStop;
+		size_t nAnchors;
+		while( (nAnchors = pTap->anchors.pop(anchors.data(), anchors.size())) > 0 ) {
+			// sample rate is set before anchors and samples are pushed
+			if( !pDecoder ) {
+				pDecoder = std::make_unique<AudioCodeDecoder>(m_opts, pTap->sampleRate);
+				pClock = std::make_unique<AudioTapClock>(pTap->sampleRate);
+				_INFO("Audio codes decoding at " << pTap->sampleRate << " Hz");
+			}
+			for (size_t i = 0; i < nAnchors; i++) {
+				pClock->add(anchors[i]);
+			}
+		}
+		const size_t n = pDecoder ? pTap->samples.pop(samples.data(), samples.size()) : 0;
+		if( n == 0 ) {
+			if( fStop ) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(VC_AUDIOCODE_POLL_MS));
+			continue;
+		}
+		m_analyzed += n;
+		pDecoder->push(samples.data(), n, codes);
+		report();
+	}
+	if( pDecoder ) {
+		pDecoder->flush(codes);
+		report();
+	}
+	_VERBOSE("AudioCodeAnalyzer leave: " << m_opts.codec);
+	_SESSION_LOG_END();
+}
+
+bool AudioCodeAnalyzer::start(LibavRecorder& recorder) {
+	if( m_pRecorder ) {
+		return false;
+	}
+	m_pTap = recorder.subscribeAudio(VC_AUDIOCODE_RING_SIZE);
+	if( !m_pTap ) {
+		return false;
+	}
+	m_pRecorder = &recorder;
+	m_thread = std::thread(&AudioCodeAnalyzer::run, this);
+	return true;
+}
+
+void AudioCodeAnalyzer::stop() {
+	m_fStop = true;
+	if( m_thread.joinable() ) {
+		m_thread.join();
+	}
+	if( m_pRecorder && m_pTap ) {
+		m_pRecorder->unsubscribeAudio(m_pTap);
+	}
+}
@@ -0,0 +1,205 @@
+#ifndef CAPTURE_AUDIOCODEANALYZER_H
+#define CAPTURE_AUDIOCODEANALYZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "reprostim/CaptureLib.h"
+#include "LibavRecorder.h"
+
+using namespace reprostim;
+
+// audio codecs in vc_opts.audiocode_codec, the same as
+// reprostim.audio.audiocodes.AudioCodec
+#define VC_AUDIOCODE_FSK "FSK"
+#define VC_AUDIOCODE_NFE "NFE"
+
+// defaults of reprostim.audio.audiocodes.AudioCodeEngine
+#ifndef VC_DEFAULT_AUDIOCODE_F0
+#define VC_DEFAULT_AUDIOCODE_F0 1000
+#endif
+
+#ifndef VC_DEFAULT_AUDIOCODE_F1
+#define VC_DEFAULT_AUDIOCODE_F1 5000
+#endif
+
+#ifndef VC_DEFAULT_AUDIOCODE_BIT_MS
+#define VC_DEFAULT_AUDIOCODE_BIT_MS 7.0
+#endif
+
+#ifndef VC_DEFAULT_AUDIOCODE_NFE_DF
+#define VC_DEFAULT_AUDIOCODE_NFE_DF 100
+#endif
+
+#ifndef VC_DEFAULT_AUDIOCODE_NFE_MS
+#define VC_DEFAULT_AUDIOCODE_NFE_MS 500
+#endif
+
+// min RMS level of code tone, fraction of full scale
+#ifndef VC_DEFAULT_AUDIOCODE_LEVEL
+#define VC_DEFAULT_AUDIOCODE_LEVEL 0.02
+#endif
+
+// Reed-Solomon parity bytes appended to FSK message
+#ifndef VC_AUDIOCODE_ECC_BYTES
+#define VC_AUDIOCODE_ECC_BYTES 4
+#endif
+
+// longer sounds are not codes, e.g. stimuli audio
+#ifndef VC_AUDIOCODE_MAX_BURST_MS
+#define VC_AUDIOCODE_MAX_BURST_MS 4000
+#endif
+
+// audio tap ring size in samples, ~2.7 sec at 48 kHz
+#ifndef VC_AUDIOCODE_RING_SIZE
+#define VC_AUDIOCODE_RING_SIZE 131072
+#endif
+
+// capture time anchors kept by analyzer
+#ifndef VC_AUDIOCODE_MAX_ANCHORS
+#define VC_AUDIOCODE_MAX_ANCHORS 4096
+#endif
+
+// analyzer thread sleep when audio tap ring is empty
+#ifndef VC_AUDIOCODE_POLL_MS
+#define VC_AUDIOCODE_POLL_MS 20
+#endif
+
+// Audio codes decoding options
+struct AudioCodeOpts {
+	bool        enabled = false;
+	std::string codec = VC_AUDIOCODE_FSK;
+	int         f0 = VC_DEFAULT_AUDIOCODE_F0;         // FSK 0 bit or NFE lowest frequency, Hz
+	int         f1 = VC_DEFAULT_AUDIOCODE_F1;         // FSK 1 bit or NFE highest frequency, Hz
+	double      bitMs = VC_DEFAULT_AUDIOCODE_BIT_MS;  // FSK bit duration
+	int         nfeDf = VC_DEFAULT_AUDIOCODE_NFE_DF;  // NFE frequency step, Hz
+	int         nfeMs = VC_DEFAULT_AUDIOCODE_NFE_MS;  // NFE tone duration
+	double      level = VC_DEFAULT_AUDIOCODE_LEVEL;
+};
+
+// Amplitude of freq tone in samples, Goertzel algorithm
+double getToneAmplitude(const float* x, size_t n, double freq, int sampleRate);
+
+// CRC-8 of FSK message value, the same as reprostim.audio.audiocodes.crc8
+uint8_t getCrc8(const uint8_t* data, size_t n);
+
+// Audio code decoded from captured audio
+struct AudioCode {
+	std::string          codec;
+	uint64_t             sampleStart = 0; // tone begin, samples since tap start
+	double               durationSec = 0; // tone length
+	double               amplitude = 0;   // tone amplitude, fraction of full scale
+	std::vector<uint8_t> data;            // FSK message value
+	bool                 fValue = false;  // value is set
+	uint64_t             value = 0;       // FSK 2, 4 or 8 bytes data or NFE number
+	int                  freq = 0;        // NFE tone frequency
+};
+
+// audio code to JSON, ts is capture time of tone begin
+nlohmann::json audioCodeToJson(const AudioCode& code, const Timestamp& ts);
+
+// Streaming decoder of audio codes generated with reprostim.audio.audiocodes.
+// Tone bursts are separated from silence around them (pre/post delay) with
+// level threshold on short blocks, and each burst is decoded when it ends.
+// FSK bits are classified with Goertzel filters on f0 and f1 in the middle
+// of each bit, message is accepted when its length matches the burst and
+// CRC-8 is correct, so Reed-Solomon parity is not used for correction.
+// NFE number is index of the strongest frequency step.
+class AudioCodeDecoder {
+private:
+	const AudioCodeOpts m_opts;
+	const int           m_sampleRate;
+	const size_t        m_blockSize;
+	const size_t        m_maxBurst;
+	std::vector<float>  m_block;     // current level block
+	std::vector<float>  m_prevBlock; // quiet block before burst
+	std::vector<float>  m_burst;
+	uint64_t            m_sample;    // samples pushed
+	uint64_t            m_burstStart;
+	double              m_burstRms;  // max block RMS in burst
+	int                 m_quietBlocks;
+	bool                m_fBurst;
+	bool                m_fOverflow; // burst is too long
+	uint64_t            m_bursts;
+
+	bool decodeFsk(const float* x, size_t n, AudioCode& code) const;
+	bool decodeNfe(const float* x, size_t n, AudioCode& code) const;
+	void endBurst(std::vector<AudioCode>& codes);
+	void pushBlock(std::vector<AudioCode>& codes);
+
+public:
+	AudioCodeDecoder(const AudioCodeOpts& opts, int sampleRate);
+
+	// tone bursts seen, decoded or not
+	uint64_t getBursts() const { return m_bursts; }
+	int getSampleRate() const { return m_sampleRate; }
+	// decode burst in progress, e.g. at the end of capture
+	void flush(std::vector<AudioCode>& codes);
+	// append mono samples, codes which ended are added to codes
+	void push(const float* x, size_t n, std::vector<AudioCode>& codes);
+};
+
+// Maps audio tap sample index to capture time with anchors
+// pushed by recorder for every captured block
+class AudioTapClock {
+private:
+	std::deque<AudioTapAnchor> m_anchors;
+	const int                  m_sampleRate;
+
+public:
+	explicit AudioTapClock(int sampleRate);
+
+	void add(const AudioTapAnchor& anchor);
+	// av_gettime_relative() time of sample, 0 when unknown,
+	// samples should be requested in increasing order
+	int64_t getUs(uint64_t sample);
+};
+
+// Called from analyzer thread with session logger set, ts is
+// capture time of code tone begin
+using AudioCodeCallback = std::function<void(const AudioCode& code, const Timestamp& ts)>;
+
+// Analyzer decoding audio codes live from libav recorder ALSA
+// input. Recorder audio encoder thread pushes captured samples
+// to lock-free audio tap, which is drained by analyzer thread,
+// so encoding is never blocked by decoding.
+class AudioCodeAnalyzer {
+private:
+	const AudioCodeOpts       m_opts;
+	const SessionLogger_ptr   m_pLogger;
+	const AudioCodeCallback   m_callback;
+	LibavRecorder*            m_pRecorder;
+	std::shared_ptr<AudioTap> m_pTap;
+	std::thread               m_thread;
+	std::atomic<bool>         m_fStop;
+	std::atomic<uint64_t>     m_analyzed;
+	std::atomic<uint64_t>     m_bursts;
+	std::atomic<int>          m_decoded;
+
+	void run();
+
+public:
+	AudioCodeAnalyzer(const AudioCodeOpts& opts, const SessionLogger_ptr& pLogger,
+					  const AudioCodeCallback& callback);
+	~AudioCodeAnalyzer();
+
+	// samples analyzed, tone bursts and codes decoded from them
+	uint64_t getAnalyzed() const { return m_analyzed; }
+	uint64_t getBursts() const { return m_bursts; }
+	int getDecoded() const { return m_decoded; }
+	// samples lost on full audio tap
+	uint64_t getDropped() const;
+	// tap recorder audio and start analyzer thread, returns false
+	// when recorder has no audio, recorder must outlive analyzer
+	bool start(LibavRecorder& recorder);
+	// decode buffered samples and stop analyzer thread
+	void stop();
+};
+
+#endif //CAPTURE_AUDIOCODEANALYZER_H
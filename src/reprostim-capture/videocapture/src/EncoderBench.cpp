@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <sysexits.h>
+#include <unistd.h>
+#include "reprostim/CaptureProc.h"
+#include "EncoderBench.h"
+#include "RecorderOpts.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static std::string quoteArg(const std::string& value) {
+	if( value.find_first_of(" \t'\"") == std::string::npos ) {
+		return value;
+	}
+	return "'" + value + "'";
+}
+
+static std::string formatFixed(double value, int precision) {
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(precision) << value;
+	return ss.str();
+}
+
+static BenchResult runBenchCandidate(const FfmpegOpts& ffm, const BenchCandidate& c,
+									 const BenchOpts& opts, const std::string& outFile) {
+	BenchResult res;
+	res.candidate = c;
+	const std::string cmd = makeBenchCommand(ffm, c, opts, outFile);
+	_VERBOSE("Bench command: " << cmd);
+
+	// synthetic frames are generated much faster than realtime, so
+	// candidate which is 10x slower than realtime is not usable anyway
+	const int timeoutMs = std::max(60, opts.durationSec * 10) * 1000;
+	const auto ts = std::chrono::steady_clock::now();
+	ChildProc proc;
+	if( !proc.spawn(cmd, true) ) {
+		res.error = "failed to start ffmpeg";
+		return res;
+	}
+	std::string lastLine;
+	while( proc.readOutput(1000, [&lastLine](std::string_view line, int stream) {
+			lastLine.assign(line);
+			_VERBOSE("ffmpeg: " << line);
+		}) >= 0 ) {
+		if( std::chrono::steady_clock::now() - ts > std::chrono::milliseconds(timeoutMs) ) {
+			_ERROR("Bench candidate timed out: " << c.label);
+			break;
+		}
+	}
+	proc.stop({{SIGINT, 1000}, {SIGKILL, 1000}});
+	proc.wait(-1);
+	res.wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - ts).count();
+
+	std::error_code ec;
+	const uintmax_t bytes = std::filesystem::file_size(outFile, ec);
+	std::filesystem::remove(outFile, ec);
+	if( proc.getExitCode() != 0 || res.wallSec <= 0 ) {
+		while( !lastLine.empty() && (lastLine.back() == '\n' || lastLine.back() == '\r') ) {
+			lastLine.pop_back();
+		}
+		res.error = lastLine.empty() ? "ffmpeg failed" : lastLine;
+		return res;
+	}
+
+	const struct rusage usage = proc.getUsage();
+	const double cpuSec = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+						  usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+	const double videoSec = opts.durationSec;
+	res.ok = true;
+	res.speed = videoSec / res.wallSec;
+	res.cpuPct = cpuSec / res.wallSec * 100.0;
+	res.maxRssKb = usage.ru_maxrss;
+	res.bytesPerMin = static_cast<double>(bytes) / videoSec * 60.0;
+	return res;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+std::string makeBenchCommand(const FfmpegOpts& ffm, const BenchCandidate& c,
+							 const BenchOpts& opts, const std::string& outFile) {
+	const std::string size = std::to_string(opts.cx) + "x" + std::to_string(opts.cy);
+	const std::string fps = std::to_string(opts.fps);
+	std::string input;
+	std::string outOpts;
+	if( opts.inputFile.empty() ) {
+		// synthetic frames in capture pixel format, so
+		// conversion is benchmarked as well
+		InputOpts in;
+		std::vector<std::string> ignored;
+		parseInputOpts(ffm.v_fmt, in, ignored);
+		const std::string pixFmt = in.options.count("input_format") ?
+								   in.options["input_format"] : "yuyv422";
+		input = "-f lavfi -i testsrc2=size=" + size + ":rate=" + fps + ",format=" + pixFmt;
+	} else {
+		input = "-stream_loop -1 -i " + quoteArg(opts.inputFile);
+		outOpts = " -s " + size + " -r " + fps;
+	}
+	const int nFrames = opts.durationSec * opts.fps;
+	return "exec ffmpeg -hide_banner -nostdin -loglevel error -y " + input +
+		   " -frames:v " + std::to_string(nFrames) + outOpts + " " + c.v_enc + " " +
+		   ffm.pix_fmt + " " + c.n_threads + " -an " + quoteArg(outFile);
+}
+
+std::vector<BenchCandidate> makeBenchCandidates(const FfmpegOpts& ffm, int maxThreads) {
+	std::vector<BenchCandidate> res;
+	res.push_back(BenchCandidate{"config", ffm.v_enc, ffm.n_threads});
+
+	// presets are known for x264/x265 encoders only
+	bool fPreset = false;
+	for (const auto& arg: parseFfmpegArgs(ffm.v_enc)) {
+		fPreset = fPreset || arg.key == "preset";
+	}
+	std::vector<std::string> presets = {""};
+	if( fPreset ) {
+		presets = {"ultrafast", "superfast", "veryfast", "faster"};
+	}
+	std::vector<int> threads;
+	for (int n: {2, 4, 8}) {
+		if( n <= maxThreads ) {
+			threads.push_back(n);
+		}
+	}
+	if( threads.empty() ) {
+		threads.push_back(std::max(1, maxThreads));
+	}
+
+	for (const auto& preset: presets) {
+		for (int n: threads) {
+			BenchCandidate c;
+			c.v_enc = preset.empty() ? ffm.v_enc : setFfmpegOpt(ffm.v_enc, "preset", preset);
+			c.n_threads = "-threads " + std::to_string(n);
+			c.label = (preset.empty() ? "" : "preset=" + preset + " ") + "threads=" + std::to_string(n);
+			if( c.v_enc == res[0].v_enc && c.n_threads == res[0].n_threads ) {
+				continue;
+			}
+			res.push_back(c);
+		}
+	}
+	return res;
+}
+
+bool parseBenchSpec(const std::string& spec, BenchOpts& opts) {
+	int cx = 0, cy = 0, fps = 0;
+	char tail = 0;
+	if( sscanf(spec.c_str(), "%dx%d@%d%c", &cx, &cy, &fps, &tail) != 3 ||
+		cx <= 0 || cy <= 0 || fps <= 0 ) {
+		_ERROR("Invalid benchmark spec: " << spec << ", expected <width>x<height>@<fps>");
+		return false;
+	}
+	opts.cx = cx;
+	opts.cy = cy;
+	opts.fps = fps;
+	return true;
+}
+
+int pickBenchResult(const std::vector<BenchResult>& results, double minHeadroom) {
+	int best = -1;
+	for (int i = 0; i < static_cast<int>(results.size()); i++) {
+		const BenchResult& r = results[i];
+		if( !r.ok || r.speed < minHeadroom ) {
+			continue;
+		}
+		if( best < 0 || r.bytesPerMin < results[best].bytesPerMin ||
+			(r.bytesPerMin == results[best].bytesPerMin && r.cpuPct < results[best].cpuPct) ) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+int runEncoderBench(const FfmpegOpts& ffm, const BenchOpts& opts) {
+	const int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+	const std::vector<BenchCandidate> candidates = makeBenchCandidates(ffm, maxThreads);
+	_INFO("Encoder benchmark: " << opts.cx << "x" << opts.cy << "@" << opts.fps << ", "
+		  << opts.durationSec << " sec, "
+		  << (opts.inputFile.empty() ? std::string("synthetic frames") : "replay " + opts.inputFile)
+		  << ", " << candidates.size() << " candidates, " << maxThreads << " CPUs");
+
+	std::vector<BenchResult> results;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		const std::string outFile = (std::filesystem::temp_directory_path() /
+				("reprostim-bench-" + std::to_string(getpid()) + "-" + std::to_string(i) +
+				 "." + ffm.out_fmt)).string();
+		_INFO("  [" << (i + 1) << "/" << candidates.size() << "] " << candidates[i].label);
+		results.push_back(runBenchCandidate(ffm, candidates[i], opts, outFile));
+		const BenchResult& r = results.back();
+		if( r.ok ) {
+			_INFO("      speed " << formatFixed(r.speed, 2) << "x realtime, CPU "
+				  << formatFixed(r.cpuPct, 0) << "%, RSS " << r.maxRssKb / 1024 << " MB, "
+				  << formatFixed(r.bytesPerMin / 1048576.0, 1) << " MB/min");
+		} else {
+			_ERROR("      failed: " << r.error);
+		}
+	}
+
+	const int best = pickBenchResult(results, VC_BENCH_MIN_HEADROOM);
+	if( best < 0 ) {
+		_ERROR("No encoder candidate reaches " << VC_BENCH_MIN_HEADROOM
+			   << "x realtime at " << opts.cx << "x" << opts.cy << "@" << opts.fps);
+		return EX_SOFTWARE;
+	}
+	const BenchCandidate& c = results[best].candidate;
+	_INFO("Recommended (" << c.label << ", the smallest output with at least "
+		  << VC_BENCH_MIN_HEADROOM << "x realtime speed), config.yaml:");
+	_INFO("ffm_opts:");
+	_INFO("  v_enc: \"" << c.v_enc << "\"");
+	_INFO("  n_threads: \"" << c.n_threads << "\"");
+	return EX_OK;
+}
+
+std::string setFfmpegOpt(const std::string& args, const std::string& key,
+						 const std::string& value) {
+	std::string res;
+	bool fFound = false;
+	for (const auto& arg: parseFfmpegArgs(args)) {
+		std::string item;
+		if( arg.key.empty() ) {
+			item = quoteArg(arg.value);
+		} else if( arg.key == key ) {
+			item = "-" + key + " " + quoteArg(value);
+			fFound = true;
+		} else {
+			item = "-" + arg.key + (arg.value.empty() ? "" : " " + quoteArg(arg.value));
+		}
+		res += (res.empty() ? "" : " ") + item;
+	}
+	if( !fFound ) {
+		res += (res.empty() ? "" : " ") + ("-" + key + " " + quoteArg(value));
+	}
+	return res;
+}
@@ -0,0 +1,77 @@
+#ifndef CAPTURE_ENCODERBENCH_H
+#define CAPTURE_ENCODERBENCH_H
+
+#include <string>
+#include <vector>
+#include "reprostim/CaptureApp.h"
+
+using namespace reprostim;
+
+// default benchmark frames size and rate
+#ifndef VC_BENCH_DEFAULT_SPEC
+#define VC_BENCH_DEFAULT_SPEC "1920x1080@60"
+#endif
+
+// length of encoded video per candidate
+#ifndef VC_BENCH_DURATION_SEC
+#define VC_BENCH_DURATION_SEC 10
+#endif
+
+// min realtime speed of recommended candidate, leaves
+// CPU for capture, audio and the rest of the system
+#ifndef VC_BENCH_MIN_HEADROOM
+#define VC_BENCH_MIN_HEADROOM 1.5
+#endif
+
+// Encoder benchmark options
+struct BenchOpts {
+	int         cx = 1920;
+	int         cy = 1080;
+	int         fps = 60;
+	int         durationSec = VC_BENCH_DURATION_SEC;
+	std::string inputFile; // replayed video, synthetic frames when empty
+};
+
+// Single encoder configuration to benchmark
+struct BenchCandidate {
+	std::string label;
+	std::string v_enc;
+	std::string n_threads;
+};
+
+// Benchmark result of single candidate
+struct BenchResult {
+	BenchCandidate candidate;
+	bool           ok = false;
+	double         wallSec = 0;
+	double         speed = 0;     // encoded video length / wall time
+	double         cpuPct = 0;    // user+system time / wall time
+	long           maxRssKb = 0;
+	double         bytesPerMin = 0;
+	std::string    error;         // last ffmpeg output line on failure
+};
+
+// ffmpeg command encoding benchmark frames to outFile
+std::string makeBenchCommand(const FfmpegOpts& ffm, const BenchCandidate& c,
+							 const BenchOpts& opts, const std::string& outFile);
+
+// matrix of presets and threads around configured encoder,
+// the configured one goes first
+std::vector<BenchCandidate> makeBenchCandidates(const FfmpegOpts& ffm, int maxThreads);
+
+// parse "<width>x<height>@<fps>" spec
+bool parseBenchSpec(const std::string& spec, BenchOpts& opts);
+
+// index of the smallest output among candidates with at least
+// minHeadroom realtime speed, -1 when there is no such one
+int pickBenchResult(const std::vector<BenchResult>& results, double minHeadroom);
+
+// run all candidates and print results and recommended ffm_opts,
+// returns process exit code
+int runEncoderBench(const FfmpegOpts& ffm, const BenchOpts& opts);
+
+// set value of ffmpeg option in args, option is appended when missing
+std::string setFfmpegOpt(const std::string& args, const std::string& key,
+						 const std::string& value);
+
+#endif //CAPTURE_ENCODERBENCH_H
@@ -0,0 +1,94 @@
+#include <charconv>
+#include "EncoderProgress.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// progress values can be "N/A" before the first packet, parsed as 0
+static inline int64_t toInt(std::string_view value) {
+	int64_t res = 0;
+	std::from_chars(value.data(), value.data() + value.size(), res);
+	return res;
+}
+
+static inline double toDouble(std::string_view value) {
+	double res = 0;
+	std::from_chars(value.data(), value.data() + value.size(), res);
+	return res;
+}
+
+////////////////////////////////////////////////////////////////////////
+// ProgressParser
+
+bool ProgressParser::parseLine(std::string_view line, bool& fComplete) {
+	fComplete = false;
+	std::string_view s = line;
+	while( !s.empty() && (s.back() == '\n' || s.back() == '\r') ) {
+		s.remove_suffix(1);
+	}
+	const size_t eq = s.find('=');
+	if( eq == std::string_view::npos || eq == 0 || s.find(' ') != std::string_view::npos ) {
+		return false;
+	}
+	const std::string_view key = s.substr(0, eq);
+	const std::string_view value = s.substr(eq + 1);
+	if( key == "frame" ) {
+		m_cur.frame = toInt(value);
+	} else if( key == "fps" ) {
+		m_cur.fps = toDouble(value);
+	} else if( key == "dup_frames" ) {
+		m_cur.dupFrames = toInt(value);
+	} else if( key == "drop_frames" ) {
+		m_cur.dropFrames = toInt(value);
+	} else if( key == "bitrate" ) {
+		// e.g. "8012.3kbits/s"
+		m_cur.bitrateKbps = toDouble(value);
+	} else if( key == "total_size" ) {
+		m_cur.totalSize = toInt(value);
+	} else if( key == "out_time_us" ) {
+		m_cur.outTimeUs = toInt(value);
+	} else if( key == "speed" ) {
+		// e.g. "1.01x"
+		m_cur.speed = toDouble(value);
+	} else if( key == "progress" ) {
+		m_cur.fEnd = value == "end";
+		m_last = m_cur;
+		fComplete = true;
+	} else if( !key.starts_with("stream_") && key != "out_time" && key != "out_time_ms" ) {
+		// not progress key, e.g. ffmpeg log "key=value" output
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// EncodeRateMonitor
+
+EncodeRateMonitor::EncodeRateMonitor(double inputFps, double ratio):
+		m_inputFps(inputFps), m_ratio(ratio) {
+	m_frames = 0;
+	m_tsMs = -1;
+	m_fps = 0;
+	m_fLow = false;
+}
+
+int EncodeRateMonitor::update(uint64_t frames, long long tsMs) {
+	if( m_tsMs < 0 || tsMs <= m_tsMs || frames < m_frames ) {
+		// baseline, e.g. encoder startup is not counted
+		m_frames = frames;
+		m_tsMs = tsMs;
+		return 0;
+	}
+	m_fps = static_cast<double>(frames - m_frames) * 1000.0 / static_cast<double>(tsMs - m_tsMs);
+	m_frames = frames;
+	m_tsMs = tsMs;
+	if( m_inputFps <= 0 ) {
+		return 0;
+	}
+	const bool fLow = m_fps < m_inputFps * m_ratio;
+	if( fLow == m_fLow ) {
+		return 0;
+	}
+	m_fLow = fLow;
+	return fLow ? 1 : -1;
+}
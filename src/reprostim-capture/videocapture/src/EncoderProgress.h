@@ -0,0 +1,64 @@
+#ifndef CAPTURE_ENCODERPROGRESS_H
+#define CAPTURE_ENCODERPROGRESS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// encode rate below input rate multiplied by this ratio raises alert
+#ifndef VC_ENCODE_FPS_ALERT_RATIO
+#define VC_ENCODE_FPS_ALERT_RATIO 0.95
+#endif
+
+// Encoder progress snapshot from ffmpeg "-progress" stream
+struct EncoderProgress {
+	int64_t frame = 0;
+	double  fps = 0;          // average since start
+	int64_t dupFrames = 0;
+	int64_t dropFrames = 0;
+	double  bitrateKbps = 0;
+	int64_t totalSize = 0;    // output bytes
+	int64_t outTimeUs = 0;
+	double  speed = 0;        // realtime multiple
+	bool    fEnd = false;     // the last block, encoding finished
+};
+
+// Parser of ffmpeg "-progress" key=value lines, which come in
+// blocks terminated with "progress=continue|end" line
+class ProgressParser {
+private:
+	EncoderProgress m_cur;
+	EncoderProgress m_last;
+
+public:
+	// the last complete block
+	const EncoderProgress& getProgress() const { return m_last; }
+	// returns true when line belongs to progress stream, fComplete
+	// is set when the line terminates block
+	bool parseLine(std::string_view line, bool& fComplete);
+};
+
+// Tracks encoded frames rate against input frame rate and reports
+// when it falls below and recovers
+class EncodeRateMonitor {
+private:
+	const double m_inputFps;
+	const double m_ratio;
+	uint64_t     m_frames;
+	long long    m_tsMs;  // -1 before the first update
+	double       m_fps;
+	bool         m_fLow;
+
+public:
+	EncodeRateMonitor(double inputFps, double ratio = VC_ENCODE_FPS_ALERT_RATIO);
+
+	// encode rate between the last two updates
+	double getFps() const { return m_fps; }
+	double getInputFps() const { return m_inputFps; }
+	bool isLow() const { return m_fLow; }
+	// update with total encoded frames at tsMs, returns 1 when rate
+	// fell below input rate, -1 when recovered and 0 otherwise
+	int update(uint64_t frames, long long tsMs);
+};
+
+#endif //CAPTURE_ENCODERPROGRESS_H
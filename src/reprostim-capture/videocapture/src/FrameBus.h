@@ -0,0 +1,260 @@
+#ifndef CAPTURE_FRAMEBUS_H
+#define CAPTURE_FRAMEBUS_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What subscriber queue does with new frame when it is full
+enum FrameBusPolicy {
+	BUS_DROP_OLDEST, // keep the most recent frames, e.g. encoder
+	BUS_DROP_NEWEST  // keep queued frames, skip new ones
+};
+
+template<typename T>
+class FrameBus;
+
+// Subscriber of frame bus with own bounded queue, frames are shared
+// by all subscribers and released when the last one drops them.
+// Every stride-th published frame is delivered, so sampling analyzers
+// don't pay for frames they skip anyway.
+template<typename T>
+class FrameBusQueue {
+	friend class FrameBus<T>;
+private:
+	const std::string                    m_name;
+	const size_t                         m_size;
+	const FrameBusPolicy                 m_policy;
+	const uint64_t                       m_stride;
+	mutable std::mutex                   m_mutex;
+	std::condition_variable              m_cond;
+	std::deque<std::shared_ptr<const T>> m_queue;
+	bool                                 m_fClosed;
+	uint64_t                             m_offered;
+	uint64_t                             m_delivered;
+	uint64_t                             m_dropped;
+	size_t                               m_maxDepth;
+
+	void close();
+	void push(const std::shared_ptr<const T>& frame);
+
+public:
+	FrameBusQueue(const std::string& name, size_t size, FrameBusPolicy policy, uint64_t stride);
+
+	// frames put to queue
+	uint64_t getDelivered() const;
+	size_t getDepth() const;
+	// frames dropped on full queue
+	uint64_t getDropped() const;
+	size_t getMaxDepth() const;
+	const std::string& getName() const { return m_name; }
+	FrameBusPolicy getPolicy() const { return m_policy; }
+	bool isClosed() const;
+	// wait up to timeoutMs for frame, -1 for infinite wait, returns
+	// false on timeout or when bus is closed and queue is drained
+	bool pop(std::shared_ptr<const T>& frame, int timeoutMs);
+};
+
+// In-process bus fanning out frames from single capture to several
+// consumers, e.g. encoder and analyzers. Publisher never blocks on
+// slow subscriber, each one applies own policy to its full queue.
+template<typename T>
+class FrameBus {
+private:
+	mutable std::mutex                             m_mutex;
+	std::vector<std::shared_ptr<FrameBusQueue<T>>> m_queues;
+	uint64_t                                       m_published;
+	bool                                           m_fClosed;
+
+public:
+	FrameBus();
+
+	// close all subscribers, they drain queued frames and stop
+	void close();
+	uint64_t getPublished() const;
+	size_t getSubscriberCount() const;
+	// snapshot of current subscribers
+	std::vector<std::shared_ptr<FrameBusQueue<T>>> getSubscribers() const;
+	bool isClosed() const;
+	void publish(const std::shared_ptr<const T>& frame);
+	// add subscriber with queue of size frames, returns closed
+	// queue when bus is closed already
+	std::shared_ptr<FrameBusQueue<T>> subscribe(const std::string& name, size_t size,
+												FrameBusPolicy policy, uint64_t stride = 1);
+	// remove and close subscriber
+	void unsubscribe(const std::shared_ptr<FrameBusQueue<T>>& queue);
+};
+
+//////////////////////////////////////////////////////////////////////////
+// FrameBusQueue Implementation
+
+template<typename T>
+FrameBusQueue<T>::FrameBusQueue(const std::string& name, size_t size, FrameBusPolicy policy,
+								uint64_t stride):
+		m_name(name), m_size(std::max<size_t>(size, 1)), m_policy(policy),
+		m_stride(std::max<uint64_t>(stride, 1)) {
+	m_fClosed = false;
+	m_offered = 0;
+	m_delivered = 0;
+	m_dropped = 0;
+	m_maxDepth = 0;
+}
+
+template<typename T>
+void FrameBusQueue<T>::close() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fClosed = true;
+	}
+	m_cond.notify_all();
+}
+
+template<typename T>
+uint64_t FrameBusQueue<T>::getDelivered() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_delivered;
+}
+
+template<typename T>
+size_t FrameBusQueue<T>::getDepth() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queue.size();
+}
+
+template<typename T>
+uint64_t FrameBusQueue<T>::getDropped() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_dropped;
+}
+
+template<typename T>
+size_t FrameBusQueue<T>::getMaxDepth() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_maxDepth;
+}
+
+template<typename T>
+bool FrameBusQueue<T>::isClosed() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_fClosed;
+}
+
+template<typename T>
+bool FrameBusQueue<T>::pop(std::shared_ptr<const T>& frame, int timeoutMs) {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto ready = [this]() { return !m_queue.empty() || m_fClosed; };
+	if( timeoutMs < 0 ) {
+		m_cond.wait(lock, ready);
+	} else if( !m_cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready) ) {
+		return false;
+	}
+	if( m_queue.empty() ) {
+		return false;
+	}
+	frame = std::move(m_queue.front());
+	m_queue.pop_front();
+	return true;
+}
+
+template<typename T>
+void FrameBusQueue<T>::push(const std::shared_ptr<const T>& frame) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if( m_fClosed || (m_offered++ % m_stride) != 0 ) {
+			return;
+		}
+		if( m_queue.size() >= m_size ) {
+			m_dropped++;
+			if( m_policy == BUS_DROP_NEWEST ) {
+				return;
+			}
+			m_queue.pop_front();
+		}
+		m_queue.push_back(frame);
+		m_delivered++;
+		m_maxDepth = std::max(m_maxDepth, m_queue.size());
+	}
+	m_cond.notify_one();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// FrameBus Implementation
+
+template<typename T>
+FrameBus<T>::FrameBus() {
+	m_published = 0;
+	m_fClosed = false;
+}
+
+template<typename T>
+void FrameBus<T>::close() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fClosed = true;
+	for (auto& q: m_queues) {
+		q->close();
+	}
+}
+
+template<typename T>
+uint64_t FrameBus<T>::getPublished() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_published;
+}
+
+template<typename T>
+size_t FrameBus<T>::getSubscriberCount() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queues.size();
+}
+
+template<typename T>
+std::vector<std::shared_ptr<FrameBusQueue<T>>> FrameBus<T>::getSubscribers() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_queues;
+}
+
+template<typename T>
+bool FrameBus<T>::isClosed() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_fClosed;
+}
+
+template<typename T>
+void FrameBus<T>::publish(const std::shared_ptr<const T>& frame) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if( m_fClosed ) {
+		return;
+	}
+	m_published++;
+	for (auto& q: m_queues) {
+		q->push(frame);
+	}
+}
+
+template<typename T>
+std::shared_ptr<FrameBusQueue<T>> FrameBus<T>::subscribe(const std::string& name, size_t size,
+														 FrameBusPolicy policy, uint64_t stride) {
+	auto q = std::make_shared<FrameBusQueue<T>>(name, size, policy, stride);
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if( m_fClosed ) {
+		q->close();
+	} else {
+		m_queues.push_back(q);
+	}
+	return q;
+}
+
+template<typename T>
+void FrameBus<T>::unsubscribe(const std::shared_ptr<FrameBusQueue<T>>& queue) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_queues.erase(std::remove(m_queues.begin(), m_queues.end(), queue), m_queues.end());
+	queue->close();
+}
+
+#endif //CAPTURE_FRAMEBUS_H
@@ -0,0 +1,1295 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "LibavRecorder.h"
+#include "PreRollBuffer.h"
+
+#ifdef CAPTURE_LIBAV_ENABLED
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavdevice/avdevice.h>
+#include <libavformat/avformat.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/samplefmt.h>
+#include <libavutil/time.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+// AVChannelLayout API, FFmpeg 5.1+
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 24, 100)
+#define CAPTURE_LIBAV_CH_LAYOUT 1
+#endif
+
+// av_find_input_format returns const pointer since FFmpeg 5.0
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+typedef const AVInputFormat* InputFormatPtr;
+#else
+typedef AVInputFormat* InputFormatPtr;
+#endif
+
+// microseconds time base, AV_TIME_BASE_Q is not usable in C++
+static const AVRational US_TIME_BASE = {1, 1000000};
+
+////////////////////////////////////////////////////////////////////////
+// PreRollRing
+
+struct PacketDeleter {
+	void operator()(AVPacket* pkt) const {
+		av_packet_free(&pkt);
+	}
+};
+
+using PacketPtr = std::unique_ptr<AVPacket, PacketDeleter>;
+
+// Encoded packets in encoder time base, stream id is 0 for
+// video and 1 for audio
+struct PreRollRing: public PreRollBuffer<PacketPtr> {
+	using PreRollBuffer<PacketPtr>::PreRollBuffer;
+};
+
+////////////////////////////////////////////////////////////////////////
+// RecorderStream
+
+// Captured packet waiting for encoder
+struct QueuedPacket {
+	AVPacket* pkt;
+	int64_t   captureUs; // av_gettime_relative() when packet was read
+};
+
+// Capture input, encoder and queue of single stream
+struct RecorderStream {
+	const char*       name;
+	const bool        fVideo;
+	const int         id;      // pre-roll stream id
+	const InputOpts   inOpts;
+	const EncoderOpts encOpts;
+
+	// capture input and decoder of raw packets
+	AVFormatContext*  pIn = nullptr;
+	int               inIndex = -1;
+	AVRational        inTimeBase{0, 1}; // kept after input is closed by stopCapture
+	AVCodecContext*   pDec = nullptr;
+	AVFrame*          pInFrame = nullptr;
+	int64_t           firstPts = AV_NOPTS_VALUE;
+	bool              forceKey = false;
+
+	// encoder, converted frame and output stream
+	AVCodecContext*   pEnc = nullptr;
+	AVFrame*          pEncFrame = nullptr;
+	AVPacket*         pOutPkt = nullptr;
+	AVStream*         pOutStream = nullptr;
+	SwsContext*       pSws = nullptr;
+	SwrContext*       pSwr = nullptr;
+	AVAudioFifo*      pFifo = nullptr;
+	int64_t           nextAudioPts = 0;
+
+	// mono samples for audio tap
+	std::vector<float> tapSamples;
+	bool               fTapFormatError = false;
+
+	// capture to encoder queue
+	std::mutex                    mutex;
+	std::condition_variable       cond;
+	std::deque<QueuedPacket>      queue;
+	size_t                        queueSize;
+	size_t                        maxDepth = 0;
+	std::atomic<bool>             readStop{false};
+	bool                          encodeStop = false;
+	std::thread                   readThread;
+	std::thread                   encodeThread;
+
+	// encoder pts -> capture time of frames being encoded
+	std::deque<std::pair<int64_t, int64_t>> pending;
+
+	std::atomic<uint64_t> captured{0};
+	std::atomic<uint64_t> encoded{0};
+	std::atomic<uint64_t> dropped{0};
+	std::atomic<uint64_t> paused{0};
+	std::atomic<uint64_t> nLatency{0};
+	std::atomic<int64_t>  latencySumUs{0};
+	std::atomic<int64_t>  latencyMaxUs{0};
+
+	RecorderStream(const char* name_, bool fVideo_, const InputOpts& in,
+				   const EncoderOpts& enc, size_t queueSize_):
+			name(name_), fVideo(fVideo_), id(fVideo_ ? 0 : 1), inOpts(in), encOpts(enc), queueSize(queueSize_) {
+	}
+
+	~RecorderStream() {
+		for (auto& qp: queue) {
+			av_packet_free(&qp.pkt);
+		}
+		queue.clear();
+		sws_freeContext(pSws);
+		swr_free(&pSwr);
+		if( pFifo ) {
+			av_audio_fifo_free(pFifo);
+		}
+		av_frame_free(&pInFrame);
+		av_frame_free(&pEncFrame);
+		av_packet_free(&pOutPkt);
+		avcodec_free_context(&pDec);
+		avcodec_free_context(&pEnc);
+		avformat_close_input(&pIn);
+	}
+
+	size_t getDepth() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return queue.size();
+	}
+
+	size_t getMaxDepth() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return maxDepth;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static std::string avErrorStr(int err) {
+	char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+	av_strerror(err, buf, sizeof(buf));
+	return buf;
+}
+
+static void dictFromMap(const std::map<std::string, std::string>& m, AVDictionary** ppDict) {
+	for (const auto& [key, value]: m) {
+		av_dict_set(ppDict, key.c_str(), value.c_str(), 0);
+	}
+}
+
+static void warnUnusedOptions(const char* what, AVDictionary* pDict) {
+	const AVDictionaryEntry* e = nullptr;
+	while( (e = av_dict_get(pDict, "", e, AV_DICT_IGNORE_SUFFIX)) != nullptr ) {
+		_INFO("Unused " << what << " option: " << e->key << "=" << e->value);
+	}
+}
+
+static inline int getChannels(const AVCodecContext* pCtx) {
+#ifdef CAPTURE_LIBAV_CH_LAYOUT
+	return pCtx->ch_layout.nb_channels;
+#else
+	return pCtx->channels;
+#endif
+}
+
+static int interruptCallback(void* p) {
+	return static_cast<RecorderStream*>(p)->readStop ? 1 : 0;
+}
+
+// packet decoding time in microseconds
+static inline int64_t getPacketUs(const RecorderStream& s, const AVPacket* pkt) {
+	const int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+	return av_rescale_q(ts, s.pEnc->time_base, US_TIME_BASE);
+}
+
+static void updateMax(std::atomic<int64_t>& max, int64_t value) {
+	int64_t cur = max.load();
+	while( value > cur && !max.compare_exchange_weak(cur, value) ) {
+	}
+}
+
+// downmix decoded audio samples to mono float, returns false
+// when sample format is not supported
+static bool getMonoSamples(const AVFrame* pFrame, int channels, float* pOut) {
+	const AVSampleFormat fmt = static_cast<AVSampleFormat>(pFrame->format);
+	const bool fPlanar = av_sample_fmt_is_planar(fmt) != 0;
+	const int n = pFrame->nb_samples;
+	std::fill(pOut, pOut + n, 0.0f);
+	for (int ch = 0; ch < channels; ch++) {
+		const uint8_t* p = pFrame->extended_data[fPlanar ? ch : 0];
+		const int first = fPlanar ? 0 : ch;
+		const int step = fPlanar ? 1 : channels;
+		switch( av_get_packed_sample_fmt(fmt) ) {
+			case AV_SAMPLE_FMT_S16:
+				for (int i = 0; i < n; i++) {
+					pOut[i] += reinterpret_cast<const int16_t*>(p)[first + i * step] / 32768.0f;
+				}
+				break;
+			case AV_SAMPLE_FMT_S32:
+				for (int i = 0; i < n; i++) {
+					pOut[i] += reinterpret_cast<const int32_t*>(p)[first + i * step] / 2147483648.0f;
+				}
+				break;
+			case AV_SAMPLE_FMT_FLT:
+				for (int i = 0; i < n; i++) {
+					pOut[i] += reinterpret_cast<const float*>(p)[first + i * step];
+				}
+				break;
+			default:
+				return false;
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		pOut[i] /= static_cast<float>(channels);
+	}
+	return true;
+}
+
+// locate 8-bit color components, others are left with 0 step
+static void setComponents(VideoFrame& frame) {
+	const AVPixFmtDescriptor* pDesc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame.pixFmt));
+	if( !pDesc || (pDesc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM)) ) {
+		return;
+	}
+	for (int i = 0; i < 3 && i < pDesc->nb_components; i++) {
+		const AVComponentDescriptor& comp = pDesc->comp[i];
+		if( comp.depth == 8 && comp.shift == 0 ) {
+			frame.comp[i] = FrameComponent{comp.plane, comp.step, comp.offset};
+		}
+	}
+	frame.fRgb = (pDesc->flags & AV_PIX_FMT_FLAG_RGB) != 0;
+	frame.log2ChromaW = pDesc->log2_chroma_w;
+	frame.log2ChromaH = pDesc->log2_chroma_h;
+}
+
+////////////////////////////////////////////////////////////////////////
+// VideoFrame
+
+VideoFrame::~VideoFrame() {
+	av_frame_free(&pFrame);
+}
+
+////////////////////////////////////////////////////////////////////////
+// LibavRecorder
+
+LibavRecorder::LibavRecorder(const RecorderOpts& opts): m_opts(opts) {
+	m_pOut = nullptr;
+	m_outBaseUs = AV_NOPTS_VALUE;
+	m_outLastUs = AV_NOPTS_VALUE;
+	m_outBytes = 0;
+	m_fOutContinued = false;
+	m_segIndex = 0;
+	m_segOriginUs = AV_NOPTS_VALUE;
+	m_pWritePkt = nullptr;
+	m_fGlobalHeader = false;
+	m_failed = false;
+	m_running = false;
+	m_capturing = false;
+	m_bytesWritten = 0;
+	m_videoPaused = false;
+	m_keyRequested = false;
+	m_rotateRequested = false;
+}
+
+LibavRecorder::~LibavRecorder() {
+	stop();
+}
+
+void LibavRecorder::close() {
+	closeOutput();
+	m_video.reset();
+	m_audio.reset();
+	m_preRoll.reset();
+	av_packet_free(&m_pWritePkt);
+}
+
+void LibavRecorder::closeOutput() {
+	if( m_pOut ) {
+		if( !(m_pOut->oformat->flags & AVFMT_NOFILE) ) {
+			avio_closep(&m_pOut->pb);
+		}
+		avformat_free_context(m_pOut);
+		m_pOut = nullptr;
+	}
+	for (RecorderStream* s: {m_video.get(), m_audio.get()}) {
+		if( s ) {
+			s->pOutStream = nullptr;
+		}
+	}
+	m_outFile.clear();
+	m_outComment.clear();
+	m_outBaseUs = AV_NOPTS_VALUE;
+	m_outLastUs = AV_NOPTS_VALUE;
+	m_outBytes = 0;
+	m_fOutContinued = false;
+}
+
+void LibavRecorder::encodeLoop(RecorderStream& s) {
+	while( true ) {
+		QueuedPacket qp{nullptr, 0};
+		{
+			std::unique_lock<std::mutex> lock(s.mutex);
+			s.cond.wait(lock, [&s]() { return !s.queue.empty() || s.encodeStop; });
+			if( s.queue.empty() ) {
+				break; // stopped and queue drained
+			}
+			qp = s.queue.front();
+			s.queue.pop_front();
+		}
+		int res = avcodec_send_packet(s.pDec, qp.pkt);
+		av_packet_free(&qp.pkt);
+		if( res < 0 ) {
+			_ERROR("Failed to decode captured " << s.name << " packet: " << avErrorStr(res));
+			continue;
+		}
+		while( (res = avcodec_receive_frame(s.pDec, s.pInFrame)) >= 0 ) {
+			if( s.fVideo ) {
+				s.pending.emplace_back(0, qp.captureUs);
+			} else {
+				publishAudio(s, qp.captureUs);
+			}
+			const bool fOk = encodeFrame(s, false);
+			av_frame_unref(s.pInFrame);
+			if( !fOk ) {
+				m_failed = true;
+				break;
+			}
+		}
+	}
+	// flush encoder at the end
+	if( !encodeFrame(s, true) ) {
+		m_failed = true;
+	}
+}
+
+bool LibavRecorder::encodeFrame(RecorderStream& s, bool fFlush) {
+	AVFrame* pFrame = nullptr;
+	if( !fFlush && s.fVideo ) {
+		// rebase timestamps to start from zero, like setpts=PTS-STARTPTS
+		int64_t pts = s.pInFrame->best_effort_timestamp;
+		if( pts == AV_NOPTS_VALUE ) {
+			pts = s.pInFrame->pts;
+		}
+		if( s.firstPts == AV_NOPTS_VALUE ) {
+			s.firstPts = pts;
+		}
+		int res = av_frame_make_writable(s.pEncFrame);
+		if( res < 0 ) {
+			_ERROR("Failed to allocate video frame: " << avErrorStr(res));
+			return false;
+		}
+		sws_scale(s.pSws, s.pInFrame->data, s.pInFrame->linesize, 0, s.pInFrame->height,
+				  s.pEncFrame->data, s.pEncFrame->linesize);
+		s.pEncFrame->pts = av_rescale_q(pts - s.firstPts, s.inTimeBase, s.pEnc->time_base);
+		s.pEncFrame->pict_type = s.forceKey ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+		s.forceKey = false;
+		s.pending.back().first = s.pEncFrame->pts;
+		pFrame = s.pEncFrame;
+	}
+
+	if( !fFlush && !s.fVideo ) {
+		// resample to encoder format, encoder frame size is
+		// fixed, so samples are buffered in fifo
+		uint8_t** ppData = nullptr;
+		const int nMax = swr_get_out_samples(s.pSwr, s.pInFrame->nb_samples);
+		int res = av_samples_alloc_array_and_samples(&ppData, nullptr, getChannels(s.pEnc),
+													 nMax, s.pEnc->sample_fmt, 0);
+		if( res < 0 ) {
+			_ERROR("Failed to allocate audio samples: " << avErrorStr(res));
+			return false;
+		}
+		const int n = swr_convert(s.pSwr, ppData, nMax,
+								  const_cast<const uint8_t**>(s.pInFrame->extended_data),
+								  s.pInFrame->nb_samples);
+		if( n > 0 ) {
+			av_audio_fifo_write(s.pFifo, reinterpret_cast<void**>(ppData), n);
+		}
+		av_freep(&ppData[0]);
+		av_freep(&ppData);
+		if( n < 0 ) {
+			_ERROR("Failed to resample audio: " << avErrorStr(n));
+			return false;
+		}
+	}
+
+	while( true ) {
+		if( !s.fVideo ) {
+			// take full encoder frame from fifo, pad the rest
+			// with silence on flush
+			const int frameSize = s.pEncFrame->nb_samples;
+			const int nAvail = av_audio_fifo_size(s.pFifo);
+			if( nAvail >= frameSize || (fFlush && nAvail > 0) ) {
+				int res = av_frame_make_writable(s.pEncFrame);
+				if( res < 0 ) {
+					_ERROR("Failed to allocate audio frame: " << avErrorStr(res));
+					return false;
+				}
+				const int n = av_audio_fifo_read(s.pFifo, reinterpret_cast<void**>(s.pEncFrame->data),
+												 std::min(nAvail, frameSize));
+				if( n < frameSize ) {
+					av_samples_set_silence(s.pEncFrame->data, n, frameSize - n,
+										   getChannels(s.pEnc), s.pEnc->sample_fmt);
+				}
+				s.pEncFrame->pts = s.nextAudioPts;
+				s.nextAudioPts += frameSize;
+				pFrame = s.pEncFrame;
+			} else if( fFlush ) {
+				pFrame = nullptr;
+			} else {
+				return true; // wait for more samples
+			}
+		}
+
+		int res = avcodec_send_frame(s.pEnc, pFrame);
+		if( res < 0 && res != AVERROR_EOF ) {
+			_ERROR("Failed to encode " << s.name << " frame: " << avErrorStr(res));
+			return false;
+		}
+		while( (res = avcodec_receive_packet(s.pEnc, s.pOutPkt)) >= 0 ) {
+			if( !writePacket(s) ) {
+				return false;
+			}
+		}
+		if( res != AVERROR(EAGAIN) && res != AVERROR_EOF ) {
+			_ERROR("Failed to receive " << s.name << " packet: " << avErrorStr(res));
+			return false;
+		}
+		// video sends single frame, audio drains fifo, flush
+		// ends with null frame
+		if( s.fVideo || pFrame == nullptr ) {
+			return true;
+		}
+	}
+}
+
+void LibavRecorder::encodeVideoLoop(RecorderStream& s) {
+	// bus is closed on stop, queued frames are encoded first
+	std::shared_ptr<const VideoFrame> pFrame;
+	while( m_pEncoderQueue->pop(pFrame, -1) ) {
+		if( m_videoPaused ) {
+			pFrame.reset();
+			s.paused++;
+			s.forceKey = true;
+			continue;
+		}
+		if( m_keyRequested.exchange(false) ) {
+			s.forceKey = true;
+		}
+		const int64_t captureUs = pFrame->captureUs;
+		int res = av_frame_ref(s.pInFrame, pFrame->pFrame);
+		pFrame.reset();
+		if( res < 0 ) {
+			_ERROR("Failed to reference captured video frame: " << avErrorStr(res));
+			continue;
+		}
+		s.pending.emplace_back(0, captureUs);
+		const bool fOk = encodeFrame(s, false);
+		av_frame_unref(s.pInFrame);
+		if( !fOk ) {
+			m_failed = true;
+		}
+	}
+	// flush encoder at the end
+	if( !encodeFrame(s, true) ) {
+		m_failed = true;
+	}
+}
+
+std::string LibavRecorder::finishOutput(bool fRotate, int64_t endUs) {
+	const int res = av_write_trailer(m_pOut);
+	if( res < 0 ) {
+		_ERROR("Failed to finalize output " << m_outFile << ": " << avErrorStr(res));
+	}
+	_INFO("Stopped libav recorder output: " << m_outFile);
+	const bool fEmpty = m_outBaseUs == AV_NOPTS_VALUE;
+	const SegmentInfo info{
+			m_segIndex,
+			m_outFile,
+			fEmpty ? 0 : m_outBaseUs - m_segOriginUs,
+			fEmpty || endUs == AV_NOPTS_VALUE ? 0 : endUs - m_outBaseUs,
+			m_outBytes
+	};
+	closeOutput();
+	return m_segmentCallback ? m_segmentCallback(info, fRotate) : "";
+}
+
+bool LibavRecorder::isSegmentDue(int64_t tsUs) const {
+	if( m_outBaseUs == AV_NOPTS_VALUE ) {
+		return false;
+	}
+	return (m_opts.segmentSec > 0 && tsUs - m_outBaseUs >= m_opts.segmentSec * 1000000LL) ||
+		   (m_opts.segmentMb > 0 && m_outBytes >= static_cast<uint64_t>(m_opts.segmentMb) * 1048576);
+}
+
+bool LibavRecorder::openAudioEncoder(RecorderStream& s) {
+	const AVCodec* pCodec = avcodec_find_encoder_by_name(s.encOpts.codec.c_str());
+	if( !pCodec || pCodec->type != AVMEDIA_TYPE_AUDIO ) {
+		_ERROR("Audio encoder not found: " << s.encOpts.codec);
+		return false;
+	}
+	s.pEnc = avcodec_alloc_context3(pCodec);
+	s.pEnc->sample_fmt = pCodec->sample_fmts ? pCodec->sample_fmts[0] : s.pDec->sample_fmt;
+	s.pEnc->sample_rate = s.encOpts.sampleRate > 0 ? s.encOpts.sampleRate : s.pDec->sample_rate;
+#ifdef CAPTURE_LIBAV_CH_LAYOUT
+	if( s.encOpts.channels > 0 ) {
+		av_channel_layout_default(&s.pEnc->ch_layout, s.encOpts.channels);
+	} else {
+		av_channel_layout_copy(&s.pEnc->ch_layout, &s.pDec->ch_layout);
+	}
+#else
+	s.pEnc->channels = s.encOpts.channels > 0 ? s.encOpts.channels : s.pDec->channels;
+	s.pEnc->channel_layout = av_get_default_channel_layout(s.pEnc->channels);
+#endif
+	s.pEnc->time_base = AVRational{1, s.pEnc->sample_rate};
+	if( s.encOpts.bitRate > 0 ) {
+		s.pEnc->bit_rate = s.encOpts.bitRate;
+	}
+	if( m_fGlobalHeader ) {
+		s.pEnc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+	AVDictionary* pDict = nullptr;
+	dictFromMap(s.encOpts.options, &pDict);
+	int res = avcodec_open2(s.pEnc, pCodec, &pDict);
+	warnUnusedOptions("audio encoder", pDict);
+	av_dict_free(&pDict);
+	if( res < 0 ) {
+		_ERROR("Failed to open audio encoder " << s.encOpts.codec << ": " << avErrorStr(res));
+		return false;
+	}
+
+	// resampler from captured to encoder format
+#ifdef CAPTURE_LIBAV_CH_LAYOUT
+	res = swr_alloc_set_opts2(&s.pSwr,
+							  &s.pEnc->ch_layout, s.pEnc->sample_fmt, s.pEnc->sample_rate,
+							  &s.pDec->ch_layout, s.pDec->sample_fmt, s.pDec->sample_rate,
+							  0, nullptr);
+#else
+	s.pSwr = swr_alloc_set_opts(nullptr,
+								s.pEnc->channel_layout, s.pEnc->sample_fmt, s.pEnc->sample_rate,
+								s.pDec->channel_layout ? s.pDec->channel_layout :
+									av_get_default_channel_layout(s.pDec->channels),
+								s.pDec->sample_fmt, s.pDec->sample_rate,
+								0, nullptr);
+	res = s.pSwr ? 0 : AVERROR(ENOMEM);
+#endif
+	if( res < 0 || (res = swr_init(s.pSwr)) < 0 ) {
+		_ERROR("Failed to create audio resampler: " << avErrorStr(res));
+		return false;
+	}
+
+	const int frameSize = s.pEnc->frame_size > 0 ? s.pEnc->frame_size : 1024;
+	s.pFifo = av_audio_fifo_alloc(s.pEnc->sample_fmt, getChannels(s.pEnc), frameSize);
+	s.pEncFrame = av_frame_alloc();
+	s.pEncFrame->format = s.pEnc->sample_fmt;
+	s.pEncFrame->sample_rate = s.pEnc->sample_rate;
+	s.pEncFrame->nb_samples = frameSize;
+#ifdef CAPTURE_LIBAV_CH_LAYOUT
+	av_channel_layout_copy(&s.pEncFrame->ch_layout, &s.pEnc->ch_layout);
+#else
+	s.pEncFrame->channel_layout = s.pEnc->channel_layout;
+#endif
+	if( !s.pFifo || av_frame_get_buffer(s.pEncFrame, 0) < 0 ) {
+		_ERROR("Failed to allocate audio buffers");
+		return false;
+	}
+	return true;
+}
+
+bool LibavRecorder::openInput(RecorderStream& s) {
+	InputFormatPtr pFormat = av_find_input_format(s.inOpts.format.c_str());
+	if( !pFormat ) {
+		_ERROR("Input format not found: " << s.inOpts.format);
+		return false;
+	}
+	AVDictionary* pDict = nullptr;
+	dictFromMap(s.inOpts.options, &pDict);
+	// non-blocking reads, so capture thread can be stopped
+	// when device provides no data
+	s.pIn = avformat_alloc_context();
+	s.pIn->flags |= AVFMT_FLAG_NONBLOCK;
+	s.pIn->interrupt_callback.callback = interruptCallback;
+	s.pIn->interrupt_callback.opaque = &s;
+	int res = avformat_open_input(&s.pIn, s.inOpts.device.c_str(), pFormat, &pDict);
+	warnUnusedOptions(s.inOpts.format.c_str(), pDict);
+	av_dict_free(&pDict);
+	if( res < 0 ) {
+		_ERROR("Failed to open " << s.name << " input " << s.inOpts.device << ": " << avErrorStr(res));
+		return false;
+	}
+	res = avformat_find_stream_info(s.pIn, nullptr);
+	if( res < 0 ) {
+		_ERROR("Failed to read " << s.name << " stream info: " << avErrorStr(res));
+		return false;
+	}
+	s.inIndex = av_find_best_stream(s.pIn, s.fVideo ? AVMEDIA_TYPE_VIDEO : AVMEDIA_TYPE_AUDIO,
+									-1, -1, nullptr, 0);
+	if( s.inIndex < 0 ) {
+		_ERROR("No " << s.name << " stream in input: " << s.inOpts.device);
+		return false;
+	}
+
+	// decoder of captured packets, e.g. rawvideo or pcm
+	const AVCodecParameters* pPar = s.pIn->streams[s.inIndex]->codecpar;
+	const AVCodec* pDecoder = avcodec_find_decoder(pPar->codec_id);
+	if( !pDecoder ) {
+		_ERROR("No decoder for captured " << s.name << " codec: " << avcodec_get_name(pPar->codec_id));
+		return false;
+	}
+	s.pDec = avcodec_alloc_context3(pDecoder);
+	avcodec_parameters_to_context(s.pDec, pPar);
+	s.inTimeBase = s.pIn->streams[s.inIndex]->time_base;
+	s.pDec->pkt_timebase = s.inTimeBase;
+	res = avcodec_open2(s.pDec, pDecoder, nullptr);
+	if( res < 0 ) {
+		_ERROR("Failed to open " << s.name << " decoder: " << avErrorStr(res));
+		return false;
+	}
+	s.pInFrame = av_frame_alloc();
+	s.pOutPkt = av_packet_alloc();
+	return true;
+}
+
+bool LibavRecorder::openOutput(const std::string& outFile, const std::string& comment) {
+	int res = avformat_alloc_output_context2(&m_pOut, nullptr, nullptr, outFile.c_str());
+	if( res < 0 || !m_pOut ) {
+		_ERROR("Failed to create output " << outFile << ": " << avErrorStr(res));
+		return false;
+	}
+	// write packets to file immediately, like -flush_packets 1
+	m_pOut->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+	if( !comment.empty() ) {
+		av_dict_set(&m_pOut->metadata, "comment", comment.c_str(), 0);
+	}
+	// output streams in video, audio order as with ffmpeg
+	bool fOk = true;
+	for (RecorderStream* s: {m_video.get(), m_audio.get()}) {
+		if( !fOk || !s ) continue;
+		s->pOutStream = avformat_new_stream(m_pOut, nullptr);
+		fOk = s->pOutStream && avcodec_parameters_from_context(s->pOutStream->codecpar, s->pEnc) >= 0;
+		if( fOk ) {
+			s->pOutStream->time_base = s->pEnc->time_base;
+		}
+	}
+	if( fOk && !(m_pOut->oformat->flags & AVFMT_NOFILE) ) {
+		res = avio_open(&m_pOut->pb, outFile.c_str(), AVIO_FLAG_WRITE);
+		if( res < 0 ) {
+			_ERROR("Failed to open output file " << outFile << ": " << avErrorStr(res));
+			fOk = false;
+		}
+	}
+	if( fOk ) {
+		res = avformat_write_header(m_pOut, nullptr);
+		if( res < 0 ) {
+			_ERROR("Failed to write header " << outFile << ": " << avErrorStr(res));
+			fOk = false;
+		}
+	}
+	if( !fOk ) {
+		closeOutput();
+		return false;
+	}
+	m_outFile = outFile;
+	m_outComment = comment;
+	return true;
+}
+
+bool LibavRecorder::openVideoEncoder(RecorderStream& s) {
+	const AVCodec* pCodec = avcodec_find_encoder_by_name(s.encOpts.codec.c_str());
+	if( !pCodec || pCodec->type != AVMEDIA_TYPE_VIDEO ) {
+		_ERROR("Video encoder not found: " << s.encOpts.codec);
+		return false;
+	}
+	AVPixelFormat pixFmt = s.pDec->pix_fmt;
+	if( !s.encOpts.pixFmt.empty() ) {
+		pixFmt = av_get_pix_fmt(s.encOpts.pixFmt.c_str());
+		if( pixFmt == AV_PIX_FMT_NONE ) {
+			_ERROR("Invalid pixel format: " << s.encOpts.pixFmt);
+			return false;
+		}
+	} else if( pCodec->pix_fmts ) {
+		// closest to captured one, like ffmpeg does
+		pixFmt = avcodec_find_best_pix_fmt_of_list(pCodec->pix_fmts, s.pDec->pix_fmt, 0, nullptr);
+	}
+
+	const AVStream* pInStream = s.pIn->streams[s.inIndex];
+	s.pEnc = avcodec_alloc_context3(pCodec);
+	s.pEnc->width = s.pDec->width;
+	s.pEnc->height = s.pDec->height;
+	s.pEnc->pix_fmt = pixFmt;
+	s.pEnc->sample_aspect_ratio = s.pDec->sample_aspect_ratio;
+	// capture timestamps are kept, so frames are not
+	// duplicated or dropped to constant frame rate
+	s.pEnc->time_base = pInStream->time_base;
+	s.pEnc->framerate = av_guess_frame_rate(s.pIn, const_cast<AVStream*>(pInStream), nullptr);
+	if( s.encOpts.bitRate > 0 ) s.pEnc->bit_rate = s.encOpts.bitRate;
+	if( s.encOpts.maxRate > 0 ) s.pEnc->rc_max_rate = s.encOpts.maxRate;
+	if( s.encOpts.bufSize > 0 ) s.pEnc->rc_buffer_size = static_cast<int>(s.encOpts.bufSize);
+	if( s.encOpts.gopSize >= 0 ) s.pEnc->gop_size = s.encOpts.gopSize;
+	if( s.encOpts.nThreads > 0 ) s.pEnc->thread_count = s.encOpts.nThreads;
+	if( m_fGlobalHeader ) {
+		s.pEnc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+	AVDictionary* pDict = nullptr;
+	dictFromMap(s.encOpts.options, &pDict);
+	int res = avcodec_open2(s.pEnc, pCodec, &pDict);
+	warnUnusedOptions("video encoder", pDict);
+	av_dict_free(&pDict);
+	if( res < 0 ) {
+		_ERROR("Failed to open video encoder " << s.encOpts.codec << ": " << avErrorStr(res));
+		return false;
+	}
+
+	s.pSws = sws_getContext(s.pDec->width, s.pDec->height, s.pDec->pix_fmt,
+							s.pEnc->width, s.pEnc->height, s.pEnc->pix_fmt,
+							SWS_BILINEAR, nullptr, nullptr, nullptr);
+	s.pEncFrame = av_frame_alloc();
+	s.pEncFrame->format = s.pEnc->pix_fmt;
+	s.pEncFrame->width = s.pEnc->width;
+	s.pEncFrame->height = s.pEnc->height;
+	if( !s.pSws || av_frame_get_buffer(s.pEncFrame, 0) < 0 ) {
+		_ERROR("Failed to create video converter " << av_get_pix_fmt_name(s.pDec->pix_fmt)
+			<< " -> " << av_get_pix_fmt_name(s.pEnc->pix_fmt));
+		return false;
+	}
+	return true;
+}
+
+void LibavRecorder::publishAudio(RecorderStream& s, int64_t captureUs) {
+	std::shared_ptr<AudioTap> pTap;
+	{
+		std::lock_guard<std::mutex> lock(m_tapMutex);
+		pTap = m_pAudioTap;
+	}
+	const AVFrame* pFrame = s.pInFrame;
+	const int channels = getChannels(s.pDec);
+	const int rate = pFrame->sample_rate > 0 ? pFrame->sample_rate : s.pDec->sample_rate;
+	if( !pTap || pFrame->nb_samples <= 0 || channels <= 0 || rate <= 0 ) {
+		return;
+	}
+	s.tapSamples.resize(pFrame->nb_samples);
+	if( !getMonoSamples(pFrame, channels, s.tapSamples.data()) ) {
+		if( !s.fTapFormatError ) {
+			s.fTapFormatError = true;
+			_ERROR("Audio tap doesn't support sample format: "
+				   << av_get_sample_fmt_name(static_cast<AVSampleFormat>(pFrame->format)));
+		}
+		return;
+	}
+	pTap->sampleRate = rate;
+	// packet is read when its last sample is captured
+	const AudioTapAnchor anchor{pTap->written, captureUs - av_rescale(pFrame->nb_samples, 1000000, rate)};
+	pTap->anchors.push(&anchor, 1);
+	const size_t written = pTap->samples.push(s.tapSamples.data(), s.tapSamples.size());
+	pTap->written += written;
+	pTap->dropped += s.tapSamples.size() - written;
+}
+
+void LibavRecorder::publishVideo(RecorderStream& s, AVPacket* pkt, int64_t captureUs) {
+	// raw video decoding references packet data, so
+	// frames are not copied here
+	int res = avcodec_send_packet(s.pDec, pkt);
+	av_packet_free(&pkt);
+	if( res < 0 ) {
+		_ERROR("Failed to decode captured video packet: " << avErrorStr(res));
+		return;
+	}
+	while( true ) {
+		AVFrame* pDecoded = av_frame_alloc();
+		if( !pDecoded ) {
+			_ERROR("Failed to allocate captured video frame");
+			return;
+		}
+		res = avcodec_receive_frame(s.pDec, pDecoded);
+		if( res < 0 ) {
+			av_frame_free(&pDecoded);
+			if( res != AVERROR(EAGAIN) && res != AVERROR_EOF ) {
+				_ERROR("Failed to decode captured video frame: " << avErrorStr(res));
+			}
+			return;
+		}
+		auto pFrame = std::make_shared<VideoFrame>();
+		pFrame->number = s.captured++;
+		pFrame->captureUs = captureUs;
+		const int64_t pts = pDecoded->best_effort_timestamp != AV_NOPTS_VALUE ?
+							pDecoded->best_effort_timestamp : pDecoded->pts;
+		pFrame->ptsUs = pts == AV_NOPTS_VALUE ? 0 :
+						av_rescale_q(pts, s.inTimeBase, US_TIME_BASE);
+		pFrame->width = pDecoded->width;
+		pFrame->height = pDecoded->height;
+		pFrame->pixFmt = pDecoded->format;
+		for (int i = 0; i < 4; i++) {
+			pFrame->data[i] = pDecoded->data[i];
+			pFrame->linesize[i] = pDecoded->linesize[i];
+		}
+		setComponents(*pFrame);
+		pFrame->pFrame = pDecoded;
+		m_videoBus.publish(pFrame);
+	}
+}
+
+void LibavRecorder::readLoop(RecorderStream& s) {
+	while( !s.readStop ) {
+		AVPacket* pkt = av_packet_alloc();
+		const int res = av_read_frame(s.pIn, pkt);
+		if( res == AVERROR(EAGAIN) ) {
+			av_packet_free(&pkt);
+			SLEEP_MS(2);
+			continue;
+		}
+		if( res < 0 ) {
+			av_packet_free(&pkt);
+			if( !s.readStop ) {
+				_ERROR("Failed to capture " << s.name << ": " << avErrorStr(res));
+				m_failed = true;
+			}
+			break;
+		}
+		if( pkt->stream_index != s.inIndex ) {
+			av_packet_free(&pkt);
+			continue;
+		}
+		if( s.fVideo ) {
+			publishVideo(s, pkt, av_gettime_relative());
+			continue;
+		}
+		s.captured++;
+		QueuedPacket qp{pkt, av_gettime_relative()};
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			// keep capture going when encoder is behind,
+			// drop the oldest frame
+			if( s.queue.size() >= s.queueSize ) {
+				av_packet_free(&s.queue.front().pkt);
+				s.queue.pop_front();
+				s.dropped++;
+			}
+			s.queue.push_back(qp);
+			s.maxDepth = std::max(s.maxDepth, s.queue.size());
+		}
+		s.cond.notify_one();
+	}
+}
+
+RecorderStats LibavRecorder::getStats() const {
+	RecorderStats stats;
+	if( m_video ) {
+		stats.videoFrames = m_video->captured;
+		stats.videoEncoded = m_video->encoded;
+		stats.videoPaused = m_video->paused;
+		const uint64_t n = m_video->nLatency;
+		stats.encodeLatencyAvgUs = n > 0 ? m_video->latencySumUs / static_cast<int64_t>(n) : 0;
+		stats.encodeLatencyMaxUs = m_video->latencyMaxUs;
+	}
+	if( m_pEncoderQueue ) {
+		stats.videoDropped = m_pEncoderQueue->getDropped();
+		stats.videoQueueDepth = m_pEncoderQueue->getDepth();
+		stats.videoMaxQueueDepth = m_pEncoderQueue->getMaxDepth();
+	}
+	for (const auto& q: m_videoBus.getSubscribers()) {
+		if( q != m_pEncoderQueue ) {
+			stats.busSubscribers++;
+			stats.busDropped += q->getDropped();
+		}
+	}
+	if( m_audio ) {
+		stats.audioPackets = m_audio->captured;
+		stats.audioEncoded = m_audio->encoded;
+		stats.audioDropped = m_audio->dropped;
+		stats.audioQueueDepth = m_audio->getDepth();
+		stats.audioMaxQueueDepth = m_audio->getMaxDepth();
+	}
+	stats.bytesWritten = m_bytesWritten;
+	{
+		std::lock_guard<std::mutex> lock(m_outMutex);
+		stats.preRollUs = m_preRoll ? m_preRoll->getDurationUs() : 0;
+	}
+	return stats;
+}
+
+bool LibavRecorder::start() {
+	avdevice_register_all();
+	const size_t queueSize = m_opts.queueSize > 0 ? m_opts.queueSize : 1;
+	m_video = std::make_unique<RecorderStream>("video", true, m_opts.videoIn, m_opts.videoEnc, queueSize);
+	if( m_opts.hasAudio ) {
+		m_audio = std::make_unique<RecorderStream>("audio", false, m_opts.audioIn, m_opts.audioEnc, queueSize);
+	}
+	// encoders are opened before output, so they can be
+	// reused by outputs opened later
+	const std::string probeFile = m_opts.outFile.empty() ? "out." + m_opts.outFormat : m_opts.outFile;
+	const AVOutputFormat* pFormat = av_guess_format(nullptr, probeFile.c_str(), nullptr);
+	if( !pFormat ) {
+		_ERROR("Output format not found: " << probeFile);
+		close();
+		m_failed = true;
+		return false;
+	}
+	m_fGlobalHeader = (pFormat->flags & AVFMT_GLOBALHEADER) != 0;
+	m_pWritePkt = av_packet_alloc();
+	bool fOk = m_pWritePkt && openInput(*m_video) && (!m_audio || openInput(*m_audio)) &&
+			   openVideoEncoder(*m_video) && (!m_audio || openAudioEncoder(*m_audio));
+	if( fOk && !m_opts.outFile.empty() ) {
+		fOk = openOutput(m_opts.outFile, m_opts.comment);
+		m_segIndex = 0;
+		m_segOriginUs = AV_NOPTS_VALUE;
+	}
+	if( !fOk ) {
+		close();
+		m_failed = true;
+		return false;
+	}
+	if( m_opts.preRollMs > 0 ) {
+		m_preRoll = std::make_unique<PreRollRing>(m_opts.preRollMs * 1000LL, 0);
+	}
+	for (const auto& opt: m_opts.ignored) {
+		_INFO("Ignored ffmpeg option in libav recorder: " << opt);
+	}
+	_INFO("Started libav recorder: " << (m_opts.outFile.empty() ? "<no output>" : m_opts.outFile)
+		<< ", video " << m_video->pEnc->width << "x" << m_video->pEnc->height
+		<< " " << av_get_pix_fmt_name(m_video->pEnc->pix_fmt) << " " << m_opts.videoEnc.codec
+		<< (m_audio ? ", audio " + m_opts.audioEnc.codec : std::string(", no audio"))
+		<< ", pre-roll " << m_opts.preRollMs << " ms");
+
+	m_pEncoderQueue = m_videoBus.subscribe("encoder", queueSize, BUS_DROP_OLDEST);
+	m_running = true;
+	m_capturing = true;
+	for (RecorderStream* s: {m_video.get(), m_audio.get()}) {
+		if( s ) {
+			s->encodeThread = std::thread(s->fVideo ? &LibavRecorder::encodeVideoLoop :
+										  &LibavRecorder::encodeLoop, this, std::ref(*s));
+			s->readThread = std::thread(&LibavRecorder::readLoop, this, std::ref(*s));
+		}
+	}
+	return true;
+}
+
+bool LibavRecorder::startOutput(const std::string& outFile, const std::string& comment,
+								int64_t* pPreRollUs) {
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	if( !m_running ) {
+		_ERROR("Failed to open output " << outFile << ", recorder is not running");
+		return false;
+	}
+	if( m_pOut ) {
+		_ERROR("Failed to open output " << outFile << ", already recording to " << m_outFile);
+		return false;
+	}
+	if( !openOutput(outFile, comment) ) {
+		m_failed = true;
+		return false;
+	}
+	m_segIndex = 0;
+	m_segOriginUs = AV_NOPTS_VALUE;
+	int64_t preRollUs = 0;
+	if( m_preRoll ) {
+		for (const auto& e: m_preRoll->getEntries()) {
+			RecorderStream* s = e.stream == 0 ? m_video.get() : m_audio.get();
+			if( s && !writeOutputPacket(*s, e.data.get()) ) {
+				m_failed = true;
+				return false;
+			}
+		}
+		preRollUs = m_preRoll->getDurationUs();
+	}
+	if( pPreRollUs ) {
+		*pPreRollUs = preRollUs;
+	}
+	_INFO("Started libav recorder output: " << outFile << ", pre-roll " << preRollUs / 1000 << " ms");
+	return true;
+}
+
+bool LibavRecorder::rotateOutput(int64_t tsUs) {
+	m_rotateRequested = false;
+	// segment ends where the next one starts
+	const std::string comment = m_outComment;
+	const std::string nextFile = finishOutput(true, tsUs);
+	if( nextFile.empty() ) {
+		_ERROR("No file name for the next output segment");
+		return false;
+	}
+	if( !openOutput(nextFile, comment) ) {
+		return false;
+	}
+	m_segIndex++;
+	m_fOutContinued = true;
+	_INFO("Started libav recorder segment " << m_segIndex << ": " << nextFile);
+	return true;
+}
+
+void LibavRecorder::setSegmentCallback(const SegmentCallback& callback) {
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	m_segmentCallback = callback;
+}
+
+void LibavRecorder::stop() {
+	if( !m_running ) {
+		return;
+	}
+	// stop capture first, then let encoders drain queues and flush
+	stopCapture();
+	for (RecorderStream* s: {m_video.get(), m_audio.get()}) {
+		if( s ) {
+			if( s->fVideo ) {
+				// closes analyzers queues as well
+				m_videoBus.close();
+			} else {
+				std::lock_guard<std::mutex> lock(s->mutex);
+				s->encodeStop = true;
+			}
+			s->cond.notify_one();
+			s->encodeThread.join();
+		}
+	}
+	stopOutput();
+	_INFO("Stopped libav recorder: " << recorderStatsToString(getStats()));
+	m_running = false;
+	close();
+}
+
+void LibavRecorder::stopCapture() {
+	if( !m_capturing ) {
+		return;
+	}
+	m_capturing = false;
+	for (RecorderStream* s: {m_video.get(), m_audio.get()}) {
+		if( s && s->readThread.joinable() ) {
+			s->readStop = true;
+			s->readThread.join();
+			avformat_close_input(&s->pIn);
+		}
+	}
+}
+
+void LibavRecorder::stopOutput() {
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	if( !m_pOut ) {
+		return;
+	}
+	finishOutput(false, m_outLastUs);
+	m_segmentCallback = nullptr;
+}
+
+bool LibavRecorder::writeOutputPacket(RecorderStream& s, const AVPacket* pkt) {
+	const int64_t tsUs = getPacketUs(s, pkt);
+	if( m_outBaseUs == AV_NOPTS_VALUE ) {
+		// output starts with video keyframe
+		if( !s.fVideo || !(pkt->flags & AV_PKT_FLAG_KEY) ) {
+			return true;
+		}
+		m_outBaseUs = tsUs;
+		if( m_segOriginUs == AV_NOPTS_VALUE ) {
+			m_segOriginUs = tsUs;
+		}
+	}
+	// older audio of continued segment is kept, so there
+	// is no gap between segments
+	if( tsUs < m_outBaseUs && !m_fOutContinued ) {
+		return true;
+	}
+	int res = av_packet_ref(m_pWritePkt, pkt);
+	if( res < 0 ) {
+		_ERROR("Failed to reference " << s.name << " packet: " << avErrorStr(res));
+		return false;
+	}
+	// output timestamps start from zero
+	const int64_t base = av_rescale_q(m_outBaseUs, US_TIME_BASE, s.pEnc->time_base);
+	if( m_pWritePkt->pts != AV_NOPTS_VALUE ) m_pWritePkt->pts -= base;
+	if( m_pWritePkt->dts != AV_NOPTS_VALUE ) m_pWritePkt->dts -= base;
+	av_packet_rescale_ts(m_pWritePkt, s.pEnc->time_base, s.pOutStream->time_base);
+	m_pWritePkt->stream_index = s.pOutStream->index;
+	const int size = m_pWritePkt->size;
+	res = av_interleaved_write_frame(m_pOut, m_pWritePkt);
+	if( res < 0 ) {
+		_ERROR("Failed to write " << s.name << " packet: " << avErrorStr(res));
+		return false;
+	}
+	m_bytesWritten += size;
+	m_outBytes += size;
+	if( m_outLastUs == AV_NOPTS_VALUE || tsUs > m_outLastUs ) {
+		m_outLastUs = tsUs;
+	}
+	return true;
+}
+
+bool LibavRecorder::writePacket(RecorderStream& s) {
+	AVPacket* pkt = s.pOutPkt;
+	if( s.fVideo ) {
+		// capture to write latency of the frame, no reordering
+		// is expected, so older pending frames are discarded
+		while( !s.pending.empty() && s.pending.front().first <= pkt->pts ) {
+			if( s.pending.front().first == pkt->pts ) {
+				const int64_t latencyUs = av_gettime_relative() - s.pending.front().second;
+				s.latencySumUs += latencyUs;
+				updateMax(s.latencyMaxUs, latencyUs);
+				s.nLatency++;
+			}
+			s.pending.pop_front();
+		}
+	}
+	s.encoded++;
+	bool fOk = true;
+	{
+		const int64_t tsUs = getPacketUs(s, pkt);
+		const bool fKey = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+		std::lock_guard<std::mutex> lock(m_outMutex);
+		if( m_preRoll ) {
+			PacketPtr pClone(av_packet_clone(pkt));
+			if( pClone ) {
+				m_preRoll->push(PreRollEntry<PacketPtr>{std::move(pClone), s.id, tsUs, fKey,
+						static_cast<size_t>(pkt->size)});
+			}
+		}
+		if( m_pOut && s.fVideo && fKey && (m_rotateRequested || isSegmentDue(tsUs)) ) {
+			fOk = rotateOutput(tsUs);
+		}
+		if( fOk && m_pOut ) {
+			fOk = writeOutputPacket(s, pkt);
+		}
+	}
+	av_packet_unref(pkt);
+	return fOk;
+}
+
+bool isLibavRecorderSupported() {
+	return true;
+}
+
+#else // CAPTURE_LIBAV_ENABLED
+
+////////////////////////////////////////////////////////////////////////
+// LibavRecorder stub, built without libav
+
+struct RecorderStream {
+};
+
+VideoFrame::~VideoFrame() {
+}
+
+struct PreRollRing {
+};
+
+LibavRecorder::LibavRecorder(const RecorderOpts& opts): m_opts(opts) {
+	m_pOut = nullptr;
+	m_outBaseUs = 0;
+	m_outLastUs = 0;
+	m_outBytes = 0;
+	m_fOutContinued = false;
+	m_segIndex = 0;
+	m_segOriginUs = 0;
+	m_pWritePkt = nullptr;
+	m_fGlobalHeader = false;
+	m_failed = false;
+	m_running = false;
+	m_capturing = false;
+	m_bytesWritten = 0;
+	m_videoPaused = false;
+	m_keyRequested = false;
+	m_rotateRequested = false;
+}
+
+LibavRecorder::~LibavRecorder() {
+}
+
+RecorderStats LibavRecorder::getStats() const {
+	return RecorderStats();
+}
+
+bool LibavRecorder::start() {
+	_ERROR("Libav recorder is not supported, build with -DLIBAV_ENABLED=ON");
+	m_failed = true;
+	return false;
+}
+
+bool LibavRecorder::startOutput(const std::string& outFile, const std::string& comment,
+								int64_t* pPreRollUs) {
+	return false;
+}
+
+void LibavRecorder::setSegmentCallback(const SegmentCallback& callback) {
+	m_segmentCallback = callback;
+}
+
+void LibavRecorder::stop() {
+}
+
+void LibavRecorder::stopCapture() {
+}
+
+void LibavRecorder::stopOutput() {
+}
+
+bool isLibavRecorderSupported() {
+	return false;
+}
+
+#endif // CAPTURE_LIBAV_ENABLED
+
+bool LibavRecorder::requestRotate() {
+	std::lock_guard<std::mutex> lock(m_outMutex);
+	if( !m_pOut || !m_segmentCallback ) {
+		return false;
+	}
+	m_rotateRequested = true;
+	m_keyRequested = true;
+	return true;
+}
+
+void LibavRecorder::setVideoPaused(bool fPaused) {
+	if( m_videoPaused.exchange(fPaused) != fPaused ) {
+		_INFO("Libav recorder video encoding " << (fPaused ? "paused" : "resumed") << ": " << m_outFile);
+	}
+}
+
+std::shared_ptr<AudioTap> LibavRecorder::subscribeAudio(size_t capacity) {
+	if( !m_opts.hasAudio ) {
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(m_tapMutex);
+	if( m_pAudioTap ) {
+		_ERROR("Libav recorder audio is tapped already");
+		return nullptr;
+	}
+	m_pAudioTap = std::make_shared<AudioTap>(capacity);
+	_INFO("Subscribed to libav recorder audio, ring " << m_pAudioTap->samples.getCapacity() << " samples");
+	return m_pAudioTap;
+}
+
+std::shared_ptr<VideoFrameQueue> LibavRecorder::subscribeVideo(const std::string& name, size_t size,
+															   FrameBusPolicy policy, uint64_t stride) {
+	_INFO("Subscribed to libav recorder video: " << name << ", queue " << size << ", stride " << stride);
+	return m_videoBus.subscribe(name, size, policy, stride);
+}
+
+void LibavRecorder::unsubscribeAudio(const std::shared_ptr<AudioTap>& tap) {
+	std::lock_guard<std::mutex> lock(m_tapMutex);
+	if( tap && tap == m_pAudioTap ) {
+		m_pAudioTap.reset();
+	}
+}
+
+void LibavRecorder::unsubscribeVideo(const std::shared_ptr<VideoFrameQueue>& queue) {
+	if( queue ) {
+		m_videoBus.unsubscribe(queue);
+	}
+}
+
+Timestamp toCaptureTimestamp(int64_t captureUs) {
+	// av_gettime_relative() is monotonic clock, the same as
+	// steady_clock on Linux
+	const int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	const Timestamp ts = CURRENT_TIMESTAMP();
+	if( captureUs <= 0 || captureUs > nowUs ) {
+		return ts;
+	}
+	return ts - std::chrono::microseconds(nowUs - captureUs);
+}
+
+std::string recorderStatsToString(const RecorderStats& stats) {
+	std::ostringstream ss;
+	ss << "video: captured=" << stats.videoFrames
+	   << ", encoded=" << stats.videoEncoded
+	   << ", dropped=" << stats.videoDropped
+	   << ", paused=" << stats.videoPaused
+	   << ", depth=" << stats.videoQueueDepth
+	   << ", maxDepth=" << stats.videoMaxQueueDepth
+	   << ", latencyAvgUs=" << stats.encodeLatencyAvgUs
+	   << ", latencyMaxUs=" << stats.encodeLatencyMaxUs
+	   << "; audio: captured=" << stats.audioPackets
+	   << ", encoded=" << stats.audioEncoded
+	   << ", dropped=" << stats.audioDropped
+	   << ", depth=" << stats.audioQueueDepth
+	   << ", maxDepth=" << stats.audioMaxQueueDepth
+	   << "; bus: subscribers=" << stats.busSubscribers
+	   << ", dropped=" << stats.busDropped
+	   << "; bytes=" << stats.bytesWritten
+	   << ", preRollUs=" << stats.preRollUs;
+	return ss.str();
+}
@@ -0,0 +1,236 @@
+#ifndef CAPTURE_LIBAVRECORDER_H
+#define CAPTURE_LIBAVRECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "reprostim/CaptureLib.h"
+#include "FrameBus.h"
+#include "RecorderOpts.h"
+#include "SpscRing.h"
+
+using namespace reprostim;
+
+// libav* types, recorder is built without libav when
+// CAPTURE_LIBAV_ENABLED is not defined
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct RecorderStream;
+struct PreRollRing;
+
+// Recorder statistics/counters snapshot
+struct RecorderStats {
+	uint64_t videoFrames = 0;     // captured video frames
+	uint64_t videoEncoded = 0;    // encoded video packets
+	uint64_t videoDropped = 0;    // frames dropped on full queue
+	uint64_t videoPaused = 0;     // frames skipped while encoding is paused
+	size_t   videoQueueDepth = 0;
+	size_t   videoMaxQueueDepth = 0;
+	uint64_t audioPackets = 0;    // captured audio packets
+	uint64_t audioEncoded = 0;
+	uint64_t audioDropped = 0;
+	size_t   audioQueueDepth = 0;
+	size_t   audioMaxQueueDepth = 0;
+	uint64_t bytesWritten = 0;
+	int64_t  preRollUs = 0;          // buffered pre-roll length
+	int64_t  encodeLatencyAvgUs = 0; // video frame capture to packet written
+	int64_t  encodeLatencyMaxUs = 0;
+	size_t   busSubscribers = 0;     // video frame bus subscribers besides encoder
+	uint64_t busDropped = 0;         // frames dropped by them on full queues
+};
+
+// Location of 8-bit component samples in frame planes
+struct FrameComponent {
+	int plane = 0;
+	int step = 0;   // bytes between samples, 0 when unknown
+	int offset = 0;
+};
+
+// Captured video frame published on recorder frame bus, holds
+// reference to decoded libav frame, so pixel data is shared
+// by all subscribers
+struct VideoFrame {
+	uint64_t       number = 0;    // frame number since capture start, from 0
+	int64_t        captureUs = 0; // av_gettime_relative() when frame was read
+	int64_t        ptsUs = 0;     // capture timestamp
+	int            width = 0;
+	int            height = 0;
+	int            pixFmt = -1;   // AVPixelFormat
+	const uint8_t* data[4] = {};
+	int            linesize[4] = {};
+	// 8-bit Y, U, V (R, G, B when fRgb) locations for analyzers,
+	// so they don't depend on libav
+	FrameComponent comp[3];
+	bool           fRgb = false;
+	int            log2ChromaW = 0; // chroma subsampling
+	int            log2ChromaH = 0;
+	AVFrame*       pFrame = nullptr;
+
+	VideoFrame() = default;
+	VideoFrame(const VideoFrame&) = delete;
+	VideoFrame& operator=(const VideoFrame&) = delete;
+	~VideoFrame();
+};
+
+using VideoFrameQueue = FrameBusQueue<VideoFrame>;
+
+// Capture time of the first sample of block pushed to audio tap
+struct AudioTapAnchor {
+	uint64_t sample = 0;    // sample index since tap start
+	int64_t  captureUs = 0; // av_gettime_relative() time
+};
+
+// Captured audio downmixed to mono float samples, pushed lock-free
+// by recorder audio encoder thread and read by single analyzer
+// thread. Samples not fitting to ring are dropped.
+struct AudioTap {
+	SpscRing<float>          samples;
+	SpscRing<AudioTapAnchor> anchors;
+	std::atomic<int>         sampleRate{0}; // set before the first samples
+	std::atomic<uint64_t>    written{0};
+	std::atomic<uint64_t>    dropped{0};
+
+	explicit AudioTap(size_t capacity): samples(capacity), anchors(capacity / 64) {}
+};
+
+// Closed output file segment
+struct SegmentInfo {
+	int         index;       // segment number in session, from 0
+	std::string file;
+	int64_t     startUs;     // offset from the first segment start
+	int64_t     durationUs;
+	uint64_t    bytes;
+};
+
+// Called when output file segment is closed, on rotation (fRotate is
+// true) returns file name of the next segment. It is called from encoder
+// thread with muxer locked, so should not call recorder back.
+using SegmentCallback = std::function<std::string(const SegmentInfo& info, bool fRotate)>;
+
+// In-process recorder, reads V4L2 video and ALSA audio with
+// libavdevice, encodes and muxes with libavcodec/libavformat.
+// Each stream has capture and encoder threads with bounded
+// queue in between, muxer is shared.
+//
+// When pre-roll is enabled, recorder can run without output file
+// and keeps the most recent encoded packets, so output opened later
+// starts with them.
+//
+// When segments are enabled, output file is rotated on video keyframe
+// after specified duration or size, every packet is written to exactly
+// one segment.
+//
+// Captured video frames are decoded once and published on frame bus,
+// encoder is one of its subscribers, so analyzers can share the same
+// capture device without stalling encoding.
+class LibavRecorder {
+private:
+	const RecorderOpts              m_opts;
+	AVFormatContext*                m_pOut;
+	std::string                     m_outFile;
+	std::string                     m_outComment;
+	int64_t                         m_outBaseUs;  // output timestamps origin
+	int64_t                         m_outLastUs;
+	uint64_t                        m_outBytes;
+	bool                            m_fOutContinued; // output continues previous segment
+	int                             m_segIndex;
+	int64_t                         m_segOriginUs;  // the first segment timestamps origin
+	SegmentCallback                 m_segmentCallback;
+	AVPacket*                       m_pWritePkt;
+	std::unique_ptr<PreRollRing>    m_preRoll;
+	mutable std::mutex              m_outMutex;  // muxer and pre-roll access from encoder threads
+	std::unique_ptr<RecorderStream> m_video;
+	std::unique_ptr<RecorderStream> m_audio;
+	bool                            m_fGlobalHeader;
+	std::atomic<bool>               m_failed;
+	std::atomic<bool>               m_running;
+	std::atomic<bool>               m_capturing; // capture devices are open
+	std::atomic<uint64_t>           m_bytesWritten;
+	std::atomic<bool>               m_videoPaused;
+	std::atomic<bool>               m_keyRequested;    // next encoded video frame is keyframe
+	std::atomic<bool>               m_rotateRequested; // rotate output on next keyframe
+	FrameBus<VideoFrame>            m_videoBus;
+	std::shared_ptr<VideoFrameQueue> m_pEncoderQueue;
+	std::shared_ptr<AudioTap>       m_pAudioTap;
+	mutable std::mutex              m_tapMutex;
+
+	void close();
+	void closeOutput();
+	void encodeLoop(RecorderStream& s);
+	bool encodeFrame(RecorderStream& s, bool fFlush);
+	void encodeVideoLoop(RecorderStream& s);
+	std::string finishOutput(bool fRotate, int64_t endUs);
+	bool isSegmentDue(int64_t tsUs) const;
+	bool openInput(RecorderStream& s);
+	bool openOutput(const std::string& outFile, const std::string& comment);
+	bool openVideoEncoder(RecorderStream& s);
+	bool openAudioEncoder(RecorderStream& s);
+	void publishAudio(RecorderStream& s, int64_t captureUs);
+	void publishVideo(RecorderStream& s, AVPacket* pkt, int64_t captureUs);
+	void readLoop(RecorderStream& s);
+	bool rotateOutput(int64_t tsUs);
+	bool writeOutputPacket(RecorderStream& s, const AVPacket* pkt);
+	bool writePacket(RecorderStream& s);
+
+public:
+	explicit LibavRecorder(const RecorderOpts& opts);
+	~LibavRecorder();
+
+	const std::string& getOutFile() const { return m_outFile; }
+	RecorderStats getStats() const;
+	// true when running and capture devices are not released
+	bool isCapturing() const { return m_capturing; }
+	// true when capture or encoding failed and recorder should be restarted
+	bool isFailed() const { return m_failed; }
+	bool isRunning() const { return m_running; }
+	bool isVideoPaused() const { return m_videoPaused; }
+	// rotate output file on the next video frame, which is encoded
+	// as keyframe, returns false when there is no output or segment
+	// callback to name the next file
+	bool requestRotate();
+	// skip captured video frames instead of encoding them, capture
+	// and analyzers keep running, encoding resumes with keyframe
+	void setVideoPaused(bool fPaused);
+	// set callback for closed output segments, used until output is stopped
+	void setSegmentCallback(const SegmentCallback& callback);
+	// open devices and start capture/encoder threads, output file
+	// is opened as well when specified in options
+	bool start();
+	// open new output file on running recorder, pre-roll packets are
+	// written first, pPreRollUs receives written pre-roll length
+	bool startOutput(const std::string& outFile, const std::string& comment,
+					 int64_t* pPreRollUs = nullptr);
+	// stop capture, flush encoders and finalize output file
+	void stop();
+	// stop capture and release devices, so they can be opened by
+	// another recorder, encoding and output are finished by stop()
+	void stopCapture();
+	// finalize output file, capture keeps running into pre-roll
+	void stopOutput();
+	// tap captured audio as mono float samples, ring holds capacity
+	// samples, returns nullptr when there is no audio or it is tapped
+	// already
+	std::shared_ptr<AudioTap> subscribeAudio(size_t capacity);
+	// subscribe to captured video frames, every stride-th frame is
+	// queued, queue is closed when recorder stops
+	std::shared_ptr<VideoFrameQueue> subscribeVideo(const std::string& name, size_t size,
+													FrameBusPolicy policy, uint64_t stride = 1);
+	void unsubscribeAudio(const std::shared_ptr<AudioTap>& tap);
+	void unsubscribeVideo(const std::shared_ptr<VideoFrameQueue>& queue);
+};
+
+// true when built with libav* libraries
+bool isLibavRecorderSupported();
+
+// statistics to string
+std::string recorderStatsToString(const RecorderStats& stats);
+
+// system clock time of av_gettime_relative() timestamp, e.g.
+// VideoFrame::captureUs
+Timestamp toCaptureTimestamp(int64_t captureUs);
+
+#endif //CAPTURE_LIBAVRECORDER_H
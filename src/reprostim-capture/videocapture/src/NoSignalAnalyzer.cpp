@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstdlib>
+#include "NoSignalAnalyzer.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+// reference grid of rainbow pattern, centers of 6x8 cells sampled
+// from nosignal.png, the 3rd row is white "no signal" text band
+static const int GRID_ROWS = 6;
+static const int GRID_COLS = 8;
+
+static const uint8_t RAINBOW_BARS[GRID_COLS][3] = {
+		{253, 252, 255}, {253, 253, 3}, {1, 254, 255}, {0, 254, 2},
+		{254, 0, 255}, {253, 0, 1}, {0, 0, 252}, {0, 0, 0}
+};
+
+static const uint8_t RAINBOW_TEXT[GRID_COLS][3] = {
+		{253, 252, 255}, {253, 252, 255}, {251, 253, 255}, {253, 252, 255},
+		{253, 253, 253}, {253, 252, 255}, {253, 252, 255}, {0, 0, 0}
+};
+
+static inline uint8_t clampByte(int v) {
+	return static_cast<uint8_t>(std::clamp(v, 0, 255));
+}
+
+static inline int getSample(const VideoFrame& frame, const FrameComponent& comp, int x, int y) {
+	return frame.data[comp.plane][comp.offset + static_cast<ptrdiff_t>(y) * frame.linesize[comp.plane] +
+								  static_cast<ptrdiff_t>(x) * comp.step];
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+bool getPixelRgb(const VideoFrame& frame, int x, int y, uint8_t rgb[3]) {
+	if( x < 0 || y < 0 || x >= frame.width || y >= frame.height ) {
+		return false;
+	}
+	for (const FrameComponent& comp: frame.comp) {
+		if( comp.step > 0 && (comp.plane < 0 || comp.plane > 3 || !frame.data[comp.plane]) ) {
+			return false;
+		}
+	}
+	if( frame.fRgb ) {
+		for (int i = 0; i < 3; i++) {
+			if( frame.comp[i].step <= 0 ) {
+				return false;
+			}
+			rgb[i] = static_cast<uint8_t>(getSample(frame, frame.comp[i], x, y));
+		}
+		return true;
+	}
+	if( frame.comp[0].step <= 0 ) {
+		return false;
+	}
+	const int c = getSample(frame, frame.comp[0], x, y) - 16;
+	if( frame.comp[1].step <= 0 || frame.comp[2].step <= 0 ) {
+		// gray
+		rgb[0] = rgb[1] = rgb[2] = clampByte((298 * c + 128) >> 8);
+		return true;
+	}
+	const int cx = x >> frame.log2ChromaW;
+	const int cy = y >> frame.log2ChromaH;
+	const int d = getSample(frame, frame.comp[1], cx, cy) - 128;
+	const int e = getSample(frame, frame.comp[2], cx, cy) - 128;
+	rgb[0] = clampByte((298 * c + 409 * e + 128) >> 8);
+	rgb[1] = clampByte((298 * c - 100 * d - 208 * e + 128) >> 8);
+	rgb[2] = clampByte((298 * c + 516 * d + 128) >> 8);
+	return true;
+}
+
+double getRainbowDiff(const VideoFrame& frame) {
+	const int cy = frame.height / GRID_ROWS;
+	const int cx = frame.width / GRID_COLS;
+	if( cx <= 0 || cy <= 0 ) {
+		return -1;
+	}
+	int diff = 0;
+	uint8_t rgb[3];
+	for (int i = 0; i < GRID_ROWS; i++) {
+		const uint8_t (*ref)[3] = i == 2 ? RAINBOW_TEXT : RAINBOW_BARS;
+		for (int j = 0; j < GRID_COLS; j++) {
+			if( !getPixelRgb(frame, j * cx + cx / 2, i * cy + cy / 2, rgb) ) {
+				return -1;
+			}
+			for (int k = 0; k < 3; k++) {
+				diff += std::abs(rgb[k] - ref[j][k]);
+			}
+		}
+	}
+	return static_cast<double>(diff) / (GRID_ROWS * GRID_COLS);
+}
+
+////////////////////////////////////////////////////////////////////////
+// NoSignalTracker
+
+NoSignalTracker::NoSignalTracker(int64_t minUs): m_minUs(minUs) {
+	m_fActive = false;
+	m_fMatching = false;
+	m_frameStart = 0;
+	m_startUs = 0;
+}
+
+int NoSignalTracker::update(uint64_t frame, int64_t tsUs, bool fMatch) {
+	if( !fMatch ) {
+		m_fMatching = false;
+		if( m_fActive ) {
+			m_fActive = false;
+			return -1;
+		}
+		return 0;
+	}
+	if( !m_fMatching ) {
+		m_fMatching = true;
+		m_frameStart = frame;
+		m_startUs = tsUs;
+	}
+	if( !m_fActive && tsUs - m_startUs >= m_minUs ) {
+		m_fActive = true;
+		return 1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// NoSignalAnalyzer
+
+NoSignalAnalyzer::NoSignalAnalyzer(const NoSignalOpts& opts, const SessionLogger_ptr& pLogger,
+								   const NoSignalCallback& callback):
+		m_opts(opts), m_pLogger(pLogger), m_callback(callback) {
+	m_pRecorder = nullptr;
+	m_analyzed = 0;
+	m_matched = 0;
+	m_intervals = 0;
+}
+
+NoSignalAnalyzer::~NoSignalAnalyzer() {
+	stop();
+}
+
+void NoSignalAnalyzer::applyAction(bool fBegin) {
+	if( m_opts.action == VC_NOSIGNAL_PAUSE ) {
+		m_pRecorder->setVideoPaused(fBegin);
+	} else if( m_opts.action == VC_NOSIGNAL_ROTATE ) {
+		// no-signal part is recorded to own file
+		if( !m_pRecorder->requestRotate() ) {
+			_ERROR("Failed to rotate recorder output on no-signal " << (fBegin ? "begin" : "end"));
+		}
+	}
+}
+
+void NoSignalAnalyzer::run() {
+	_SESSION_LOG_BEGIN(m_pLogger);
+	_VERBOSE("NoSignalAnalyzer start");
+	NoSignalTracker tracker(m_opts.minMs * 1000LL);
+	std::shared_ptr<VideoFrameQueue> pQueue = m_pQueue;
+	std::shared_ptr<const VideoFrame> pFrame;
+	uint64_t lastFrame = 0;
+	int64_t lastUs = 0;
+	double lastDiff = -1;
+	while( pQueue->pop(pFrame, -1) ) {
+		lastFrame = pFrame->number;
+		lastUs = pFrame->captureUs;
+		lastDiff = getRainbowDiff(*pFrame);
+		pFrame.reset();
+		const bool fMatch = lastDiff >= 0 && lastDiff < m_opts.threshold;
+		m_analyzed++;
+		if( fMatch ) {
+			m_matched++;
+		}
+		const int event = tracker.update(lastFrame, lastUs, fMatch);
+		if( event > 0 ) {
+			m_intervals++;
+			applyAction(true);
+			m_callback(NoSignalEvent{true, tracker.getFrameStart(),
+									 toCaptureTimestamp(tracker.getStartUs()), 0, lastDiff});
+		} else if( event < 0 ) {
+			applyAction(false);
+			m_callback(NoSignalEvent{false, lastFrame, toCaptureTimestamp(lastUs),
+									 (lastUs - tracker.getStartUs()) / 1000000.0, lastDiff});
+		}
+	}
+	// session ends with no-signal, paused recorder can be
+	// used by the next session, output is not rotated anymore
+	if( tracker.isActive() ) {
+		if( m_opts.action == VC_NOSIGNAL_PAUSE ) {
+			m_pRecorder->setVideoPaused(false);
+		}
+		m_callback(NoSignalEvent{false, lastFrame, toCaptureTimestamp(lastUs),
+								 (lastUs - tracker.getStartUs()) / 1000000.0, lastDiff});
+	}
+	_VERBOSE("NoSignalAnalyzer leave");
+	_SESSION_LOG_END();
+}
+
+bool NoSignalAnalyzer::start(LibavRecorder& recorder) {
+	if( m_pRecorder ) {
+		return false;
+	}
+	m_pRecorder = &recorder;
+	m_pQueue = recorder.subscribeVideo("nosignal", VC_NOSIGNAL_QUEUE_SIZE, BUS_DROP_OLDEST,
+									   std::max(m_opts.stride, 1));
+	m_thread = std::thread(&NoSignalAnalyzer::run, this);
+	return true;
+}
+
+void NoSignalAnalyzer::stop() {
+	if( m_pRecorder && m_pQueue ) {
+		m_pRecorder->unsubscribeVideo(m_pQueue);
+	}
+	if( m_thread.joinable() ) {
+		m_thread.join();
+	}
+}
@@ -0,0 +1,129 @@
+#ifndef CAPTURE_NOSIGNALANALYZER_H
+#define CAPTURE_NOSIGNALANALYZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "reprostim/CaptureLib.h"
+#include "LibavRecorder.h"
+
+using namespace reprostim;
+
+// no-signal actions in vc_opts.nosignal_action
+#define VC_NOSIGNAL_NONE   "none"
+#define VC_NOSIGNAL_PAUSE  "pause"
+#define VC_NOSIGNAL_ROTATE "rotate"
+
+// check every N-th captured frame for no-signal pattern
+#ifndef VC_DEFAULT_NOSIGNAL_STRIDE
+#define VC_DEFAULT_NOSIGNAL_STRIDE 30
+#endif
+
+// max average RGB difference of grid points to reference pattern,
+// the same as in reprostim.video.nosignal.has_rainbow2
+#ifndef VC_DEFAULT_NOSIGNAL_THRESHOLD
+#define VC_DEFAULT_NOSIGNAL_THRESHOLD 35
+#endif
+
+// pattern must be seen at least this long before no-signal begins
+#ifndef VC_DEFAULT_NOSIGNAL_MIN_MS
+#define VC_DEFAULT_NOSIGNAL_MIN_MS 2000
+#endif
+
+// sampled frames waiting for analyzer, only the latest matter
+#ifndef VC_NOSIGNAL_QUEUE_SIZE
+#define VC_NOSIGNAL_QUEUE_SIZE 2
+#endif
+
+// No-signal pattern detection options
+struct NoSignalOpts {
+	bool        enabled = false;
+	int         stride = VC_DEFAULT_NOSIGNAL_STRIDE;
+	int         threshold = VC_DEFAULT_NOSIGNAL_THRESHOLD;
+	int         minMs = VC_DEFAULT_NOSIGNAL_MIN_MS;
+	std::string action = VC_NOSIGNAL_NONE;
+};
+
+// 8-bit RGB color of frame pixel, YUV is converted with BT.601
+// limited range, returns false when frame format is not supported
+bool getPixelRgb(const VideoFrame& frame, int x, int y, uint8_t rgb[3]);
+
+// Average RGB difference of Magewell "no signal" rainbow pattern
+// reference grid points to the same points of frame, -1 when frame
+// format is not supported
+double getRainbowDiff(const VideoFrame& frame);
+
+// Debounces per-frame pattern matches into no-signal intervals,
+// interval begins when pattern lasts at least minUs and ends on
+// the first frame without it
+class NoSignalTracker {
+private:
+	const int64_t m_minUs;
+	bool          m_fActive;
+	bool          m_fMatching; // pattern seen on the last update
+	uint64_t      m_frameStart;
+	int64_t       m_startUs;
+
+public:
+	explicit NoSignalTracker(int64_t minUs);
+
+	// the first frame with pattern in current or last interval
+	uint64_t getFrameStart() const { return m_frameStart; }
+	int64_t getStartUs() const { return m_startUs; }
+	bool isActive() const { return m_fActive; }
+	// returns 1 when no-signal begins, -1 when it ends on this
+	// frame and 0 otherwise
+	int update(uint64_t frame, int64_t tsUs, bool fMatch);
+};
+
+// No-signal interval begin or end
+struct NoSignalEvent {
+	bool      fBegin;
+	uint64_t  frame;       // the first frame with pattern or without it
+	Timestamp ts;          // capture time of the frame
+	double    durationSec; // interval length on end
+	double    diff;        // rainbow difference of the frame
+};
+
+// Called from analyzer thread with session logger set
+using NoSignalCallback = std::function<void(const NoSignalEvent& event)>;
+
+// Analyzer sampling captured frames from libav recorder frame bus
+// for Magewell "no signal" pattern, which is captured with valid
+// signal timing when source goes dark. Encoding is paused or output
+// is rotated while it lasts according to options.
+class NoSignalAnalyzer {
+private:
+	const NoSignalOpts               m_opts;
+	const SessionLogger_ptr          m_pLogger;
+	const NoSignalCallback           m_callback;
+	LibavRecorder*                   m_pRecorder;
+	std::shared_ptr<VideoFrameQueue> m_pQueue;
+	std::thread                      m_thread;
+	std::atomic<uint64_t>            m_analyzed;
+	std::atomic<uint64_t>            m_matched;
+	std::atomic<int>                 m_intervals;
+
+	void applyAction(bool fBegin);
+	void run();
+
+public:
+	NoSignalAnalyzer(const NoSignalOpts& opts, const SessionLogger_ptr& pLogger,
+					 const NoSignalCallback& callback);
+	~NoSignalAnalyzer();
+
+	// frames analyzed and with pattern found
+	uint64_t getAnalyzed() const { return m_analyzed; }
+	int getIntervals() const { return m_intervals; }
+	uint64_t getMatched() const { return m_matched; }
+	// subscribe to recorder video and start analyzer thread,
+	// recorder must outlive analyzer
+	bool start(LibavRecorder& recorder);
+	// unsubscribe, end open interval and undo its action
+	void stop();
+};
+
+#endif //CAPTURE_NOSIGNALANALYZER_H
@@ -0,0 +1,100 @@
+#ifndef CAPTURE_PREROLLBUFFER_H
+#define CAPTURE_PREROLLBUFFER_H
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Single encoded packet in pre-roll buffer
+template<typename T>
+struct PreRollEntry {
+	T       data;
+	int     stream;  // stream id, e.g. 0 - video, 1 - audio
+	int64_t tsUs;    // decoding timestamp in microseconds
+	bool    fKey;    // keyframe
+	size_t  size;    // payload size in bytes
+};
+
+// Ring of the most recent encoded packets, holds at least windowUs
+// of data and always starts with keyframe of the key stream, so
+// it can be written in front of new recording. Memory use is bounded
+// by window plus one GOP. Not thread-safe, caller should synchronize.
+template<typename T>
+class PreRollBuffer {
+private:
+	std::deque<PreRollEntry<T>> m_entries;
+	const int64_t               m_windowUs;
+	const int                   m_keyStream;
+	size_t                      m_bytes;
+
+	void trim();
+
+public:
+	PreRollBuffer(int64_t windowUs, int keyStream = 0);
+
+	void clear();
+	// duration between the oldest and the newest packet
+	int64_t getDurationUs() const;
+	const std::deque<PreRollEntry<T>>& getEntries() const { return m_entries; }
+	size_t getBytes() const { return m_bytes; }
+	int64_t getWindowUs() const { return m_windowUs; }
+	bool isEmpty() const { return m_entries.empty(); }
+	// add packet, packets before the first keyframe are dropped
+	void push(PreRollEntry<T>&& entry);
+	size_t size() const { return m_entries.size(); }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// PreRollBuffer Implementation
+
+template<typename T>
+PreRollBuffer<T>::PreRollBuffer(int64_t windowUs, int keyStream):
+		m_windowUs(windowUs), m_keyStream(keyStream) {
+	m_bytes = 0;
+}
+
+template<typename T>
+void PreRollBuffer<T>::clear() {
+	m_entries.clear();
+	m_bytes = 0;
+}
+
+template<typename T>
+int64_t PreRollBuffer<T>::getDurationUs() const {
+	if( m_entries.empty() ) {
+		return 0;
+	}
+	return m_entries.back().tsUs - m_entries.front().tsUs;
+}
+
+template<typename T>
+void PreRollBuffer<T>::push(PreRollEntry<T>&& entry) {
+	if( m_entries.empty() && !(entry.stream == m_keyStream && entry.fKey) ) {
+		return;
+	}
+	m_bytes += entry.size;
+	m_entries.push_back(std::move(entry));
+	trim();
+}
+
+template<typename T>
+void PreRollBuffer<T>::trim() {
+	// drop the oldest GOP while the rest still covers the window
+	while( true ) {
+		size_t next = 1;
+		while( next < m_entries.size() &&
+			   !(m_entries[next].stream == m_keyStream && m_entries[next].fKey) ) {
+			next++;
+		}
+		if( next >= m_entries.size() ||
+			m_entries.back().tsUs - m_entries[next].tsUs < m_windowUs ) {
+			break;
+		}
+		for (size_t i = 0; i < next; i++) {
+			m_bytes -= m_entries.front().size;
+			m_entries.pop_front();
+		}
+	}
+}
+
+#endif //CAPTURE_PREROLLBUFFER_H
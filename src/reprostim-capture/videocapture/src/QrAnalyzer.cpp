@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "QrAnalyzer.h"
+
+#ifdef CAPTURE_LIBAV_ENABLED
+#include <opencv2/opencv.hpp>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static double secondsBetween(const Timestamp& from, const Timestamp& to) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count() / 1000000.0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// QrTracker
+
+QrTracker::QrTracker() {
+	m_count = 0;
+}
+
+bool QrTracker::finish(QrRecord& rec) {
+	if( !m_cur ) {
+		return false;
+	}
+	rec = std::move(*m_cur);
+	m_cur.reset();
+	m_count++;
+	return true;
+}
+
+bool QrTracker::update(uint64_t frame, const Timestamp& ts, const std::string& text, QrRecord& rec) {
+	if( m_cur && m_cur->text == text ) {
+		// still the same code
+		m_cur->frameEnd = frame;
+		m_cur->tsEnd = ts;
+		return false;
+	}
+	bool fFinished = false;
+	if( m_cur ) {
+		// code changed or disappeared, it ends on this frame
+		m_cur->frameEnd = frame;
+		m_cur->tsEnd = ts;
+		fFinished = finish(rec);
+	}
+	if( !text.empty() ) {
+		m_cur = QrRecord{m_count, frame, frame, ts, ts, text};
+	}
+	return fFinished;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+bool extractLuma(const VideoFrame& frame, const QrOpts& opts, LumaImage& img) {
+	// green is close enough to luma for RGB formats
+	const FrameComponent& luma = frame.comp[frame.fRgb ? 1 : 0];
+	if( luma.step <= 0 || luma.plane < 0 || luma.plane > 3 || !frame.data[luma.plane] ) {
+		return false;
+	}
+	const int x = std::max(opts.roiX, 0);
+	const int y = std::max(opts.roiY, 0);
+	const int cx = std::min(opts.roiW > 0 ? opts.roiW : frame.width, frame.width - x);
+	const int cy = std::min(opts.roiH > 0 ? opts.roiH : frame.height, frame.height - y);
+	if( cx <= 0 || cy <= 0 ) {
+		return false;
+	}
+	img.width = cx;
+	img.height = cy;
+	img.data.resize(static_cast<size_t>(cx) * cy);
+	const int step = luma.step;
+	const int linesize = frame.linesize[luma.plane];
+	const uint8_t* pSrc = frame.data[luma.plane] + luma.offset +
+						  static_cast<ptrdiff_t>(y) * linesize + static_cast<ptrdiff_t>(x) * step;
+	uint8_t* pDst = img.data.data();
+	for (int row = 0; row < cy; row++, pSrc += linesize, pDst += cx) {
+		if( step == 1 ) {
+			std::memcpy(pDst, pSrc, cx);
+		} else {
+			for (int col = 0; col < cx; col++) {
+				pDst[col] = pSrc[col * step];
+			}
+		}
+	}
+	return true;
+}
+
+nlohmann::json qrRecordToJson(const QrRecord& rec, const Timestamp& tsSession) {
+	const double timeStart = secondsBetween(tsSession, rec.tsStart);
+	const double timeEnd = secondsBetween(tsSession, rec.tsEnd);
+	// payload of stimuli QR codes is JSON
+	nlohmann::json data = nlohmann::json::parse(rec.text, nullptr, false);
+	if( data.is_discarded() ) {
+		data = nullptr;
+	}
+	return {
+			{"type", "QrRecord"},
+			{"index", rec.index},
+			{"frame_start", rec.frameStart},
+			{"frame_end", rec.frameEnd},
+			{"isotime_start", getTimeIsoStr(rec.tsStart)},
+			{"isotime_end", getTimeIsoStr(rec.tsEnd)},
+			{"time_start", timeStart},
+			{"time_end", timeEnd},
+			{"duration", timeEnd - timeStart},
+			{"data", data},
+			{"text", rec.text}
+	};
+}
+
+////////////////////////////////////////////////////////////////////////
+// QrAnalyzer
+
+QrAnalyzer::QrAnalyzer(const QrOpts& opts, const std::string& outFile, const Timestamp& tsSession,
+					   const SessionLogger_ptr& pLogger):
+		m_opts(opts), m_outFile(outFile), m_tsSession(tsSession), m_pLogger(pLogger) {
+	m_pRecorder = nullptr;
+	m_analyzed = 0;
+	m_decoded = 0;
+	m_records = 0;
+}
+
+QrAnalyzer::~QrAnalyzer() {
+	stop();
+}
+
+void QrAnalyzer::run() {
+	_SESSION_LOG_BEGIN(m_pLogger);
+	_VERBOSE("QrAnalyzer start: " << m_outFile);
+#ifdef CAPTURE_LIBAV_ENABLED
+	cv::QRCodeDetector detector;
+#endif
+	std::shared_ptr<VideoFrameQueue> pQueue = m_pQueue;
+	QrTracker tracker;
+	QrRecord rec;
+	LumaImage img;
+	std::shared_ptr<const VideoFrame> pFrame;
+	while( pQueue->pop(pFrame, -1) ) {
+		const uint64_t number = pFrame->number;
+		const Timestamp ts = toCaptureTimestamp(pFrame->captureUs);
+		std::string text;
+		if( extractLuma(*pFrame, m_opts, img) ) {
+			// frame is released before decoding, it can take longer
+			// than a few frames interval
+			pFrame.reset();
+#ifdef CAPTURE_LIBAV_ENABLED
+			try {
+				cv::Mat gray(img.height, img.width, CV_8UC1, img.data.data());
+				text = detector.detectAndDecode(gray);
+			} catch(std::exception& e) {
+				_ERROR("QR code decoding failed: " << e.what());
+			}
+#endif
+			m_analyzed++;
+			if( !text.empty() ) {
+				m_decoded++;
+			}
+		}
+		pFrame.reset();
+		if( tracker.update(number, ts, text, rec) ) {
+			writeRecord(rec);
+		}
+	}
+	// the last code lasts until the end of analyzed frames
+	if( tracker.finish(rec) ) {
+		writeRecord(rec);
+	}
+	_VERBOSE("QrAnalyzer leave: " << m_outFile);
+	_SESSION_LOG_END();
+}
+
+bool QrAnalyzer::start(LibavRecorder& recorder) {
+	if( m_pRecorder ) {
+		return false;
+	}
+	m_pRecorder = &recorder;
+	m_pQueue = recorder.subscribeVideo("qr", VC_QR_QUEUE_SIZE, BUS_DROP_NEWEST,
+									   std::max(m_opts.stride, 1));
+	m_thread = std::thread(&QrAnalyzer::run, this);
+	return true;
+}
+
+void QrAnalyzer::stop() {
+	if( m_pRecorder && m_pQueue ) {
+		m_pRecorder->unsubscribeVideo(m_pQueue);
+	}
+	if( m_thread.joinable() ) {
+		m_thread.join();
+	}
+}
+
+void QrAnalyzer::writeRecord(const QrRecord& rec) {
+	const nlohmann::json jm = qrRecordToJson(rec, m_tsSession);
+	_VERBOSE("QR code: " << jm.dump());
+	std::ofstream out(m_outFile, std::ios::app);
+	out << jm.dump() << std::endl;
+	if( !out ) {
+		_ERROR("Failed to write QR info: " << m_outFile);
+	}
+	m_records++;
+}
@@ -0,0 +1,124 @@
+#ifndef CAPTURE_QRANALYZER_H
+#define CAPTURE_QRANALYZER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "reprostim/CaptureLib.h"
+#include "LibavRecorder.h"
+
+using namespace reprostim;
+
+// analyze every N-th captured frame for QR codes, stimuli codes
+// are shown for many frames, so this keeps decoder off the
+// capture rate
+#ifndef VC_DEFAULT_QR_STRIDE
+#define VC_DEFAULT_QR_STRIDE 6
+#endif
+
+// max number of sampled frames waiting for QR decoder, new ones
+// are skipped while it is behind
+#ifndef VC_QR_QUEUE_SIZE
+#define VC_QR_QUEUE_SIZE 4
+#endif
+
+// Live QR codes detection options
+struct QrOpts {
+	bool enabled = false;
+	int  stride = VC_DEFAULT_QR_STRIDE;
+	int  roiX = 0;     // region of interest in frame pixels,
+	int  roiY = 0;     // 0 width/height means up to frame edge
+	int  roiW = 0;
+	int  roiH = 0;
+};
+
+// QR code decoded on consecutive analyzed frames
+struct QrRecord {
+	int         index = 0;      // zero-based in session
+	uint64_t    frameStart = 0; // the first frame with code
+	uint64_t    frameEnd = 0;   // the first frame without code
+	Timestamp   tsStart;        // capture time of these frames
+	Timestamp   tsEnd;
+	std::string text;           // decoded payload
+};
+
+// Groups decoded QR codes into records the same way as
+// reprostim.qr.parse does: record lasts while the same code is
+// decoded and ends on frame with another one or without code
+class QrTracker {
+private:
+	std::optional<QrRecord> m_cur;
+	int                     m_count;
+
+public:
+	QrTracker();
+
+	// finalize open record at the end of analysis, returns false
+	// when there is none
+	bool finish(QrRecord& rec);
+	// records finished so far
+	int getCount() const { return m_count; }
+	bool isActive() const { return m_cur.has_value(); }
+	// update with analyzed frame, text is empty when no code found,
+	// returns true when record is finished
+	bool update(uint64_t frame, const Timestamp& ts, const std::string& text, QrRecord& rec);
+};
+
+// Gray image of 8-bit luma in frame region of interest
+struct LumaImage {
+	int                  width = 0;
+	int                  height = 0;
+	std::vector<uint8_t> data;
+};
+
+// Copy luma of frame region of interest, returns false when frame
+// has no 8-bit luma/green component or region is outside of frame
+bool extractLuma(const VideoFrame& frame, const QrOpts& opts, LumaImage& img);
+
+// Record as .qrinfo.jsonl line compatible with reprostim.qr.parse
+// QrRecord, time is in seconds from session start, "data" is null
+// when payload is not JSON
+nlohmann::json qrRecordToJson(const QrRecord& rec, const Timestamp& tsSession);
+
+// Analyzer sampling captured frames from libav recorder frame bus
+// in own thread and writing decoded QR codes to .qrinfo.jsonl
+// sidecar as the session runs
+class QrAnalyzer {
+private:
+	const QrOpts                     m_opts;
+	const std::string                m_outFile;
+	const Timestamp                  m_tsSession;
+	const SessionLogger_ptr          m_pLogger;
+	LibavRecorder*                   m_pRecorder;
+	std::shared_ptr<VideoFrameQueue> m_pQueue;
+	std::thread                      m_thread;
+	std::atomic<uint64_t>            m_analyzed;
+	std::atomic<uint64_t>            m_decoded;
+	std::atomic<int>                 m_records;
+
+	void run();
+	void writeRecord(const QrRecord& rec);
+
+public:
+	QrAnalyzer(const QrOpts& opts, const std::string& outFile, const Timestamp& tsSession,
+			   const SessionLogger_ptr& pLogger);
+	~QrAnalyzer();
+
+	// frames analyzed and with QR code decoded
+	uint64_t getAnalyzed() const { return m_analyzed; }
+	uint64_t getDecoded() const { return m_decoded; }
+	const std::string& getOutFile() const { return m_outFile; }
+	int getRecords() const { return m_records; }
+	// subscribe to recorder video and start analyzer thread,
+	// recorder must outlive analyzer
+	bool start(LibavRecorder& recorder);
+	// unsubscribe, analyze queued frames and finalize sidecar
+	void stop();
+};
+
+#endif //CAPTURE_QRANALYZER_H
@@ -0,0 +1,249 @@
+#include <cctype>
+#include "RecorderOpts.h"
+
+////////////////////////////////////////////////////////////////////////
+// Helpers
+
+static std::vector<std::string> splitArgs(const std::string& args) {
+	std::vector<std::string> tokens;
+	std::string cur;
+	bool fToken = false;
+	char quote = 0;
+	for (char c: args) {
+		if( quote ) {
+			if( c == quote ) {
+				quote = 0;
+			} else {
+				cur += c;
+			}
+		} else if( c == '"' || c == '\'' ) {
+			quote = c;
+			fToken = true;
+		} else if( std::isspace(static_cast<unsigned char>(c)) ) {
+			if( fToken ) {
+				tokens.push_back(cur);
+				cur.clear();
+				fToken = false;
+			}
+		} else {
+			cur += c;
+			fToken = true;
+		}
+	}
+	if( fToken ) {
+		tokens.push_back(cur);
+	}
+	return tokens;
+}
+
+// option key starts with '-' and is not negative number
+static inline bool isOptionKey(const std::string& token) {
+	return token.size() > 1 && token[0] == '-' &&
+		   !std::isdigit(static_cast<unsigned char>(token[1])) && token[1] != '.';
+}
+
+static inline std::string stripInputPrefix(const std::string& dev) {
+	return dev.rfind("-i ", 0) == 0 ? dev.substr(3) : dev;
+}
+
+static bool parseIntValue(const std::string& key, const std::string& value, int& res) {
+	try {
+		size_t pos = 0;
+		res = std::stoi(value, &pos);
+		if( pos == value.size() ) {
+			return true;
+		}
+	} catch(const std::exception&) {
+	}
+	_ERROR("Invalid ffmpeg option value: -" << key << " " << value);
+	return false;
+}
+
+static bool parseSizeValue(const std::string& key, const std::string& value, int64_t& res) {
+	res = parseFfmpegSize(value);
+	if( res < 0 ) {
+		_ERROR("Invalid ffmpeg option value: -" << key << " " << value);
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Functions
+
+std::vector<FfmpegArg> parseFfmpegArgs(const std::string& args) {
+	const std::vector<std::string> tokens = splitArgs(args);
+	std::vector<FfmpegArg> res;
+	for (size_t i = 0; i < tokens.size(); i++) {
+		if( isOptionKey(tokens[i]) ) {
+			FfmpegArg arg{tokens[i].substr(1), ""};
+			if( i + 1 < tokens.size() && !isOptionKey(tokens[i + 1]) ) {
+				arg.value = tokens[++i];
+			}
+			res.push_back(arg);
+		} else {
+			// positional value, e.g. output file
+			res.push_back(FfmpegArg{"", tokens[i]});
+		}
+	}
+	return res;
+}
+
+int64_t parseFfmpegSize(const std::string& value) {
+	if( value.empty() ) {
+		return -1;
+	}
+	size_t pos = 0;
+	double v = 0;
+	try {
+		v = std::stod(value, &pos);
+	} catch(const std::exception&) {
+		return -1;
+	}
+	if( v < 0 ) {
+		return -1;
+	}
+	std::string suffix = value.substr(pos);
+	double mul = 1;
+	if( !suffix.empty() ) {
+		switch( suffix[0] ) {
+			case 'k': case 'K': mul = 1e3; break;
+			case 'M': mul = 1e6; break;
+			case 'G': mul = 1e9; break;
+			default: return -1;
+		}
+		// binary prefix, e.g. "Ki"
+		if( suffix.size() > 1 && suffix[1] == 'i' ) {
+			mul = suffix[0] == 'G' ? 1073741824.0 : (suffix[0] == 'M' ? 1048576.0 : 1024.0);
+			suffix.erase(1, 1);
+		}
+		// bytes, e.g. "MB"
+		if( suffix.size() > 1 && suffix[1] == 'B' ) {
+			mul *= 8;
+			suffix.erase(1, 1);
+		}
+		if( suffix.size() > 1 ) {
+			return -1;
+		}
+	}
+	return static_cast<int64_t>(v * mul);
+}
+
+bool parseEncoderOpts(const std::string& args, char stream, EncoderOpts& opts,
+					  std::vector<std::string>& ignored) {
+	for (const auto& arg: parseFfmpegArgs(args)) {
+		// strip stream specifier, e.g. "b:v", skip other stream options
+		std::string key = arg.key;
+		const size_t colon = key.find(':');
+		if( colon != std::string::npos ) {
+			const std::string spec = key.substr(colon + 1);
+			key = key.substr(0, colon);
+			if( !spec.empty() && spec[0] != stream ) {
+				continue;
+			}
+		}
+		if( key.empty() ) {
+			ignored.push_back(arg.value);
+		} else if( key == "c" || key == "codec" ) {
+			opts.codec = arg.value;
+		} else if( key == "vcodec" || key == "acodec" ) {
+			if( key[0] == stream ) {
+				opts.codec = arg.value;
+			}
+		} else if( key == "b" ) {
+			if( !parseSizeValue(arg.key, arg.value, opts.bitRate) ) return false;
+		} else if( key == "maxrate" ) {
+			if( !parseSizeValue(arg.key, arg.value, opts.maxRate) ) return false;
+		} else if( key == "bufsize" ) {
+			if( !parseSizeValue(arg.key, arg.value, opts.bufSize) ) return false;
+		} else if( key == "g" ) {
+			if( !parseIntValue(arg.key, arg.value, opts.gopSize) ) return false;
+		} else if( key == "threads" ) {
+			if( !parseIntValue(arg.key, arg.value, opts.nThreads) ) return false;
+		} else if( key == "ac" ) {
+			if( !parseIntValue(arg.key, arg.value, opts.channels) ) return false;
+		} else if( key == "ar" ) {
+			if( !parseIntValue(arg.key, arg.value, opts.sampleRate) ) return false;
+		} else if( key == "pix_fmt" ) {
+			opts.pixFmt = arg.value;
+		} else if( key == "vf" || key == "af" || key == "filter" ) {
+			// timestamps always start from zero in recorder, other
+			// filters are not supported
+			if( arg.value != "setpts=PTS-STARTPTS" && arg.value != "asetpts=PTS-STARTPTS" ) {
+				ignored.push_back("-" + arg.key + " " + arg.value);
+			}
+		} else if( key == "flush_packets" ) {
+			// packets are always flushed by recorder
+		} else {
+			opts.options[key] = arg.value;
+		}
+	}
+	return true;
+}
+
+bool parseInputOpts(const std::string& args, InputOpts& opts,
+					std::vector<std::string>& ignored) {
+	for (const auto& arg: parseFfmpegArgs(args)) {
+		if( arg.key == "f" ) {
+			opts.format = arg.value;
+		} else if( arg.key == "i" ) {
+			opts.device = arg.value;
+		} else if( arg.key == "ac" ) {
+			opts.options["channels"] = arg.value;
+		} else if( arg.key == "ar" ) {
+			opts.options["sample_rate"] = arg.value;
+		} else if( arg.key.empty() || arg.key == "thread_queue_size" ) {
+			// recorder uses own capture queue
+			ignored.push_back(arg.key.empty() ? arg.value : "-" + arg.key + " " + arg.value);
+		} else {
+			opts.options[arg.key] = arg.value;
+		}
+	}
+	return true;
+}
+
+bool makeRecorderOpts(const FfmpegOpts& ffm, int cx, int cy, const std::string& frameRate,
+					  const std::string& vDev, const std::string& aDev,
+					  const std::string& outFile, const std::string& comment,
+					  RecorderOpts& opts) {
+	opts.videoIn = InputOpts{"v4l2", vDev, {}};
+	if( !parseInputOpts(ffm.v_fmt + " " + ffm.v_opt, opts.videoIn, opts.ignored) ) {
+		return false;
+	}
+	opts.videoIn.device = vDev;
+	opts.videoIn.options["video_size"] = std::to_string(cx) + "x" + std::to_string(cy);
+	if( !frameRate.empty() ) {
+		opts.videoIn.options["framerate"] = frameRate;
+	}
+
+	opts.hasAudio = !stripInputPrefix(aDev).empty();
+	if( opts.hasAudio ) {
+		opts.audioIn = InputOpts{"alsa", "", {}};
+		if( !parseInputOpts(ffm.a_fmt + " " + ffm.a_nchan + " " + ffm.a_opt, opts.audioIn, opts.ignored) ) {
+			return false;
+		}
+		opts.audioIn.device = stripInputPrefix(aDev);
+	}
+
+	// "-threads" goes after inputs in ffmpeg command, so it
+	// is output option of video encoder here
+	opts.videoEnc = EncoderOpts();
+	if( !parseEncoderOpts(ffm.v_enc + " " + ffm.pix_fmt + " " + ffm.n_threads, 'v',
+						  opts.videoEnc, opts.ignored) ) {
+		return false;
+	}
+	if( opts.videoEnc.codec.empty() ) {
+		opts.videoEnc.codec = "libx264";
+	}
+	opts.audioEnc = EncoderOpts();
+	if( !parseEncoderOpts(ffm.a_enc, 'a', opts.audioEnc, opts.ignored) ) {
+		return false;
+	}
+	if( opts.audioEnc.codec.empty() ) {
+		opts.audioEnc.codec = "aac";
+	}
+	opts.outFile = outFile;
+	opts.outFormat = ffm.out_fmt;
+	opts.comment = comment;
+	return true;
+}
@@ -0,0 +1,106 @@
+#ifndef CAPTURE_RECORDEROPTS_H
+#define CAPTURE_RECORDEROPTS_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "reprostim/CaptureApp.h"
+
+using namespace reprostim;
+
+// recorder backend types
+#ifndef VC_RECORDER_FFMPEG
+#define VC_RECORDER_FFMPEG "ffmpeg"
+#endif
+
+#ifndef VC_RECORDER_LIBAV
+#define VC_RECORDER_LIBAV "libav"
+#endif
+
+// default max number of captured frames/packets waiting for encoder
+#ifndef VC_DEFAULT_QUEUE_SIZE
+#define VC_DEFAULT_QUEUE_SIZE 64
+#endif
+
+// default length in milliseconds of encoded packets kept in memory
+// and written in front of new recording, 0 to disable
+#ifndef VC_DEFAULT_PRE_ROLL_MS
+#define VC_DEFAULT_PRE_ROLL_MS 0
+#endif
+
+// default interval in seconds between recorder statistics records
+// in session log
+#ifndef VC_DEFAULT_STATS_INTERVAL_SEC
+#define VC_DEFAULT_STATS_INTERVAL_SEC 10
+#endif
+
+// Single option from ffmpeg command line, e.g. "-preset ultrafast",
+// value is empty for flags
+struct FfmpegArg {
+	std::string key;   // without leading '-'
+	std::string value;
+};
+
+// Capture input opened with libavdevice, e.g. v4l2 or alsa
+struct InputOpts {
+	std::string                        format;  // input format name
+	std::string                        device;  // device path or name
+	std::map<std::string, std::string> options; // demuxer options
+};
+
+// Encoder settings parsed from ffm_opts encoder options
+struct EncoderOpts {
+	std::string                        codec;
+	int64_t                            bitRate = 0;
+	int64_t                            maxRate = 0;
+	int64_t                            bufSize = 0;
+	int                                gopSize = -1;
+	int                                nThreads = 0;
+	std::string                        pixFmt;
+	int                                channels = 0;
+	int                                sampleRate = 0;
+	std::map<std::string, std::string> options; // codec private options, e.g. preset, crf
+};
+
+// In-process recorder options
+struct RecorderOpts {
+	InputOpts                videoIn;
+	InputOpts                audioIn;
+	bool                     hasAudio = false;
+	EncoderOpts              videoEnc;
+	EncoderOpts              audioEnc;
+	std::string              outFile;  // empty to start without output
+	std::string              outFormat; // output file extension, e.g. "mkv"
+	std::string              comment;  // output metadata comment, e.g. instance tag
+	int                      queueSize = VC_DEFAULT_QUEUE_SIZE;
+	int                      preRollMs = VC_DEFAULT_PRE_ROLL_MS; // encoded packets kept for next output
+	int                      segmentSec = 0; // rotate output file after duration, 0 to disable
+	int                      segmentMb = 0;  // rotate output file after size, 0 to disable
+	std::vector<std::string> ignored;  // ffmpeg options not supported in-process
+};
+
+// split ffmpeg command line options string to key/value pairs
+std::vector<FfmpegArg> parseFfmpegArgs(const std::string& args);
+
+// parse ffmpeg bit rate/size value like "8M", "128k" or "16000000",
+// returns -1 on invalid value
+int64_t parseFfmpegSize(const std::string& value);
+
+// parse ffmpeg encoder options for video ('v') or audio ('a') stream,
+// unsupported options are added to ignored list
+bool parseEncoderOpts(const std::string& args, char stream, EncoderOpts& opts,
+					  std::vector<std::string>& ignored);
+
+// parse ffmpeg input options, e.g. "-f v4l2 -input_format yuyv422"
+bool parseInputOpts(const std::string& args, InputOpts& opts,
+					std::vector<std::string>& ignored);
+
+// build recorder options from ffm_opts config section and current
+// capture device state, returns false on invalid options
+bool makeRecorderOpts(const FfmpegOpts& ffm, int cx, int cy, const std::string& frameRate,
+					  const std::string& vDev, const std::string& aDev,
+					  const std::string& outFile, const std::string& comment,
+					  RecorderOpts& opts);
+
+#endif //CAPTURE_RECORDEROPTS_H
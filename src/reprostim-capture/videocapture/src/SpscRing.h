@@ -0,0 +1,86 @@
+#ifndef CAPTURE_SPSCRING_H
+#define CAPTURE_SPSCRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring buffer for exactly one producer and one
+// consumer thread, e.g. capture thread feeding analyzer. Capacity
+// is rounded up to power of two, push never blocks and writes only
+// as many items as fit.
+template<typename T>
+class SpscRing {
+private:
+	const size_t         m_capacity;
+	std::unique_ptr<T[]> m_data;
+	// read and write positions, only grow and wrap by mask
+	alignas(64) std::atomic<size_t> m_head; // written by producer
+	alignas(64) std::atomic<size_t> m_tail; // written by consumer
+
+	static size_t roundCapacity(size_t capacity);
+
+public:
+	explicit SpscRing(size_t capacity);
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	size_t getCapacity() const { return m_capacity; }
+	// consumer: copy up to n items to data, returns number copied
+	size_t pop(T* data, size_t n);
+	// producer: copy up to n items from data, returns number copied
+	size_t push(const T* data, size_t n);
+	// items ready to pop, approximate when called by another thread
+	size_t size() const;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// SpscRing Implementation
+
+template<typename T>
+SpscRing<T>::SpscRing(size_t capacity):
+		m_capacity(roundCapacity(capacity)), m_data(new T[m_capacity]()), m_head(0), m_tail(0) {
+}
+
+template<typename T>
+size_t SpscRing<T>::pop(T* data, size_t n) {
+	const size_t tail = m_tail.load(std::memory_order_relaxed);
+	const size_t head = m_head.load(std::memory_order_acquire);
+	n = std::min(n, head - tail);
+	const size_t mask = m_capacity - 1;
+	for (size_t i = 0; i < n; i++) {
+		data[i] = m_data[(tail + i) & mask];
+	}
+	m_tail.store(tail + n, std::memory_order_release);
+	return n;
+}
+
+template<typename T>
+size_t SpscRing<T>::push(const T* data, size_t n) {
+	const size_t head = m_head.load(std::memory_order_relaxed);
+	const size_t tail = m_tail.load(std::memory_order_acquire);
+	n = std::min(n, m_capacity - (head - tail));
+	const size_t mask = m_capacity - 1;
+	for (size_t i = 0; i < n; i++) {
+		m_data[(head + i) & mask] = data[i];
+	}
+	m_head.store(head + n, std::memory_order_release);
+	return n;
+}
+
+template<typename T>
+size_t SpscRing<T>::roundCapacity(size_t capacity) {
+	size_t n = 1;
+	while( n < capacity ) {
+		n <<= 1;
+	}
+	return n;
+}
+
+template<typename T>
+size_t SpscRing<T>::size() const {
+	return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+}
+
+#endif //CAPTURE_SPSCRING_H
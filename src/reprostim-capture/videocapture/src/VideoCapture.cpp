@@ -44,6 +44,7 @@
 
 #include <iostream>
 #include <filesystem>
+#include <fstream>
 #include <stdio.h>
 #include <unistd.h>
 #include <memory>
@@ -54,7 +55,12 @@
 #include <getopt.h>
 #include <csignal>
 #include <regex>
+#include <poll.h>
+#include <cstdlib>
 #include "VideoCapture.h"
+#include "EncoderBench.h"
+#include "EncoderProgress.h"
+#include "LibavRecorder.h"
 
 using namespace reprostim;
 
@@ -76,6 +82,35 @@ std::atomic<long long> s_ffmpegKeepAliveTs{0};
 #define _FFMPEG_RECOVERY_TIMEOUT_MS 60000
 #endif
 
+// ffmpeg stop escalation deadlines, stop finishes as soon
+// as process exits
+#ifndef _FFMPEG_STOP_SIGINT_MS
+#define _FFMPEG_STOP_SIGINT_MS 5000
+#endif
+
+#ifndef _FFMPEG_STOP_SIGTERM_MS
+#define _FFMPEG_STOP_SIGTERM_MS 1500
+#endif
+
+#ifndef _FFMPEG_STOP_SIGKILL_MS
+#define _FFMPEG_STOP_SIGKILL_MS 1500
+#endif
+
+// ext_proc_opts exec_command stop escalation deadlines
+#ifndef _EXT_PROC_STOP_SIGINT_MS
+#define _EXT_PROC_STOP_SIGINT_MS 1500
+#endif
+
+#ifndef _EXT_PROC_STOP_SIGTERM_MS
+#define _EXT_PROC_STOP_SIGTERM_MS 1500
+#endif
+
+// max time to wait for libav recorder to flush encoders and
+// finalize output file on stop
+#ifndef _RECORDER_STOP_TIMEOUT_MS
+#define _RECORDER_STOP_TIMEOUT_MS 10000
+#endif
+
 ////////////////////////////////////////////////////////////////////////////
 //
 
@@ -86,59 +121,6 @@ inline std::string buildVideoFile(
 	return std::filesystem::path(outPath) / (name + "." + out_fmt);
 }
 
-bool killProc(const std::string& procName,
-			  int sig = SIGKILL,
-			  float timeoutSec = 1.5,
-			  bool waitInCycle = true,
-			  const std::string& cmdSubstr = "") {
-	std::string cmd_pidof = cmdSubstr.empty()?"pidof " + procName:"pgrep -f \"^" + procName + ".*" + cmdSubstr +"\"";
-	_VERBOSE("cmd_pidof: " << cmd_pidof);
-	std::string pid = exec(cmd_pidof);
-	_INFO(procName+" pid: " << pid.c_str());
-	int c = 0; // safety counter
-	while ( pid.length() > 0 ) {
-		_INFO("<> PID of " << procName <<"\t===> " << pid.c_str());
-		std::string killCmd = "kill -" + std::to_string(sig) + " " + pid;
-		system(killCmd.c_str());
-		//
-		SLEEP_SEC(timeoutSec); // Allow time for process to stop
-		pid = exec(cmd_pidof);
-		if( !waitInCycle )
-			break;
-		c++;
-		if( c > 100 ) {
-			_ERROR("killProc: safety break after 100 cycles to prevent infinite loop");
-			break;
-		}
-	}
-	return pid.length()==0?true:false;
-}
-
-
-bool killExtProc(const std::string& cmd,
-			  int sig = SIGKILL) {
-	if( cmd.empty() ) {
-		_VERBOSE("killExtProc: command is empty, skipping");
-		return false;
-	}
-	std::string pid = exec("pgrep -o -f \"" + cmd + "\"");
-	if( pid.length() > 0 ) {
-		_INFO("Kill external process '" << cmd << "', pid: " << pid);
-		killProcById(std::stoi(pid), sig, true);
-		/*
-		// this doesn't work well with singularity containers and python
-		// so used custom terminateProc
-		std::string killCmd = "pkill --signal " + std::to_string(sig) + " -P " + pid;
-		_INFO("Kill ext proc command: " << killCmd);
-		system(killCmd.c_str());
-		*/
-		return true;
-	}
-	_VERBOSE("No external process found to kill: '" << cmd << "'");
-	return false;
-}
-
-
 void renameConductFiles(const std::string &old_prefix, const std::string &new_prefix) {
 	std::string o1 = old_prefix + "info.json";
 	std::string n1 = new_prefix + "info.json";
@@ -160,8 +142,9 @@ std::string renameVideoFile(
 		const std::string& outPath,
 		const std::string& start_ts,
 		const std::string& out_fmt,
-		const std::string& message) {
-	std::string stop_ts = getTimeStr();
+		const std::string& message,
+		const std::string& stop_ts0 = "") {
+	std::string stop_ts = stop_ts0.empty() ? getTimeStr() : stop_ts0;
 	std::string outVideoFile2 = buildVideoFile(outPath, start_ts + "--" + stop_ts, out_fmt);
 	if( std::filesystem::exists(outVideoFile) ) {
 		_INFO(message << " Saving video " << outVideoFile2);
@@ -170,6 +153,97 @@ std::string renameVideoFile(
 	return outVideoFile2;
 }
 
+// rename video file and terminate session logs when recording
+// thread is done, returns final video file name
+std::string endRecordingSession(
+		const std::string& appName,
+		const std::string& outVideoFile,
+		const std::string& outPath,
+		const std::string& start_ts,
+		const Timestamp& tsStart,
+		const std::string& out_fmt,
+		const std::string& message,
+		bool fRepromonEnabled,
+		RepromonQueue* pRepromonQueue) {
+	_FFMPEG_KEEP_ALIVE();
+	std::string outVideoFile2 = renameVideoFile(outVideoFile,
+					outPath,
+					start_ts,
+					out_fmt,
+					":\t" + message + ".");
+
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", "session_end"},
+			{"version", CAPTURE_VERSION_STRING},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"message", message},
+			{"cap_ts_start", start_ts},
+			{"cap_isotime_start", getTimeIsoStr(tsStart)}
+	};
+	_METADATA_LOG(jm);
+	_SESSION_LOG_END_CLOSE_RENAME(outVideoFile2 + ".log");
+	_FFMPEG_KEEP_ALIVE();
+	_NOTIFY_REPROMON(
+		REPROMON_INFO,
+		appName + " session " + start_ts +
+		" end, saved to " + std::filesystem::path(outVideoFile2).filename().string()
+	);
+	return outVideoFile2;
+}
+
+// Segment callback of libav recorder, renames closed segment with
+// start--stop timestamps, logs it to session log and appends to
+// segments manifest (JSON lines), returns the next segment file name
+SegmentCallback makeSegmentCallback(
+		const std::string& outPath,
+		const std::string& out_fmt,
+		const std::string& start_ts,
+		const Timestamp& tsStart,
+		const std::string& segmentsFile,
+		const SessionLogger_ptr& pLogger) {
+	// current segment start, shared between calls
+	auto pStart = std::make_shared<std::pair<std::string, Timestamp>>(start_ts, tsStart);
+	return [=](const SegmentInfo& info, bool fRotate) -> std::string {
+		// called from recorder threads, session logger is set
+		// for the call only
+		SessionLogger_ptr pPrevLogger = tl_pSessionLogger;
+		_SESSION_LOG_BEGIN(pLogger);
+		Timestamp tsStop = CURRENT_TIMESTAMP();
+		const std::string stop_ts = getTimeStr(tsStop);
+		const std::string segFile = renameVideoFile(info.file, outPath, pStart->first, out_fmt,
+				":\tSegment " + std::to_string(info.index) + " closed.", stop_ts);
+		json jm = {
+				{"type", "segment"},
+				{"json_ts", getTimeStr(tsStop)},
+				{"json_isotime", getTimeIsoStr(tsStop)},
+				{"index", info.index},
+				{"file", std::filesystem::path(segFile).filename().string()},
+				{"cap_ts_start", pStart->first},
+				{"cap_isotime_start", getTimeIsoStr(pStart->second)},
+				{"cap_ts_stop", stop_ts},
+				{"cap_isotime_stop", getTimeIsoStr(tsStop)},
+				{"start_sec", info.startUs / 1000000.0},
+				{"duration_sec", info.durationUs / 1000000.0},
+				{"bytes", info.bytes}
+		};
+		_METADATA_LOG(jm);
+		std::ofstream manifest(segmentsFile, std::ios::app);
+		manifest << jm.dump() << std::endl;
+		if( !manifest ) {
+			_ERROR("Failed to write segments manifest: " << segmentsFile);
+		}
+		std::string nextFile;
+		if( fRotate ) {
+			*pStart = {stop_ts, tsStop};
+			nextFile = buildVideoFile(outPath, stop_ts + "--", out_fmt);
+		}
+		_SESSION_LOG_BEGIN(pPrevLogger);
+		return nextFile;
+	};
+}
+
 bool runAndMatchStatusCommand(const ExtProcOpts& opts, bool fDump) {
 	bool fExec = false;
 	if (fDump) {
@@ -224,12 +298,13 @@ void ExtProcThread::run() {
 
 		if (fExec && !opts.exec_command.empty()) {
 			_INFO("Execute external process command: " << opts.exec_command);
-			exec(opts.exec_command,
-				true, !getParams().fTopLogExtProc, 48,
-				[this]() {
-					return isTerminated();
-				}
-			);
+			ProcRunOpts runOpts;
+			runOpts.showOutput = true;
+			runOpts.sessionLogOnly = !getParams().fTopLogExtProc;
+			runOpts.cancelFd = getTerminateFd();
+			runOpts.stopSteps = {{SIGINT, _EXT_PROC_STOP_SIGINT_MS}, {SIGTERM, _EXT_PROC_STOP_SIGTERM_MS}};
+			int code = getParams().pProc->run({"/bin/sh", "-c", opts.exec_command}, runOpts);
+			_INFO("External process exited, code=" << code);
 		}
 	} catch(std::exception& e) {
 		_ERROR("ExtProcThread unhandled exception: " << e.what());
@@ -240,13 +315,67 @@ void ExtProcThread::run() {
 }
 
 
+// log and notify when encoder can't keep up with input frame rate
+static void checkEncodeRate(int event, const EncodeRateMonitor& monitor,
+							const std::string& appName, const std::string& start_ts,
+							bool fRepromonEnabled, RepromonQueue* pRepromonQueue) {
+	if( event==0 ) {
+		return;
+	}
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", "encode_rate_alert"},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"cap_ts_start", start_ts},
+			{"state", event > 0 ? "low" : "recovered"},
+			{"encode_fps", monitor.getFps()},
+			{"input_fps", monitor.getInputFps()}
+	};
+	_METADATA_LOG(jm);
+	if( event > 0 ) {
+		_ERROR("Encode rate " << monitor.getFps() << " fps is below input rate "
+			   << monitor.getInputFps() << " fps, session " << start_ts);
+		_NOTIFY_REPROMON(
+			REPROMON_WARNING,
+			appName + " session " + start_ts + " encodes " + std::to_string(monitor.getFps()) +
+			" fps, below input " + std::to_string(monitor.getInputFps()) + " fps"
+		);
+	} else {
+		_INFO("Encode rate recovered: " << monitor.getFps() << " fps, session " << start_ts);
+	}
+}
+
+static void logEncoderProgress(const EncoderProgress& p, const EncodeRateMonitor& monitor,
+							   const std::string& start_ts) {
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", "encoder_progress"},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"cap_ts_start", start_ts},
+			{"frame", p.frame},
+			{"fps", p.fps},
+			{"encode_fps", monitor.getFps()},
+			{"input_fps", monitor.getInputFps()},
+			{"dup_frames", p.dupFrames},
+			{"drop_frames", p.dropFrames},
+			{"bitrate_kbps", p.bitrateKbps},
+			{"total_size", p.totalSize},
+			{"out_time_sec", p.outTimeUs / 1000000.0},
+			{"speed", p.speed},
+			{"end", p.fEnd}
+	};
+	_METADATA_LOG(jm);
+}
+
 // specialization/override for default WorkerThread::run
 template<>
 void FfmpegThread::run() {
 	_SESSION_LOG_BEGIN(getParams().pLogger);
 	_FFMPEG_KEEP_ALIVE();
 
-	bool fRepromonEnabled = getParams().fRepromonEnabled;
+	const bool fRepromonEnabled = getParams().fRepromonEnabled;
 	RepromonQueue* pRepromonQueue = getParams().pRepromonQueue;
 
 	std::thread::id tid= std::this_thread::get_id();
@@ -254,51 +383,298 @@ void FfmpegThread::run() {
 
 	_INFO("ffmpeg_cmd: " << getParams().ffmpeg_cmd);
 	_INFO(getParams().start_ts << ": <SYSTEMCALL> " << getParams().cmd);
-	//system(cmd);
 
-	// NOTE: in future improve async subprocess execution with reworked exec API.
+	// process is spawned by startRecording, here output is
+	// logged until it exits or thread is stopped
+	ChildProc& proc = *getParams().pProc;
+	const bool fSessionLogOnly = !getParams().fTopLogFfmpeg;
+	// "-progress" blocks are turned into periodic encoder_progress
+	// records instead of logging them as is
+	const long long statsIntervalMs = getParams().statsIntervalSec * 1000LL;
+	long long tsStats = currentTimeMs();
+	ProgressParser parser;
+	EncodeRateMonitor monitor(getParams().inputFps);
+	auto onLine = [&](std::string_view line, int stream) {
+		bool fComplete = false;
+		if( parser.parseLine(line, fComplete) ) {
+			if( !fComplete ) {
+				return;
+			}
+			const EncoderProgress& p = parser.getProgress();
+			const long long ts = currentTimeMs();
+			if( p.fEnd || (statsIntervalMs > 0 && ts - tsStats >= statsIntervalMs) ) {
+				tsStats = ts;
+				const int event = monitor.update(p.frame, ts);
+				logEncoderProgress(p, monitor, getParams().start_ts);
+				checkEncodeRate(event, monitor, getParams().appName, getParams().start_ts,
+								fRepromonEnabled, pRepromonQueue);
+			}
+			return;
+		}
+		if( fSessionLogOnly ) {
+			_SESSION_LOG_INFO(line);
+		} else {
+			_INFO_RAW(line);
+			fflush(stdout); // force output
+		}
+	};
 	try {
-		exec(getParams().cmd,
-			 true, !getParams().fTopLogFfmpeg, 48,
-			 [this]() {
-				 _FFMPEG_KEEP_ALIVE();
-				 return isTerminated();
+		while( !isTerminated() ) {
+			int res = proc.readOutput(1000, onLine, getTerminateFd());
+			_FFMPEG_KEEP_ALIVE();
+			if( res<0 ) {
+				break;
 			}
-		);
+		}
+		// output is closed when process exits
+		while( !isTerminated() && !proc.wait(1000) ) {
+			_FFMPEG_KEEP_ALIVE();
+		}
+		if( !proc.isRunning() ) {
+			_INFO("ffmpeg process exited, pid=" << proc.getPid() << ", code=" << proc.getExitCode());
+		}
 	} catch(std::exception& e) {
 		_ERROR("FfmpegThread unhandled exception: " << e.what());
 		_FFMPEG_KEEP_ALIVE();
 	}
 	_VERBOSE("FfmpegThread terminating [" << tid << "]: " << getParams().cmd);
 
-	_FFMPEG_KEEP_ALIVE();
-	std::string outVideoFile2 = renameVideoFile(getParams().outVideoFile,
+	// terminate session logs
+	_VERBOSE("FfmpegThread leave [" << tid << "]: " << getParams().cmd);
+	std::string outVideoFile2 = endRecordingSession(getParams().appName,
+					getParams().outVideoFile,
 					getParams().outPath,
 					getParams().start_ts,
+					getParams().tsStart,
 					getParams().outExt,
-					":\tFfmpeg thread terminated.");
+					"ffmpeg thread terminated",
+					fRepromonEnabled,
+					pRepromonQueue);
+	renameConductFiles(getParams().duct_prefix, outVideoFile2+".duct_");
+	_FFMPEG_KEEP_ALIVE();
+}
 
-	// terminate session logs
-	_VERBOSE("FfmpegThread leave [" << tid << "]: " << getParams().cmd);
+static void logCaptureStop(const std::string& start_ts, const Timestamp& tsStart,
+						   const Timestamp& tsStop, const std::string& message,
+						   bool fHandover) {
 	Timestamp ts = CURRENT_TIMESTAMP();
 	json jm = {
-			{"type", "session_end"},
+			{"type", "capture_stop"},
 			{"version", CAPTURE_VERSION_STRING},
 			{"json_ts", getTimeStr(ts)},
 			{"json_isotime", getTimeIsoStr(ts)},
-			{"message", "ffmpeg thread terminated"},
-			{"cap_ts_start", getParams().start_ts},
-			{"cap_isotime_start", getTimeIsoStr(getParams().tsStart)}
+			{"message", message},
+			{"cap_ts_start", start_ts},
+			{"cap_isotime_start", getTimeIsoStr(tsStart)},
+			{"cap_ts_stop", getTimeStr(tsStop)},
+			{"cap_isotime_stop", getTimeIsoStr(tsStop)}
 	};
+	if( fHandover ) {
+		jm["handover"] = true;
+	}
 	_METADATA_LOG(jm);
-	_SESSION_LOG_END_CLOSE_RENAME(outVideoFile2 + ".log");
+}
+
+static void logRecorderStats(const RecorderStats& stats, const EncodeRateMonitor& monitor,
+							 const std::string& start_ts) {
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", "recorder_stats"},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"cap_ts_start", start_ts},
+			{"video_frames", stats.videoFrames},
+			{"video_encoded", stats.videoEncoded},
+			{"video_dropped", stats.videoDropped},
+			{"video_paused", stats.videoPaused},
+			{"video_queue_depth", stats.videoQueueDepth},
+			{"video_max_queue_depth", stats.videoMaxQueueDepth},
+			{"audio_packets", stats.audioPackets},
+			{"audio_encoded", stats.audioEncoded},
+			{"audio_dropped", stats.audioDropped},
+			{"audio_queue_depth", stats.audioQueueDepth},
+			{"audio_max_queue_depth", stats.audioMaxQueueDepth},
+			{"bytes_written", stats.bytesWritten},
+			{"pre_roll_ms", stats.preRollUs / 1000},
+			{"encode_fps", monitor.getFps()},
+			{"input_fps", monitor.getInputFps()},
+			{"encode_latency_avg_us", stats.encodeLatencyAvgUs},
+			{"encode_latency_max_us", stats.encodeLatencyMaxUs},
+			{"bus_subscribers", stats.busSubscribers},
+			{"bus_dropped", stats.busDropped}
+	};
+	_METADATA_LOG(jm);
+}
+
+static void logNoSignalEvent(const NoSignalEvent& event, const std::string& action,
+							 const std::string& appName, const std::string& start_ts,
+							 bool fRepromonEnabled, RepromonQueue* pRepromonQueue) {
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", event.fBegin ? "nosignal_begin" : "nosignal_end"},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"cap_ts_start", start_ts},
+			{"frame", event.frame},
+			{"isotime", getTimeIsoStr(event.ts)},
+			{"diff", event.diff},
+			{"action", action}
+	};
+	if( event.fBegin ) {
+		_INFO("No-signal pattern captured since frame " << event.frame << ", session " << start_ts);
+		_NOTIFY_REPROMON(
+			REPROMON_WARNING,
+			appName + " session " + start_ts + " captures no-signal pattern"
+		);
+	} else {
+		jm["duration_sec"] = event.durationSec;
+		_INFO("No-signal pattern ended on frame " << event.frame << " after "
+			  << event.durationSec << " sec, session " << start_ts);
+	}
+	_METADATA_LOG(jm);
+}
+
+static void logAudioCode(const AudioCode& code, const Timestamp& tsCode, const std::string& start_ts) {
+	Timestamp ts = CURRENT_TIMESTAMP();
+	json jm = {
+			{"type", "audiocode"},
+			{"json_ts", getTimeStr(ts)},
+			{"json_isotime", getTimeIsoStr(ts)},
+			{"cap_ts_start", start_ts}
+	};
+	jm.update(audioCodeToJson(code, tsCode));
+	_INFO("Audio code " << code.codec << " decoded: " << jm["value"].dump() << ", session " << start_ts);
+	_METADATA_LOG(jm);
+}
+
+// specialization/override for default WorkerThread::run
+template<>
+void RecorderThread::run() {
+	_SESSION_LOG_BEGIN(getParams().pLogger);
 	_FFMPEG_KEEP_ALIVE();
-	_NOTIFY_REPROMON(
-		REPROMON_INFO,
-		getParams().appName + " session " + getParams().start_ts +
-		" end, saved to " + std::filesystem::path(outVideoFile2).filename().string()
-	);
-	renameConductFiles(getParams().duct_prefix, outVideoFile2+".duct_");
+
+	const bool fRepromonEnabled = getParams().fRepromonEnabled;
+	RepromonQueue* pRepromonQueue = getParams().pRepromonQueue;
+	const RecorderOpts& opts = getParams().opts;
+	LibavRecorder* pRecorder = getParams().pRecorder.get();
+
+	std::thread::id tid= std::this_thread::get_id();
+	_VERBOSE("RecorderThread start [" << tid << "]: " << opts.outFile);
+	_INFO(getParams().start_ts << ": <LIBAV> " << opts.videoIn.device <<
+		  (opts.hasAudio ? " + " + opts.audioIn.device : "") << " -> " << opts.outFile);
+
+	std::string message = "recorder thread terminated";
+	try {
+		if( pRecorder && pRecorder->isRunning() && !pRecorder->getOutFile().empty() ) {
+			const long long statsIntervalMs = getParams().statsIntervalSec * 1000LL;
+			long long tsStats = currentTimeMs();
+			EncodeRateMonitor monitor(getParams().inputFps);
+			monitor.update(pRecorder->getStats().videoEncoded, tsStats);
+			std::unique_ptr<QrAnalyzer> pQrAnalyzer;
+			if( !getParams().qrInfoFile.empty() ) {
+				pQrAnalyzer = std::make_unique<QrAnalyzer>(getParams().qrOpts, getParams().qrInfoFile,
+														   getParams().tsStart, getParams().pLogger);
+				pQrAnalyzer->start(*pRecorder);
+			}
+			std::unique_ptr<NoSignalAnalyzer> pNoSignalAnalyzer;
+			if( getParams().nosignalOpts.enabled ) {
+				const std::string action = getParams().nosignalOpts.action;
+				const std::string appName = getParams().appName;
+				const std::string start_ts = getParams().start_ts;
+				pNoSignalAnalyzer = std::make_unique<NoSignalAnalyzer>(getParams().nosignalOpts, getParams().pLogger,
+						[=](const NoSignalEvent& event) {
+							logNoSignalEvent(event, action, appName, start_ts, fRepromonEnabled, pRepromonQueue);
+						});
+				pNoSignalAnalyzer->start(*pRecorder);
+			}
+			std::unique_ptr<AudioCodeAnalyzer> pAudioCodeAnalyzer;
+			if( getParams().audiocodeOpts.enabled ) {
+				const std::string start_ts = getParams().start_ts;
+				pAudioCodeAnalyzer = std::make_unique<AudioCodeAnalyzer>(getParams().audiocodeOpts,
+						getParams().pLogger, [=](const AudioCode& code, const Timestamp& ts) {
+							logAudioCode(code, ts, start_ts);
+						});
+				if( !pAudioCodeAnalyzer->start(*pRecorder) ) {
+					_ERROR("Audio codes decoding is not started, recorder has no audio input");
+					pAudioCodeAnalyzer.reset();
+				}
+			}
+			struct pollfd pfd = {getTerminateFd(), POLLIN, 0};
+			while( !isTerminated() ) {
+				poll(&pfd, pfd.fd >= 0 ? 1 : 0, 1000);
+				_FFMPEG_KEEP_ALIVE();
+				if( pRecorder->isFailed() ) {
+					_ERROR("Recorder failed, terminating session " << getParams().start_ts);
+					message = "recorder failed";
+					break;
+				}
+				if( statsIntervalMs > 0 && currentTimeMs() - tsStats >= statsIntervalMs ) {
+					tsStats = currentTimeMs();
+					const RecorderStats stats = pRecorder->getStats();
+					const int event = monitor.update(stats.videoEncoded, tsStats);
+					logRecorderStats(stats, monitor, getParams().start_ts);
+					checkEncodeRate(event, monitor, getParams().appName, getParams().start_ts,
+									fRepromonEnabled, pRepromonQueue);
+				}
+			}
+			if( pAudioCodeAnalyzer ) {
+				pAudioCodeAnalyzer->stop();
+				_INFO("Audio code analyzer: " << pAudioCodeAnalyzer->getAnalyzed() << " samples analyzed, "
+					  << pAudioCodeAnalyzer->getDropped() << " dropped, " << pAudioCodeAnalyzer->getBursts()
+					  << " tone bursts, " << pAudioCodeAnalyzer->getDecoded() << " codes");
+			}
+			if( pNoSignalAnalyzer ) {
+				pNoSignalAnalyzer->stop();
+				_INFO("No-signal analyzer: " << pNoSignalAnalyzer->getAnalyzed() << " frames analyzed, "
+					  << pNoSignalAnalyzer->getMatched() << " matched, " << pNoSignalAnalyzer->getIntervals()
+					  << " intervals");
+			}
+			if( pQrAnalyzer ) {
+				pQrAnalyzer->stop();
+				_INFO("QR analyzer: " << pQrAnalyzer->getAnalyzed() << " frames analyzed, "
+					  << pQrAnalyzer->getDecoded() << " decoded, " << pQrAnalyzer->getRecords() << " codes");
+			}
+			// capture is stopped already on handover to new recorder
+			if( getParams().fKeepArmed && !pRecorder->isFailed() && pRecorder->isCapturing() ) {
+				pRecorder->stopOutput();
+			} else {
+				pRecorder->stop();
+			}
+			_FFMPEG_KEEP_ALIVE();
+			const RecorderStats stats = pRecorder->getStats();
+			logRecorderStats(stats, monitor, getParams().start_ts);
+			_INFO("Recorder stats: " << recorderStatsToString(stats));
+		} else {
+			message = "recorder failed to start";
+		}
+	} catch(std::exception& e) {
+		_ERROR("RecorderThread unhandled exception: " << e.what());
+	}
+	_VERBOSE("RecorderThread leave [" << tid << "]: " << opts.outFile);
+
+	// segments are renamed on close, name of the whole
+	// session is used for log and manifest
+	const std::string outVideoFile2 = endRecordingSession(getParams().appName,
+					getParams().outVideoFile,
+					getParams().outPath,
+					getParams().start_ts,
+					getParams().tsStart,
+					getParams().outExt,
+					message,
+					fRepromonEnabled,
+					pRepromonQueue);
+	const std::string& segmentsFile = getParams().segmentsFile;
+	if( !segmentsFile.empty() && std::filesystem::exists(segmentsFile) ) {
+		const std::string segmentsFile2 = outVideoFile2 + ".segments.jsonl";
+		_INFO("Renaming segments manifest: " << segmentsFile << " -> " << segmentsFile2);
+		rename(segmentsFile.c_str(), segmentsFile2.c_str());
+	}
+	const std::string& qrInfoFile = getParams().qrInfoFile;
+	if( !qrInfoFile.empty() && std::filesystem::exists(qrInfoFile) ) {
+		const std::string qrInfoFile2 = outVideoFile2 + ".qrinfo.jsonl";
+		_INFO("Renaming QR info: " << qrInfoFile << " -> " << qrInfoFile2);
+		rename(qrInfoFile.c_str(), qrInfoFile2.c_str());
+	}
 	_FFMPEG_KEEP_ALIVE();
 }
 
@@ -308,13 +684,58 @@ void FfmpegThread::run() {
 VideoCaptureApp::VideoCaptureApp() {
 	appName = "reprostim-videocapture";
 	audioEnabled = true;
+	m_fLibavActive = false;
+	m_pRetiringRecorder = nullptr;
+	m_retiringDeadlineMs = 0;
+	m_vcOpts.recorder = VC_RECORDER_FFMPEG;
+	m_vcOpts.queue_size = VC_DEFAULT_QUEUE_SIZE;
+	m_vcOpts.stats_interval_sec = VC_DEFAULT_STATS_INTERVAL_SEC;
+	m_vcOpts.pre_roll_ms = VC_DEFAULT_PRE_ROLL_MS;
+	m_vcOpts.segment_sec = 0;
+	m_vcOpts.segment_mb = 0;
+	m_vcOpts.handover = false;
+	m_vcOpts.qr = QrOpts();
+	m_vcOpts.nosignal = NoSignalOpts();
+	m_vcOpts.audiocode = AudioCodeOpts();
 }
 
 VideoCaptureApp::~VideoCaptureApp() {
+	reapRetiringRecorder(true);
+	m_recorderExec.shutdown();
+	m_pArmedRecorder.reset();
 	m_ffmpegExec.shutdown();
 	m_extProcExec.shutdown();
 }
 
+bool VideoCaptureApp::armRecorder(int cx, int cy, const std::string& frameRate,
+		const std::string& v_dev, const std::string& a_dev) {
+	const std::string key = v_dev + "|" + a_dev + "|" + std::to_string(cx) + "x" +
+							std::to_string(cy) + "@" + frameRate;
+	if( m_pArmedRecorder && m_armedKey == key &&
+		m_pArmedRecorder->isCapturing() && !m_pArmedRecorder->isFailed() ) {
+		return true;
+	}
+	// devices can be opened once only, release previous capture first
+	m_pArmedRecorder.reset();
+	m_armedKey.clear();
+
+	RecorderOpts opts;
+	makeRecorderOpts(cfg.ffm_opts, cx, cy, frameRate, v_dev, a_dev, "", "", opts);
+	opts.queueSize = m_vcOpts.queue_size;
+	opts.preRollMs = m_vcOpts.pre_roll_ms;
+	opts.segmentSec = m_vcOpts.segment_sec;
+	opts.segmentMb = m_vcOpts.segment_mb;
+	std::shared_ptr<LibavRecorder> pRecorder = std::make_shared<LibavRecorder>(opts);
+	_INFO("Start pre-roll capture: " << v_dev << ", " << cx << "x" << cy << ", " << frameRate << " fps");
+	if( !pRecorder->start() ) {
+		_ERROR("Failed to start pre-roll capture: " << v_dev);
+		return false;
+	}
+	m_pArmedRecorder = pRecorder;
+	m_armedKey = key;
+	return true;
+}
+
 void VideoCaptureApp::checkExtProc(const std::string& mode) {
 	printVersion();
 	if( !(mode == "all" || mode == "status" || mode == "exec") ) {
@@ -331,30 +752,110 @@ void VideoCaptureApp::checkExtProc(const std::string& mode) {
 
 	if( fExec && (mode == "all" || mode == "exec") ) {
 		std::string cmd = cfg.ext_proc_opts.exec_command;
+		auto pProc = std::make_shared<ChildProc>();
 		// create background thread to execute test kill command
-		std::thread([cmd]() {
+		std::thread([pProc]() {
 			SLEEP_SEC(1*60);
 			_INFO("Kill external process command for testing purposes");
-			killExtProc(cmd, SIGTERM);
+			pProc->kill(SIGTERM);
 		}).detach(); // run in the background
 
 		_INFO(" ");
 		_INFO("[Check exec command]: pid=" << getpid());
 		_INFO("  [EXEC COMMAND]  : " << cmd);
 		_INFO("  [OUTPUT]        : ");
-		exec(cmd, true);
+		ProcRunOpts runOpts;
+		runOpts.showOutput = true;
+		pProc->run({"/bin/sh", "-c", cmd}, runOpts);
 		_INFO("  [DONE]");
 	}
 }
 
+void VideoCaptureApp::onCaptureChange(const std::string& message) {
+	if( !m_vcOpts.handover || recording==0 || isSysBreakExec() ) {
+		onCaptureStop(message);
+		return;
+	}
+
+	// make-before-break: old capture devices are released and new
+	// recording is started first, old output is finalized after it
+	// by own recorder thread, which retires until it's stopped
+	const std::string prev_start_ts = start_ts;
+	Timestamp tsStop;
+	RecorderThread *pt = m_fLibavActive ? m_recorderExec.getCurrentThread() : nullptr;
+	if( pt!=nullptr && pt->isRunning() ) {
+		// only one retiring recorder, previous one should be done by now
+		reapRetiringRecorder(true);
+		_INFO("Handover: releasing capture of session " << start_ts);
+		pt->getParams().pRecorder->stopCapture();
+		tsStop = CURRENT_TIMESTAMP();
+		logCaptureStop(start_ts, tsStart, tsStop, message, true);
+		if( m_pArmedRecorder==pt->getParams().pRecorder ) {
+			m_pArmedRecorder.reset();
+			m_armedKey.clear();
+		}
+		if (cfg.ext_proc_opts.enabled) {
+			stopExtProc();
+		}
+		_SESSION_LOG_END();
+		_INFO(getTimeStr(tsStop) << " " << message);
+		m_pRetiringRecorder = m_recorderExec.release();
+		m_retiringDeadlineMs = reprostim::currentTimeMs() + _RECORDER_STOP_TIMEOUT_MS;
+		m_pRetiringRecorder->terminate();
+	} else {
+		// ffmpeg process keeps devices open until output is
+		// finalized, so it's stopped first and restarted right away
+		onCaptureStop(message);
+		tsStop = CURRENT_TIMESTAMP();
+	}
+
+	startRecording(vssCur.cx,
+				   vssCur.cy,
+				   frameRate,
+				   targetVideoDevPath,
+				   targetAudioInDevPath,
+				   false);
+	recording = 1;
+	const Timestamp tsStarted = m_tsOutputStarted;
+	const long long gapMs = std::chrono::duration_cast<std::chrono::milliseconds>(tsStarted - tsStop).count();
+	json jm = {
+			{"type", "capture_handover"},
+			{"json_ts", getTimeStr(tsStarted)},
+			{"json_isotime", getTimeIsoStr(tsStarted)},
+			{"prev_cap_ts_start", prev_start_ts},
+			{"prev_cap_ts_stop", getTimeStr(tsStop)},
+			{"prev_cap_isotime_stop", getTimeIsoStr(tsStop)},
+			{"cap_ts_start", start_ts},
+			{"cap_isotime_start", getTimeIsoStr(tsStart)},
+			{"recorder", m_fLibavActive ? VC_RECORDER_LIBAV : VC_RECORDER_FFMPEG},
+			{"gap_ms", gapMs}
+	};
+	_METADATA_LOG(jm);
+	_INFO(start_ts << ":\tHandover recording: " << prev_start_ts << " -> " << start_ts
+		  << ", gap " << gapMs << " ms");
+	_INFO("Apct Rat: " << vssCur.cx << "x" << vssCur.cy);
+	_INFO("FR: " << frameRate);
+	// the same settle time as on regular start
+	SLEEP_SEC(5);
+}
+
 void VideoCaptureApp::onCaptureIdle() {
+	reapRetiringRecorder(false);
 	if ( recording==1 ) {
-		FfmpegThread *pt = m_ffmpegExec.getCurrentThread();
-		if ( pt!=nullptr && !pt->isRunning() ) {
+		bool fTerminated = false;
+		if( m_fLibavActive ) {
+			RecorderThread *pt = m_recorderExec.getCurrentThread();
+			fTerminated = pt!=nullptr && !pt->isRunning();
+		} else {
+			FfmpegThread *pt = m_ffmpegExec.getCurrentThread();
+			fTerminated = pt!=nullptr && !pt->isRunning();
+		}
+		if ( fTerminated ) {
 			if (!isSysBreakExec() ) {
 				long long ts = s_ffmpegKeepAliveTs.load() + _FFMPEG_RECOVERY_TIMEOUT_MS;
 				if ( reprostim::currentTimeMs() > ts ) {
-					_INFO("Restart Recording: Ffmpeg thread terminated, restarting capture");
+					_INFO("Restart Recording: " << (m_fLibavActive ? "Recorder" : "Ffmpeg") <<
+						  " thread terminated, restarting capture");
 					onCaptureStartInternal(true);
 				} else {
 					_VERBOSE("Skip Restart Recording, waiting for recovery timeout");
@@ -389,25 +890,162 @@ void VideoCaptureApp::onCaptureStop(const std::string& message) {
 	if ( recording > 0 ) {
 		Timestamp tsStop = CURRENT_TIMESTAMP();
 		std::string stop_ts = getTimeStr(tsStop);
-
-		Timestamp ts = CURRENT_TIMESTAMP();
-		json jm = {
-				{"type", "capture_stop"},
-				{"version", CAPTURE_VERSION_STRING},
-				{"json_ts", getTimeStr(ts)},
-				{"json_isotime", getTimeIsoStr(ts)},
-				{"message", message},
-				{"cap_ts_start", start_ts},
-				{"cap_isotime_start", getTimeIsoStr(tsStart)},
-				{"cap_ts_stop", stop_ts},
-				{"cap_isotime_stop", getTimeIsoStr(tsStop)}
-		};
-		_METADATA_LOG(jm);
+		logCaptureStop(start_ts, tsStart, tsStop, message, false);
 
 		stopRecording(start_ts, outPath, message);
 		recording = 0;
 		_INFO(stop_ts << " " << message);
+
+		// start pre-roll of new video mode right away, so next
+		// session starts with frames captured before it is detected
+		if( m_fLibavActive && m_vcOpts.pre_roll_ms > 0 && !isSysBreakExec() &&
+			vssCur.cx > 0 && vssCur.cx < 9999 && vssCur.cy > 0 && vssCur.cy < 9999 ) {
+			armRecorder(vssCur.cx, vssCur.cy, frameRate, targetVideoDevPath, targetAudioInDevPath);
+		}
+	}
+}
+
+bool VideoCaptureApp::onLoadConfig(AppConfig& cfg, const std::string& pathConfig, YAML::Node doc) {
+	if( doc["vc_opts"] ) {
+		YAML::Node node = doc["vc_opts"];
+		m_vcOpts.recorder = node["recorder"] ? getYamlProp<std::string>(node, "recorder") : VC_RECORDER_FFMPEG;
+		m_vcOpts.queue_size = node["queue_size"] ? getYamlProp<int>(node, "queue_size") : VC_DEFAULT_QUEUE_SIZE;
+		m_vcOpts.stats_interval_sec = node["stats_interval_sec"] ?
+				getYamlProp<int>(node, "stats_interval_sec") : VC_DEFAULT_STATS_INTERVAL_SEC;
+		m_vcOpts.pre_roll_ms = node["pre_roll_ms"] ? getYamlProp<int>(node, "pre_roll_ms") : VC_DEFAULT_PRE_ROLL_MS;
+		m_vcOpts.segment_sec = node["segment_sec"] ? getYamlProp<int>(node, "segment_sec") : 0;
+		m_vcOpts.segment_mb = node["segment_mb"] ? getYamlProp<int>(node, "segment_mb") : 0;
+		m_vcOpts.handover = node["handover"] ? getYamlProp<bool>(node, "handover") : false;
+		m_vcOpts.qr = QrOpts();
+		m_vcOpts.qr.enabled = node["qr_enabled"] ? getYamlProp<bool>(node, "qr_enabled") : false;
+		m_vcOpts.qr.stride = node["qr_stride"] ? getYamlProp<int>(node, "qr_stride") : VC_DEFAULT_QR_STRIDE;
+		if( node["qr_roi"] ) {
+			const std::vector<int> roi = node["qr_roi"].as<std::vector<int>>();
+			if( roi.size() != 4 ) {
+				_ERROR("Invalid vc_opts.qr_roi value, must be [x, y, width, height]");
+				return false;
+			}
+			m_vcOpts.qr.roiX = roi[0];
+			m_vcOpts.qr.roiY = roi[1];
+			m_vcOpts.qr.roiW = roi[2];
+			m_vcOpts.qr.roiH = roi[3];
+		}
+		m_vcOpts.nosignal = NoSignalOpts();
+		m_vcOpts.nosignal.enabled = node["nosignal_enabled"] ? getYamlProp<bool>(node, "nosignal_enabled") : false;
+		m_vcOpts.nosignal.stride = node["nosignal_stride"] ?
+				getYamlProp<int>(node, "nosignal_stride") : VC_DEFAULT_NOSIGNAL_STRIDE;
+		m_vcOpts.nosignal.threshold = node["nosignal_threshold"] ?
+				getYamlProp<int>(node, "nosignal_threshold") : VC_DEFAULT_NOSIGNAL_THRESHOLD;
+		m_vcOpts.nosignal.minMs = node["nosignal_min_ms"] ?
+				getYamlProp<int>(node, "nosignal_min_ms") : VC_DEFAULT_NOSIGNAL_MIN_MS;
+		m_vcOpts.nosignal.action = node["nosignal_action"] ?
+				getYamlProp<std::string>(node, "nosignal_action") : VC_NOSIGNAL_NONE;
+		m_vcOpts.audiocode = AudioCodeOpts();
+		m_vcOpts.audiocode.enabled = node["audiocode_enabled"] ? getYamlProp<bool>(node, "audiocode_enabled") : false;
+		m_vcOpts.audiocode.codec = node["audiocode_codec"] ?
+				getYamlProp<std::string>(node, "audiocode_codec") : VC_AUDIOCODE_FSK;
+		m_vcOpts.audiocode.f0 = node["audiocode_f0"] ? getYamlProp<int>(node, "audiocode_f0") : VC_DEFAULT_AUDIOCODE_F0;
+		m_vcOpts.audiocode.f1 = node["audiocode_f1"] ? getYamlProp<int>(node, "audiocode_f1") : VC_DEFAULT_AUDIOCODE_F1;
+		m_vcOpts.audiocode.bitMs = node["audiocode_bit_ms"] ?
+				getYamlProp<double>(node, "audiocode_bit_ms") : VC_DEFAULT_AUDIOCODE_BIT_MS;
+		m_vcOpts.audiocode.nfeDf = node["audiocode_nfe_df"] ?
+				getYamlProp<int>(node, "audiocode_nfe_df") : VC_DEFAULT_AUDIOCODE_NFE_DF;
+		m_vcOpts.audiocode.nfeMs = node["audiocode_nfe_ms"] ?
+				getYamlProp<int>(node, "audiocode_nfe_ms") : VC_DEFAULT_AUDIOCODE_NFE_MS;
+		m_vcOpts.audiocode.level = node["audiocode_level"] ?
+				getYamlProp<double>(node, "audiocode_level") : VC_DEFAULT_AUDIOCODE_LEVEL;
+	} else {
+		m_vcOpts.recorder = VC_RECORDER_FFMPEG;
+		m_vcOpts.queue_size = VC_DEFAULT_QUEUE_SIZE;
+		m_vcOpts.stats_interval_sec = VC_DEFAULT_STATS_INTERVAL_SEC;
+		m_vcOpts.pre_roll_ms = VC_DEFAULT_PRE_ROLL_MS;
+		m_vcOpts.segment_sec = 0;
+		m_vcOpts.segment_mb = 0;
+		m_vcOpts.handover = false;
+		m_vcOpts.qr = QrOpts();
+		m_vcOpts.nosignal = NoSignalOpts();
+		m_vcOpts.audiocode = AudioCodeOpts();
+	}
+	if( m_vcOpts.recorder != VC_RECORDER_FFMPEG && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_ERROR("Invalid vc_opts.recorder value: " << m_vcOpts.recorder << ", must be '"
+			   << VC_RECORDER_FFMPEG << "' or '" << VC_RECORDER_LIBAV << "'");
+		return false;
+	}
+	if( m_vcOpts.recorder == VC_RECORDER_LIBAV && !isLibavRecorderSupported() ) {
+		_ERROR("vc_opts.recorder '" << VC_RECORDER_LIBAV << "' is not supported in this build, "
+			   << "rebuild with -DLIBAV_ENABLED=ON");
+		return false;
+	}
+	if( m_vcOpts.recorder == VC_RECORDER_LIBAV ) {
+		RecorderOpts recOpts;
+		if( !makeRecorderOpts(cfg.ffm_opts, 0, 0, "", "", "", "", "", recOpts) ) {
+			_ERROR("Invalid ffm_opts values for vc_opts.recorder '" << VC_RECORDER_LIBAV << "'");
+			return false;
+		}
+	}
+	if( m_vcOpts.queue_size < 1 ) {
+		_ERROR("Invalid vc_opts.queue_size value: " << m_vcOpts.queue_size << ", must be >= 1");
+		return false;
+	}
+	if( m_vcOpts.pre_roll_ms < 0 ) {
+		_ERROR("Invalid vc_opts.pre_roll_ms value: " << m_vcOpts.pre_roll_ms << ", must be >= 0");
+		return false;
+	}
+	if( m_vcOpts.pre_roll_ms > 0 && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_INFO("vc_opts.pre_roll_ms is supported by '" << VC_RECORDER_LIBAV << "' recorder only, ignored");
+	}
+	if( m_vcOpts.segment_sec < 0 || m_vcOpts.segment_mb < 0 ) {
+		_ERROR("Invalid vc_opts.segment_sec/segment_mb values: " << m_vcOpts.segment_sec << "/"
+			   << m_vcOpts.segment_mb << ", must be >= 0");
+		return false;
+	}
+	if( (m_vcOpts.segment_sec > 0 || m_vcOpts.segment_mb > 0) && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_INFO("vc_opts.segment_sec/segment_mb are supported by '" << VC_RECORDER_LIBAV << "' recorder only, ignored");
+	}
+	if( m_vcOpts.stats_interval_sec < 0 ) {
+		_ERROR("Invalid vc_opts.stats_interval_sec value: " << m_vcOpts.stats_interval_sec << ", must be >= 0");
+		return false;
 	}
+	const QrOpts& qr = m_vcOpts.qr;
+	if( qr.stride < 1 || qr.roiX < 0 || qr.roiY < 0 || qr.roiW < 0 || qr.roiH < 0 ) {
+		_ERROR("Invalid vc_opts.qr_stride/qr_roi values: " << qr.stride << "/[" << qr.roiX << ", "
+			   << qr.roiY << ", " << qr.roiW << ", " << qr.roiH << "], must be >= 1 and >= 0");
+		return false;
+	}
+	if( qr.enabled && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_INFO("vc_opts.qr_enabled is supported by '" << VC_RECORDER_LIBAV << "' recorder only, ignored");
+	}
+	const NoSignalOpts& ns = m_vcOpts.nosignal;
+	if( ns.stride < 1 || ns.threshold < 0 || ns.minMs < 0 ) {
+		_ERROR("Invalid vc_opts.nosignal_stride/nosignal_threshold/nosignal_min_ms values: " << ns.stride
+			   << "/" << ns.threshold << "/" << ns.minMs << ", must be >= 1, >= 0 and >= 0");
+		return false;
+	}
+	if( ns.action != VC_NOSIGNAL_NONE && ns.action != VC_NOSIGNAL_PAUSE && ns.action != VC_NOSIGNAL_ROTATE ) {
+		_ERROR("Invalid vc_opts.nosignal_action value: " << ns.action << ", must be '" << VC_NOSIGNAL_NONE
+			   << "', '" << VC_NOSIGNAL_PAUSE << "' or '" << VC_NOSIGNAL_ROTATE << "'");
+		return false;
+	}
+	if( ns.enabled && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_INFO("vc_opts.nosignal_enabled is supported by '" << VC_RECORDER_LIBAV << "' recorder only, ignored");
+	}
+	const AudioCodeOpts& ac = m_vcOpts.audiocode;
+	if( ac.codec != VC_AUDIOCODE_FSK && ac.codec != VC_AUDIOCODE_NFE ) {
+		_ERROR("Invalid vc_opts.audiocode_codec value: " << ac.codec << ", must be '" << VC_AUDIOCODE_FSK
+			   << "' or '" << VC_AUDIOCODE_NFE << "'");
+		return false;
+	}
+	if( ac.f0 <= 0 || ac.f1 <= ac.f0 || ac.bitMs <= 0 || ac.nfeDf <= 0 || ac.nfeMs <= 0 ||
+		ac.level <= 0 || ac.level > 1 ) {
+		_ERROR("Invalid vc_opts.audiocode_f0/audiocode_f1/audiocode_bit_ms/audiocode_nfe_df/audiocode_nfe_ms/"
+			   << "audiocode_level values: " << ac.f0 << "/" << ac.f1 << "/" << ac.bitMs << "/" << ac.nfeDf
+			   << "/" << ac.nfeMs << "/" << ac.level << ", must be > 0, f1 > f0 and level <= 1");
+		return false;
+	}
+	if( ac.enabled && m_vcOpts.recorder != VC_RECORDER_LIBAV ) {
+		_INFO("vc_opts.audiocode_enabled is supported by '" << VC_RECORDER_LIBAV << "' recorder only, ignored");
+	}
+	return true;
 }
 
 int VideoCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
@@ -444,6 +1082,15 @@ int VideoCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 								 "\t         \t  status : run only status command and regex\n"
 								 "\t         \t  exec   : run external process command\n"
 								 "\t         \tDefault value is \"status\"\n"
+								 "\t--bench-encoders <spec>\n"
+								 "\t         \tBenchmark matrix of encoder presets/threads around\n"
+								 "\t         \tconfigured ffm_opts.v_enc on synthetic frames, report\n"
+								 "\t         \trealtime speed, CPU, RSS, output size and recommended\n"
+								 "\t         \tffm_opts. <spec> is <width>x<height>@<fps>, default\n"
+								 "\t         \tvalue is \"" VC_BENCH_DEFAULT_SPEC "\"\n"
+								 "\t--bench-input <path>\n"
+								 "\t         \tReplay video file instead of synthetic frames in\n"
+								 "\t         \tencoder benchmark\n"
 								 "\t-h, --help\n"
 								 "\t         \tPrint this help string\n";
 
@@ -461,11 +1108,16 @@ int VideoCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 			{"list-devices", optional_argument, nullptr, 'l'},
 			{"ext-proc", optional_argument, nullptr, 'e'},
 			{"file-log", required_argument, nullptr, 'f'},
+			{"bench-encoders", optional_argument, nullptr, 1001},
+			{"bench-input", required_argument, nullptr, 1002},
 			{nullptr, 0, nullptr, 0}
 	};
 
 	m_fTopLogFfmpeg = false;
 	bool fExtProc = false;
+	bool fBench = false;
+	std::string benchSpec = VC_BENCH_DEFAULT_SPEC;
+	BenchOpts benchOpts;
 
 	while ((c = getopt_long(argc, argv, "o:c:d:f:hvVlet", longOpts, nullptr)) != -1) {
 		switch(c) {
@@ -511,6 +1163,18 @@ int VideoCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 			case 't':
 				m_fTopLogFfmpeg = true;
 				break;
+			case 1001:
+				fBench = true;
+				if (optarg) {
+					benchSpec = std::string(optarg);
+				} else if (optind < argc && argv[optind][0] != '-') {
+					benchSpec = std::string(argv[optind]);
+					optind++;
+				}
+				break;
+			case 1002:
+				if(optarg) benchOpts.inputFile = optarg;
+				break;
 		}
 	}
 
@@ -552,9 +1216,46 @@ int VideoCaptureApp::parseOpts(AppOpts& opts, int argc, char* argv[]) {
 		return 1;
 	}
 
+	// run encoder benchmark with ffm_opts from config
+	if (fBench) {
+		setVerbose(opts.verbose);
+		if( !parseBenchSpec(benchSpec, benchOpts) ) {
+			return EX_USAGE;
+		}
+		if( !loadConfig(cfg, opts.configPath) ) {
+			return EX_CONFIG;
+		}
+		const int res = runEncoderBench(cfg.ffm_opts, benchOpts);
+		return res == EX_OK ? 1 : res;
+	}
+
 	return EX_OK;
 }
 
+void VideoCaptureApp::reapRetiringRecorder(bool fWait) {
+	if( m_pRetiringRecorder==nullptr ) {
+		return;
+	}
+	// recorder thread finalizing handed over output is checked on
+	// capture idle cycles, so main loop isn't blocked on it
+	while( fWait && m_pRetiringRecorder->isRunning() &&
+		   reprostim::currentTimeMs() < m_retiringDeadlineMs ) {
+		SLEEP_MS(100);
+	}
+	if( m_pRetiringRecorder->isRunning() ) {
+		if( reprostim::currentTimeMs() < m_retiringDeadlineMs ) {
+			return;
+		}
+		// NOTE: memory-leaks are possible in rare conditions
+		_ERROR("Handover: libav recorder not stopped in " << _RECORDER_STOP_TIMEOUT_MS << " ms");
+	} else {
+		_INFO("Handover: libav recorder of session "
+			  << m_pRetiringRecorder->getParams().start_ts << " stopped");
+		RecorderThread::deleteInstance(m_pRetiringRecorder);
+	}
+	m_pRetiringRecorder = nullptr;
+}
+
 void VideoCaptureApp::startRecording(int cx, int cy, const std::string& frameRate,
 		const std::string& v_dev, const std::string& a_dev, bool fRecovery) {
 	tsStart = CURRENT_TIMESTAMP();
@@ -570,7 +1271,7 @@ void VideoCaptureApp::startRecording(int cx, int cy, const std::string& frameRat
 	sprintf(
 			ffmpg,
 			"ffmpeg %s %s %s %s %s -framerate %s -video_size %ix%i %s -i %s "
-			"%s %s %s %s -metadata comment=%s %s 2>&1", // > /dev/null &",
+			"%s %s %s %s -progress pipe:1 -metadata comment=%s %s 2>&1", // > /dev/null &",
 			opts.a_fmt.c_str(),
 			opts.a_nchan.c_str(),
 			opts.a_opt.c_str(),
@@ -591,6 +1292,44 @@ void VideoCaptureApp::startRecording(int cx, int cy, const std::string& frameRat
 
 	SessionLogger_ptr pLogger = createSessionLogger("session_logger_" + start_ts, outVideoFile + ".log");
 	_SESSION_LOG_BEGIN(pLogger);
+
+	// libav recorder is started here, so pre-roll length
+	// is known for session metadata
+	m_fLibavActive = m_vcOpts.recorder == VC_RECORDER_LIBAV;
+	const bool fPreRoll = m_fLibavActive && m_vcOpts.pre_roll_ms > 0;
+	// no-signal intervals are rotated to own segments
+	const bool fNoSignalRotate = m_vcOpts.nosignal.enabled && m_vcOpts.nosignal.action == VC_NOSIGNAL_ROTATE;
+	const bool fSegments = m_fLibavActive && (m_vcOpts.segment_sec > 0 || m_vcOpts.segment_mb > 0 ||
+											  fNoSignalRotate);
+	const std::string segmentsFile = fSegments ? outVideoFile + ".segments.jsonl" : "";
+	const std::string qrInfoFile = m_fLibavActive && m_vcOpts.qr.enabled ? outVideoFile + ".qrinfo.jsonl" : "";
+	std::shared_ptr<LibavRecorder> pRecorder;
+	RecorderOpts recOpts;
+	int64_t preRollUs = 0;
+	if( m_fLibavActive ) {
+		// options are validated on config load
+		makeRecorderOpts(opts, cx, cy, frameRate, v_dev, a_dev, outVideoFile, instanceTag, recOpts);
+		recOpts.queueSize = m_vcOpts.queue_size;
+		recOpts.preRollMs = m_vcOpts.pre_roll_ms;
+		recOpts.segmentSec = m_vcOpts.segment_sec;
+		recOpts.segmentMb = m_vcOpts.segment_mb;
+		if( fPreRoll && armRecorder(cx, cy, frameRate, v_dev, a_dev) ) {
+			pRecorder = m_pArmedRecorder;
+		} else {
+			pRecorder = std::make_shared<LibavRecorder>(recOpts);
+		}
+		if( fSegments ) {
+			pRecorder->setSegmentCallback(makeSegmentCallback(outPath, opts.out_fmt, start_ts, tsStart,
+															  segmentsFile, pLogger));
+		}
+		if( pRecorder->isRunning() ) {
+			pRecorder->startOutput(outVideoFile, instanceTag, &preRollUs);
+		} else {
+			pRecorder->start();
+		}
+		m_tsOutputStarted = CURRENT_TIMESTAMP();
+	}
+
 	Timestamp ts = CURRENT_TIMESTAMP();
 	json jm = {
 			{"type", "session_begin"},
@@ -607,7 +1346,9 @@ void VideoCaptureApp::startRecording(int cx, int cy, const std::string& frameRat
 			{"cx", cx},
 			{"cy", cy},
 			{"frameRate", frameRate},
-			{"autoRecovery", fRecovery}
+			{"autoRecovery", fRecovery},
+			{"recorder", m_vcOpts.recorder},
+			{"pre_roll_ms", preRollUs / 1000}
 	};
 	_METADATA_LOG(jm);
 	_NOTIFY_REPROMON(
@@ -624,74 +1365,139 @@ void VideoCaptureApp::startRecording(int cx, int cy, const std::string& frameRat
 		}
 	);
 
-	std::string cmd = ffmpg;
-	const ConductOpts& conduct_opts = cfg.conduct_opts;
-	std::string duct_prefix = outVideoFile + ".duct_";
-	if (conduct_opts.enabled) {
-		_VERBOSE("Expand con/duct macros...");
-		cmd = expandMacros(conduct_opts.cmd, {
-				{"duct_bin", conduct_opts.duct_bin},
-				{"start_ts", start_ts},
-				{"prefix", duct_prefix},
-				{"ffmpeg_cmd", ffmpg}
+	if( m_fLibavActive ) {
+		RecorderThread* ptr = RecorderThread::newInstance(RecorderParams{
+				recOpts,
+				pRecorder,
+				fPreRoll,
+				segmentsFile,
+				m_vcOpts.qr,
+				qrInfoFile,
+				m_vcOpts.nosignal,
+				m_vcOpts.audiocode,
+				appName,
+				opts.out_fmt,
+				outPath,
+				outVideoFile,
+				start_ts,
+				tsStart,
+				pLogger,
+				fRepromonEnabled,
+				pRepromonQueue.get(), // NOTE: unsafe ownership
+				std::atof(frameRate.c_str()),
+				m_vcOpts.stats_interval_sec
+		});
+		m_recorderExec.schedule(ptr);
+	} else {
+		std::string cmd = ffmpg;
+		const ConductOpts& conduct_opts = cfg.conduct_opts;
+		std::string duct_prefix = outVideoFile + ".duct_";
+		if (conduct_opts.enabled) {
+			_VERBOSE("Expand con/duct macros...");
+			cmd = expandMacros(conduct_opts.cmd, {
+					{"duct_bin", conduct_opts.duct_bin},
+					{"start_ts", start_ts},
+					{"prefix", duct_prefix},
+					{"ffmpeg_cmd", ffmpg}
+			});
+			_INFO("Con/duct command: " << cmd);
+		}
+		auto pProc = std::make_shared<ChildProc>();
+		if( !pProc->spawn(cmd, true) ) {
+			_ERROR("Failed to start ffmpeg process: " << cmd);
+		}
+		m_tsOutputStarted = CURRENT_TIMESTAMP();
+		_VERBOSE("Created session logger: session_logger_" << start_ts);
+		FfmpegThread* ptf = FfmpegThread::newInstance(FfmpegParams{
+				appName,
+				cmd,
+				ffmpg,
+				opts.out_fmt,
+				outPath,
+				outVideoFile,
+				start_ts,
+				tsStart,
+				pLogger,
+				fRepromonEnabled,
+				pRepromonQueue.get(), // NOTE: unsafe ownership
+				m_fTopLogFfmpeg,
+				duct_prefix,
+				pProc,
+				std::atof(frameRate.c_str()),
+				m_vcOpts.stats_interval_sec
 		});
-		_INFO("Con/duct command: " << cmd);
+
+		m_ffmpegExec.schedule(ptf);
 	}
-	_VERBOSE("Created session logger: session_logger_" << start_ts);
-	FfmpegThread* ptf = FfmpegThread::newInstance(FfmpegParams{
-			appName,
-			cmd,
-			ffmpg,
-			opts.out_fmt,
-			outPath,
-			outVideoFile,
-			start_ts,
-			tsStart,
-			pLogger,
-			fRepromonEnabled,
-			pRepromonQueue.get(), // NOTE: unsafe ownership
-			m_fTopLogFfmpeg,
-			duct_prefix
-	});
-
-	m_ffmpegExec.schedule(ptf);
 
 	if (cfg.ext_proc_opts.enabled) {
 		_VERBOSE("Starting external process...");
 		ExtProcThread *pte = ExtProcThread::newInstance(ExtProcParams{
 				cfg.ext_proc_opts,
 				pLogger,
-				m_fTopLogFfmpeg
+				m_fTopLogFfmpeg,
+				std::make_shared<ChildProc>()
 		});
 		m_extProcExec.schedule(pte);
 	}
 }
 
+void VideoCaptureApp::stopExtProc() {
+	ExtProcThread *pt = m_extProcExec.getCurrentThread();
+	if( pt==nullptr ) {
+		return;
+	}
+	_VERBOSE("terminating external process with SIGINT/SIGTERM: " << cfg.ext_proc_opts.exec_command);
+	if( !pt->getParams().pProc->stop({
+			{SIGINT, _EXT_PROC_STOP_SIGINT_MS},
+			{SIGTERM, _EXT_PROC_STOP_SIGTERM_MS}}) ) {
+		_ERROR("External process not stopped, pid=" << pt->getParams().pProc->getPid());
+	}
+}
+
 void VideoCaptureApp::stopRecording(const std::string& start_ts,
 									const std::string& vpath,
 									const std::string& message) {
 	std::string out_fmt = cfg.ffm_opts.out_fmt;
 	std::string oldname = buildVideoFile(vpath, start_ts + "--", out_fmt);
 
-	_INFO("stop record says: " << "terminating ffmpeg with SIGINT");
-	if( !killProc("ffmpeg", SIGINT, 5, false, instanceTag) ) {
-		_INFO("stop record says: " << "terminating ffmpeg with SIGTERM");
-		if( !killProc("ffmpeg", SIGTERM, 1.5, false, instanceTag) ) {
-			_INFO("stop record says: " << "terminating ffmpeg with SIGKILL");
-			killProc("ffmpeg", SIGKILL, 1.5, true, instanceTag);
+	if( m_fLibavActive ) {
+		RecorderThread *pt = m_recorderExec.getCurrentThread();
+		if( pt!=nullptr ) {
+			_INFO("stop record says: " << "stopping libav recorder");
+			// stop() waits shortly only, give recorder time to flush encoders
+			pt->stop();
+			long long ts = reprostim::currentTimeMs() + _RECORDER_STOP_TIMEOUT_MS;
+			while( pt->isRunning() && reprostim::currentTimeMs() < ts ) {
+				SLEEP_MS(100);
+			}
+			if( pt->isRunning() ) {
+				_ERROR("stop record says: " << "libav recorder not stopped in "
+					   << _RECORDER_STOP_TIMEOUT_MS << " ms");
+			}
+		}
+	} else {
+		FfmpegThread *pt = m_ffmpegExec.getCurrentThread();
+		if( pt!=nullptr ) {
+			_INFO("stop record says: " << "terminating ffmpeg with SIGINT/SIGTERM/SIGKILL");
+			if( !pt->getParams().pProc->stop({
+					{SIGINT, _FFMPEG_STOP_SIGINT_MS},
+					{SIGTERM, _FFMPEG_STOP_SIGTERM_MS},
+					{SIGKILL, _FFMPEG_STOP_SIGKILL_MS}}) ) {
+				_ERROR("stop record says: " << "ffmpeg process not stopped, pid="
+					   << pt->getParams().pProc->getPid());
+			}
 		}
 	}
 
 	if (cfg.ext_proc_opts.enabled) {
-		_VERBOSE("terminating external process with SIGINT: " << cfg.ext_proc_opts.exec_command);
-		killExtProc(cfg.ext_proc_opts.exec_command, SIGINT);
-		SLEEP_SEC(1.5);
-		_VERBOSE("terminating external process with SIGTERM: " << cfg.ext_proc_opts.exec_command);
-		killExtProc(cfg.ext_proc_opts.exec_command, SIGTERM);
+		stopExtProc();
 	}
+	reapRetiringRecorder(true);
 
 	_SESSION_LOG_END();
 	m_ffmpegExec.schedule(nullptr);
+	m_recorderExec.schedule(nullptr);
 	m_extProcExec.schedule(nullptr);
 
 	// finally double check file again, as sometime ffmpeg
@@ -2,7 +2,13 @@
 #define CAPTURE_VIDEOCAPTURE_H
 
 #include "reprostim/CaptureApp.h"
+#include "reprostim/CaptureProc.h"
 #include "reprostim/CaptureThreading.h"
+#include "LibavRecorder.h"
+#include "AudioCodeAnalyzer.h"
+#include "NoSignalAnalyzer.h"
+#include "QrAnalyzer.h"
+#include "RecorderOpts.h"
 
 ///////////////////////////////////////////////////////////////////////////
 //
@@ -15,6 +21,7 @@ struct ExtProcParams {
 	const ExtProcOpts       opts; // passed all options by value
 	const SessionLogger_ptr pLogger;
 	const bool              fTopLogExtProc;
+	const std::shared_ptr<ChildProc> pProc; // exec_command process, spawned by thread
 };
 
 
@@ -34,21 +41,77 @@ struct FfmpegParams {
 	RepromonQueue*          pRepromonQueue;
 	const bool              fTopLogFfmpeg;
 	const std::string       duct_prefix;
+	const std::shared_ptr<ChildProc> pProc; // spawned ffmpeg (or con/duct) process
+	const double            inputFps;
+	const int               statsIntervalSec;
+};
+
+
+// in-process libav recorder params shared between threads
+// make sure it's thread-safe in usage
+struct RecorderParams {
+	const RecorderOpts      opts; // passed all options by value
+	const std::shared_ptr<LibavRecorder> pRecorder; // started with output file
+	const bool              fKeepArmed; // keep capture running into pre-roll after session end
+	const std::string       segmentsFile; // segments manifest, empty when not segmented
+	const QrOpts            qrOpts;
+	const std::string       qrInfoFile; // QR codes sidecar, empty when disabled
+	const NoSignalOpts      nosignalOpts;
+	const AudioCodeOpts     audiocodeOpts;
+	const std::string       appName;
+	const std::string       outExt;
+	const std::string       outPath;
+	const std::string       outVideoFile;
+	const std::string       start_ts;
+	const Timestamp         tsStart;
+	const SessionLogger_ptr pLogger;
+	const bool              fRepromonEnabled;
+	RepromonQueue*          pRepromonQueue;
+	const double            inputFps;
+	const int               statsIntervalSec;
+};
+
+
+// Specific options for VideoCaptureApp
+struct VideoCaptureOpts {
+	std::string recorder;            // "ffmpeg" or "libav"
+	int         queue_size;
+	int         stats_interval_sec;
+	int         pre_roll_ms;         // 0 to disable
+	int         segment_sec;         // 0 to disable
+	int         segment_mb;          // 0 to disable
+	bool        handover;            // start new recording before old one is finalized
+	QrOpts      qr;                  // live QR codes detection
+	NoSignalOpts nosignal;           // live no-signal pattern detection
+	AudioCodeOpts audiocode;         // live audio codes decoding
 };
 
 
 using ExtProcThread = WorkerThread<ExtProcParams>;
 using FfmpegThread = WorkerThread<FfmpegParams>;
+using RecorderThread = WorkerThread<RecorderParams>;
 
 
 class VideoCaptureApp: public CaptureApp {
 private:
 	SingleThreadExecutor<ExtProcThread> m_extProcExec;
 	SingleThreadExecutor<FfmpegThread>  m_ffmpegExec;
+	SingleThreadExecutor<RecorderThread> m_recorderExec;
+	RecorderThread*                     m_pRetiringRecorder; // finalizing output after handover
+	long long                           m_retiringDeadlineMs;
+	Timestamp                           m_tsOutputStarted; // recorder output of current session started
 	bool                                m_fTopLogFfmpeg;
+	VideoCaptureOpts                    m_vcOpts;
+	bool                                m_fLibavActive; // current session uses libav recorder
+	std::shared_ptr<LibavRecorder>      m_pArmedRecorder; // capturing into pre-roll between sessions
+	std::string                         m_armedKey;
 
+	bool armRecorder(int cx, int cy, const std::string& frameRate,
+					 const std::string& v_dev, const std::string& a_dev);
 	void checkExtProc(const std::string& mode);
 	void onCaptureStartInternal(bool fRecovery	= false);
+	void reapRetiringRecorder(bool fWait);
+	void stopExtProc();
 
 	void startRecording(int cx, int cy, const std::string& frameRate,
 							   const std::string& v_dev, const std::string& a_dev,
@@ -61,9 +124,11 @@ public:
 	~VideoCaptureApp();
 
 	//
+	void onCaptureChange(const std::string& message) override;
 	void onCaptureIdle() override;
 	void onCaptureStart() override;
 	void onCaptureStop(const std::string& message) override;
+	bool onLoadConfig(AppConfig& cfg, const std::string& pathConfig, YAML::Node doc) override;
 	int  parseOpts(AppOpts& opts, int argc, char* argv[]) override;
 };
 
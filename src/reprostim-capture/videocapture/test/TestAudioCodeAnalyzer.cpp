@@ -0,0 +1,193 @@
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "AudioCodeAnalyzer.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// tone like reprostim.audio.audiocodes.AudioCodeEngine.generate_sin
+static void appendTone(std::vector<float>& out, double freq, double durationSec, int sampleRate) {
+	const int n = static_cast<int>(sampleRate * durationSec);
+	for (int i = 0; i < n; i++) {
+		out.push_back(static_cast<float>(0.8 * std::sin(2 * M_PI * freq * i / sampleRate)));
+	}
+}
+
+// FSK code with 0.1 sec silence around, bits restart tone
+// phase like AudioCodeEngine.generate_fsk
+static void appendFsk(std::vector<float>& out, const std::vector<uint8_t>& value, int sampleRate) {
+	std::vector<uint8_t> msg = {getCrc8(value.data(), value.size()), static_cast<uint8_t>(value.size())};
+	msg.insert(msg.end(), value.begin(), value.end());
+	// parity is not checked
+	msg.insert(msg.end(), {0x5A, 0xA5, 0x0F, 0xF0});
+	appendTone(out, 0, 0.1, sampleRate);
+	for (uint8_t b: msg) {
+		for (int i = 7; i >= 0; i--) {
+			appendTone(out, (b >> i) & 1 ? 5000 : 1000, 0.007, sampleRate);
+		}
+	}
+	appendTone(out, 0, 0.1, sampleRate);
+}
+
+// low noise, so silence is not digital zero
+static void addNoise(std::vector<float>& x, float amplitude) {
+	uint32_t seed = 12345;
+	for (float& v: x) {
+		seed = seed * 1103515245 + 12345;
+		v += amplitude * (static_cast<float>((seed >> 16) & 0x7FFF) / 16384.0f - 1.0f);
+	}
+}
+
+static std::vector<AudioCode> decodeAll(AudioCodeDecoder& decoder, const std::vector<float>& x) {
+	std::vector<AudioCode> codes;
+	// captured in periods of different size
+	size_t pos = 0;
+	for (size_t k = 0; pos < x.size(); k++) {
+		const size_t n = std::min(x.size() - pos, static_cast<size_t>(100 + (k % 7) * 250));
+		decoder.push(x.data() + pos, n, codes);
+		pos += n;
+	}
+	decoder.flush(codes);
+	return codes;
+}
+
+TEST_CASE("TestAudioCodeAnalyzer_functions",
+		  "[videocapture][AudioCodeAnalyzer]") {
+	// reprostim.audio.audiocodes.crc8 doc example
+	const std::string s = "123456789";
+	REQUIRE(getCrc8(reinterpret_cast<const uint8_t*>(s.data()), s.size()) == 0xA2);
+
+	std::vector<float> x;
+	appendTone(x, 1000, 0.01, 48000);
+	REQUIRE(std::fabs(getToneAmplitude(x.data(), x.size(), 1000, 48000) - 0.8) < 0.01);
+	REQUIRE(getToneAmplitude(x.data(), x.size(), 5000, 48000) < 0.01);
+	REQUIRE(getToneAmplitude(x.data(), 0, 1000, 48000) == 0);
+}
+
+TEST_CASE("TestAudioCodeAnalyzer_FSK",
+		  "[videocapture][AudioCodeAnalyzer][AudioCodeDecoder]") {
+	for (int rate: {44100, 48000}) {
+		std::vector<float> x;
+		appendFsk(x, {0x30, 0x39}, rate);
+		const size_t start2 = x.size() + rate / 10;
+		appendFsk(x, {0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05}, rate);
+		appendFsk(x, {'h', 'e', 'l', 'l', 'o'}, rate);
+		addNoise(x, 0.005f);
+
+		AudioCodeDecoder decoder(AudioCodeOpts(), rate);
+		const std::vector<AudioCode> codes = decodeAll(decoder, x);
+		REQUIRE(decoder.getBursts() == 3);
+		REQUIRE(codes.size() == 3);
+		REQUIRE(codes[0].codec == VC_AUDIOCODE_FSK);
+		REQUIRE(codes[0].fValue);
+		REQUIRE(codes[0].value == 12345);
+		REQUIRE(std::fabs(static_cast<double>(codes[0].sampleStart) - rate / 10.0) < rate / 2000.0);
+		REQUIRE(std::fabs(codes[0].durationSec - 64 * 0.007) < 0.002);
+		REQUIRE(std::fabs(codes[0].amplitude - 0.8) < 0.05);
+		REQUIRE(codes[1].value == 0x0102030405ULL);
+		REQUIRE(std::fabs(static_cast<double>(codes[1].sampleStart) - start2) < rate / 2000.0);
+		REQUIRE_FALSE(codes[2].fValue);
+		REQUIRE(codes[2].data == std::vector<uint8_t>{'h', 'e', 'l', 'l', 'o'});
+
+		const nlohmann::json jm = audioCodeToJson(codes[0], CURRENT_TIMESTAMP());
+		REQUIRE(jm["codec"] == "FSK");
+		REQUIRE(jm["data"] == "3039");
+		REQUIRE(jm["value"] == 12345);
+	}
+}
+
+TEST_CASE("TestAudioCodeAnalyzer_rejected",
+		  "[videocapture][AudioCodeAnalyzer][AudioCodeDecoder]") {
+	const int rate = 48000;
+	AudioCodeOpts opts;
+	// noise and quiet code
+	std::vector<float> x(rate / 10, 0.0f);
+	std::vector<float> noise(rate / 3, 0.0f);
+	addNoise(noise, 0.5f);
+	x.insert(x.end(), noise.begin(), noise.end());
+	x.resize(x.size() + rate / 10, 0.0f);
+	std::vector<float> quiet;
+	appendFsk(quiet, {0x30, 0x39}, rate);
+	for (float& v: quiet) {
+		v *= 0.01f;
+	}
+	x.insert(x.end(), quiet.begin(), quiet.end());
+	AudioCodeDecoder decoder(opts, rate);
+	REQUIRE(decodeAll(decoder, x).empty());
+	REQUIRE(decoder.getBursts() == 1);
+
+	// corrupted bit fails CRC
+	x.clear();
+	appendFsk(x, {0x30, 0x39}, rate);
+	const size_t bitLen = rate * 7 / 1000;
+	const size_t from = rate / 10 + 20 * bitLen;
+	for (size_t i = 0; i < bitLen; i++) {
+		x[from + i] = static_cast<float>(0.8 * std::sin(2 * M_PI * 3000 * i / rate));
+	}
+	AudioCodeDecoder decoder2(opts, rate);
+	REQUIRE(decodeAll(decoder2, x).empty());
+
+	// NFE tone is not FSK code
+	x.clear();
+	appendTone(x, 0, 0.1, rate);
+	appendTone(x, 1400, 0.5, rate);
+	appendTone(x, 0, 0.1, rate);
+	AudioCodeDecoder decoder3(opts, rate);
+	REQUIRE(decodeAll(decoder3, x).empty());
+	REQUIRE(decoder3.getBursts() == 1);
+}
+
+TEST_CASE("TestAudioCodeAnalyzer_NFE",
+		  "[videocapture][AudioCodeAnalyzer][AudioCodeDecoder]") {
+	const int rate = 44100;
+	AudioCodeOpts opts;
+	opts.codec = VC_AUDIOCODE_NFE;
+	// 12345 % 41 = 4 -> 1400 Hz, 41 -> 1000 Hz
+	std::vector<float> x;
+	for (int freq: {1400, 1000, 5000}) {
+		appendTone(x, 0, 0.1, rate);
+		appendTone(x, freq, 0.5, rate);
+		appendTone(x, 0, 0.1, rate);
+	}
+	// too short
+	appendTone(x, 2000, 0.1, rate);
+	appendTone(x, 0, 0.1, rate);
+	addNoise(x, 0.005f);
+
+	AudioCodeDecoder decoder(opts, rate);
+	const std::vector<AudioCode> codes = decodeAll(decoder, x);
+	REQUIRE(decoder.getBursts() == 4);
+	REQUIRE(codes.size() == 3);
+	REQUIRE(codes[0].codec == VC_AUDIOCODE_NFE);
+	REQUIRE(codes[0].value == 4);
+	REQUIRE(codes[0].freq == 1400);
+	REQUIRE(std::fabs(static_cast<double>(codes[0].sampleStart) - rate / 10.0) < rate / 1000.0);
+	REQUIRE(std::fabs(codes[0].durationSec - 0.5) < 0.002);
+	REQUIRE(codes[1].value == 0);
+	REQUIRE(codes[2].value == 40);
+
+	const nlohmann::json jm = audioCodeToJson(codes[0], CURRENT_TIMESTAMP());
+	REQUIRE(jm["freq"] == 1400);
+	REQUIRE(jm["value"] == 4);
+	REQUIRE_FALSE(jm.contains("data"));
+}
+
+TEST_CASE("TestAudioCodeAnalyzer_AudioTapClock",
+		  "[videocapture][AudioCodeAnalyzer][AudioTapClock]") {
+	AudioTapClock clock(48000);
+	REQUIRE(clock.getUs(0) == 0);
+	clock.add(AudioTapAnchor{0, 1000000});
+	clock.add(AudioTapAnchor{4800, 1100500});
+	clock.add(AudioTapAnchor{9600, 1200000});
+	REQUIRE(clock.getUs(2400) == 1050000);
+	// the latest anchor before sample is used
+	REQUIRE(clock.getUs(4800 + 480) == 1110500);
+	REQUIRE(clock.getUs(12000) == 1250000);
+}
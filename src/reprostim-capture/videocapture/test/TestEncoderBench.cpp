@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+#include "EncoderBench.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static FfmpegOpts makeBenchFfmpegOpts() {
+	FfmpegOpts opts;
+	opts.v_fmt = "-f v4l2 -input_format yuyv422";
+	opts.v_enc = "-c:v libx264 -preset ultrafast -crf 18 -metadata 'title=a b'";
+	opts.n_threads = "-threads 4";
+	opts.out_fmt = "mkv";
+	return opts;
+}
+
+TEST_CASE("TestEncoderBench_parseBenchSpec",
+		  "[videocapture][EncoderBench][parseBenchSpec]") {
+	BenchOpts opts;
+	REQUIRE(parseBenchSpec(VC_BENCH_DEFAULT_SPEC, opts));
+	REQUIRE(opts.cx == 1920);
+	REQUIRE(opts.cy == 1080);
+	REQUIRE(opts.fps == 60);
+	REQUIRE(parseBenchSpec("1280x720@30", opts));
+	REQUIRE(opts.cx == 1280);
+	REQUIRE(opts.fps == 30);
+
+	REQUIRE_FALSE(parseBenchSpec("1280x720", opts));
+	REQUIRE_FALSE(parseBenchSpec("1280x720@30fps", opts));
+	REQUIRE_FALSE(parseBenchSpec("0x720@30", opts));
+}
+
+TEST_CASE("TestEncoderBench_setFfmpegOpt",
+		  "[videocapture][EncoderBench][setFfmpegOpt]") {
+	const FfmpegOpts ffm = makeBenchFfmpegOpts();
+	REQUIRE(setFfmpegOpt(ffm.v_enc, "preset", "veryfast") ==
+			"-c:v libx264 -preset veryfast -crf 18 -metadata 'title=a b'");
+	REQUIRE(setFfmpegOpt("-c:v libx264", "preset", "fast") == "-c:v libx264 -preset fast");
+	REQUIRE(setFfmpegOpt("", "threads", "2") == "-threads 2");
+}
+
+TEST_CASE("TestEncoderBench_makeBenchCandidates",
+		  "[videocapture][EncoderBench][makeBenchCandidates]") {
+	const FfmpegOpts ffm = makeBenchFfmpegOpts();
+	std::vector<BenchCandidate> res = makeBenchCandidates(ffm, 4);
+	// config + 4 presets x 2 threads, without the same as config
+	REQUIRE(res.size() == 8);
+	REQUIRE(res[0].label == "config");
+	REQUIRE(res[0].v_enc == ffm.v_enc);
+	REQUIRE(res[1].label == "preset=ultrafast threads=2");
+	REQUIRE(res[1].n_threads == "-threads 2");
+	REQUIRE(res.back().label == "preset=faster threads=4");
+
+	// no presets in encoder options, threads only
+	FfmpegOpts ffm2 = ffm;
+	ffm2.v_enc = "-c:v mjpeg";
+	res = makeBenchCandidates(ffm2, 1);
+	REQUIRE(res.size() == 2);
+	REQUIRE(res[1].label == "threads=1");
+
+	BenchOpts opts;
+	opts.durationSec = 2;
+	std::string cmd = makeBenchCommand(ffm, res[1], opts, "/tmp/out.mkv");
+	REQUIRE(cmd.find("testsrc2=size=1920x1080:rate=60,format=yuyv422") != std::string::npos);
+	REQUIRE(cmd.find("-frames:v 120") != std::string::npos);
+	REQUIRE(cmd.find("-threads 1 -an /tmp/out.mkv") != std::string::npos);
+}
+
+TEST_CASE("TestEncoderBench_pickBenchResult",
+		  "[videocapture][EncoderBench][pickBenchResult]") {
+	std::vector<BenchResult> results(4);
+	results[0].ok = true;
+	results[0].speed = 3.0;
+	results[0].bytesPerMin = 100;
+	results[1].ok = true;
+	results[1].speed = 1.2;     // too slow
+	results[1].bytesPerMin = 50;
+	results[2].ok = true;
+	results[2].speed = 1.6;
+	results[2].bytesPerMin = 80;
+	results[3].ok = false;      // failed
+	REQUIRE(pickBenchResult(results, VC_BENCH_MIN_HEADROOM) == 2);
+	REQUIRE(pickBenchResult(results, 5.0) == -1);
+}
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include "EncoderProgress.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static bool isNear(double value, double expected) {
+	return std::fabs(value - expected) < 1e-6;
+}
+
+TEST_CASE("TestEncoderProgress_parseLine",
+		  "[videocapture][EncoderProgress][parseLine]") {
+	ProgressParser parser;
+	bool fComplete = false;
+
+	// ffmpeg log output is not a part of progress stream
+	REQUIRE_FALSE(parser.parseLine("Input #0, video4linux2,v4l2, from '/dev/video0':\n", fComplete));
+	REQUIRE_FALSE(parser.parseLine("title=abc\n", fComplete));
+	REQUIRE_FALSE(parser.parseLine("\n", fComplete));
+
+	const std::vector<std::string> block1 = {
+			"frame=0\n", "fps=0.00\n", "stream_0_0_q=0.0\n", "bitrate=N/A\n",
+			"total_size=N/A\n", "out_time_us=N/A\n", "out_time_ms=N/A\n",
+			"out_time=N/A\n", "dup_frames=0\n", "drop_frames=0\n", "speed=N/A\n"
+	};
+	for (const auto& line: block1) {
+		REQUIRE(parser.parseLine(line, fComplete));
+		REQUIRE_FALSE(fComplete);
+	}
+	REQUIRE(parser.parseLine("progress=continue\n", fComplete));
+	REQUIRE(fComplete);
+	REQUIRE(parser.getProgress().frame == 0);
+	REQUIRE(parser.getProgress().bitrateKbps == 0);
+	REQUIRE(parser.getProgress().outTimeUs == 0);
+	REQUIRE_FALSE(parser.getProgress().fEnd);
+
+	const std::vector<std::string> block2 = {
+			"frame=600\r\n", "fps=59.94\n", "bitrate=8012.3kbits/s\n",
+			"total_size=10015360\n", "out_time_us=10000000\n",
+			"dup_frames=2\n", "drop_frames=5\n", "speed=0.999x\n"
+	};
+	for (const auto& line: block2) {
+		REQUIRE(parser.parseLine(line, fComplete));
+	}
+	// previous block is reported until the current one is complete
+	REQUIRE(parser.getProgress().frame == 0);
+	REQUIRE(parser.parseLine("progress=end", fComplete));
+	REQUIRE(fComplete);
+	const EncoderProgress& p = parser.getProgress();
+	REQUIRE(p.frame == 600);
+	REQUIRE(isNear(p.fps, 59.94));
+	REQUIRE(isNear(p.bitrateKbps, 8012.3));
+	REQUIRE(p.totalSize == 10015360);
+	REQUIRE(p.outTimeUs == 10000000);
+	REQUIRE(p.dupFrames == 2);
+	REQUIRE(p.dropFrames == 5);
+	REQUIRE(isNear(p.speed, 0.999));
+	REQUIRE(p.fEnd);
+}
+
+TEST_CASE("TestEncoderProgress_EncodeRateMonitor",
+		  "[videocapture][EncoderProgress][EncodeRateMonitor]") {
+	EncodeRateMonitor monitor(60.0);
+	REQUIRE(monitor.getInputFps() == 60.0);
+
+	// the first update is baseline only
+	REQUIRE(monitor.update(100, 1000) == 0);
+	REQUIRE(monitor.getFps() == 0);
+	REQUIRE_FALSE(monitor.isLow());
+
+	REQUIRE(monitor.update(700, 11000) == 0);
+	REQUIRE(isNear(monitor.getFps(), 60.0));
+	REQUIRE_FALSE(monitor.isLow());
+
+	// 50 fps is below 95% of input rate
+	REQUIRE(monitor.update(1200, 21000) == 1);
+	REQUIRE(isNear(monitor.getFps(), 50.0));
+	REQUIRE(monitor.isLow());
+	// reported once while low
+	REQUIRE(monitor.update(1700, 31000) == 0);
+	REQUIRE(monitor.isLow());
+
+	REQUIRE(monitor.update(2280, 41000) == -1);
+	REQUIRE(isNear(monitor.getFps(), 58.0));
+	REQUIRE_FALSE(monitor.isLow());
+
+	// counter reset, e.g. new ffmpeg process, is a new baseline
+	REQUIRE(monitor.update(10, 51000) == 0);
+	REQUIRE_FALSE(monitor.isLow());
+
+	// unknown input rate never alerts
+	EncodeRateMonitor monitor2(0);
+	REQUIRE(monitor2.update(0, 0) == 0);
+	REQUIRE(monitor2.update(10, 10000) == 0);
+	REQUIRE(isNear(monitor2.getFps(), 1.0));
+	REQUIRE_FALSE(monitor2.isLow());
+}
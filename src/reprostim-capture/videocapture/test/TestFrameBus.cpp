@@ -0,0 +1,102 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "FrameBus.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// frame which counts live instances
+struct TestFrame {
+	static std::atomic<int> s_count;
+	const int number;
+
+	explicit TestFrame(int n): number(n) { s_count++; }
+	~TestFrame() { s_count--; }
+};
+
+std::atomic<int> TestFrame::s_count{0};
+
+static void publishFrames(FrameBus<TestFrame>& bus, int from, int to) {
+	for (int n = from; n < to; n++) {
+		bus.publish(std::make_shared<const TestFrame>(n));
+	}
+}
+
+TEST_CASE("TestFrameBus_policy",
+		  "[videocapture][FrameBus]") {
+	FrameBus<TestFrame> bus;
+	auto qOldest = bus.subscribe("oldest", 3, BUS_DROP_OLDEST);
+	auto qNewest = bus.subscribe("newest", 3, BUS_DROP_NEWEST);
+	auto qStride = bus.subscribe("stride", 10, BUS_DROP_OLDEST, 4);
+	REQUIRE(bus.getSubscriberCount() == 3);
+
+	publishFrames(bus, 0, 10);
+	REQUIRE(bus.getPublished() == 10);
+
+	// slow subscribers don't affect each other
+	std::shared_ptr<const TestFrame> frame;
+	REQUIRE(qOldest->getDepth() == 3);
+	REQUIRE(qOldest->getDropped() == 7);
+	REQUIRE(qOldest->pop(frame, 0));
+	REQUIRE(frame->number == 7);
+
+	REQUIRE(qNewest->getDropped() == 7);
+	REQUIRE(qNewest->getDelivered() == 3);
+	REQUIRE(qNewest->pop(frame, 0));
+	REQUIRE(frame->number == 0);
+
+	REQUIRE(qStride->getDelivered() == 3);
+	REQUIRE(qStride->getDropped() == 0);
+	for (int n: {0, 4, 8}) {
+		REQUIRE(qStride->pop(frame, 0));
+		REQUIRE(frame->number == n);
+	}
+	REQUIRE_FALSE(qStride->pop(frame, 10));
+	REQUIRE_FALSE(qStride->isClosed());
+
+	// frames are shared, released when the last subscriber drops them
+	frame.reset();
+	REQUIRE(TestFrame::s_count == 4);
+	bus.unsubscribe(qOldest);
+	REQUIRE(qOldest->isClosed());
+	REQUIRE(bus.getSubscriberCount() == 2);
+	publishFrames(bus, 10, 11);
+	REQUIRE(qOldest->getDepth() == 2);
+	qOldest.reset();
+	REQUIRE(TestFrame::s_count == 3);
+}
+
+TEST_CASE("TestFrameBus_close",
+		  "[videocapture][FrameBus]") {
+	FrameBus<TestFrame> bus;
+	auto q = bus.subscribe("consumer", 100, BUS_DROP_OLDEST);
+
+	// consumer drains queue after close and stops
+	int nReceived = 0;
+	std::thread consumer([&]() {
+		std::shared_ptr<const TestFrame> frame;
+		while( q->pop(frame, -1) ) {
+			nReceived++;
+		}
+	});
+	publishFrames(bus, 0, 50);
+	bus.close();
+	consumer.join();
+	REQUIRE(nReceived == 50);
+	REQUIRE(q->isClosed());
+
+	// closed bus ignores frames and new subscribers
+	publishFrames(bus, 50, 60);
+	REQUIRE(bus.getPublished() == 50);
+	auto q2 = bus.subscribe("late", 10, BUS_DROP_OLDEST);
+	REQUIRE(q2->isClosed());
+	REQUIRE(bus.getSubscriberCount() == 1);
+	REQUIRE(TestFrame::s_count == 0);
+}
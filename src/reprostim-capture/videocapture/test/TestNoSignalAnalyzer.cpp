@@ -0,0 +1,127 @@
+#include <cstdint>
+#include <vector>
+#include "NoSignalAnalyzer.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// rainbow bars with white text band in the 3rd of 6 rows
+static void getRainbowRgb(int x, int y, int width, int height, uint8_t rgb[3]) {
+	static const uint8_t BARS[8][3] = {
+			{255, 255, 255}, {255, 255, 0}, {0, 255, 255}, {0, 255, 0},
+			{255, 0, 255}, {255, 0, 0}, {0, 0, 255}, {0, 0, 0}
+	};
+	const int col = x * 8 / width;
+	const bool fText = y * 6 / height == 2 && col < 7;
+	for (int k = 0; k < 3; k++) {
+		rgb[k] = fText ? 255 : BARS[col][k];
+	}
+}
+
+// packed RGB24 or YUYV422 test frame
+struct TestFrame {
+	std::vector<uint8_t> buf;
+	VideoFrame           frame;
+
+	TestFrame(int width, int height, bool fRgb, bool fRainbow) {
+		const int linesize = width * (fRgb ? 3 : 2) + 16;
+		buf.assign(static_cast<size_t>(linesize) * height, 0);
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				uint8_t rgb[3] = {128, 128, 128};
+				if( fRainbow ) {
+					getRainbowRgb(x, y, width, height, rgb);
+				}
+				uint8_t* p = buf.data() + y * linesize;
+				if( fRgb ) {
+					std::copy(rgb, rgb + 3, p + x * 3);
+					continue;
+				}
+				// BT.601 limited range
+				const int r = rgb[0], g = rgb[1], b = rgb[2];
+				p[x * 2] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+				if( (x & 1) == 0 ) {
+					p[x * 2 + 1] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+					p[x * 2 + 3] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+				}
+			}
+		}
+		frame.width = width;
+		frame.height = height;
+		frame.data[0] = buf.data();
+		frame.linesize[0] = linesize;
+		frame.fRgb = fRgb;
+		if( fRgb ) {
+			frame.comp[0] = FrameComponent{0, 3, 0};
+			frame.comp[1] = FrameComponent{0, 3, 1};
+			frame.comp[2] = FrameComponent{0, 3, 2};
+		} else {
+			frame.comp[0] = FrameComponent{0, 2, 0};
+			frame.comp[1] = FrameComponent{0, 4, 1};
+			frame.comp[2] = FrameComponent{0, 4, 3};
+			frame.log2ChromaW = 1;
+		}
+	}
+};
+
+TEST_CASE("TestNoSignalAnalyzer_getRainbowDiff",
+		  "[videocapture][NoSignalAnalyzer][getRainbowDiff]") {
+	TestFrame rgbRainbow(640, 480, true, true);
+	const double diffRgb = getRainbowDiff(rgbRainbow.frame);
+	REQUIRE(diffRgb >= 0);
+	REQUIRE(diffRgb < 10);
+
+	TestFrame yuvRainbow(640, 480, false, true);
+	uint8_t rgb[3];
+	REQUIRE(getPixelRgb(yuvRainbow.frame, 120, 40, rgb));
+	REQUIRE(rgb[0] > 240);
+	REQUIRE(rgb[1] > 240);
+	REQUIRE(rgb[2] < 16);
+	const double diffYuv = getRainbowDiff(yuvRainbow.frame);
+	REQUIRE(diffYuv >= 0);
+	REQUIRE(diffYuv < VC_DEFAULT_NOSIGNAL_THRESHOLD);
+
+	TestFrame yuvGray(640, 480, false, false);
+	REQUIRE(getRainbowDiff(yuvGray.frame) > VC_DEFAULT_NOSIGNAL_THRESHOLD);
+
+	// unknown format
+	yuvGray.frame.comp[0].step = 0;
+	REQUIRE_FALSE(getPixelRgb(yuvGray.frame, 0, 0, rgb));
+	REQUIRE(getRainbowDiff(yuvGray.frame) < 0);
+	REQUIRE_FALSE(getPixelRgb(rgbRainbow.frame, 640, 0, rgb));
+}
+
+TEST_CASE("TestNoSignalAnalyzer_NoSignalTracker",
+		  "[videocapture][NoSignalAnalyzer][NoSignalTracker]") {
+	NoSignalTracker tracker(2000000);
+	REQUIRE(tracker.update(0, 0, false) == 0);
+	// short pattern is ignored
+	REQUIRE(tracker.update(30, 500000, true) == 0);
+	REQUIRE(tracker.update(60, 1000000, false) == 0);
+	REQUIRE_FALSE(tracker.isActive());
+
+	REQUIRE(tracker.update(90, 1500000, true) == 0);
+	REQUIRE(tracker.update(120, 2000000, true) == 0);
+	REQUIRE(tracker.update(150, 3500000, true) == 1);
+	REQUIRE(tracker.isActive());
+	REQUIRE(tracker.getFrameStart() == 90);
+	REQUIRE(tracker.getStartUs() == 1500000);
+	REQUIRE(tracker.update(180, 4000000, true) == 0);
+
+	// ends on the first frame without pattern
+	REQUIRE(tracker.update(210, 4500000, false) == -1);
+	REQUIRE_FALSE(tracker.isActive());
+	REQUIRE(tracker.getFrameStart() == 90);
+	REQUIRE(tracker.update(240, 5000000, false) == 0);
+
+	// no delay
+	NoSignalTracker tracker0(0);
+	REQUIRE(tracker0.update(0, 0, true) == 1);
+	REQUIRE(tracker0.update(1, 1, true) == 0);
+}
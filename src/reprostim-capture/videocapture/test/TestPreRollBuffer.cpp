@@ -0,0 +1,65 @@
+#include <memory>
+#include "PreRollBuffer.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// video packet every 10 ms with keyframe every 5 packets, audio in between
+static void pushPackets(PreRollBuffer<int>& buf, int from, int to) {
+	for (int n = from; n < to; n++) {
+		buf.push(PreRollEntry<int>{n, 0, n * 10000LL, n % 5 == 0, 100});
+		buf.push(PreRollEntry<int>{-n, 1, n * 10000LL + 5000, true, 10});
+	}
+}
+
+TEST_CASE("TestPreRollBuffer_window",
+		  "[videocapture][PreRollBuffer]") {
+	PreRollBuffer<int> buf(100000); // 100 ms
+	REQUIRE(buf.isEmpty());
+	REQUIRE(buf.getDurationUs() == 0);
+
+	// packets before the first keyframe are dropped
+	buf.push(PreRollEntry<int>{-1, 1, 0, true, 10});
+	buf.push(PreRollEntry<int>{1, 0, 0, false, 100});
+	REQUIRE(buf.isEmpty());
+
+	pushPackets(buf, 0, 8);
+	REQUIRE(buf.size() == 16);
+	REQUIRE(buf.getBytes() == 8 * 110);
+
+	pushPackets(buf, 8, 40);
+	// starts with video keyframe and covers at least the window
+	const auto& entries = buf.getEntries();
+	REQUIRE(entries.front().stream == 0);
+	REQUIRE(entries.front().fKey);
+	REQUIRE(buf.getDurationUs() >= 100000);
+	// window plus less than one GOP
+	REQUIRE(buf.getDurationUs() < 100000 + 50000);
+	REQUIRE(entries.back().data == -39);
+	size_t bytes = 0;
+	for (const auto& e: entries) {
+		bytes += e.size;
+	}
+	REQUIRE(buf.getBytes() == bytes);
+
+	buf.clear();
+	REQUIRE(buf.isEmpty());
+	REQUIRE(buf.getBytes() == 0);
+}
+
+TEST_CASE("TestPreRollBuffer_zero_window",
+		  "[videocapture][PreRollBuffer]") {
+	// only the last GOP is kept
+	PreRollBuffer<std::unique_ptr<int>> buf(0);
+	for (int n = 0; n < 12; n++) {
+		buf.push(PreRollEntry<std::unique_ptr<int>>{std::make_unique<int>(n), 0, n * 10000LL, n % 5 == 0, 1});
+	}
+	REQUIRE(buf.size() == 2);
+	REQUIRE(*buf.getEntries().front().data == 10);
+}
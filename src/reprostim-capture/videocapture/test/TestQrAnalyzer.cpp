@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "QrAnalyzer.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+static bool isNear(double value, double expected) {
+	return std::fabs(value - expected) < 1e-6;
+}
+
+TEST_CASE("TestQrAnalyzer_QrTracker",
+		  "[videocapture][QrAnalyzer][QrTracker]") {
+	const Timestamp ts0 = CURRENT_TIMESTAMP();
+	auto tsAt = [&](uint64_t frame) { return ts0 + std::chrono::milliseconds(frame * 100); };
+	// analyzed frames with decoded text, every 2nd frame
+	const std::vector<std::pair<uint64_t, std::string>> frames = {
+			{0, ""}, {2, "A"}, {4, "A"}, {6, "A"}, {8, "B"}, {10, ""},
+			{12, ""}, {14, "A"}, {16, "A"}
+	};
+	QrTracker tracker;
+	std::vector<QrRecord> records;
+	QrRecord rec;
+	for (const auto& f: frames) {
+		if( tracker.update(f.first, tsAt(f.first), f.second, rec) ) {
+			records.push_back(rec);
+		}
+	}
+	REQUIRE(tracker.isActive());
+	REQUIRE(tracker.finish(rec));
+	records.push_back(rec);
+	REQUIRE_FALSE(tracker.isActive());
+	REQUIRE_FALSE(tracker.finish(rec));
+	REQUIRE(tracker.getCount() == 3);
+
+	// record ends on the first frame with another code or without it,
+	// and on the last analyzed frame
+	REQUIRE(records.size() == 3);
+	const std::vector<std::tuple<int, uint64_t, uint64_t, std::string>> expected = {
+			{0, 2, 8, "A"}, {1, 8, 10, "B"}, {2, 14, 16, "A"}
+	};
+	for (size_t i = 0; i < expected.size(); i++) {
+		REQUIRE(records[i].index == std::get<0>(expected[i]));
+		REQUIRE(records[i].frameStart == std::get<1>(expected[i]));
+		REQUIRE(records[i].frameEnd == std::get<2>(expected[i]));
+		REQUIRE(records[i].text == std::get<3>(expected[i]));
+		REQUIRE(records[i].tsStart == tsAt(records[i].frameStart));
+		REQUIRE(records[i].tsEnd == tsAt(records[i].frameEnd));
+	}
+}
+
+TEST_CASE("TestQrAnalyzer_extractLuma",
+		  "[videocapture][QrAnalyzer][extractLuma]") {
+	// 4x3 YUYV422 frame with padded lines, luma is pixel index
+	const int width = 4, height = 3, linesize = 12;
+	std::vector<uint8_t> buf(linesize * height, 0xEE);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			buf[y * linesize + x * 2] = static_cast<uint8_t>(y * width + x);
+			buf[y * linesize + x * 2 + 1] = 0x80;
+		}
+	}
+	VideoFrame frame;
+	frame.width = width;
+	frame.height = height;
+	frame.data[0] = buf.data();
+	frame.linesize[0] = linesize;
+
+	QrOpts opts;
+	LumaImage img;
+	// unknown luma location
+	REQUIRE_FALSE(extractLuma(frame, opts, img));
+
+	frame.comp[0].step = 2;
+	REQUIRE(extractLuma(frame, opts, img));
+	REQUIRE(img.width == width);
+	REQUIRE(img.height == height);
+	for (int i = 0; i < width * height; i++) {
+		REQUIRE(img.data[i] == i);
+	}
+
+	// region is clipped to frame
+	opts.roiX = 1;
+	opts.roiY = 1;
+	opts.roiW = 10;
+	REQUIRE(extractLuma(frame, opts, img));
+	REQUIRE(img.width == 3);
+	REQUIRE(img.height == 2);
+	REQUIRE(img.data == std::vector<uint8_t>{5, 6, 7, 9, 10, 11});
+
+	// planar luma
+	std::vector<uint8_t> plane = {1, 2, 3, 4, 0, 0, 5, 6, 7, 8, 0, 0, 9, 10, 11, 12, 0, 0};
+	frame.data[0] = plane.data();
+	frame.linesize[0] = 6;
+	frame.comp[0].step = 1;
+	opts.roiW = 2;
+	REQUIRE(extractLuma(frame, opts, img));
+	REQUIRE(img.data == std::vector<uint8_t>{6, 7, 10, 11});
+
+	opts.roiX = width;
+	REQUIRE_FALSE(extractLuma(frame, opts, img));
+}
+
+TEST_CASE("TestQrAnalyzer_qrRecordToJson",
+		  "[videocapture][QrAnalyzer][qrRecordToJson]") {
+	const Timestamp tsSession = CURRENT_TIMESTAMP();
+	QrRecord rec;
+	rec.index = 3;
+	rec.frameStart = 120;
+	rec.frameEnd = 150;
+	rec.tsStart = tsSession + std::chrono::milliseconds(2000);
+	rec.tsEnd = tsSession + std::chrono::milliseconds(2500);
+	rec.text = R"({"event": "trigger", "keys": "5", "time_formatted": "2024-01-01T10:00:00"})";
+
+	nlohmann::json jm = qrRecordToJson(rec, tsSession);
+	REQUIRE(jm["type"] == "QrRecord");
+	REQUIRE(jm["index"] == 3);
+	REQUIRE(jm["frame_start"] == 120);
+	REQUIRE(jm["frame_end"] == 150);
+	REQUIRE(jm["isotime_start"] == getTimeIsoStr(rec.tsStart));
+	REQUIRE(isNear(jm["time_start"].get<double>(), 2.0));
+	REQUIRE(isNear(jm["time_end"].get<double>(), 2.5));
+	REQUIRE(isNear(jm["duration"].get<double>(), 0.5));
+	REQUIRE(jm["data"]["event"] == "trigger");
+	REQUIRE(jm["text"] == rec.text);
+
+	// payload which is not JSON is kept as text only
+	rec.text = "{'event': 'trigger'}";
+	jm = qrRecordToJson(rec, tsSession);
+	REQUIRE(jm["data"].is_null());
+	REQUIRE(jm["text"] == rec.text);
+}
@@ -0,0 +1,198 @@
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "RecorderOpts.h"
+#include "LibavRecorder.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+// default ffm_opts values from config.yaml
+static FfmpegOpts makeFfmpegOpts() {
+	FfmpegOpts opts;
+	opts.a_fmt = "-f alsa";
+	opts.a_nchan = "-ac 2";
+	opts.a_opt = "-thread_queue_size 4096";
+	opts.v_fmt = "-f v4l2 -input_format yuyv422";
+	opts.v_opt = "-thread_queue_size 4096";
+	opts.v_enc = "-c:v libx264 -flush_packets 1 -preset ultrafast -crf 18 -tune zerolatency "
+				 "-b:v 8M -maxrate 8M -bufsize 16M -vf setpts=PTS-STARTPTS";
+	opts.pix_fmt = "";
+	opts.n_threads = "-threads 4";
+	opts.a_enc = "-acodec aac -af asetpts=PTS-STARTPTS";
+	opts.out_fmt = "mkv";
+	return opts;
+}
+
+TEST_CASE("TestRecorderOpts_parseFfmpegArgs",
+		  "[videocapture][RecorderOpts][parseFfmpegArgs]") {
+	std::vector<FfmpegArg> args = parseFfmpegArgs("  -f v4l2 -y -itsoffset -0.5 -metadata 'comment=a b' out.mkv");
+	REQUIRE(args.size() == 5);
+	REQUIRE(args[0].key == "f");
+	REQUIRE(args[0].value == "v4l2");
+	REQUIRE(args[1].key == "y");
+	REQUIRE(args[1].value.empty());
+	REQUIRE(args[2].key == "itsoffset");
+	REQUIRE(args[2].value == "-0.5");
+	REQUIRE(args[3].value == "comment=a b");
+	REQUIRE(args[4].key.empty());
+	REQUIRE(args[4].value == "out.mkv");
+
+	REQUIRE(parseFfmpegArgs("").empty());
+}
+
+TEST_CASE("TestRecorderOpts_parseFfmpegSize",
+		  "[videocapture][RecorderOpts][parseFfmpegSize]") {
+	REQUIRE(parseFfmpegSize("16000000") == 16000000);
+	REQUIRE(parseFfmpegSize("128k") == 128000);
+	REQUIRE(parseFfmpegSize("8M") == 8000000);
+	REQUIRE(parseFfmpegSize("1.5M") == 1500000);
+	REQUIRE(parseFfmpegSize("1G") == 1000000000);
+	REQUIRE(parseFfmpegSize("1Ki") == 1024);
+	REQUIRE(parseFfmpegSize("1KiB") == 8192);
+	REQUIRE(parseFfmpegSize("1MB") == 8000000);
+	REQUIRE(parseFfmpegSize("") == -1);
+	REQUIRE(parseFfmpegSize("abc") == -1);
+	REQUIRE(parseFfmpegSize("8X") == -1);
+	REQUIRE(parseFfmpegSize("8Mbit") == -1);
+	REQUIRE(parseFfmpegSize("-1") == -1);
+}
+
+TEST_CASE("TestRecorderOpts_parseEncoderOpts",
+		  "[videocapture][RecorderOpts][parseEncoderOpts]") {
+	const FfmpegOpts ffm = makeFfmpegOpts();
+	std::vector<std::string> ignored;
+
+	EncoderOpts v;
+	REQUIRE(parseEncoderOpts(ffm.v_enc, 'v', v, ignored));
+	REQUIRE(v.codec == "libx264");
+	REQUIRE(v.bitRate == 8000000);
+	REQUIRE(v.maxRate == 8000000);
+	REQUIRE(v.bufSize == 16000000);
+	REQUIRE(v.options.size() == 3);
+	REQUIRE(v.options["preset"] == "ultrafast");
+	REQUIRE(v.options["crf"] == "18");
+	REQUIRE(v.options["tune"] == "zerolatency");
+
+	EncoderOpts a;
+	REQUIRE(parseEncoderOpts(ffm.a_enc, 'a', a, ignored));
+	REQUIRE(a.codec == "aac");
+	REQUIRE(a.options.empty());
+	REQUIRE(ignored.empty());
+
+	// options for other stream are skipped, unsupported filters reported
+	EncoderOpts v2;
+	REQUIRE(parseEncoderOpts("-c:a mp3 -b:a 128k -g 30 -vf scale=640:480 -pix_fmt yuv420p", 'v', v2, ignored));
+	REQUIRE(v2.codec.empty());
+	REQUIRE(v2.bitRate == 0);
+	REQUIRE(v2.gopSize == 30);
+	REQUIRE(v2.pixFmt == "yuv420p");
+	REQUIRE(ignored.size() == 1);
+	REQUIRE(ignored[0] == "-vf scale=640:480");
+
+	REQUIRE_FALSE(parseEncoderOpts("-b:v fast", 'v', v2, ignored));
+	REQUIRE_FALSE(parseEncoderOpts("-threads four", 'v', v2, ignored));
+}
+
+TEST_CASE("TestRecorderOpts_makeRecorderOpts",
+		  "[videocapture][RecorderOpts][makeRecorderOpts]") {
+	const FfmpegOpts ffm = makeFfmpegOpts();
+	RecorderOpts opts;
+	REQUIRE(makeRecorderOpts(ffm, 1920, 1080, "60", "/dev/video0", "-i hw:1,0",
+							 "/tmp/out.mkv", "tag", opts));
+	REQUIRE(opts.videoIn.format == "v4l2");
+	REQUIRE(opts.videoIn.device == "/dev/video0");
+	REQUIRE(opts.videoIn.options["input_format"] == "yuyv422");
+	REQUIRE(opts.videoIn.options["video_size"] == "1920x1080");
+	REQUIRE(opts.videoIn.options["framerate"] == "60");
+	REQUIRE(opts.videoIn.options.count("thread_queue_size") == 0);
+
+	REQUIRE(opts.hasAudio);
+	REQUIRE(opts.audioIn.format == "alsa");
+	REQUIRE(opts.audioIn.device == "hw:1,0");
+	REQUIRE(opts.audioIn.options["channels"] == "2");
+
+	REQUIRE(opts.videoEnc.codec == "libx264");
+	REQUIRE(opts.videoEnc.nThreads == 4);
+	REQUIRE(opts.audioEnc.codec == "aac");
+	REQUIRE(opts.outFile == "/tmp/out.mkv");
+	REQUIRE(opts.outFormat == "mkv");
+	REQUIRE(opts.preRollMs == VC_DEFAULT_PRE_ROLL_MS);
+	REQUIRE(opts.comment == "tag");
+	REQUIRE(opts.queueSize == VC_DEFAULT_QUEUE_SIZE);
+	// segments are disabled by default
+	REQUIRE(opts.segmentSec == 0);
+	REQUIRE(opts.segmentMb == 0);
+	// -thread_queue_size for both inputs
+	REQUIRE(opts.ignored.size() == 2);
+
+	// no audio device
+	RecorderOpts opts2;
+	REQUIRE(makeRecorderOpts(ffm, 640, 480, "", "/dev/video1", "-i ", "/tmp/out2.mkv", "", opts2));
+	REQUIRE_FALSE(opts2.hasAudio);
+	REQUIRE(opts2.videoIn.options.count("framerate") == 0);
+
+	FfmpegOpts ffm2 = ffm;
+	ffm2.v_enc = "-c:v libx264 -b:v 8Q";
+	REQUIRE_FALSE(makeRecorderOpts(ffm2, 640, 480, "", "/dev/video1", "", "/tmp/out3.mkv", "", opts2));
+}
+
+TEST_CASE("TestRecorderOpts_recorderStatsToString",
+		  "[videocapture][LibavRecorder][recorderStatsToString]") {
+	RecorderStats stats;
+	stats.videoFrames = 10;
+	stats.videoDropped = 1;
+	REQUIRE_FALSE(recorderStatsToString(stats).empty());
+
+#ifndef CAPTURE_LIBAV_ENABLED
+	// recorder can't be started without libav
+	REQUIRE_FALSE(isLibavRecorderSupported());
+	LibavRecorder recorder{RecorderOpts()};
+	REQUIRE_FALSE(recorder.start());
+	REQUIRE_FALSE(recorder.isRunning());
+#endif
+}
+
+#ifdef CAPTURE_LIBAV_ENABLED
+TEST_CASE("TestRecorderOpts_LibavRecorder_stopCapture_queued",
+		  "[videocapture][LibavRecorder][stopCapture]") {
+	const std::filesystem::path outFile = std::filesystem::temp_directory_path() /
+			("reprostim_test_recorder_" + std::to_string(getpid()) + ".mkv");
+	RecorderOpts opts;
+	// test source is read unthrottled, so encoder queue fills up
+	opts.videoIn.format = "lavfi";
+	opts.videoIn.device = "testsrc2=size=640x480:rate=60";
+	opts.videoEnc.codec = "mpeg4";
+	opts.outFile = outFile.string();
+	opts.outFormat = "mkv";
+	opts.queueSize = 64;
+	opts.preRollMs = 0;
+
+	LibavRecorder recorder(opts);
+	REQUIRE(recorder.start());
+	for (int i = 0; i < 400 && recorder.getStats().videoQueueDepth == 0; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	// input is closed while frames are still queued, as on handover,
+	// encoder keeps encoding them without the input context
+	recorder.stopCapture();
+	REQUIRE_FALSE(recorder.isCapturing());
+	recorder.stop();
+	REQUIRE_FALSE(recorder.isRunning());
+	REQUIRE_FALSE(recorder.isFailed());
+	const RecorderStats stats = recorder.getStats();
+	REQUIRE(stats.videoEncoded > 0);
+	REQUIRE(stats.videoQueueDepth == 0);
+	REQUIRE(std::filesystem::file_size(outFile) > 0);
+	std::filesystem::remove(outFile);
+}
+#endif
@@ -0,0 +1,72 @@
+#include <thread>
+#include <vector>
+#include "SpscRing.h"
+
+// Catch2 v2/v3 includes
+#if __has_include(<catch2/catch_all.hpp>)
+    // Catch2 v3
+    #include <catch2/catch_all.hpp>
+#else
+  // Catch2 v2 fallback
+  #include <catch2/catch.hpp>
+#endif
+
+TEST_CASE("TestSpscRing_pushPop",
+		  "[videocapture][SpscRing]") {
+	SpscRing<int> ring(5);
+	REQUIRE(ring.getCapacity() == 8);
+	REQUIRE(ring.size() == 0);
+
+	// push writes only what fits
+	std::vector<int> in = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	REQUIRE(ring.push(in.data(), in.size()) == 8);
+	REQUIRE(ring.size() == 8);
+	REQUIRE(ring.push(in.data(), 1) == 0);
+
+	std::vector<int> out(10, -1);
+	REQUIRE(ring.pop(out.data(), 3) == 3);
+	REQUIRE(out[0] == 0);
+	REQUIRE(out[2] == 2);
+
+	// wraps around
+	REQUIRE(ring.push(in.data() + 8, 2) == 2);
+	REQUIRE(ring.pop(out.data(), out.size()) == 7);
+	REQUIRE(out[0] == 3);
+	REQUIRE(out[4] == 7);
+	REQUIRE(out[5] == 8);
+	REQUIRE(out[6] == 9);
+	REQUIRE(ring.size() == 0);
+	REQUIRE(ring.pop(out.data(), out.size()) == 0);
+}
+
+TEST_CASE("TestSpscRing_threads",
+		  "[videocapture][SpscRing]") {
+	SpscRing<int> ring(64);
+	const int count = 100000;
+	std::thread producer([&ring]() {
+		int next = 0;
+		while( next < count ) {
+			int block[7];
+			int n = 0;
+			while( n < 7 && next + n < count ) {
+				block[n] = next + n;
+				n++;
+			}
+			next += static_cast<int>(ring.push(block, n));
+		}
+	});
+	// items arrive complete and in order
+	int expected = 0;
+	bool fOrdered = true;
+	std::vector<int> out(13);
+	while( expected < count ) {
+		const size_t n = ring.pop(out.data(), out.size());
+		for (size_t i = 0; i < n; i++) {
+			fOrdered = fOrdered && out[i] == expected;
+			expected++;
+		}
+	}
+	producer.join();
+	REQUIRE(fOrdered);
+	REQUIRE(ring.size() == 0);
+}